@@ -0,0 +1,504 @@
+#include "configParser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+
+#ifdef ESP_PLATFORM
+    #include <esp_log.h>
+    #include "ClassLogFile.h"
+
+    static const char *TAG = "CONFIGPARSER";
+#endif
+
+#define CONFIGPARSER_MAX_NUMBER_LEN 32
+
+
+static inline bool isBlank(char c)
+{
+    return (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == 11);
+}
+
+
+static inline bool isDelimiter(char c)          // Delimiters of ZerlegeZeile(line, " =")
+{
+    return isBlank(c) || (c == '=');
+}
+
+
+static ConfigToken makeToken(const char *_start, const char *_end)
+{
+    ConfigToken token;
+    token.str = _start;
+    token.len = _end - _start;
+    return token;
+}
+
+
+/* Returns the part of [_start, _end) without leading and trailing blanks */
+static ConfigToken trimToken(const char *_start, const char *_end)
+{
+    while ((_start < _end) && isBlank(*_start)) {
+        _start++;
+    }
+    while ((_end > _start) && isBlank(*(_end - 1))) {
+        _end--;
+    }
+    return makeToken(_start, _end);
+}
+
+
+bool ConfigToken::equalsIgnoreCase(const char *_other) const
+{
+    int i = 0;
+    for (; i < (int)len; ++i) {
+        if ((_other[i] == '\0') || (toupper((unsigned char)str[i]) != toupper((unsigned char)_other[i]))) {
+            return false;
+        }
+    }
+    return (_other[i] == '\0');
+}
+
+
+uint32_t ConfigKeyHash(const char *_str, int _len)
+{
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < _len; ++i) {
+        hash ^= (uint8_t)toupper((unsigned char)_str[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+/*******************************************************************
+ * ConfigEntry
+ *******************************************************************/
+int ConfigEntry::valueCount() const
+{
+    if (rawValue) {
+        return 1;
+    }
+
+    int count = 0;
+    const char *p = rest.str;
+    const char *end = rest.str + rest.len;
+
+    while (p < end) {
+        while ((p < end) && isDelimiter(*p)) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+        count++;
+        while ((p < end) && !isDelimiter(*p)) {
+            p++;
+        }
+    }
+
+    return count;
+}
+
+
+ConfigToken ConfigEntry::value(int _index) const
+{
+    if (rawValue) {
+        return (_index == 0) ? rest : ConfigToken();
+    }
+
+    const char *p = rest.str;
+    const char *end = rest.str + rest.len;
+
+    while (p < end) {
+        while ((p < end) && isDelimiter(*p)) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+
+        const char *start = p;
+        while ((p < end) && !isDelimiter(*p)) {
+            p++;
+        }
+
+        if (_index-- == 0) {
+            return makeToken(start, p);
+        }
+    }
+
+    return ConfigToken();
+}
+
+
+bool ConfigEntry::isNumeric(int _index) const
+{
+    ConfigToken v = value(_index);
+    int start = 0;
+    bool hasPoint = false;
+
+    if (v.empty()) {
+        return false;
+    }
+
+    if (v.str[0] == '-') {
+        start = 1;
+    }
+
+    for (int i = start; i < (int)v.len; ++i) {
+        if (((v.str[i] == '.') || (v.str[i] == ',')) && (i > 0) && !hasPoint) {
+            hasPoint = true;
+        }
+        else if (!isdigit((unsigned char)v.str[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool ConfigEntry::asBool(int _index) const
+{
+    ConfigToken v = value(_index);
+
+    if (v.equalsIgnoreCase("true")) {
+        return true;
+    }
+
+    if (isNumeric(_index)) {
+        return (asInt(_index) != 0);
+    }
+
+    return false;
+}
+
+
+int ConfigEntry::asInt(int _index) const
+{
+    ConfigToken v = value(_index);
+    char number[CONFIGPARSER_MAX_NUMBER_LEN];
+    int len = std::min((int)v.len, CONFIGPARSER_MAX_NUMBER_LEN - 1);
+
+    memcpy(number, v.str, len);
+    number[len] = '\0';
+    return atoi(number);
+}
+
+
+float ConfigEntry::asFloat(int _index) const
+{
+    ConfigToken v = value(_index);
+    char number[CONFIGPARSER_MAX_NUMBER_LEN];
+    int len = std::min((int)v.len, CONFIGPARSER_MAX_NUMBER_LEN - 1);
+
+    for (int i = 0; i < len; ++i) {
+        number[i] = (v.str[i] == ',') ? '.' : v.str[i];     // Comma is accepted as decimal separator
+    }
+    number[len] = '\0';
+    return strtof(number, NULL);
+}
+
+
+/*******************************************************************
+ * ConfigSection
+ *******************************************************************/
+bool ConfigSection::isNamed(const char *_name) const
+{
+    ConfigToken plain = name;
+    if (disabled) {
+        plain.str++;
+        plain.len--;
+    }
+    return plain.equalsIgnoreCase(_name);
+}
+
+
+/*******************************************************************
+ * ConfigParamTable
+ *******************************************************************/
+void ConfigParamTable::add(const char *_key, Setter _setter)
+{
+    Param param;
+    param.hash = ConfigKeyHash(_key, strlen(_key));
+    param.key = _key;
+    param.setter = _setter;
+    params.push_back(param);
+    sorted = false;
+}
+
+
+void ConfigParamTable::setDefault(Setter _setter)
+{
+    defaultSetter = _setter;
+}
+
+
+void ConfigParamTable::setNumberPrefix(bool _prefixed)
+{
+    numberPrefix = _prefixed;
+}
+
+
+void ConfigParamTable::addBool(const char *_key, bool *_target)
+{
+    add(_key, [_target](const ConfigEntry &_entry) { *_target = _entry.asBool(); });
+}
+
+
+void ConfigParamTable::addInt(const char *_key, int *_target)
+{
+    add(_key, [_target](const ConfigEntry &_entry) {
+        if (_entry.isNumeric()) {
+            *_target = _entry.asInt();
+        }
+    });
+}
+
+
+void ConfigParamTable::addFloat(const char *_key, float *_target)
+{
+    add(_key, [_target](const ConfigEntry &_entry) {
+        if (_entry.isNumeric()) {
+            *_target = _entry.asFloat();
+        }
+    });
+}
+
+
+void ConfigParamTable::addString(const char *_key, std::string *_target)
+{
+    add(_key, [_target](const ConfigEntry &_entry) { *_target = _entry.asString(); });
+}
+
+
+const ConfigParamTable::Param *ConfigParamTable::find(const ConfigToken &_key)
+{
+    if (!sorted) {
+        std::sort(params.begin(), params.end(), [](const Param &a, const Param &b) { return a.hash < b.hash; });
+        sorted = true;
+    }
+
+    uint32_t hash = ConfigKeyHash(_key.str, _key.len);
+    auto it = std::lower_bound(params.begin(), params.end(), hash, [](const Param &p, uint32_t h) { return p.hash < h; });
+
+    for (; (it != params.end()) && (it->hash == hash); ++it) {
+        if (_key.equalsIgnoreCase(it->key)) {       // Guard against hash collisions
+            return &(*it);
+        }
+    }
+
+    return NULL;
+}
+
+
+int ConfigParamTable::apply(const ConfigSection &_section)
+{
+    int handled = 0;
+
+    for (const ConfigEntry &entry : _section.entries) {
+        // Like before, a key without value is ignored
+        if (entry.valueCount() == 0) {
+            continue;
+        }
+
+        ConfigToken key = entry.key;
+        if (numberPrefix) {
+            const char *dot = (const char*)memchr(key.str, '.', key.len);
+            if (dot) {
+                key.len -= (dot + 1) - key.str;
+                key.str = dot + 1;
+            }
+        }
+
+        const Param *param = find(key);
+        if (param) {
+            param->setter(entry);
+            handled++;
+        }
+        else if (defaultSetter) {
+            defaultSetter(entry);
+            handled++;
+        }
+    }
+
+    return handled;
+}
+
+
+/*******************************************************************
+ * ConfigParser
+ *******************************************************************/
+ConfigParser::ConfigParser()
+{
+    buffer = NULL;
+    bufferSize = 0;
+}
+
+
+ConfigParser::~ConfigParser()
+{
+    FreeBuffer();
+}
+
+
+void ConfigParser::FreeBuffer(void)
+{
+    if (buffer) {
+        free(buffer);
+        buffer = NULL;
+    }
+    bufferSize = 0;
+    sections.clear();
+}
+
+
+bool ConfigParser::Load(std::string _filePath)
+{
+    FreeBuffer();
+
+    FILE *pFile = fopen(_filePath.c_str(), "r");
+    if (pFile == NULL) {
+#ifdef ESP_PLATFORM
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to open " + _filePath);
+#endif
+        return false;
+    }
+
+    fseek(pFile, 0, SEEK_END);
+    long size = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    if (size < 0) {
+        fclose(pFile);
+        return false;
+    }
+
+    buffer = (char*)malloc(size + 1);
+    if (buffer == NULL) {
+#ifdef ESP_PLATFORM
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Not enough memory to load " + _filePath);
+#endif
+        fclose(pFile);
+        return false;
+    }
+
+    bufferSize = fread(buffer, 1, size, pFile);
+    buffer[bufferSize] = '\0';
+    fclose(pFile);
+
+    Tokenize();
+    return true;
+}
+
+
+bool ConfigParser::Parse(const char *_text, size_t _len)
+{
+    FreeBuffer();
+
+    buffer = (char*)malloc(_len + 1);
+    if (buffer == NULL) {
+        return false;
+    }
+
+    memcpy(buffer, _text, _len);
+    buffer[_len] = '\0';
+    bufferSize = _len;
+
+    Tokenize();
+    return true;
+}
+
+
+void ConfigParser::Tokenize(void)
+{
+    const char *p = buffer;
+    const char *end = buffer + bufferSize;
+    ConfigSection *section = NULL;
+
+    while (p < end) {
+        const char *lineStart = p;
+        const char *lineEnd = (const char*)memchr(p, '\n', end - p);
+        if (lineEnd == NULL) {
+            lineEnd = end;
+        }
+        p = (lineEnd < end) ? lineEnd + 1 : end;
+
+        ConfigToken line = trimToken(lineStart, lineEnd);
+        if (line.empty()) {
+            continue;
+        }
+
+        // Section header, disabled sections start with ";["
+        if ((line.str[0] == '[') || ((line.len > 1) && (line.str[0] == ';') && (line.str[1] == '['))) {
+            if (section) {
+                section->body.len = lineStart - section->body.str;
+            }
+
+            sections.emplace_back();
+            section = &sections.back();
+            section->name = line;
+            section->disabled = (line.str[0] == ';');
+            section->body.str = p;
+            continue;
+        }
+
+        // Comments and disabled parameters
+        if ((line.str[0] == ';') || (line.str[0] == '#') || (section == NULL)) {
+            continue;
+        }
+
+        ConfigEntry entry;
+        const char *s = line.str;
+        const char *e = line.str + line.len;
+
+        // Passwords and tokens may contain blanks and '=', only the first '=' separates key and value
+        bool raw = false;
+        for (const char *c = s; (c + 5 <= e) && !raw; ++c) {
+            raw = ((c + 8 <= e) && (memcmp(c, "password", 8) == 0)) || (memcmp(c, "Token", 5) == 0);
+        }
+
+        if (raw) {
+            const char *eq = (const char*)memchr(s, '=', e - s);
+            entry.rawValue = true;
+            entry.key = trimToken(s, eq ? eq : e);
+            entry.rest = eq ? trimToken(eq + 1, e) : makeToken(e, e);
+        }
+        else {
+            const char *k = s;
+            while ((k < e) && !isDelimiter(*k)) {
+                k++;
+            }
+            entry.key = makeToken(s, k);
+
+            while ((k < e) && isDelimiter(*k)) {
+                k++;
+            }
+            entry.rest = makeToken(k, e);
+        }
+
+        section->entries.push_back(entry);
+    }
+
+    if (section) {
+        section->body.len = end - section->body.str;
+    }
+
+#ifdef ESP_PLATFORM
+    ESP_LOGD(TAG, "Parsed %d sections from %d bytes", (int)sections.size(), (int)bufferSize);
+#endif
+}
+
+
+ConfigSection *ConfigParser::getSection(const char *_name)
+{
+    for (auto &section : sections) {
+        if (!section.disabled && section.name.equalsIgnoreCase(_name)) {
+            return &section;
+        }
+    }
+    return NULL;
+}
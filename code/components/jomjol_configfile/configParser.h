@@ -0,0 +1,105 @@
+#pragma once
+
+#ifndef CONFIGPARSER_H
+#define CONFIGPARSER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+/* Single pass reader for config.ini
+ * The file gets read with one fread() into a buffer and tokenized into sections and key/value
+ * entries which only point into this buffer, so there is no allocation per line. The entries of a
+ * section get dispatched through a ConfigParamTable (key hash -> typed setter). */
+
+// Non-owning reference to a part of the buffer
+struct ConfigToken {
+    const char *str = NULL;
+    size_t len = 0;
+
+    bool empty() const { return len == 0; }
+    bool equalsIgnoreCase(const char *_other) const;
+    std::string toString() const { return std::string(str, len); }
+};
+
+
+struct ConfigEntry {
+    ConfigToken key;
+    ConfigToken rest;       // Everything behind the key and its delimiters, e.g. "main.dig1 28 144 55 100 false" -> "28 144 55 100 false"
+    bool rawValue = false;  // Value may contain blanks and '=' (password, token), it does not get split
+
+    int valueCount() const;
+    ConfigToken value(int _index = 0) const;    // Same splitting as ZerlegeZeile(line, " =")
+
+    bool asBool(int _index = 0) const;          // Same as alphanumericToBoolean()
+    bool isNumeric(int _index = 0) const;       // Same as isStringNumeric()
+    int asInt(int _index = 0) const;
+    float asFloat(int _index = 0) const;
+    std::string asString(int _index = 0) const { return value(_index).toString(); }
+};
+
+
+struct ConfigSection {
+    ConfigToken name;               // e.g. "[MQTT]", disabled sections start with ';'
+    bool disabled = false;
+    ConfigToken body;               // Raw text of the section without the header line
+    std::vector<ConfigEntry> entries;
+
+    bool isNamed(const char *_name) const;      // Also true for the disabled section, e.g. ";[Analog]" is "[Analog]"
+};
+
+
+uint32_t ConfigKeyHash(const char *_str, int _len);     // Case insensitive FNV-1a
+
+
+class ConfigParamTable {
+public:
+    typedef std::function<void(const ConfigEntry &_entry)> Setter;
+
+    void addBool(const char *_key, bool *_target);
+    void addInt(const char *_key, int *_target);
+    void addFloat(const char *_key, float *_target);
+    void addString(const char *_key, std::string *_target);
+    void add(const char *_key, Setter _setter);
+    void setDefault(Setter _setter);                    // Entries without own key, e.g. the ROIs "main.dig1 28 144 55 100"
+    void setNumberPrefix(bool _prefixed);               // Keys are "<number>.<param>", only <param> gets looked up
+
+    int apply(const ConfigSection &_section);           // Returns the number of handled entries
+
+private:
+    struct Param {
+        uint32_t hash;
+        const char *key;
+        Setter setter;
+    };
+    std::vector<Param> params;
+    bool sorted = false;
+    Setter defaultSetter;
+    bool numberPrefix = false;
+
+    const Param *find(const ConfigToken &_key);
+};
+
+
+class ConfigParser {
+public:
+    ConfigParser();
+    ~ConfigParser();
+
+    bool Load(std::string _filePath);
+    bool Parse(const char *_text, size_t _len);         // Parses a copy of _text
+
+    std::vector<ConfigSection> &getSections() { return sections; }
+    ConfigSection *getSection(const char *_name);       // First enabled section with this name, e.g. "[System]"
+
+private:
+    char *buffer;
+    size_t bufferSize;
+    std::vector<ConfigSection> sections;
+
+    void Tokenize(void);
+    void FreeBuffer(void);
+};
+
+#endif //CONFIGPARSER_H
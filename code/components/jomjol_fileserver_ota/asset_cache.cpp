@@ -0,0 +1,200 @@
+#include "asset_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "md5.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "psram.h"
+#include "ClassLogFile.h"
+
+static const char *TAG = "ASSET_CACHE";
+#else
+#include <chrono>
+#endif
+
+
+static time_t asset_cache_uptime(void)
+{
+#ifdef ESP_PLATFORM
+    return (time_t)(esp_timer_get_time() / 1000000);
+#else
+    return (time_t)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+CachedAsset::~CachedAsset()
+{
+    if (data != NULL) {
+#ifdef ESP_PLATFORM
+        free_psram_heap("AssetCache", data);
+#else
+        free(data);
+#endif
+    }
+}
+
+
+AssetCache::AssetCache(size_t _maxBytes, size_t _maxFileSize, int _revalidateS)
+    : maxBytes(_maxBytes), maxFileSize(_maxFileSize), revalidateS(_revalidateS)
+{
+}
+
+
+void AssetCache::remove(std::list<std::shared_ptr<CachedAsset>>::iterator _it)
+{
+    usedBytes -= (*_it)->size;
+    index.erase((*_it)->key);
+    lru.erase(_it);
+}
+
+
+std::shared_ptr<const CachedAsset> AssetCache::get(const std::string &_key)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto found = index.find(_key);
+    if (found == index.end()) {
+        misses++;
+        return NULL;
+    }
+
+    auto it = found->second;
+    std::shared_ptr<CachedAsset> asset = *it;
+
+    time_t now = asset_cache_uptime();
+    if (now - asset->validated >= revalidateS) {
+        struct stat file_stat;
+        if ((stat(asset->file.c_str(), &file_stat) != 0) || (file_stat.st_mtime != asset->mtime) ||
+            ((size_t)file_stat.st_size != asset->size)) {
+            remove(it);
+            misses++;
+            return NULL;
+        }
+        asset->validated = now;
+    }
+
+    lru.splice(lru.begin(), lru, it);
+    hits++;
+    return asset;
+}
+
+
+std::shared_ptr<const CachedAsset> AssetCache::load(const std::string &_key, const std::string &_file, bool _gzip)
+{
+    struct stat file_stat;
+    if ((stat(_file.c_str(), &file_stat) != 0) || ((size_t)file_stat.st_size > maxFileSize) ||
+        ((size_t)file_stat.st_size > maxBytes)) {
+        return NULL;
+    }
+
+    std::shared_ptr<CachedAsset> asset = std::make_shared<CachedAsset>();
+    asset->key = _key;
+    asset->file = _file;
+    asset->gzip = _gzip;
+    asset->mtime = file_stat.st_mtime;
+    asset->size = file_stat.st_size;
+    asset->validated = asset_cache_uptime();
+
+#ifdef ESP_PLATFORM
+    asset->data = (char*) malloc_psram_heap("AssetCache", asset->size + 1, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+#else
+    asset->data = (char*) malloc(asset->size + 1);
+#endif
+    if (asset->data == NULL) {
+#ifdef ESP_PLATFORM
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Not enough memory to cache " + _file);
+#endif
+        return NULL;
+    }
+
+    // Read without holding the lock, hits of other requests do not wait for the SD card
+    FILE *fd = fopen(_file.c_str(), "r");
+    if (fd == NULL) {
+        return NULL;
+    }
+    size_t len = fread(asset->data, 1, asset->size + 1, fd);
+    fclose(fd);
+    if (len != asset->size) {               // Changed in the meantime
+        return NULL;
+    }
+
+    MD5Context md5;
+    md5Init(&md5);
+    md5Update(&md5, (uint8_t*) asset->data, asset->size);
+    md5Finalize(&md5);
+
+    char etag[2 + 16 + 1];
+    etag[0] = '"';
+    for (int i = 0; i < 8; ++i) {
+        snprintf(etag + 1 + 2 * i, 3, "%02x", md5.digest[i]);
+    }
+    etag[17] = '"';
+    etag[18] = '\0';
+    asset->etag = etag;
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto found = index.find(_key);
+    if (found != index.end()) {
+        remove(found->second);
+    }
+    while (!lru.empty() && (usedBytes + asset->size > maxBytes)) {
+        remove(std::prev(lru.end()));       // Least recently used
+    }
+
+    lru.push_front(asset);
+    index[_key] = lru.begin();
+    usedBytes += asset->size;
+    return asset;
+}
+
+
+void AssetCache::invalidate(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    lru.clear();
+    index.clear();
+    usedBytes = 0;
+}
+
+
+size_t AssetCache::getUsedBytes(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return usedBytes;
+}
+
+
+int AssetCache::getCount(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return lru.size();
+}
+
+
+int AssetCache::getHits(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return hits;
+}
+
+
+int AssetCache::getMisses(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return misses;
+}
+
+
+AssetCache &getAssetCache(void)
+{
+    static AssetCache cache;
+    return cache;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#ifndef ASSETCACHE_H
+#define ASSETCACHE_H
+
+#include <stddef.h>
+#include <time.h>
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "../../include/defines.h"
+
+
+/* Content of a cached file, stays valid as long as a shared_ptr to it is held (also after the eviction) */
+struct CachedAsset {
+    std::string key;
+    std::string file;           // File which got read, e.g. the .gz variant
+    bool gzip = false;
+    time_t mtime = 0;
+    size_t size = 0;
+    std::string etag;           // Quoted, computed from the content when it got loaded
+    char *data = NULL;
+    time_t validated = 0;       // Last check against the SD card (uptime in s)
+
+    CachedAsset() = default;
+    CachedAsset(const CachedAsset&) = delete;
+    CachedAsset& operator=(const CachedAsset&) = delete;
+    ~CachedAsset();
+};
+
+
+/**
+ * @brief LRU cache (PSRAM) for the static files of the web UI.
+ *
+ * The entries are keyed by the request (path and whether the client accepts gzip) and remember the mtime and the
+ * size of the file which got read. A hit is served without touching the SD card, every revalidateS seconds the
+ * entry gets compared with the file (stat) and dropped if it changed. The file server drops everything with
+ * invalidate() when it changes files, so uploads and OTA updates are visible right away.
+ */
+class AssetCache {
+public:
+    AssetCache(size_t _maxBytes = ASSET_CACHE_SIZE, size_t _maxFileSize = ASSET_CACHE_MAX_FILE_SIZE,
+               int _revalidateS = ASSET_CACHE_REVALIDATE_S);
+
+    AssetCache(const AssetCache&) = delete;
+    AssetCache& operator=(const AssetCache&) = delete;
+
+    // Cached content for _key, NULL if it is not cached (anymore)
+    std::shared_ptr<const CachedAsset> get(const std::string &_key);
+
+    // Reads _file into the cache under _key, NULL if it is too large, no memory is left or it can not be read
+    std::shared_ptr<const CachedAsset> load(const std::string &_key, const std::string &_file, bool _gzip);
+
+    void invalidate(void);
+
+    size_t getUsedBytes(void);
+    int getCount(void);
+    int getHits(void);
+    int getMisses(void);
+
+private:
+    size_t maxBytes;
+    size_t maxFileSize;
+    int revalidateS;
+
+    std::mutex lock;                        // Everything below
+    std::list<std::shared_ptr<CachedAsset>> lru;    // Most recently used first
+    std::unordered_map<std::string, std::list<std::shared_ptr<CachedAsset>>::iterator> index;
+    size_t usedBytes = 0;
+    int hits = 0;
+    int misses = 0;
+
+    void remove(std::list<std::shared_ptr<CachedAsset>>::iterator _it);
+};
+
+
+AssetCache &getAssetCache(void);
+
+#endif //ASSETCACHE_H
@@ -0,0 +1,158 @@
+#include "delete_job.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <dirent.h>
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef ESP_PLATFORM
+#include "ClassLogFile.h"
+
+static const char *TAG = "DELETE_JOB";
+#endif
+
+
+DeleteJob::~DeleteJob()
+{
+    wait();
+#ifndef ESP_PLATFORM
+    if (worker.joinable()) {
+        worker.join();
+    }
+#endif
+}
+
+
+DeleteJobStart DeleteJob::start(const std::string &_directory, std::function<void()> _finished)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (status.state == DELETE_JOB_RUNNING) {
+        return DELETE_JOB_BUSY;
+    }
+
+    status = DeleteJobStatus();
+    status.state = DELETE_JOB_RUNNING;
+    status.directory = _directory;
+    finished = _finished;
+
+#ifdef ESP_PLATFORM
+    BaseType_t xReturned = xTaskCreate(&task_delete_job, "delete_job", DELETE_JOB_TASK_STACKSIZE, this,
+                                       DELETE_JOB_TASK_PRIORITY, NULL);
+    if (xReturned != pdPASS) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to create task, " + _directory + " does not get deleted");
+        status.state = DELETE_JOB_FAILED;
+        return DELETE_JOB_NO_TASK;
+    }
+#else
+    if (worker.joinable()) {
+        worker.join();
+    }
+    worker = std::thread([this]() { run(); });
+#endif
+    return DELETE_JOB_STARTED;
+}
+
+
+void DeleteJob::run(void)
+{
+    std::string directory;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        directory = status.directory;
+    }
+
+    DIR *dir = opendir(directory.c_str());
+    int deleted = 0;
+    int failed = 0;
+
+    if (dir) {
+        struct dirent *entry;
+        std::string filename;
+
+        while ((entry = readdir(dir)) != NULL) {
+            if ((entry->d_type == DT_DIR) || (strcmp("wlan.ini", entry->d_name) == 0)) {    // wlan.ini shall not be touched
+                continue;
+            }
+
+            filename = directory + "/" + entry->d_name;
+            if (unlink(filename.c_str()) == 0) {
+                deleted++;
+            }
+            else {
+                failed++;
+            }
+
+            std::lock_guard<std::mutex> guard(lock);
+            status.deleted = deleted;
+            status.failed = failed;
+        }
+        closedir(dir);
+    }
+
+#ifdef ESP_PLATFORM
+    if (dir) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Deleted " + std::to_string(deleted) + " files in " + directory +
+                            ((failed > 0) ? " (" + std::to_string(failed) + " failed)" : ""));
+    }
+    else {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to open dir: " + directory);
+    }
+#endif
+
+    if (finished) {
+        finished();
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        status.state = dir ? DELETE_JOB_DONE : DELETE_JOB_FAILED;
+    }
+    changed.notify_all();
+}
+
+
+#ifdef ESP_PLATFORM
+void DeleteJob::task_delete_job(void *_job)
+{
+    ((DeleteJob*) _job)->run();
+    vTaskDelete(NULL);
+}
+#endif
+
+
+DeleteJobStatus DeleteJob::getStatus(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return status;
+}
+
+
+std::string DeleteJob::getStatusJson(void)
+{
+    static const char *states[] = { "idle", "running", "done", "failed" };
+    DeleteJobStatus current = getStatus();
+
+    return "{\"state\":\"" + std::string(states[current.state]) + "\",\"directory\":\"" + current.directory +
+           "\",\"deleted\":" + std::to_string(current.deleted) + ",\"failed\":" + std::to_string(current.failed) + "}";
+}
+
+
+void DeleteJob::wait(void)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [&] { return status.state != DELETE_JOB_RUNNING; });
+}
+
+
+DeleteJob &getDeleteJob(void)
+{
+    static DeleteJob job;
+    return job;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef DELETEJOB_H
+#define DELETEJOB_H
+
+#include <string>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <thread>
+#endif
+
+#include "../../include/defines.h"
+
+
+enum DeleteJobState {
+    DELETE_JOB_IDLE,
+    DELETE_JOB_RUNNING,
+    DELETE_JOB_DONE,
+    DELETE_JOB_FAILED           // Directory could not be opened
+};
+
+
+enum DeleteJobStart {
+    DELETE_JOB_STARTED,
+    DELETE_JOB_BUSY,            // Another job is still running
+    DELETE_JOB_NO_TASK          // The task could not be created
+};
+
+
+struct DeleteJobStatus {
+    DeleteJobState state = DELETE_JOB_IDLE;
+    std::string directory;
+    int deleted = 0;
+    int failed = 0;
+};
+
+
+/**
+ * @brief Deletes all files of a directory (e.g. months of logged images) in a task of its own,
+ *        so the HTTP server does not block meanwhile. One job at a time, the progress is available with getStatus().
+ */
+class DeleteJob {
+public:
+    DeleteJob() = default;
+    ~DeleteJob();
+
+    DeleteJob(const DeleteJob&) = delete;
+    DeleteJob& operator=(const DeleteJob&) = delete;
+
+    // Subfolders and wlan.ini are kept, _finished gets called in the task when done
+    DeleteJobStart start(const std::string &_directory, std::function<void()> _finished = nullptr);
+
+    DeleteJobStatus getStatus(void);
+    std::string getStatusJson(void);
+
+    // Blocks until the running job (if any) is done
+    void wait(void);
+
+private:
+    std::mutex lock;                        // Everything below
+    std::condition_variable changed;
+    DeleteJobStatus status;
+    std::function<void()> finished;
+
+#ifdef ESP_PLATFORM
+    static void task_delete_job(void *_job);
+#else
+    std::thread worker;
+#endif
+
+    void run(void);
+};
+
+
+DeleteJob &getDeleteJob(void);
+
+#endif //DELETEJOB_H
@@ -0,0 +1,173 @@
+#include "dir_listing.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <dirent.h>
+#ifdef __cplusplus
+}
+#endif
+
+
+ResponseBuffer::ResponseBuffer(FileStreamSink _sink, size_t _flushSize) : sink(_sink), flushSize(_flushSize)
+{
+    buffer.reserve(_flushSize + 256);
+}
+
+
+void ResponseBuffer::flushIfFull(void)
+{
+    if (buffer.size() >= flushSize) {
+        flush();
+    }
+}
+
+
+void ResponseBuffer::append(const char *_text)
+{
+    buffer.append(_text);
+    flushIfFull();
+}
+
+
+void ResponseBuffer::appendHtml(const char *_text)
+{
+    for (const char *c = _text; *c != '\0'; ++c) {
+        switch (*c) {
+            case '&': buffer.append("&amp;"); break;
+            case '<': buffer.append("&lt;"); break;
+            case '>': buffer.append("&gt;"); break;
+            case '"': buffer.append("&quot;"); break;
+            default: buffer.push_back(*c);
+        }
+    }
+    flushIfFull();
+}
+
+
+void ResponseBuffer::appendJson(const char *_text)
+{
+    char escaped[8];
+
+    for (const char *c = _text; *c != '\0'; ++c) {
+        if ((*c == '"') || (*c == '\\')) {
+            buffer.push_back('\\');
+            buffer.push_back(*c);
+        }
+        else if ((uint8_t)*c < 0x20) {
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (uint8_t)*c);
+            buffer.append(escaped);
+        }
+        else {
+            buffer.push_back(*c);
+        }
+    }
+    flushIfFull();
+}
+
+
+bool ResponseBuffer::flush(void)
+{
+    if (!failed && !buffer.empty()) {
+        failed = !sink(buffer.data(), buffer.size());
+    }
+    buffer.clear();
+    return !failed;
+}
+
+
+int for_each_dir_entry(const std::string &_directory, size_t _offset, size_t _limit, DirEntryCallback _callback)
+{
+    DIR *pdir = opendir(_directory.c_str());
+    if (!pdir) {
+        return -1;
+    }
+
+    std::string entrypath = _directory;
+    if (entrypath.empty() || (entrypath.back() != '/')) {
+        entrypath += "/";
+    }
+    const size_t dirpath_len = entrypath.length();
+
+    struct dirent *entry;
+    struct stat entry_stat;
+    size_t index = 0;
+    bool listing = true;
+
+    while ((entry = readdir(pdir)) != NULL) {
+        if (strcmp("wlan.ini", entry->d_name) == 0) {       // wlan.ini shall not be shown
+            continue;
+        }
+
+        if (listing && (index >= _offset) && (index - _offset < _limit)) {
+            DirEntry dirEntry = { entry->d_name, entry->d_type == DT_DIR, -1 };
+
+            bool found = true;
+            if (!dirEntry.isDir) {
+                entrypath.resize(dirpath_len);
+                entrypath += entry->d_name;
+                found = (stat(entrypath.c_str(), &entry_stat) == 0);
+                dirEntry.size = found ? entry_stat.st_size : -1;
+            }
+            if (found) {
+                listing = _callback(dirEntry);
+            }
+        }
+        index++;
+    }
+
+    closedir(pdir);
+    return index;
+}
+
+
+void dir_listing_html_row(ResponseBuffer &_out, const char *_uripath, const DirEntry &_entry, bool _readonly)
+{
+    char entrysize[24];
+
+    if (_entry.isDir) {
+        strcpy(entrysize, "-");
+    }
+    else if (_entry.size >= 1024) {
+        snprintf(entrysize, sizeof(entrysize), "%ld KiB", _entry.size / 1024); // kBytes
+    }
+    else {
+        snprintf(entrysize, sizeof(entrysize), "%ld B", _entry.size); // Bytes
+    }
+
+    _out.append("<tr><td><a href=\"/fileserver");
+    _out.appendHtml(_uripath);
+    _out.appendHtml(_entry.name);
+    _out.append(_entry.isDir ? "/\">" : "\">");
+    _out.appendHtml(_entry.name);
+    _out.append("</a></td><td>");
+    _out.append(_entry.isDir ? "directory" : "file");
+    _out.append("</td><td>");
+    _out.append(entrysize);
+
+    if (!_readonly) {
+        _out.append("</td><td><form method=\"post\" action=\"/delete");
+        _out.appendHtml(_uripath);
+        _out.appendHtml(_entry.name);
+        _out.append("\"><button type=\"submit\">Delete</button></form>");
+    }
+
+    _out.append("</td></tr>\n");
+}
+
+
+void dir_listing_json_entry(ResponseBuffer &_out, const DirEntry &_entry, bool _first)
+{
+    _out.append(_first ? "{\"name\":\"" : ",{\"name\":\"");
+    _out.appendJson(_entry.name);
+    if (_entry.isDir) {
+        _out.append("\",\"type\":\"directory\"}");
+    }
+    else {
+        _out.append("\",\"type\":\"file\",\"size\":" + std::to_string(_entry.size) + "}");
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#ifndef DIRLISTING_H
+#define DIRLISTING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <functional>
+
+#include "file_stream.h"
+#include "../../include/defines.h"
+
+
+/**
+ * @brief Collects a generated response and hands it to the sink in pieces of about _flushSize bytes,
+ *        instead of one HTTP chunk per HTML fragment.
+ */
+class ResponseBuffer {
+public:
+    ResponseBuffer(FileStreamSink _sink, size_t _flushSize = DIR_LISTING_FLUSH_SIZE);
+
+    void append(const char *_text);
+    void append(const std::string &_text) { append(_text.c_str()); };
+    void appendHtml(const char *_text);     // Escapes &, <, > and "
+    void appendJson(const char *_text);     // Escapes for a JSON string (without the quotes)
+
+    // Sends what is buffered, false if the sink failed (now or before)
+    bool flush(void);
+
+    bool ok(void) { return !failed; };
+
+private:
+    FileStreamSink sink;
+    size_t flushSize;
+    std::string buffer;
+    bool failed = false;
+
+    void flushIfFull(void);
+};
+
+
+struct DirEntry {
+    const char *name;
+    bool isDir;
+    long size;                  // Bytes, -1 for directories
+};
+
+typedef std::function<bool(const DirEntry &_entry)> DirEntryCallback;     // false stops the listing
+
+/**
+ * @brief Calls _callback for the entries _offset ... _offset + _limit - 1 of _directory (wlan.ini is hidden).
+ *        Only those get a stat (files only, for the size), the others are just counted.
+ *
+ * @return Number of all entries, -1 if the directory can not be opened
+ */
+int for_each_dir_entry(const std::string &_directory, size_t _offset, size_t _limit, DirEntryCallback _callback);
+
+// Table row of the file server page
+void dir_listing_html_row(ResponseBuffer &_out, const char *_uripath, const DirEntry &_entry, bool _readonly);
+
+// Object of the "entries" array of the JSON listing
+void dir_listing_json_entry(ResponseBuffer &_out, const DirEntry &_entry, bool _first);
+
+#endif //DIRLISTING_H
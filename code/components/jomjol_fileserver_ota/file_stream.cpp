@@ -0,0 +1,210 @@
+#include "file_stream.h"
+
+#include <stdlib.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#include "psram.h"
+#include "ClassLogFile.h"
+
+static const char *TAG = "FILE_STREAM";
+#endif
+
+
+FileStreamer::FileStreamer(size_t _bufferSize) : bufferSize(_bufferSize)
+{
+}
+
+
+FileStreamer::~FileStreamer()
+{
+    for (int i = 0; (i < 2) && (buffers[i] != NULL); ++i) {
+#ifdef ESP_PLATFORM
+        free_psram_heap("FileStream", buffers[i]);
+#else
+        free(buffers[i]);
+#endif
+    }
+}
+
+
+bool FileStreamer::allocate(void)
+{
+    for (int i = 0; i < 2; ++i) {
+        if (buffers[i] == NULL) {
+#ifdef ESP_PLATFORM
+            buffers[i] = (char*) malloc_psram_heap("FileStream", bufferSize, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+#else
+            buffers[i] = (char*) malloc(bufferSize);
+#endif
+        }
+        if (buffers[i] == NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void FileStreamer::readLoop(void)
+{
+    for (int i = 1; ; i ^= 1) {             // Buffer 0 got filled by send()
+        {
+            std::unique_lock<std::mutex> lock(slotLock);
+            slotChanged.wait(lock, [&] { return !slotFull[i] || stopReading; });
+            if (stopReading) {
+                break;
+            }
+        }
+
+        size_t len = fread(buffers[i], 1, bufferSize, file);
+        bool last = (len < bufferSize);
+
+        {
+            std::lock_guard<std::mutex> lock(slotLock);
+            slotLen[i] = len;
+            slotFull[i] = true;
+            readFailed = last && (ferror(file) != 0);
+        }
+        slotChanged.notify_all();
+
+        if (last) {
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(slotLock);
+        reading = false;
+    }
+    slotChanged.notify_all();
+}
+
+
+bool FileStreamer::send(FILE *_file, FileStreamSink _sink)
+{
+    std::lock_guard<std::mutex> transfer(transferLock);
+
+    if (!allocate()) {
+        return false;
+    }
+
+    size_t len = fread(buffers[0], 1, bufferSize, _file);
+    if (len < bufferSize) {                 // Fits into one buffer, nothing to overlap
+        return (ferror(_file) == 0) && ((len == 0) || _sink(buffers[0], len));
+    }
+
+    file = _file;
+    slotLen[0] = len;
+    slotFull[0] = true;
+    slotFull[1] = false;
+    stopReading = false;
+    readFailed = false;
+    reading = true;
+
+    if (!startReader()) {                   // Still works, just one after the other
+        reading = false;
+        bool ok = _sink(buffers[0], len);
+        while (ok && ((len = fread(buffers[0], 1, bufferSize, _file)) > 0)) {
+            ok = _sink(buffers[0], len);
+        }
+        return ok && (ferror(_file) == 0);
+    }
+
+    bool ok = true;
+    for (int i = 0; ; i ^= 1) {
+        {
+            std::unique_lock<std::mutex> lock(slotLock);
+            slotChanged.wait(lock, [&] { return slotFull[i]; });
+            len = slotLen[i];
+        }
+
+        if ((len > 0) && !_sink(buffers[i], len)) {
+            ok = false;
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(slotLock);
+            slotFull[i] = false;
+        }
+        slotChanged.notify_all();
+
+        if (len < bufferSize) {             // End of the file
+            break;
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(slotLock);
+        stopReading = true;
+        slotChanged.notify_all();
+        slotChanged.wait(lock, [&] { return !reading; });
+        ok = ok && !readFailed;
+    }
+    joinReader();
+
+    file = NULL;
+    return ok;
+}
+
+
+#ifdef ESP_PLATFORM
+
+void FileStreamer::task_file_stream_reader(void *_streamer)
+{
+    FileStreamer *streamer = (FileStreamer*) _streamer;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        streamer->readLoop();
+    }
+}
+
+
+bool FileStreamer::startReader(void)
+{
+    if (readerTask == NULL) {
+        BaseType_t xReturned = xTaskCreate(&task_file_stream_reader, "file_stream", FILE_STREAM_TASK_STACKSIZE, this,
+                                           FILE_STREAM_TASK_PRIORITY, &readerTask);
+        if (xReturned != pdPASS) {
+            readerTask = NULL;
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Failed to create reader task, files are sent without overlap");
+            return false;
+        }
+    }
+
+    xTaskNotifyGive(readerTask);
+    return true;
+}
+
+
+void FileStreamer::joinReader(void)
+{
+    // The task stays for the next transfer
+}
+
+#else // Host build
+
+bool FileStreamer::startReader(void)
+{
+    readerThread = std::thread([this]() { readLoop(); });
+    return true;
+}
+
+
+void FileStreamer::joinReader(void)
+{
+    if (readerThread.joinable()) {
+        readerThread.join();
+    }
+}
+
+#endif // ESP_PLATFORM
+
+
+FileStreamer &getFileStreamer(void)
+{
+    static FileStreamer streamer;
+    return streamer;
+}
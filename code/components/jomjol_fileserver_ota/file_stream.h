@@ -0,0 +1,77 @@
+#pragma once
+
+#ifndef FILESTREAM_H
+#define FILESTREAM_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <thread>
+#endif
+
+#include "../../include/defines.h"
+
+
+// Gets the file piece by piece (e.g. httpd_resp_send_chunk), false aborts the transfer
+typedef std::function<bool(const char *_data, size_t _len)> FileStreamSink;
+
+
+/**
+ * @brief Sends files with two buffers: a reader task fills one from the SD card while the other one gets sent.
+ *
+ * The SD card and the socket work at the same time instead of one after the other, the larger buffers
+ * (FILE_STREAM_BUFFER_SIZE) let FAT read several clusters at once. A file which fits into one buffer is
+ * sent directly without involving the reader. The sink gets the buffer itself, nothing is copied.
+ * The buffers are allocated on first use (PSRAM) and shared, transfers run one after the other.
+ */
+class FileStreamer {
+public:
+    FileStreamer(size_t _bufferSize = FILE_STREAM_BUFFER_SIZE);
+    ~FileStreamer();
+
+    FileStreamer(const FileStreamer&) = delete;
+    FileStreamer& operator=(const FileStreamer&) = delete;
+
+    // Sends the file from its current position to the end, false on a read error or if the sink failed
+    bool send(FILE *_file, FileStreamSink _sink);
+
+    size_t getBufferSize(void) { return bufferSize; };
+
+private:
+    size_t bufferSize;
+    char *buffers[2] = { NULL, NULL };
+    std::mutex transferLock;                // One transfer at a time uses the buffers
+
+    std::mutex slotLock;                    // Everything below
+    std::condition_variable slotChanged;
+    size_t slotLen[2] = { 0, 0 };
+    bool slotFull[2] = { false, false };
+    bool stopReading = false;
+    bool reading = false;
+    bool readFailed = false;
+    FILE *file = NULL;
+
+#ifdef ESP_PLATFORM
+    TaskHandle_t readerTask = NULL;
+    static void task_file_stream_reader(void *_streamer);
+#else
+    std::thread readerThread;
+#endif
+
+    bool allocate(void);
+    bool startReader(void);
+    void joinReader(void);
+    void readLoop(void);
+};
+
+
+FileStreamer &getFileStreamer(void);
+
+#endif //FILESTREAM_H
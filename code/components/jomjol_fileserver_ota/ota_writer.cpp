@@ -0,0 +1,172 @@
+#include "ota_writer.h"
+
+#include <string.h>
+#include <algorithm>
+
+#ifdef ESP_PLATFORM
+#include "esp_app_format.h"
+#include "esp_err.h"
+
+static_assert(OTA_FIRMWARE_HEADER_LEN == sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t),
+              "OTA_FIRMWARE_HEADER_LEN does not match the image format");
+#endif
+
+
+/*******************************************************************
+ * EspOtaWriter
+ *******************************************************************/
+#ifdef ESP_PLATFORM
+bool EspOtaWriter::begin(void)
+{
+    partition = esp_ota_get_next_update_partition(NULL);
+    if (partition == NULL) {
+        error = "No OTA partition found";
+        return false;
+    }
+
+    // Erases the whole partition
+    esp_err_t err = esp_ota_begin(partition, OTA_SIZE_UNKNOWN, &handle);
+    if (err != ESP_OK) {
+        error = "esp_ota_begin failed (" + std::string(esp_err_to_name(err)) + ")";
+        handle = 0;
+        return false;
+    }
+    return true;
+}
+
+
+bool EspOtaWriter::write(const void *_data, size_t _len)
+{
+    esp_err_t err = esp_ota_write(handle, _data, _len);
+    if (err != ESP_OK) {
+        error = "esp_ota_write failed (" + std::string(esp_err_to_name(err)) + ")";
+        return false;
+    }
+    return true;
+}
+
+
+bool EspOtaWriter::end(void)
+{
+    esp_err_t err = esp_ota_end(handle);       // Frees the handle also in case of an error
+    handle = 0;
+    if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
+        error = "Image validation failed, image is corrupted";
+        return false;
+    }
+    else if (err != ESP_OK) {
+        error = "esp_ota_end failed (" + std::string(esp_err_to_name(err)) + ")";
+        return false;
+    }
+
+    err = esp_ota_set_boot_partition(partition);
+    if (err != ESP_OK) {
+        error = "esp_ota_set_boot_partition failed (" + std::string(esp_err_to_name(err)) + ")";
+        return false;
+    }
+    return true;
+}
+
+
+void EspOtaWriter::abort(void)
+{
+    if (handle != 0) {
+        esp_ota_abort(handle);
+        handle = 0;
+    }
+}
+#endif
+
+
+/*******************************************************************
+ * FirmwareStream
+ *******************************************************************/
+FirmwareStream::FirmwareStream(OtaWriter *_writer, OtaHeaderCheck _headerCheck)
+    : writer(_writer), headerCheck(_headerCheck)
+{
+}
+
+
+FirmwareStream::~FirmwareStream()
+{
+    abort();
+}
+
+
+bool FirmwareStream::fail(const std::string &_error)
+{
+    abort();
+    error = _error;
+    return false;
+}
+
+
+bool FirmwareStream::write(const void *_data, size_t _len)
+{
+    const uint8_t *data = (const uint8_t*) _data;
+
+    if (failed) {
+        return false;
+    }
+    size += _len;
+
+    if (!started) {
+        size_t part = std::min(_len, (size_t)OTA_FIRMWARE_HEADER_LEN - headerLen);
+        memcpy(header + headerLen, data, part);
+        headerLen += part;
+        data += part;
+        _len -= part;
+
+        if (headerLen < OTA_FIRMWARE_HEADER_LEN) {
+            return true;
+        }
+
+        if (header[0] != OTA_FIRMWARE_MAGIC) {
+            return fail("Not a firmware image (magic byte " + std::to_string(header[0]) + ")");
+        }
+        if (headerCheck && !headerCheck(header, headerLen)) {
+            return fail("Firmware image rejected");
+        }
+
+        if (!writer->begin()) {
+            return fail(writer->getError());
+        }
+        started = true;
+
+        if (!writer->write(header, headerLen)) {
+            return fail(writer->getError());
+        }
+    }
+
+    if ((_len > 0) && !writer->write(data, _len)) {
+        return fail(writer->getError());
+    }
+    return true;
+}
+
+
+bool FirmwareStream::finish(void)
+{
+    if (failed) {
+        return false;
+    }
+    if (!started) {
+        return fail("Firmware image too short (" + std::to_string(size) + " bytes)");
+    }
+
+    started = false;                        // end() releases the writer in any case
+    if (!writer->end()) {
+        return fail(writer->getError());
+    }
+    return true;
+}
+
+
+void FirmwareStream::abort(void)
+{
+    if (started) {
+        writer->abort();
+        started = false;
+    }
+    failed = true;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#ifndef OTAWRITER_H
+#define OTAWRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <functional>
+
+
+// esp_image_header_t + esp_image_segment_header_t + esp_app_desc_t, the start of every app image
+#define OTA_FIRMWARE_HEADER_LEN     (24 + 8 + 256)
+#define OTA_FIRMWARE_MAGIC          0xE9        // ESP_IMAGE_HEADER_MAGIC
+
+
+/**
+ * @brief Target of a firmware update: the next OTA partition on the device, a file on the host (tests).
+ *
+ * begin() prepares (erases) the partition, end() validates the written image and makes it the
+ * boot partition. After abort() or a failed end() the running firmware stays active.
+ */
+class OtaWriter {
+public:
+    virtual ~OtaWriter() {};
+
+    virtual bool begin(void) = 0;
+    virtual bool write(const void *_data, size_t _len) = 0;
+    virtual bool end(void) = 0;
+    virtual void abort(void) = 0;
+
+    std::string getError(void) { return error; };
+
+protected:
+    std::string error;
+};
+
+
+#ifdef ESP_PLATFORM
+#include <esp_ota_ops.h>
+
+class EspOtaWriter : public OtaWriter {
+public:
+    bool begin(void) override;
+    bool write(const void *_data, size_t _len) override;
+    bool end(void) override;
+    void abort(void) override;
+
+private:
+    const esp_partition_t *partition = NULL;
+    esp_ota_handle_t handle = 0;
+};
+#endif
+
+
+// Gets the first OTA_FIRMWARE_HEADER_LEN bytes of the image, false rejects the firmware
+typedef std::function<bool(const uint8_t *_header, size_t _len)> OtaHeaderCheck;
+
+
+/**
+ * @brief Feeds a firmware image piece by piece into an OtaWriter.
+ *
+ * The image header is collected first and checked (magic byte, optional _headerCheck) before the
+ * writer gets started, so a wrong file never erases the OTA partition. Afterwards every piece goes
+ * straight to the writer, the image is never stored completely (SD card, RAM).
+ */
+class FirmwareStream {
+public:
+    FirmwareStream(OtaWriter *_writer, OtaHeaderCheck _headerCheck = nullptr);
+    ~FirmwareStream();
+
+    FirmwareStream(const FirmwareStream&) = delete;
+    FirmwareStream& operator=(const FirmwareStream&) = delete;
+
+    bool write(const void *_data, size_t _len);
+    bool finish(void);                      // Completes the image (OtaWriter::end)
+    void abort(void);
+
+    size_t getSize(void) { return size; };      // Bytes received so far
+    std::string getError(void) { return error; };
+
+private:
+    OtaWriter *writer;
+    OtaHeaderCheck headerCheck;
+    uint8_t header[OTA_FIRMWARE_HEADER_LEN];
+    size_t headerLen = 0;
+    size_t size = 0;
+    bool started = false;                   // writer->begin() done
+    bool failed = false;
+    std::string error;
+
+    bool fail(const std::string &_error);
+};
+
+#endif //OTAWRITER_H
@@ -10,7 +10,9 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #include <string>
+#include <memory>
 #include <sys/param.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
@@ -36,6 +38,10 @@ extern "C" {
 #include "MainFlowControl.h"
 
 #include "server_help.h"
+#include "dir_listing.h"
+#include "delete_job.h"
+#include "zip_stream.h"
+#include "image_log_store.h"
 #include "md5.h"
 #ifdef ENABLE_MQTT
     #include "interface_mqtt.h"
@@ -43,7 +49,7 @@ extern "C" {
 #include "server_GPIO.h"
 
 #include "Helper.h"
-#include "miniz.h"
+#include "zip_extract.h"
 #include "basic_auth.h"
 
 static const char *TAG = "OTA FILE";
@@ -168,19 +174,30 @@ esp_err_t get_tflite_file_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+/* Link to another page of the HTML listing */
+static void dir_listing_page_link(ResponseBuffer &_out, const char *_uripath, size_t _offset, size_t _limit, bool _readonly,
+                                  const char *_label)
+{
+    _out.append("<a href=\"/fileserver");
+    _out.appendHtml(_uripath);
+    _out.append("?offset=" + std::to_string(_offset) + "&amp;limit=" + std::to_string(_limit));
+    if (_readonly) {
+        _out.append("&amp;readonly=true");
+    }
+    _out.append("\">");
+    _out.append(_label);
+    _out.append("</a>");
+}
+
+
 /* Send HTTP response with a run-time generated html consisting of
  * a list of all files and folders under the requested path.
  * In case of SPIFFS this returns empty list when path is any
- * string other than '/', since SPIFFS doesn't support directories */
-static esp_err_t http_resp_dir_html(httpd_req_t *req, const char *dirpath, const char *uripath, bool readonly)
+ * string other than '/', since SPIFFS doesn't support directories.
+ * The page gets collected in a ResponseBuffer and sent in pieces of DIR_LISTING_FLUSH_SIZE. */
+static esp_err_t http_resp_dir_html(httpd_req_t *req, const char *dirpath, const char *uripath, bool readonly,
+                                    size_t offset, size_t limit)
 {
-    char entrypath[FILE_PATH_MAX];
-    char entrysize[16];
-    const char *entrytype;
-
-    struct dirent *entry;
-    struct stat entry_stat;
-
     char dirpath_corrected[FILE_PATH_MAX];
     strcpy(dirpath_corrected, dirpath);
 
@@ -192,136 +209,167 @@ static esp_err_t http_resp_dir_html(httpd_req_t *req, const char *dirpath, const
     }
 
     DIR *pdir = opendir(dirpath_corrected);
-
-    const size_t dirpath_len = strlen(dirpath);
-    ESP_LOGD(TAG, "Dirpath: <%s>, Pathlength: %d", dirpath, dirpath_len);
-
-    // Retrieve the base path of file storage to construct the full path
-    strlcpy(entrypath, dirpath, sizeof(entrypath));
-    ESP_LOGD(TAG, "entrypath: <%s>", entrypath);
-
     if (!pdir) {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to stat dir: " + std::string(dirpath) + "!");
         // Respond with 404 Not Found
         httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, get404());
         return ESP_FAIL;
     }
+    closedir(pdir);
+
+    ESP_LOGD(TAG, "Dirpath: <%s>, offset: %d, limit: %d", dirpath, offset, limit);
 
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
 
-    // Send HTML file header
-    httpd_resp_sendstr_chunk(req, "<!DOCTYPE html><html lang=\"en\" xml:lang=\"en\"><head>");
-    httpd_resp_sendstr_chunk(req, "<link href=\"/file_server.css\" rel=\"stylesheet\">");
-    httpd_resp_sendstr_chunk(req, "<link href=\"/firework.css\" rel=\"stylesheet\">");
-    httpd_resp_sendstr_chunk(req, "<script type=\"text/javascript\" src=\"/jquery-3.6.0.min.js\"></script>");
-    httpd_resp_sendstr_chunk(req, "<script type=\"text/javascript\" src=\"/firework.js\"></script></head>");
-
-    httpd_resp_sendstr_chunk(req, "<body>");
-
-    httpd_resp_sendstr_chunk(req, "<table class=\"fixed\" border=\"0\" width=100% style=\"font-family: arial\">");
-    httpd_resp_sendstr_chunk(req, "<tr><td style=\"vertical-align: top;width: 300px;\"><h2>Fileserver</h2></td>"
-                                  "<td rowspan=\"2\"><table border=\"0\" style=\"width:100%\"><tr><td style=\"width:80px\">"
-                                  "<label for=\"newfile\">Source</label></td><td colspan=\"2\">"
-                                  "<input id=\"newfile\" type=\"file\" onchange=\"setpath()\" style=\"width:100%;\"></td></tr>"
-                                  "<tr><td><label for=\"filepath\">Destination</label></td><td>"
-                                  "<input id=\"filepath\" type=\"text\" style=\"width:94%;\"></td><td>"
-                                  "<button id=\"upload\" type=\"button\" class=\"button\" onclick=\"upload()\">Upload</button></td></tr>"
-                                  "</table></td></tr><tr></tr><tr><td colspan=\"2\">"
-                                  "<button style=\"font-size:16px; padding: 5px 10px\" id=\"dirup\" type=\"button\" onclick=\"dirup()\""
-                                  "disabled>&#129145; Directory up</button><span style=\"padding-left:15px\" id=\"currentpath\">"
-                                  "</span></td></tr>");
-    httpd_resp_sendstr_chunk(req, "</table>");
-
-    httpd_resp_sendstr_chunk(req, "<script type=\"text/javascript\" src=\"/file_server.js\"></script>");
-    httpd_resp_sendstr_chunk(req, "<script type=\"text/javascript\">initFileServer();</script>");
+    ResponseBuffer out([req](const char *_data, size_t _len) {
+        return httpd_resp_send_chunk(req, _data, _len) == ESP_OK;
+    });
+
+    DeleteJobStatus deleteStatus = getDeleteJob().getStatus();
+    bool deleting = (deleteStatus.state == DELETE_JOB_RUNNING);
+
+    // HTML file header
+    out.append("<!DOCTYPE html><html lang=\"en\" xml:lang=\"en\"><head>");
+    if (deleting) {
+        out.append("<meta http-equiv=\"refresh\" content=\"3\">");
+    }
+    out.append("<link href=\"/file_server.css\" rel=\"stylesheet\">");
+    out.append("<link href=\"/firework.css\" rel=\"stylesheet\">");
+    out.append("<script type=\"text/javascript\" src=\"/jquery-3.6.0.min.js\"></script>");
+    out.append("<script type=\"text/javascript\" src=\"/firework.js\"></script></head>");
+
+    out.append("<body>");
+
+    out.append("<table class=\"fixed\" border=\"0\" width=100% style=\"font-family: arial\">");
+    out.append("<tr><td style=\"vertical-align: top;width: 300px;\"><h2>Fileserver</h2></td>"
+               "<td rowspan=\"2\"><table border=\"0\" style=\"width:100%\"><tr><td style=\"width:80px\">"
+               "<label for=\"newfile\">Source</label></td><td colspan=\"2\">"
+               "<input id=\"newfile\" type=\"file\" onchange=\"setpath()\" style=\"width:100%;\"></td></tr>"
+               "<tr><td><label for=\"filepath\">Destination</label></td><td>"
+               "<input id=\"filepath\" type=\"text\" style=\"width:94%;\"></td><td>"
+               "<button id=\"upload\" type=\"button\" class=\"button\" onclick=\"upload()\">Upload</button></td></tr>"
+               "</table></td></tr><tr></tr><tr><td colspan=\"2\">"
+               "<button style=\"font-size:16px; padding: 5px 10px\" id=\"dirup\" type=\"button\" onclick=\"dirup()\""
+               "disabled>&#129145; Directory up</button><span style=\"padding-left:15px\" id=\"currentpath\">"
+               "</span></td></tr>");
+    out.append("</table>");
+
+    out.append("<script type=\"text/javascript\" src=\"/file_server.js\"></script>");
+    out.append("<script type=\"text/javascript\">initFileServer();</script>");
+
+    if (deleting) {
+        out.append("<p>Deleting the files in ");
+        out.appendHtml(deleteStatus.directory.substr(strlen(server_data->base_path)).c_str());
+        out.append(" in the background: " + std::to_string(deleteStatus.deleted) + " deleted so far...</p>");
+    }
 
     std::string _zw = std::string(dirpath);
     _zw = _zw.substr(8, _zw.length() - 8);
     _zw = "/delete/" + _zw + "?task=deldircontent";
 
-    // Send file-list table definition and column labels
-    httpd_resp_sendstr_chunk(req, "<table id=\"files_table\">"
-                                  "<col width=\"800px\"><col width=\"300px\"><col width=\"300px\"><col width=\"100px\">"
-                                  "<thead><tr><th>Name</th><th>Type</th><th>Size</th>");
+    // File-list table definition and column labels
+    out.append("<table id=\"files_table\">"
+               "<col width=\"800px\"><col width=\"300px\"><col width=\"300px\"><col width=\"100px\">"
+               "<thead><tr><th>Name</th><th>Type</th><th>Size</th>");
 
     if (!readonly) {
-        httpd_resp_sendstr_chunk(req, "<th><form method=\"post\" action=\"");
-        httpd_resp_sendstr_chunk(req, _zw.c_str());
-        httpd_resp_sendstr_chunk(req, "\"><button type=\"submit\">DELETE ALL!</button></form></th></tr>");
+        out.append("<th><form method=\"post\" action=\"");
+        out.appendHtml(_zw.c_str());
+        out.append("\"><button type=\"submit\">DELETE ALL!</button></form></th></tr>");
     }
 
-    httpd_resp_sendstr_chunk(req, "</thead><tbody>\n");
+    out.append("</thead><tbody>\n");
 
-    // Iterate over all files / folders and fetch their names and sizes
-    while ((entry = readdir(pdir)) != NULL) {
-        // wlan.ini soll nicht angezeigt werden!
-        if (strcmp("wlan.ini", entry->d_name) != 0) {
-            entrytype = (entry->d_type == DT_DIR ? "directory" : "file");
+    // All files / folders with their sizes
+    int total = for_each_dir_entry(dirpath_corrected, offset, limit, [&](const DirEntry &_entry) {
+        dir_listing_html_row(out, uripath, _entry, readonly);
+        return out.ok();
+    });
 
-            strlcpy(entrypath + dirpath_len, entry->d_name, sizeof(entrypath) - dirpath_len);
-            ESP_LOGD(TAG, "Entrypath: %s", entrypath);
+    // Finish the file list table
+    out.append("</tbody></table>");
 
-            if (stat(entrypath, &entry_stat) == -1) {
-                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to stat " + std::string(entrytype) + ": " + std::string(entry->d_name));
-                continue;
-            }
+    bool hasNext = (total >= 0) && ((size_t)total > offset) && ((size_t)total - offset > limit);
 
-            if (entry->d_type == DT_DIR) {
-                strcpy(entrysize, "-\0");
-            }
-            else {
-                if (entry_stat.st_size >= 1024) {
-                    sprintf(entrysize, "%ld KiB", entry_stat.st_size / 1024); // kBytes
-                }
-                else {
-                    sprintf(entrysize, "%ld B", entry_stat.st_size); // Bytes
-                }
-            }
+    if ((total >= 0) && ((offset > 0) || hasNext)) {
+        size_t last = std::min((size_t)total, offset + limit);
+        out.append("<p>Entries " + std::to_string(std::min(offset + 1, last)) + " to " + std::to_string(last) +
+                   " of " + std::to_string(total));
+        if (offset > 0) {
+            out.append(" ");
+            dir_listing_page_link(out, uripath, (offset > limit) ? offset - limit : 0, limit, readonly, "&#129144; Previous");
+        }
+        if (hasNext) {
+            out.append(" ");
+            dir_listing_page_link(out, uripath, offset + limit, limit, readonly, "Next &#129146;");
+        }
+        out.append("</p>");
+    }
 
-            ESP_LOGD(TAG, "Found %s: %s (%s bytes)", entrytype, entry->d_name, entrysize);
+    // Remaining part of the HTML file to complete it
+    out.append("</body></html>");
 
-            // Send chunk of HTML file containing table entries with file name and size
-            httpd_resp_sendstr_chunk(req, "<tr><td><a href=\"");
-            httpd_resp_sendstr_chunk(req, "/fileserver");
-            httpd_resp_sendstr_chunk(req, uripath);
-            httpd_resp_sendstr_chunk(req, entry->d_name);
+    if (!out.flush()) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to send the listing of " + std::string(dirpath));
+        return ESP_FAIL;
+    }
 
-            if (entry->d_type == DT_DIR) {
-                httpd_resp_sendstr_chunk(req, "/");
-            }
+    // Send empty chunk to signal HTTP response completion
+    httpd_resp_sendstr_chunk(req, NULL);
+    return ESP_OK;
+}
 
-            httpd_resp_sendstr_chunk(req, "\">");
-            httpd_resp_sendstr_chunk(req, entry->d_name);
-            httpd_resp_sendstr_chunk(req, "</a></td><td>");
-            httpd_resp_sendstr_chunk(req, entrytype);
-            httpd_resp_sendstr_chunk(req, "</td><td>");
-            httpd_resp_sendstr_chunk(req, entrysize);
-
-            if (!readonly) {
-                httpd_resp_sendstr_chunk(req, "</td><td>");
-                httpd_resp_sendstr_chunk(req, "<form method=\"post\" action=\"/delete");
-                httpd_resp_sendstr_chunk(req, uripath);
-                httpd_resp_sendstr_chunk(req, entry->d_name);
-                httpd_resp_sendstr_chunk(req, "\"><button type=\"submit\">Delete</button></form>");
-            }
 
-            httpd_resp_sendstr_chunk(req, "</td></tr>\n");
-        }
+/* Same listing as JSON, one page of it: {"path":..,"offset":..,"limit":..,"total":..,"entries":[{"name":..,"type":..,"size":..},..]} */
+static esp_err_t http_resp_dir_json(httpd_req_t *req, const char *dirpath, const char *uripath, size_t offset, size_t limit)
+{
+    char dirpath_corrected[FILE_PATH_MAX];
+    strcpy(dirpath_corrected, dirpath);
+
+    file_server_data *server_data = (file_server_data *)req->user_ctx;
+
+    if ((strlen(dirpath_corrected) - 1) > strlen(server_data->base_path)) {
+        // if dirpath is not mountpoint, the last "\" needs to be removed
+        dirpath_corrected[strlen(dirpath_corrected) - 1] = '\0';
     }
 
-    closedir(pdir);
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_type(req, "application/json");
 
-    // Finish the file list table
-    httpd_resp_sendstr_chunk(req, "</tbody></table>");
+    ResponseBuffer out([req](const char *_data, size_t _len) {
+        return httpd_resp_send_chunk(req, _data, _len) == ESP_OK;
+    });
 
-    // Send remaining chunk of HTML file to complete it
-    httpd_resp_sendstr_chunk(req, "</body></html>");
+    bool first = true;
+    out.append("{\"path\":\"");
+    out.appendJson(uripath);
+    out.append("\",\"entries\":[");
+
+    int total = for_each_dir_entry(dirpath_corrected, offset, limit, [&](const DirEntry &_entry) {
+        dir_listing_json_entry(out, _entry, first);
+        first = false;
+        return out.ok();
+    });
+
+    if (total < 0) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to stat dir: " + std::string(dirpath) + "!");
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, get404());
+        return ESP_FAIL;
+    }
+
+    out.append("],\"offset\":" + std::to_string(offset) + ",\"limit\":" + std::to_string(limit) +
+               ",\"total\":" + std::to_string(total) + "}");
+
+    if (!out.flush()) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to send the listing of " + std::string(dirpath));
+        return ESP_FAIL;
+    }
 
-    // Send empty chunk to signal HTTP response completion
     httpd_resp_sendstr_chunk(req, NULL);
     return ESP_OK;
 }
 
+
 static esp_err_t logfileact_get_full_handler(httpd_req_t *req) {
     return send_logfile(req, true);
 }
@@ -388,33 +436,12 @@ static esp_err_t send_datafile(httpd_req_t *req, bool send_full_file)
         }
     }
 
-    /* Retrieve the pointer to scratch buffer for temporary storage */
-    char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
-    size_t chunksize;
-    do {
-        /* Read file in chunks into the scratch buffer */
-        chunksize = fread(chunk, 1, SERVER_FILER_SCRATCH_BUFSIZE, fd);
-
-        /* Send the buffer contents as HTTP response chunk */
-        if (httpd_resp_send_chunk(req, chunk, chunksize) != ESP_OK) {
-            fclose(fd);
-            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "File sending failed!");
-            /* Abort sending file */
-            httpd_resp_sendstr_chunk(req, NULL);
-            /* Respond with 500 Internal Server Error */
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send file");
-            return ESP_FAIL;
-        }
-
-        /* Keep looping till the whole file is sent */
-    } while (chunksize != 0);
-
-    /* Close file after sending complete */
-    fclose(fd);
+    if (send_file_chunks(req, fd) != ESP_OK) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "File sending failed!");
+        return ESP_FAIL;
+    }
     ESP_LOGI(TAG, "File sending complete");
 
-    /* Respond with an empty chunk to signal HTTP response completion */
-    httpd_resp_send_chunk(req, NULL, 0);
     return ESP_OK;
 }
 
@@ -473,33 +500,12 @@ static esp_err_t send_logfile(httpd_req_t *req, bool send_full_file)
         }
     }
 
-    /* Retrieve the pointer to scratch buffer for temporary storage */
-    char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
-    size_t chunksize;
-    do {
-        /* Read file in chunks into the scratch buffer */
-        chunksize = fread(chunk, 1, SERVER_FILER_SCRATCH_BUFSIZE, fd);
-
-        /* Send the buffer contents as HTTP response chunk */
-        if (httpd_resp_send_chunk(req, chunk, chunksize) != ESP_OK) {
-            fclose(fd);
-            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "File sending failed!");
-            /* Abort sending file */
-            httpd_resp_sendstr_chunk(req, NULL);
-            /* Respond with 500 Internal Server Error */
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send file");
-            return ESP_FAIL;
-        }
-
-        /* Keep looping till the whole file is sent */
-    } while (chunksize != 0);
-
-    /* Close file after sending complete */
-    fclose(fd);
+    if (send_file_chunks(req, fd) != ESP_OK) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "File sending failed!");
+        return ESP_FAIL;
+    }
     ESP_LOGD(TAG, "File sending complete");
 
-    /* Respond with an empty chunk to signal HTTP response completion */
-    httpd_resp_send_chunk(req, NULL, 0);
     return ESP_OK;
 }
 
@@ -530,6 +536,10 @@ static esp_err_t download_get_handler(httpd_req_t *req)
     /* If name has trailing '/', respond with directory contents */
     if (filename[strlen(filename) - 1] == '/') {
         bool readonly = false;
+        bool json = false;
+        size_t offset = 0;
+        size_t limit = 0;
+        bool limit_set = false;
         size_t buf_len = httpd_req_get_url_query_len(req) + 1;
         if (buf_len > 1) {
             char buf[buf_len];
@@ -541,11 +551,24 @@ static esp_err_t download_get_handler(httpd_req_t *req)
                     ESP_LOGI(TAG, "Found URL query parameter => readonly=%s", param);
                     readonly = (strcmp(param,"true") == 0);
                 }
+                if (httpd_query_key_value(buf, "format", param, sizeof(param)) == ESP_OK) {
+                    json = (strcmp(param, "json") == 0);
+                }
+                if (httpd_query_key_value(buf, "offset", param, sizeof(param)) == ESP_OK) {
+                    offset = strtoul(param, NULL, 10);
+                }
+                if (httpd_query_key_value(buf, "limit", param, sizeof(param)) == ESP_OK) {
+                    limit = strtoul(param, NULL, 10);
+                    limit_set = (limit > 0);
+                }
             }
         }
 
         ESP_LOGD(TAG, "uri: %s, filename: %s, filepath: %s", req->uri, filename, filepath);
-        return http_resp_dir_html(req, filepath, filename, readonly);
+        if (json) {
+            return http_resp_dir_json(req, filepath, filename, offset, limit_set ? limit : DIR_LISTING_JSON_LIMIT);
+        }
+        return http_resp_dir_html(req, filepath, filename, readonly, offset, limit_set ? limit : DIR_LISTING_HTML_LIMIT);
     }
 
     std::string testwlan = toUpper(std::string(filename));
@@ -573,31 +596,10 @@ static esp_err_t download_get_handler(httpd_req_t *req)
     ESP_LOGD(TAG, "Sending file: %s (%ld bytes)...", filename, file_stat.st_size);
     set_content_type_from_file(req, filename);
 
-    /* Retrieve the pointer to scratch buffer for temporary storage */
-    char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
-    size_t chunksize;
-    do {
-        /* Read file in chunks into the scratch buffer */
-        chunksize = fread(chunk, 1, SERVER_FILER_SCRATCH_BUFSIZE, fd);
-
-        /* Send buffer contents as HTTP chunk. If empty this functions as a
-         * last-chunk message, signaling end-of-response, to the HTTP client.
-         * See RFC 2616, section 3.6.1 for details on Chunked Transfer Encoding. */
-        if (httpd_resp_send_chunk(req, chunk, chunksize) != ESP_OK) {
-            fclose(fd);
-            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "File sending failed!");
-            /* Abort sending file */
-            httpd_resp_sendstr_chunk(req, NULL);
-            /* Respond with 500 Internal Server Error */
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send file!");
-            return ESP_FAIL;
-        }
-
-        /* Keep looping till the whole file is sent */
-    } while (chunksize != 0);
-
-    /* Close file after sending complete */
-    fclose(fd);
+    if (send_file_chunks(req, fd) != ESP_OK) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "File sending failed!");
+        return ESP_FAIL;
+    }
     ESP_LOGD(TAG, "File successfully sent");
 
     return ESP_OK;
@@ -711,6 +713,7 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
 
     /* Close file upon upload completion */
     fclose(fd);
+    web_files_changed();
     LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "File saved: " + string(filename));
     ESP_LOGI(TAG, "File reception completed");
 
@@ -833,15 +836,26 @@ static esp_err_t delete_post_handler(httpd_req_t *req)
         zw = "/sdcard" + zw;
         ESP_LOGD(TAG, "Directory to delete: %s", zw.c_str());
 
-        delete_all_in_directory(zw);
+        // Can be thousands of logged images, the listing shows the progress meanwhile
+        DeleteJobStart started = getDeleteJob().start(zw, web_files_changed);
+        if (started == DELETE_JOB_BUSY) {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Deleting " + zw + " refused, another delete job is still running");
+            httpd_resp_set_status(req, "409 Conflict");
+            httpd_resp_sendstr(req, "Another directory is still being deleted, please try again later");
+            return ESP_FAIL;
+        }
+        else if (started != DELETE_JOB_STARTED) {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start deleting the files");
+            return ESP_FAIL;
+        }
 //        directory = std::string(filepath);
 //        directory = "/fileserver" + directory;
         ESP_LOGD(TAG, "Location after delete directory content: %s", directory.c_str());
-        /* Redirect onto root to see the updated file list */
-//        httpd_resp_set_status(req, "303 See Other");
-//        httpd_resp_set_hdr(req, "Location", directory.c_str());
-//        httpd_resp_sendstr(req, "File deleted successfully");
-//        return ESP_OK;        
+        /* Redirect onto the folder to see the progress */
+        httpd_resp_set_status(req, "303 See Other");
+        httpd_resp_set_hdr(req, "Location", directory.c_str());
+        httpd_resp_sendstr(req, "Deleting the files in the background");
+        return ESP_OK;
     }
     else
     {
@@ -876,6 +890,7 @@ static esp_err_t delete_post_handler(httpd_req_t *req)
 
         /* Delete file */
         unlink(filepath);
+        web_files_changed();
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "File deleted: " + string(filename));
         ESP_LOGI(TAG, "File deletion completed");
 
@@ -922,6 +937,237 @@ static esp_err_t delete_post_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+/* Progress of the background delete (DELETE ALL! of the file server) */
+static esp_err_t delete_status_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, getDeleteJob().getStatusJson().c_str());
+}
+
+
+static void image_log_record_time(const ImageLogRecord &_record, struct tm *_time)
+{
+    memset(_time, 0, sizeof(struct tm));
+    if (sscanf(_record.time.c_str(), "%4d%2d%2d-%2d%2d%2d", &_time->tm_year, &_time->tm_mon, &_time->tm_mday,
+               &_time->tm_hour, &_time->tm_min, &_time->tm_sec) == 6) {
+        _time->tm_year -= 1900;
+        _time->tm_mon -= 1;
+    }
+}
+
+
+static esp_err_t image_log_send_zip(httpd_req_t *req, ImageLogStore &store, const std::string &from, const std::string &to,
+                                    const std::string &name)
+{
+    std::string disposition = "attachment; filename=\"imagelog_" + from + "_" + to + ".zip\"";
+    httpd_resp_set_type(req, "application/zip");
+    httpd_resp_set_hdr(req, "Content-Disposition", disposition.c_str());
+
+    ZipStreamWriter zip([req](const char *_data, size_t _len) {
+        return httpd_resp_send_chunk(req, _data, _len) == ESP_OK;
+    });
+
+    std::vector<ImageLogRecord> records;
+    struct tm modified;
+    bool limited = false;
+
+    for (const std::string &day : store.ListDays()) {
+        if (limited) {
+            break;
+        }
+        if ((day < from) || (day > to) || !store.ReadIndex(day, records)) {
+            continue;
+        }
+
+        for (const ImageLogRecord &record : records) {
+            if (!name.empty() && (record.name != name)) {
+                continue;
+            }
+            if (zip.getEntryCount() >= IMAGE_LOG_ZIP_MAX_ENTRIES) {
+                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Image log ZIP is limited to " + std::to_string(IMAGE_LOG_ZIP_MAX_ENTRIES) + " images");
+                limited = true;
+                break;
+            }
+
+            // Same structure as the folder layout
+            image_log_record_time(record, &modified);
+            zip.beginEntry(day + "/" + record.time.LOGFILE_TIME_FORMAT_HOUR_EXTR + "/" + record.getFileName(), &modified);
+            if (!store.ReadImage(day, record, [&zip](const char *_data, size_t _len) { return zip.write(_data, _len); })) {
+                if (!zip.ok()) {
+                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to send the image log ZIP");
+                    return ESP_FAIL;
+                }
+                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Image " + record.getFileName() + " is not readable");
+            }
+            zip.endEntry();
+        }
+    }
+
+    if (!zip.finish()) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to send the image log ZIP");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+
+static bool image_log_is_day(const std::string &_day)
+{
+    if (_day.length() != 8) {
+        return false;
+    }
+
+    for (char c : _day) {
+        if (!isdigit((unsigned char)c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/* Access to the images which got logged in the packed format (see ImageLogStore), e.g.
+ *   /imagelog?folder=/log/digit                                        -> days as JSON
+ *   /imagelog?folder=/log/digit&day=20240131                           -> index of the day as JSON
+ *   /imagelog?folder=/log/digit&day=20240131&index=12                  -> one image
+ *   /imagelog?folder=/log/digit&from=20240101&to=20240131&format=zip   -> ZIP of the range, optional &name=<ROI> */
+static esp_err_t image_log_get_handler(httpd_req_t *req)
+{
+    char query[200] = "";
+    char param[64];
+    std::string folder;
+    std::string day;
+    std::string from;
+    std::string to;
+    std::string name;
+    long index = -1;
+    bool zip = false;
+
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+
+    if (httpd_query_key_value(query, "folder", param, sizeof(param)) == ESP_OK) {
+        folder = param;
+    }
+    if (httpd_query_key_value(query, "day", param, sizeof(param)) == ESP_OK) {
+        day = param;
+        from = param;
+        to = param;
+    }
+    if (httpd_query_key_value(query, "from", param, sizeof(param)) == ESP_OK) {
+        from = param;
+    }
+    if (httpd_query_key_value(query, "to", param, sizeof(param)) == ESP_OK) {
+        to = param;
+    }
+    if (httpd_query_key_value(query, "name", param, sizeof(param)) == ESP_OK) {
+        name = param;
+    }
+    if (httpd_query_key_value(query, "index", param, sizeof(param)) == ESP_OK) {
+        index = strtol(param, NULL, 10);
+    }
+    if (httpd_query_key_value(query, "format", param, sizeof(param)) == ESP_OK) {
+        zip = (strcmp(param, "zip") == 0);
+    }
+
+    if ((folder.empty()) || (folder[0] != '/') || (folder.find("..") != std::string::npos)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Parameter folder missing or invalid");
+        return ESP_FAIL;
+    }
+
+    if ((!day.empty() && !image_log_is_day(day)) || (!from.empty() && !image_log_is_day(from)) ||
+        (!to.empty() && !image_log_is_day(to))) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Parameters day, from and to have to be dates like 20240131");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    ImageLogStore store("/sdcard" + folder);
+
+    if (zip) {
+        if (to.empty()) {
+            to = "99999999";
+        }
+        return image_log_send_zip(req, store, from, to, name);
+    }
+
+    if (day.empty()) {
+        httpd_resp_set_type(req, "application/json");
+        ResponseBuffer out([req](const char *_data, size_t _len) {
+            return httpd_resp_send_chunk(req, _data, _len) == ESP_OK;
+        });
+
+        out.append("{\"folder\":\"");
+        out.appendJson(folder.c_str());
+        out.append("\",\"days\":[");
+        std::vector<std::string> days = store.ListDays();
+        for (size_t i = 0; i < days.size(); ++i) {
+            out.append(((i > 0) ? ",\"" : "\"") + days[i] + "\"");
+        }
+        out.append("]}");
+
+        if (!out.flush()) {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to send the image log days of " + folder);
+            return ESP_FAIL;
+        }
+
+        httpd_resp_sendstr_chunk(req, NULL);
+        return ESP_OK;
+    }
+
+    std::vector<ImageLogRecord> records;
+    if (!store.ReadIndex(day, records)) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No images of this day");
+        return ESP_FAIL;
+    }
+
+    if (index >= 0) {
+        if (index >= (long)records.size()) {
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No image with this index");
+            return ESP_FAIL;
+        }
+
+        std::string disposition = "inline; filename=\"" + records[index].getFileName() + "\"";
+        httpd_resp_set_type(req, "image/jpeg");
+        httpd_resp_set_hdr(req, "Content-Disposition", disposition.c_str());
+
+        if (!store.ReadImage(day, records[index], [req](const char *_data, size_t _len) {
+                return httpd_resp_send_chunk(req, _data, _len) == ESP_OK;
+            })) {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to send image " + records[index].getFileName());
+            httpd_resp_send_chunk(req, NULL, 0);
+            return ESP_FAIL;
+        }
+        httpd_resp_send_chunk(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    ResponseBuffer out([req](const char *_data, size_t _len) {
+        return httpd_resp_send_chunk(req, _data, _len) == ESP_OK;
+    });
+
+    out.append("{\"day\":\"" + day + "\",\"images\":[");
+    for (size_t i = 0; (i < records.size()) && out.ok(); ++i) {
+        out.append(((i > 0) ? ",{\"index\":" : "{\"index\":") + std::to_string(i) + ",\"time\":\"" + records[i].time + "\",\"name\":\"");
+        out.appendJson(records[i].name.c_str());
+        out.append("\",\"result\":\"" + records[i].result + "\",\"size\":" + std::to_string(records[i].length) + "}");
+    }
+    out.append("]}");
+
+    if (!out.flush()) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to send the image log index of " + day);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_sendstr_chunk(req, NULL);
+    return ESP_OK;
+}
+
+
 void delete_all_in_directory(std::string _directory)
 {
     struct dirent *entry;
@@ -947,218 +1193,267 @@ void delete_all_in_directory(std::string _directory)
     closedir(dir);
 }
 
-std::string unzip_new(std::string _in_zip_file, std::string _html_tmp, std::string _html_final, std::string _target_bin, std::string _main, bool _initial_setup)
+/**
+ * @brief Extracts an update ZIP file. Each entry is streamed into a temporary file and renamed afterwards,
+ *        so only the buffers of the extraction are needed in memory, not the complete file.
+ *
+ * @return Path of the extracted firmware.bin, "" if there is none, "ERROR" if an entry could not be written
+ */
+/* Where an entry of an update ZIP gets extracted to, an empty string if it is skipped.
+ * Files in the html folder are redirected to the temporary html folder, config-initial only gets used for an initial setup. */
+static std::string unzip_target(std::string _entry, std::string _html_tmp, std::string _html_final, std::string _main, bool _initial_setup)
 {
-    int i, sort_iter;
-    mz_bool status;
-    size_t uncomp_size;
-    mz_zip_archive zip_archive;
-    void* p;
-    char archive_filename[64];
-    std::string zw, ret = "";
-    std::string directory = "";
+    std::string zw = _entry;
+    std::string _s1 = "config-initial";
+    std::string _dir = "config";
+
+    if ((getDirectory(zw) == _s1) && !_initial_setup)
+    {
+        return "";
+    }
+    FindReplace(zw, _s1, _dir);
+    zw = _main + zw;
+
+    if (zw.find(_html_final) == 0) {
+        FindReplace(zw, _html_final, _html_tmp);
+    }
+    return zw;
+}
+
+
+static bool is_firmware_entry(const std::string &_entry)
+{
+    return toUpper(_entry) == "FIRMWARE.BIN";
+}
+
+
+bool unzip_new(std::string _in_zip_file, std::string _html_tmp, std::string _html_final, FirmwareStream *_firmware, std::string _main, bool _initial_setup)
+{
+    ZipExtractor zip;
+    ZipEntry entry;
+    std::string zw;
+    bool ret = true;
 
     ESP_LOGD(TAG, "miniz.c version: %s", MZ_VERSION);
     ESP_LOGD(TAG, "Zipfile: %s", _in_zip_file.c_str());
 
     // Now try to open the archive.
-    memset(&zip_archive, 0, sizeof(zip_archive));
-    status = mz_zip_reader_init_file(&zip_archive, _in_zip_file.c_str(), 0);
-    if (!status)
+    if (!zip.open(_in_zip_file))
     {
-        ESP_LOGD(TAG, "mz_zip_reader_init_file() failed!");
-        return ret;
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Opening " + _in_zip_file + " failed: " + zip.getError());
+        return false;
     }
 
-    // Get and print information about each file in the archive.
-    int numberoffiles = (int)mz_zip_reader_get_num_files(&zip_archive);
+    int numberoffiles = zip.getEntryCount();
     LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Files to be extracted: " + to_string(numberoffiles));
 
-    sort_iter = 0;
+    for (int i = 0; i < numberoffiles; i++)
     {
-        memset(&zip_archive, 0, sizeof(zip_archive));
-        status = mz_zip_reader_init_file(&zip_archive, _in_zip_file.c_str(), sort_iter ? MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY : 0);
-        if (!status)
+        if (!zip.getEntry(i, &entry) || entry.isDirectory) {
+            continue;
+        }
+        ESP_LOGD(TAG, "Rohfilename: %s", entry.name.c_str());
+
+        // The firmware goes straight into the OTA partition
+        if (is_firmware_entry(entry.name))
+        {
+            LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Writing " + entry.name + " to the OTA partition, size " + to_string(entry.size));
+            if (!zip.extract(i, [_firmware](const void *_data, size_t _len) { return _firmware->write(_data, _len); }))
+            {
+                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in writing the firmware: " + _firmware->getError());
+                ret = false;
+            }
+            continue;
+        }
+
+        zw = unzip_target(entry.name, _html_tmp, _html_final, _main, _initial_setup);
+        if (zw.length() == 0) {
+            continue;
+        }
+
+        string filename_zw = zw + SUFFIX_ZW;
+
+        ESP_LOGI(TAG, "File to extract: %s, Temp. Filename: %s", zw.c_str(), filename_zw.c_str());
+
+        std::string folder = filename_zw.substr(0, filename_zw.find_last_of('/'));
+        MakeDir(folder);
+
+        // extrahieren in zwischendatei
+        DeleteFile(filename_zw);
+
+        bool isokay = zip.extractToFile(i, filename_zw);
+        if (!isokay)
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in writting extracted file \"" + entry.name + "\", size " + to_string(entry.size) +
+                                ": " + zip.getError());
+
+        DeleteFile(zw);
+        isokay = isokay && RenameFile(filename_zw, zw);
+        if (!isokay)
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in Rename \"" + filename_zw + "\" to \"" + zw);
+
+        if (isokay)
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Successfully extracted file \"" + entry.name + "\", size " + to_string(entry.size));
+        else
         {
-            ESP_LOGD(TAG, "mz_zip_reader_init_file() failed!");
-            return ret;
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in extracting file \"" + entry.name + "\", size " + to_string(entry.size));
+            ret = false;
         }
+    }
+
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Max. memory used for extracting: " + to_string(zip.getPeakAllocation()) + " bytes");
+    ESP_LOGD(TAG, "Success.");
+    return ret;
+}
 
-        for (i = 0; i < numberoffiles; i++)
+
+ZipStreamHandler unzip_stream_handler(std::string _html_tmp, std::string _html_final, FirmwareStream *_firmware, std::string _staging, std::string _main)
+{
+    struct TargetFile {
+        FILE *file = NULL;
+        std::string name;
+    };
+    std::shared_ptr<TargetFile> target = std::make_shared<TargetFile>();
+    ZipStreamHandler handler;
+
+    handler.begin = [=](const ZipEntry &_entry) -> ZipWrite {
+        if (is_firmware_entry(_entry.name))
         {
-            mz_zip_archive_file_stat file_stat;
-            mz_zip_reader_file_stat(&zip_archive, i, &file_stat);
-            sprintf(archive_filename, file_stat.m_filename);
-            
-            if (!file_stat.m_is_directory) {
-            // Try to extract all the files to the heap.
-            p = mz_zip_reader_extract_file_to_heap(&zip_archive, archive_filename, &uncomp_size, 0);
-                if (!p)
-                {
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "mz_zip_reader_extract_file_to_heap() failed on file " + string(archive_filename));
-                    mz_zip_reader_end(&zip_archive);
-                    return ret;
-                }
-            
-                // Save to File.
-                zw = std::string(archive_filename);
-                ESP_LOGD(TAG, "Rohfilename: %s", zw.c_str());
-
-                if (toUpper(zw) == "FIRMWARE.BIN")
-                {
-                    zw = _target_bin + zw;
-                    ret = zw;
-                }
-                else
-                {
-                    std::string _dir = getDirectory(zw);
-                    if ((_dir == "config-initial") && !_initial_setup)
-                    {
-                        continue;
-                    }
-                    else
-                    {
-                        _dir = "config";
-                        std::string _s1 = "config-initial";
-                        FindReplace(zw, _s1, _dir);
-                    }
-
-                    if (_dir.length() > 0)
-                    {
-                        zw = _main + zw;
-                    }
-                    else
-                    {
-                        zw = _html_tmp + zw;
-                    }
+            LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Writing " + _entry.name + " to the OTA partition");
+            return [_firmware](const void *_data, size_t _len) { return _firmware->write(_data, _len); };
+        }
 
-                }
+        target->name = unzip_target(_entry.name, _html_tmp, _html_final, _main, false);
+        if (target->name.length() == 0) {
+            return nullptr;
+        }
 
-                // files in the html folder shall be redirected to the temporary html folder
-                if (zw.find(_html_final) == 0) {
-                    FindReplace(zw, _html_final, _html_tmp);
-                }
-            
-                string filename_zw = zw + SUFFIX_ZW;
+        // Everything outside of html_tmp gets staged, unzip_commit_staged() moves it into place
+        if ((target->name.find(_html_tmp) != 0) && (target->name.find(_main) == 0)) {
+            target->name = _staging + target->name.substr(_main.length());
+        }
 
-                ESP_LOGI(TAG, "File to extract: %s, Temp. Filename: %s", zw.c_str(), filename_zw.c_str());
+        std::string filename_zw = target->name + SUFFIX_ZW;
+        MakeDir(filename_zw.substr(0, filename_zw.find_last_of('/')));
 
-                std::string folder = filename_zw.substr(0, filename_zw.find_last_of('/'));
-                MakeDir(folder);
+        target->file = fopen(filename_zw.c_str(), "wb");
+        if (target->file == NULL)
+        {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to create file: " + filename_zw);
+            return [](const void *_data, size_t _len) { return false; };
+        }
 
-                // extrahieren in zwischendatei
-                DeleteFile(filename_zw);
+        FILE *file = target->file;
+        return [file](const void *_data, size_t _len) { return fwrite(_data, 1, _len, file) == _len; };
+    };
 
-                FILE* fpTargetFile = fopen(filename_zw.c_str(), "wb");
-                uint writtenbytes = fwrite(p, 1, (uint)uncomp_size, fpTargetFile);
-                fclose(fpTargetFile);
-                
-                bool isokay = true;
+    handler.end = [=](const ZipEntry &_entry, bool _ok) {
+        if (is_firmware_entry(_entry.name))
+        {
+            if (!_ok)
+                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in writing the firmware: " + _firmware->getError());
+            return _ok;
+        }
 
-                if (writtenbytes == (uint)uncomp_size)
-                {
-                    isokay = true;
-                }
-                else
-                {
-                    isokay = false;
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in writting extracted file (function fwrite) extracted file \"" +
-                            string(archive_filename) + "\", size " + to_string(uncomp_size));
-                }
+        std::string filename_zw = target->name + SUFFIX_ZW;
+        bool isokay = _ok && (target->file != NULL);
 
-                DeleteFile(zw);
-                if (!isokay)
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in fwrite \"" + string(archive_filename) + "\", size " + to_string(uncomp_size));
-                isokay = isokay && RenameFile(filename_zw, zw);
-                if (!isokay)
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in Rename \"" + filename_zw + "\" to \"" + zw);
-
-                if (isokay)
-                    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Successfully extracted file \"" + string(archive_filename) + "\", size " + to_string(uncomp_size));
-                else
-                {
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in extracting file \"" + string(archive_filename) + "\", size " + to_string(uncomp_size));
-                    ret = "ERROR";
-                }
-                mz_free(p);
-            }
+        if (target->file != NULL)
+        {
+            isokay = (fclose(target->file) == 0) && isokay;
+            target->file = NULL;
         }
 
-        // Close the archive, freeing any resources it was using
-        mz_zip_reader_end(&zip_archive);
+        if (isokay)
+        {
+            DeleteFile(target->name);
+            isokay = RenameFile(filename_zw, target->name);
+        }
+
+        if (isokay)
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Successfully extracted file \"" + _entry.name + "\", size " + to_string(_entry.size));
+        else
+        {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in extracting file \"" + _entry.name + "\"");
+            DeleteFile(filename_zw);
+        }
+        return isokay;
+    };
+
+    return handler;
+}
+
+bool unzip_commit_staged(std::string _staging, std::string _main)
+{
+    struct dirent *entry;
+    DIR *dir = opendir(_staging.c_str());
+    bool ret = true;
+
+    if (!dir) {
+        return true;        // Nothing got staged
     }
 
-    ESP_LOGD(TAG, "Success.");
+    while ((entry = readdir(dir)) != NULL) {
+        if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) {
+            continue;
+        }
+
+        std::string from = _staging + entry->d_name;
+        std::string to = _main + entry->d_name;
+
+        if (entry->d_type == DT_DIR) {
+            MakeDir(to);
+            ret = unzip_commit_staged(from + "/", to + "/") && ret;
+        }
+        else {
+            DeleteFile(to);
+            if (RenameFile(from, to)) {
+                LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Installed " + to);
+            }
+            else {
+                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ERROR in moving \"" + from + "\" to \"" + to + "\"");
+                ret = false;
+            }
+        }
+    }
+    closedir(dir);
     return ret;
 }
 
+
 void unzip(std::string _in_zip_file, std::string _target_directory){
-    int i, sort_iter;
-    mz_bool status;
-    size_t uncomp_size;
-    mz_zip_archive zip_archive;
-    void* p;
-    char archive_filename[64];
+    ZipExtractor zip;
+    ZipEntry entry;
     std::string zw;
-//    static const char* s_Test_archive_filename = "testhtml.zip";
 
     ESP_LOGD(TAG, "miniz.c version: %s", MZ_VERSION);
     ESP_LOGD(TAG, "Zipfile: %s", _in_zip_file.c_str());
     ESP_LOGD(TAG, "Target Dir: %s", _target_directory.c_str());
 
     // Now try to open the archive.
-    memset(&zip_archive, 0, sizeof(zip_archive));
-    status = mz_zip_reader_init_file(&zip_archive, _in_zip_file.c_str(), 0);
-    if (!status)
+    if (!zip.open(_in_zip_file))
     {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "mz_zip_reader_init_file() failed!");
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Opening " + _in_zip_file + " failed: " + zip.getError());
         return;
     }
 
-    // Get and print information about each file in the archive.
-    int numberoffiles = (int)mz_zip_reader_get_num_files(&zip_archive);
-    for (sort_iter = 0; sort_iter < 2; sort_iter++)
+    int numberoffiles = zip.getEntryCount();
+    for (int i = 0; i < numberoffiles; i++)
     {
-        memset(&zip_archive, 0, sizeof(zip_archive));
-        status = mz_zip_reader_init_file(&zip_archive, _in_zip_file.c_str(), sort_iter ? MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY : 0);
-        if (!status)
-        {
-            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "mz_zip_reader_init_file() failed!");
-            return;
+        if (!zip.getEntry(i, &entry) || entry.isDirectory) {
+            continue;
         }
 
-        for (i = 0; i < numberoffiles; i++)
-        {
-            mz_zip_archive_file_stat file_stat;
-            mz_zip_reader_file_stat(&zip_archive, i, &file_stat);
-            sprintf(archive_filename, file_stat.m_filename);
- 
-            // Try to extract all the files to the heap.
-            p = mz_zip_reader_extract_file_to_heap(&zip_archive, archive_filename, &uncomp_size, 0);
-            if (!p)
-            {
-                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "mz_zip_reader_extract_file_to_heap() failed!");
-                mz_zip_reader_end(&zip_archive);
-                return;
-            }
-
-            // Save to File.
-            zw = std::string(archive_filename);
-            zw = _target_directory + zw;
-            ESP_LOGD(TAG, "File to extract: %s", zw.c_str());
-            FILE* fpTargetFile = fopen(zw.c_str(), "wb");
-            fwrite(p, 1, (uint)uncomp_size, fpTargetFile);
-            fclose(fpTargetFile);
+        // Save to File.
+        zw = _target_directory + entry.name;
+        ESP_LOGD(TAG, "File to extract: %s", zw.c_str());
 
-            ESP_LOGD(TAG, "Successfully extracted file \"%s\", size %u", archive_filename, (uint)uncomp_size);
-            //            ESP_LOGD(TAG, "File data: \"%s\"", (const char*)p);
-
-            // We're done.
-            mz_free(p);
+        if (!zip.extractToFile(i, zw))
+        {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Extracting " + entry.name + " failed: " + zip.getError());
+            return;
         }
 
-        // Close the archive, freeing any resources it was using
-        mz_zip_reader_end(&zip_archive);
+        ESP_LOGD(TAG, "Successfully extracted file \"%s\", size %u", entry.name.c_str(), (uint)entry.size);
     }
 
     ESP_LOGD(TAG, "Success.");
@@ -1252,4 +1547,20 @@ void register_server_file_uri(httpd_handle_t server, const char *base_path)
         .user_ctx  = server_data    // Pass server data as context
     };
     httpd_register_uri_handler(server, &file_delete);
+
+    httpd_uri_t file_delete_status = {
+        .uri       = "/delete_status",
+        .method    = HTTP_GET,
+        .handler = APPLY_BASIC_AUTH_FILTER(delete_status_get_handler),
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &file_delete_status);
+
+    httpd_uri_t file_image_log = {
+        .uri       = "/imagelog",
+        .method    = HTTP_GET,
+        .handler = APPLY_BASIC_AUTH_FILTER(image_log_get_handler),
+        .user_ctx  = server_data    // Pass server data as context
+    };
+    httpd_register_uri_handler(server, &file_image_log);
 }
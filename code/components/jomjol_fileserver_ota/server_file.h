@@ -6,10 +6,16 @@
 #include <esp_http_server.h>
 #include <string>
 
+#include "zip_extract.h"
+#include "ota_writer.h"
+
 void register_server_file_uri(httpd_handle_t server, const char *base_path);
 
 void unzip(std::string _in_zip_file, std::string _target_directory);
-std::string unzip_new(std::string _in_zip_file, std::string _html_tmp, std::string _html_final, std::string _target_bin, std::string _main = "/sdcard/", bool _initial_setup = false);
+bool unzip_new(std::string _in_zip_file, std::string _html_tmp, std::string _html_final, FirmwareStream *_firmware, std::string _main = "/sdcard/", bool _initial_setup = false);
+// Entries outside of the html folder get extracted below _staging, unzip_commit_staged() moves them to _main
+ZipStreamHandler unzip_stream_handler(std::string _html_tmp, std::string _html_final, FirmwareStream *_firmware, std::string _staging, std::string _main = "/sdcard/");
+bool unzip_commit_staged(std::string _staging, std::string _main = "/sdcard/");
 
 
 void delete_all_in_directory(std::string _directory);
@@ -18,12 +18,13 @@ extern "C" {
 #include "esp_log.h"
 #include "Helper.h"
 #include "esp_http_server.h"
+#include "file_stream.h"
+#include "asset_cache.h"
+#include "web_bundle.h"
 #include "../../include/defines.h"
 
 static const char *TAG = "SERVER HELP";
 
-char scratch[SERVER_HELPER_SCRATCH_BUFSIZE];
-
 bool endsWith(std::string const &str, std::string const &suffix) 
 {
     if (str.length() < suffix.length()) {
@@ -32,33 +33,21 @@ bool endsWith(std::string const &str, std::string const &suffix)
     return str.compare(str.length() - suffix.length(), suffix.length(), suffix) == 0;
 }
 
-esp_err_t send_file(httpd_req_t *req, std::string filename)
+static bool accepts_gzip(httpd_req_t *req)
 {
-    std::string _filename_old = filename;
-    struct stat file_stat;
-    bool _gz_file_exists = false;
+    char value[100] = "";
 
-    ESP_LOGD(TAG, "old filename: %s", filename.c_str());
-    std::string _filename_temp = std::string(filename) + ".gz";
-
-    // Checks whether the file is available as .gz
-    if (stat(_filename_temp.c_str(), &file_stat) == 0) {
-        filename = _filename_temp;
-
-        ESP_LOGD(TAG, "new filename: %s", filename.c_str());
-        _gz_file_exists = true;
+    if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", value, sizeof(value)) == ESP_ERR_HTTPD_RESULT_TRUNC) {
+        return true;        // Long list, gzip is part of every browser's list anyway
     }
+    return strstr(value, "gzip") != NULL;
+}
 
-    FILE *fd = fopen(filename.c_str(), "r");
-    if (!fd)  {
-        ESP_LOGE(TAG, "Failed to read file: %s", filename.c_str());
-		
-        /* Respond with 404 Error */
-        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, get404());
-        return ESP_FAIL;
-    }
 
-    ESP_LOGD(TAG, "Sending file: %s ...", filename.c_str());
+/* Sets the headers for a static file, _filename is the requested one and _gz_file_exists whether the .gz variant gets sent */
+static void set_file_headers(httpd_req_t *req, const std::string &_filename, bool _gz_file_exists)
+{
+    std::string filename = _gz_file_exists ? _filename + ".gz" : _filename;
 
     /* For all files with the following file extention tell the webbrowser to cache them for 12h */
     if (endsWith(filename, ".html") ||
@@ -81,7 +70,8 @@ esp_err_t send_file(httpd_req_t *req, std::string filename)
         else if (_gz_file_exists) {
             httpd_resp_set_hdr(req, "Cache-Control", "max-age=43200");
             httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
-            set_content_type_from_file(req, _filename_old.c_str());
+            httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+            set_content_type_from_file(req, _filename.c_str());
         }
         else {
             httpd_resp_set_hdr(req, "Cache-Control", "max-age=43200");
@@ -91,39 +81,144 @@ esp_err_t send_file(httpd_req_t *req, std::string filename)
     else {
         set_content_type_from_file(req, filename.c_str());
     }
+}
+
+
+/* Static files of the web UI, they get served from the AssetCache */
+static bool is_cacheable_asset(const std::string &_filename)
+{
+    return (_filename.compare(0, sizeof(ASSET_CACHE_DIRECTORY) - 1, ASSET_CACHE_DIRECTORY) == 0) &&
+           (_filename != "/sdcard/html/setup.html") &&
+           (endsWith(_filename, ".html") ||
+            endsWith(_filename, ".htm") ||
+            endsWith(_filename, ".xml") ||
+            endsWith(_filename, ".css") ||
+            endsWith(_filename, ".js") ||
+            endsWith(_filename, ".map") ||
+            endsWith(_filename, ".jpg") ||
+            endsWith(_filename, ".jpeg") ||
+            endsWith(_filename, ".ico") ||
+            endsWith(_filename, ".png") ||
+            endsWith(_filename, ".gif"));
+}
+
+
+/* Sends a file from the memory (AssetCache, WebBundle), answers with 304 if the browser has the same version already */
+static esp_err_t send_memory_file(httpd_req_t *req, const std::string &_filename, const char *_data, size_t _size,
+                                  bool _gzip, const char *_etag)
+{
+    char if_none_match[100] = "";
+
+    set_file_headers(req, _filename, _gzip);
+    httpd_resp_set_hdr(req, "ETag", _etag);
+
+    if ((httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK) &&
+        (strstr(if_none_match, _etag) != NULL)) {
+        ESP_LOGD(TAG, "Not modified: %s", _filename.c_str());
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    ESP_LOGD(TAG, "Sending %s from memory ...", _filename.c_str());
+    return httpd_resp_send(req, _data, _size);
+}
 
-    /* Retrieve the pointer to scratch buffer for temporary storage */
-    char *chunk = scratch;
-    size_t chunksize;
-	
-    do  {
-        /* Read file in chunks into the scratch buffer */
-        chunksize = fread(chunk, 1, SERVER_HELPER_SCRATCH_BUFSIZE, fd);
-
-        /* Send the buffer contents as HTTP response chunk */
-        if (httpd_resp_send_chunk(req, chunk, chunksize) != ESP_OK)  {
-            fclose(fd);
-            ESP_LOGE(TAG, "File sending failed!");
-			
-            /* Abort sending file */
-            httpd_resp_sendstr_chunk(req, NULL);
-			
-            /* Respond with 500 Internal Server Error */
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send file");
-			
-            return ESP_FAIL;
+
+esp_err_t send_file(httpd_req_t *req, std::string filename)
+{
+    std::string _filename_old = filename;
+    struct stat file_stat;
+    bool _gz_file_exists = false;
+    bool _accepts_gzip = accepts_gzip(req);
+
+    // Part of the firmware (gzip only), as long as the SD card has no other version
+    if (_accepts_gzip && (filename.compare(0, sizeof(ASSET_CACHE_DIRECTORY) - 1, ASSET_CACHE_DIRECTORY) == 0)) {
+        const WebBundleAsset *bundled = getWebBundle().find(filename.substr(sizeof(ASSET_CACHE_DIRECTORY) - 1));
+        if (bundled) {
+            return send_memory_file(req, filename, (const char*) bundled->data, bundled->size, true, bundled->etag);
         }
+    }
 
-        /* Keep looping till the whole file is sent */
-    } while (chunksize != 0);
+    bool cacheable = is_cacheable_asset(filename);
+    std::string cache_key = _accepts_gzip ? filename + ":gzip" : filename;
+    if (cacheable) {
+        std::shared_ptr<const CachedAsset> asset = getAssetCache().get(cache_key);
+        if (asset) {
+            return send_memory_file(req, filename, asset->data, asset->size, asset->gzip, asset->etag.c_str());
+        }
+    }
+
+    ESP_LOGD(TAG, "old filename: %s", filename.c_str());
+    std::string _filename_temp = std::string(filename) + ".gz";
+
+    // Checks whether the file is available as .gz, it gets sent as it is (if the browser accepts it or there is no other)
+    if ((stat(_filename_temp.c_str(), &file_stat) == 0) &&
+        (_accepts_gzip || (stat(filename.c_str(), &file_stat) != 0))) {
+        filename = _filename_temp;
+
+        ESP_LOGD(TAG, "new filename: %s", filename.c_str());
+        _gz_file_exists = true;
+    }
 
-    /* Close file after sending complete */
+    if (cacheable) {
+        std::shared_ptr<const CachedAsset> asset = getAssetCache().load(cache_key, filename, _gz_file_exists);
+        if (asset) {
+            return send_memory_file(req, _filename_old, asset->data, asset->size, asset->gzip, asset->etag.c_str());
+        }
+    }
+
+    FILE *fd = fopen(filename.c_str(), "r");
+    if (!fd)  {
+        ESP_LOGE(TAG, "Failed to read file: %s", filename.c_str());
+		
+        /* Respond with 404 Error */
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, get404());
+        return ESP_FAIL;
+    }
+
+    ESP_LOGD(TAG, "Sending file: %s ...", filename.c_str());
+
+    set_file_headers(req, _filename_old, _gz_file_exists);
+
+    return send_file_chunks(req, fd);
+}
+
+
+/* Sends the rest of the file as HTTP chunks (double buffered, see FileStreamer) and closes it */
+esp_err_t send_file_chunks(httpd_req_t *req, FILE *fd)
+{
+    bool ok = getFileStreamer().send(fd, [req](const char *_data, size_t _len) {
+        return httpd_resp_send_chunk(req, _data, _len) == ESP_OK;
+    });
     fclose(fd);
+
+    if (!ok) {
+        ESP_LOGE(TAG, "File sending failed!");
+
+        /* Abort sending file */
+        httpd_resp_sendstr_chunk(req, NULL);
+
+        /* Respond with 500 Internal Server Error */
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send file");
+
+        return ESP_FAIL;
+    }
+
+    /* Respond with an empty chunk to signal HTTP response completion */
+    httpd_resp_send_chunk(req, NULL, 0);
     ESP_LOGD(TAG, "File sending complete");
-	
-    return ESP_OK;    
+
+    return ESP_OK;
 }
 
+
+void web_files_changed(void)
+{
+    getAssetCache().invalidate();
+    getWebBundle().invalidate();
+}
+
+
 /* Copies the full path into destination buffer and returns
  * pointer to path (skipping the preceding base path) */
 const char* get_path_from_uri(char *dest, const char *base_path, const char *uri, size_t destsize)
@@ -3,6 +3,7 @@
 #ifndef SERVERHELP_H
 #define SERVERHELP_H
 
+#include <stdio.h>
 #include <string>
 //#include <sys/param.h>
 #include "esp_http_server.h"
@@ -11,6 +12,10 @@
 const char* get_path_from_uri(char *dest, const char *base_path, const char *uri, size_t destsize);
 
 esp_err_t send_file(httpd_req_t *req, std::string filename);
+esp_err_t send_file_chunks(httpd_req_t *req, FILE *fd);
+
+// Files in the html folder got changed, drops the cached ones and checks the bundled ones again
+void web_files_changed(void);
 
 esp_err_t set_content_type_from_file(httpd_req_t *req, const char *filename);
 
@@ -27,9 +27,15 @@ https://docs.espressif.com/projects/esp-idf/en/latest/esp32/migration-guides/rel
 #include "errno.h"
 
 #include <sys/stat.h>
+#include <sys/param.h>
+#include <memory>
 
 #include "MainFlowControl.h"
 #include "server_file.h"
+#include "ota_writer.h"
+#include "server_help.h"
+#include "zip_extract.h"
+#include "md5.h"
 #include "server_GPIO.h"
 #ifdef ENABLE_MQTT
     #include "interface_mqtt.h"
@@ -68,6 +74,70 @@ static void infinite_loop(void)
 }
 
 
+/* Compares the version of the new firmware with the one which got rolled back the last time */
+static bool ota_check_header(const uint8_t *_header, size_t _len)
+{
+    esp_app_desc_t new_app_info;
+    memcpy(&new_app_info, &_header[sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t)], sizeof(esp_app_desc_t));
+    ESP_LOGI(TAG, "New firmware version: %s", new_app_info.version);
+
+    esp_app_desc_t running_app_info;
+    if (esp_ota_get_partition_description(esp_ota_get_running_partition(), &running_app_info) == ESP_OK) {
+        ESP_LOGI(TAG, "Running firmware version: %s", running_app_info.version);
+    }
+
+    const esp_partition_t* last_invalid_app = esp_ota_get_last_invalid_partition();
+    esp_app_desc_t invalid_app_info;
+    if (esp_ota_get_partition_description(last_invalid_app, &invalid_app_info) == ESP_OK) {
+        ESP_LOGI(TAG, "Last invalid firmware version: %s", invalid_app_info.version);
+
+        // check current version with last invalid partition
+        if (memcmp(invalid_app_info.version, new_app_info.version, sizeof(new_app_info.version)) == 0) {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "New version is the same as invalid version");
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Previously, there was an attempt to launch the firmware with " + 
+                    string(invalid_app_info.version) + " version, but it failed");
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "The firmware has been rolled back to the previous version");
+            return false;
+        }
+    }
+
+/*
+    if (memcmp(new_app_info.version, running_app_info.version, sizeof(new_app_info.version)) == 0) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Current running version is the same as a new. We will not continue the update");
+        return false;
+    }
+*/
+    return true;
+}
+
+
+// Update during startup: a rejected firmware stops here until the device gets reset
+static bool ota_check_header_or_wait(const uint8_t *_header, size_t _len)
+{
+    if (!ota_check_header(_header, _len)) {
+        infinite_loop();
+    }
+    return true;
+}
+
+
+/* Replaces the html folder with the one extracted to html_tmp */
+static void ota_replace_html(void)
+{
+    std::string outHtml = "/sdcard/html";
+    std::string outHtmlTmp = "/sdcard/html_tmp";
+    std::string outHtmlOld = "/sdcard/html_old";
+
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Renaming folder " + outHtml + " to " + outHtmlOld + "...");
+    RenameFolder(outHtml, outHtmlOld);
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Renaming folder " + outHtmlTmp + " to " + outHtml + "...");
+    RenameFolder(outHtmlTmp, outHtml);
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Deleting folder " + outHtmlOld + "...");
+    removeFolder(outHtmlOld.c_str(), TAG);
+    web_files_changed();
+}
+
+
 void task_do_Update_ZIP(void *pvParameter)
 {
     StatusLED(AP_OR_OTA, 1, true);  // Signaling an OTA update
@@ -78,34 +148,38 @@ void task_do_Update_ZIP(void *pvParameter)
 
     if (filetype == "ZIP")
     {
-        std::string in, outHtml, outHtmlTmp, outHtmlOld, outbin, zw, retfirmware;
+        std::string outHtml, outHtmlTmp, outHtmlOld;
 
         outHtml = "/sdcard/html";
         outHtmlTmp = "/sdcard/html_tmp";
         outHtmlOld = "/sdcard/html_old";
-        outbin = "/sdcard/firmware";
 
         /* Remove the old and tmp html folder in case they still exist */
         removeFolder(outHtmlTmp.c_str(), TAG);
         removeFolder(outHtmlOld.c_str(), TAG);
 
-        /* Extract the ZIP file. The content of the html folder gets extracted to the temporar folder html-temp. */
+        /* Extract the ZIP file. The content of the html folder gets extracted to the temporar folder html-temp,
+         * the firmware gets written directly to the OTA partition. */
+        EspOtaWriter writer;
+        FirmwareStream firmware(&writer, ota_check_header_or_wait);
+
         LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Extracting ZIP file " + _file_name_update + "...");
-        retfirmware = unzip_new(_file_name_update, outHtmlTmp+"/", outHtml+"/", outbin+"/", "/sdcard/", initial_setup);
+        bool unzipped = unzip_new(_file_name_update, outHtmlTmp+"/", outHtml+"/", &firmware, "/sdcard/", initial_setup);
     	LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Files unzipped.");
 
         /* ZIP file got extracted, replace the old html folder with the new one */
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Renaming folder " + outHtml + " to " + outHtmlOld + "...");
-        RenameFolder(outHtml, outHtmlOld);
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Renaming folder " + outHtmlTmp + " to " + outHtml + "...");
-        RenameFolder(outHtmlTmp, outHtml);
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Deleting folder " + outHtmlOld + "...");
-        removeFolder(outHtmlOld.c_str(), TAG);
+        ota_replace_html();
 
-        if (retfirmware.length() > 0)
+        if (firmware.getSize() > 0)
         {
             LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Found firmware.bin");
-            ota_update_task(retfirmware);
+            if (unzipped && firmware.finish()) {
+                LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Firmware written: " + to_string(firmware.getSize()) + " bytes");
+            }
+            else {
+                firmware.abort();
+                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Firmware update failed: " + firmware.getError());
+            }
         }
 
         LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Trigger reboot due to firmware update");
@@ -159,11 +233,6 @@ void CheckUpdate()
 
 static bool ota_update_task(std::string fn)
 {
-    esp_err_t err;
-    /* update handle : set by esp_ota_begin(), must be freed via esp_ota_end() */
-    esp_ota_handle_t update_handle = 0 ;
-    const esp_partition_t *update_partition = NULL;
-
     ESP_LOGI(TAG, "Starting OTA update");
 
     const esp_partition_t *configured = esp_ota_get_boot_partition();
@@ -177,119 +246,30 @@ static bool ota_update_task(std::string fn)
     ESP_LOGI(TAG, "Running partition type %d subtype %d (offset 0x%08x)",
              running->type, running->subtype, (unsigned int)running->address);
 
-
-    update_partition = esp_ota_get_next_update_partition(NULL);
-    ESP_LOGI(TAG, "Writing to partition subtype %d at offset 0x%x",
-             update_partition->subtype, (unsigned int)update_partition->address);
-//    assert(update_partition != NULL);
-
-    int binary_file_length = 0;
-
-    // deal with all receive packet 
-    bool image_header_was_checked = false;
-
-    int data_read;     
-
     FILE* f = fopen(fn.c_str(), "rb");     // previously only "r
 
     if (f == NULL) { // File does not exist
         return false;
     }
 
-    data_read = fread(ota_write_data, 1, SERVER_OTA_SCRATCH_BUFSIZE, f);
-
-    while (data_read > 0) {
-        if (data_read < 0) {
-            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Error: SSL data read error");
-            return false;
-        } else if (data_read > 0) {
-            if (image_header_was_checked == false) {
-                esp_app_desc_t new_app_info;
-                if (data_read > sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t)) {
-                    // check current version with downloading
-                    memcpy(&new_app_info, &ota_write_data[sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t)], sizeof(esp_app_desc_t));
-                    ESP_LOGI(TAG, "New firmware version: %s", new_app_info.version);
-
-                    esp_app_desc_t running_app_info;
-                    if (esp_ota_get_partition_description(running, &running_app_info) == ESP_OK) {
-                        ESP_LOGI(TAG, "Running firmware version: %s", running_app_info.version);
-                    }
-
-                    const esp_partition_t* last_invalid_app = esp_ota_get_last_invalid_partition();
-                    esp_app_desc_t invalid_app_info;
-                    if (esp_ota_get_partition_description(last_invalid_app, &invalid_app_info) == ESP_OK) {
-                        ESP_LOGI(TAG, "Last invalid firmware version: %s", invalid_app_info.version);
-                    }
-
-                    // check current version with last invalid partition
-                    if (last_invalid_app != NULL) {
-                        if (memcmp(invalid_app_info.version, new_app_info.version, sizeof(new_app_info.version)) == 0) {
-                            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "New version is the same as invalid version");
-                            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Previously, there was an attempt to launch the firmware with " + 
-                                    string(invalid_app_info.version) + " version, but it failed");
-                            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "The firmware has been rolled back to the previous version");
-                            infinite_loop();
-                        }
-                    }
+    EspOtaWriter writer;
+    FirmwareStream firmware(&writer, ota_check_header_or_wait);
+    int data_read;
 
-/*
-                    if (memcmp(new_app_info.version, running_app_info.version, sizeof(new_app_info.version)) == 0) {
-                        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Current running version is the same as a new. We will not continue the update");
-                        infinite_loop();
-                    }
-*/
-                    image_header_was_checked = true;
-
-                    err = esp_ota_begin(update_partition, OTA_SIZE_UNKNOWN, &update_handle);
-                    if (err != ESP_OK) {
-                        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "esp_ota_begin failed (" + string(esp_err_to_name(err)) + ")");
-                        return false;
-                    }
-                    ESP_LOGI(TAG, "esp_ota_begin succeeded");
-                } else {
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "received package is not fit len");
-                    return false;
-                }
-            }            
-            err = esp_ota_write( update_handle, (const void *)ota_write_data, data_read);
-            if (err != ESP_OK) {
-                return false;
-            }
-            binary_file_length += data_read;
-            ESP_LOGD(TAG, "Written image length %d", binary_file_length);
-        } else if (data_read == 0) {
-           //
-           // * As esp_http_client_read never returns negative error code, we rely on
-           // * `errno` to check for underlying transport connectivity closure if any
-           //
-            if (errno == ECONNRESET || errno == ENOTCONN) {
-                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Connection closed, errno = " + to_string(errno));
-                break;
-            }
+    while ((data_read = fread(ota_write_data, 1, SERVER_OTA_SCRATCH_BUFSIZE, f)) > 0) {
+        if (!firmware.write(ota_write_data, data_read)) {
+            break;
         }
-        data_read = fread(ota_write_data, 1, SERVER_OTA_SCRATCH_BUFSIZE, f);
     }
     fclose(f);  
 
-    ESP_LOGI(TAG, "Total Write binary data length: %d", binary_file_length);
+    ESP_LOGI(TAG, "Total Write binary data length: %d", (int)firmware.getSize());
 
-    err = esp_ota_end(update_handle);
-    if (err != ESP_OK) {
-        if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
-            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Image validation failed, image is corrupted");
-        }
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "esp_ota_end failed (" + string(esp_err_to_name(err)) + ")!");
+    if (!firmware.finish()) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Firmware update failed: " + firmware.getError());
         return false;
     }
 
-    err = esp_ota_set_boot_partition(update_partition);
-    if (err != ESP_OK) {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "esp_ota_set_boot_partition failed (" + string(esp_err_to_name(err)) + ")!");
-
-    }
-//    ESP_LOGI(TAG, "Prepare to restart system!");
-//    esp_restart();
-
     return true ;
 }
 
@@ -585,6 +565,165 @@ esp_err_t handler_ota_update(httpd_req_t *req)
 }
 
 
+static bool ota_is_md5(const char *_md5)
+{
+    if (strlen(_md5) != 32) {
+        return false;
+    }
+
+    for (int i = 0; i < 32; i++) {
+        if (!isxdigit((unsigned char)_md5[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/* Firmware update while the file gets uploaded: POST /ota_stream?file=<name.bin|name.zip>&md5=<md5 of the file>
+ * A bin file goes straight into the OTA partition, a zip file gets extracted on the fly: the firmware into the
+ * OTA partition, the html folder to html_tmp and everything else to the staging folder. Nothing gets moved into
+ * place or activated before the whole upload is received and its MD5 sum matches. Responds "reboot", the reboot
+ * has to be triggered (/reboot). */
+esp_err_t handler_ota_stream(httpd_req_t *req)
+{
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "handler_ota_stream");
+    const std::string staging = "/sdcard/ota_staging/";
+    char _query[200];
+    char _filename[100] = "";
+    char _md5[34] = "";         // One more than a MD5 sum, to detect a truncated value
+
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    if (httpd_req_get_url_query_str(req, _query, sizeof(_query)) == ESP_OK)
+    {
+        httpd_query_key_value(_query, "file", _filename, sizeof(_filename));
+        httpd_query_key_value(_query, "md5", _md5, sizeof(_md5));
+    }
+
+    if (!ota_is_md5(_md5))
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Parameter md5 (32 hex digits) is required");
+        return ESP_FAIL;
+    }
+
+    std::string filetype = toUpper(getFileType(_filename));
+    if ((filetype != "ZIP") && (filetype != "BIN"))
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Only zip and bin files can be installed directly");
+        return ESP_FAIL;
+    }
+
+    if ((req->content_len == 0) || (req->content_len > MAX_FILE_SIZE))
+    {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Invalid update size: " + to_string(req->content_len) + " bytes");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "File size must be less than " MAX_FILE_SIZE_STR "!");
+        return ESP_FAIL;
+    }
+
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Streaming update: " + std::string(_filename) + ", " + to_string(req->content_len) + " bytes");
+
+    // Like a regular update: no flow and no GPIO handling while the OTA partition gets erased and written
+    DeleteMainFlowTask();
+    gpio_handler_deinit();
+
+    EspOtaWriter writer;
+    FirmwareStream firmware(&writer, ota_check_header);
+    std::unique_ptr<ZipStreamReader> zip;
+
+    if (filetype == "ZIP")
+    {
+        removeFolder("/sdcard/html_tmp", TAG);
+        removeFolder("/sdcard/html_old", TAG);
+        removeFolder(staging.c_str(), TAG);
+        zip.reset(new ZipStreamReader(unzip_stream_handler("/sdcard/html_tmp/", "/sdcard/html/", &firmware, staging)));
+    }
+
+    MD5Context md5;
+    md5Init(&md5);
+
+    std::string error = "";
+    int remaining = req->content_len;
+    int received;
+
+    while (remaining > 0)
+    {
+        if ((received = httpd_req_recv(req, ota_write_data, MIN(remaining, SERVER_OTA_SCRATCH_BUFSIZE))) <= 0)
+        {
+            if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+                /* Retry if timeout occurred */
+                continue;
+            }
+            error = "Failed to receive file";
+            break;
+        }
+
+        md5Update(&md5, (uint8_t*)ota_write_data, received);
+
+        if (zip ? !zip->feed(ota_write_data, received) : !firmware.write(ota_write_data, received))
+        {
+            error = zip ? zip->getError() : firmware.getError();
+            break;
+        }
+        remaining -= received;
+    }
+
+    if (error.empty() && zip && !zip->finish()) {
+        error = zip->getError();
+    }
+
+    if (error.empty())
+    {
+        char hex[3];
+        std::string md5hex = "";
+
+        md5Finalize(&md5);
+        for (int i = 0; i < sizeof(md5.digest); i++) {
+            snprintf(hex, sizeof(hex), "%02x", md5.digest[i]);
+            md5hex.append(hex);
+        }
+
+        if (md5hex != toLower(_md5)) {
+            error = "The file got corrupted (MD5 " + md5hex + ")";
+        }
+    }
+
+    if (error.empty() && ((filetype == "BIN") || (firmware.getSize() > 0)) && !firmware.finish()) {
+        error = firmware.getError();
+    }
+
+    if (!error.empty())
+    {
+        firmware.abort();
+        zip.reset();
+        removeFolder("/sdcard/html_tmp", TAG);
+        removeFolder(staging.c_str(), TAG);
+
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Update failed: " + error);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, ("Update failed: " + error).c_str());
+        return ESP_FAIL;
+    }
+
+    if (zip)
+    {
+        bool committed = unzip_commit_staged(staging);
+        removeFolder(staging.c_str(), TAG);
+        ota_replace_html();
+
+        if (!committed)
+        {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Update incomplete: not all files could be moved into place");
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Update incomplete: not all files could be installed, reboot required");
+            return ESP_FAIL;
+        }
+    }
+
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Update installed (firmware: " + to_string(firmware.getSize()) + " bytes), reboot required");
+    httpd_resp_sendstr(req, "reboot\n");
+    return ESP_OK;
+}
+
+
 void hard_restart() 
 {
   esp_task_wdt_config_t twdt_config = {
@@ -709,6 +848,12 @@ void register_server_ota_sdcard_uri(httpd_handle_t server)
     camuri.user_ctx  = (void*) "Do OTA";    
     httpd_register_uri_handler(server, &camuri);
 
+    camuri.method    = HTTP_POST;
+    camuri.uri       = "/ota_stream";
+    camuri.handler = APPLY_BASIC_AUTH_FILTER(handler_ota_stream);
+    camuri.user_ctx  = (void*) "Streamed OTA";    
+    httpd_register_uri_handler(server, &camuri);
+
     camuri.method    = HTTP_GET;
     camuri.uri       = "/reboot";
     camuri.handler = APPLY_BASIC_AUTH_FILTER(handler_reboot);
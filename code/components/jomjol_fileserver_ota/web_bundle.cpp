@@ -0,0 +1,148 @@
+#include "web_bundle.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "miniz.h"
+
+#ifdef ESP_PLATFORM
+#include "ClassLogFile.h"
+
+static const char *TAG = "WEB_BUNDLE";
+#endif
+
+
+uint32_t web_bundle_hash(const char *_path, uint32_t _seed)
+{
+    uint32_t h = 0x811c9dc5 ^ _seed;        // FNV-1a, has to match make-web-bundle.py
+
+    for (const uint8_t *c = (const uint8_t*) _path; *c != '\0'; ++c) {
+        h ^= *c;
+        h *= 0x01000193;
+    }
+    return h ^ (h >> 16);
+}
+
+
+WebBundle::WebBundle(const WebBundleIndex &_index, const std::string &_directory)
+    : index(_index), directory(_directory)
+{
+}
+
+
+const WebBundleAsset *WebBundle::lookup(const std::string &_path)
+{
+    if (index.count == 0) {
+        return NULL;
+    }
+
+    uint16_t slot = index.slots[web_bundle_hash(_path.c_str(), index.seed) % index.slotCount];
+    if ((slot == 0) || (strcmp(index.assets[slot - 1].path, _path.c_str()) != 0)) {
+        return NULL;
+    }
+    return &index.assets[slot - 1];
+}
+
+
+const WebBundleAsset *WebBundle::find(const std::string &_path)
+{
+    const WebBundleAsset *asset = lookup(_path);
+    if (asset == NULL) {
+        return NULL;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (!checked) {
+        checkOverrides();
+    }
+    return overridden[asset - index.assets] ? NULL : asset;
+}
+
+
+void WebBundle::invalidate(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    checked = false;
+}
+
+
+int WebBundle::getOverrideCount(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (!checked) {
+        checkOverrides();
+    }
+    int count = 0;
+    for (bool o : overridden) {
+        count += o ? 1 : 0;
+    }
+    return count;
+}
+
+
+void WebBundle::checkOverrides(void)
+{
+    overridden.assign(index.count, false);
+
+    for (uint32_t i = 0; i < index.count; ++i) {
+        overridden[i] = isOverridden(index.assets[i]);
+#ifdef ESP_PLATFORM
+        if (overridden[i]) {
+            LogFile.WriteToFile(ESP_LOG_INFO, TAG, std::string(index.assets[i].path) + " differs on the SD card, the SD card version gets used");
+        }
+#endif
+    }
+    checked = true;
+}
+
+
+/* Whether the html folder contains another version of the file (the release has the .gz files, a development
+ * setup the plain ones) */
+bool WebBundle::isOverridden(const WebBundleAsset &_asset)
+{
+    std::string filename = directory + _asset.path;
+    struct stat file_stat;
+
+    FILE *fd = fopen((filename + ".gz").c_str(), "rb");
+    if (fd != NULL) {
+        uint8_t trailer[8];             // CRC32 and size of the uncompressed content
+        bool same = (fseek(fd, -8, SEEK_END) == 0) && (fread(trailer, 1, sizeof(trailer), fd) == sizeof(trailer)) &&
+                    (((uint32_t)trailer[0] | ((uint32_t)trailer[1] << 8) | ((uint32_t)trailer[2] << 16) | ((uint32_t)trailer[3] << 24)) == _asset.originalCrc32) &&
+                    (((uint32_t)trailer[4] | ((uint32_t)trailer[5] << 8) | ((uint32_t)trailer[6] << 16) | ((uint32_t)trailer[7] << 24)) == _asset.originalSize);
+        fclose(fd);
+        if (!same) {
+            return true;
+        }
+    }
+
+    if (stat(filename.c_str(), &file_stat) != 0) {
+        return false;
+    }
+    if ((size_t)file_stat.st_size != _asset.originalSize) {
+        return true;
+    }
+
+    fd = fopen(filename.c_str(), "rb");
+    if (fd == NULL) {
+        return true;
+    }
+
+    uint8_t chunk[512];
+    size_t len;
+    mz_ulong crc = MZ_CRC32_INIT;
+    while ((len = fread(chunk, 1, sizeof(chunk), fd)) > 0) {
+        crc = mz_crc32(crc, chunk, len);
+    }
+    fclose(fd);
+    return crc != _asset.originalCrc32;
+}
+
+
+WebBundle &getWebBundle(void)
+{
+    static WebBundle bundle(webBundleIndex);
+    return bundle;
+}
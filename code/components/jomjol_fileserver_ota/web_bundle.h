@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef WEBBUNDLE_H
+#define WEBBUNDLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include "../../include/defines.h"
+
+
+/* A web UI file which got compiled into the firmware (gzip compressed, lives in the flash) */
+struct WebBundleAsset {
+    const char *path;               // Relative to the html folder, e.g. "common.js"
+    const uint8_t *data;
+    uint32_t size;
+    uint32_t originalSize;          // Uncompressed
+    uint32_t originalCrc32;         // Uncompressed, recognizes the same file on the SD card
+    const char *etag;               // Quoted
+};
+
+
+/* Perfect hash over the paths: slots[web_bundle_hash(path, seed) % slotCount] is the asset index + 1 (0 = empty) */
+struct WebBundleIndex {
+    const WebBundleAsset *assets;
+    uint32_t count;
+    const uint16_t *slots;
+    uint32_t slotCount;
+    uint32_t seed;
+};
+
+
+// Generated by tools/web-bundle/make-web-bundle.py from tools/web-bundle/web-bundle.txt during the build
+extern const WebBundleIndex webBundleIndex;
+
+uint32_t web_bundle_hash(const char *_path, uint32_t _seed);
+
+
+/**
+ * @brief The web UI files which are part of the firmware, so they do not need the SD card.
+ *
+ * A file in the html folder on the SD card overrides the bundled one if its content differs (e.g. a user modified
+ * page). The first find() compares the bundled files with the SD card (size and CRC32, for .gz files taken from
+ * the gzip trailer), after that a lookup only hashes the path. invalidate() lets the next find() check again.
+ */
+class WebBundle {
+public:
+    WebBundle(const WebBundleIndex &_index, const std::string &_directory = ASSET_CACHE_DIRECTORY);
+
+    // Bundled file for _path (relative to the html folder), NULL if it is not bundled or overridden on the SD card
+    const WebBundleAsset *find(const std::string &_path);
+
+    // Bundled file for _path without looking at the SD card
+    const WebBundleAsset *lookup(const std::string &_path);
+
+    void invalidate(void);
+
+    int getOverrideCount(void);
+
+private:
+    const WebBundleIndex &index;
+    std::string directory;
+
+    std::mutex lock;                        // Everything below
+    bool checked = false;
+    std::vector<bool> overridden;
+
+    void checkOverrides(void);
+    bool isOverridden(const WebBundleAsset &_asset);
+};
+
+
+WebBundle &getWebBundle(void);
+
+#endif //WEBBUNDLE_H
@@ -0,0 +1,495 @@
+#include "zip_extract.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+
+// Every allocation starts with its size, so zipFree() knows how much got freed
+struct ZipAllocHeader {
+    size_t size;
+    size_t align;               // Keeps the returned memory 8 byte aligned
+};
+
+
+ZipExtractor::ZipExtractor()
+{
+    memset(&archive, 0, sizeof(archive));
+}
+
+
+ZipExtractor::~ZipExtractor()
+{
+    close();
+}
+
+
+void *ZipExtractor::zipAlloc(void *_opaque, size_t _items, size_t _size)
+{
+    ZipExtractor *extractor = (ZipExtractor*) _opaque;
+    size_t size = _items * _size;
+
+    ZipAllocHeader *header = (ZipAllocHeader*) malloc(sizeof(ZipAllocHeader) + size);
+    if (header == NULL) {
+        return NULL;
+    }
+
+    header->size = size;
+    extractor->allocated += size;
+    extractor->peakAllocated = std::max(extractor->peakAllocated, extractor->allocated);
+    return header + 1;
+}
+
+
+void ZipExtractor::zipFree(void *_opaque, void *_address)
+{
+    if (_address == NULL) {
+        return;
+    }
+
+    ZipExtractor *extractor = (ZipExtractor*) _opaque;
+    ZipAllocHeader *header = ((ZipAllocHeader*) _address) - 1;
+
+    extractor->allocated -= header->size;
+    free(header);
+}
+
+
+void *ZipExtractor::zipRealloc(void *_opaque, void *_address, size_t _items, size_t _size)
+{
+    if (_address == NULL) {
+        return zipAlloc(_opaque, _items, _size);
+    }
+
+    ZipExtractor *extractor = (ZipExtractor*) _opaque;
+    ZipAllocHeader *header = ((ZipAllocHeader*) _address) - 1;
+    size_t oldSize = header->size;
+    size_t size = _items * _size;
+
+    header = (ZipAllocHeader*) realloc(header, sizeof(ZipAllocHeader) + size);
+    if (header == NULL) {
+        return NULL;
+    }
+
+    header->size = size;
+    extractor->allocated = extractor->allocated - oldSize + size;
+    extractor->peakAllocated = std::max(extractor->peakAllocated, extractor->allocated);
+    return header + 1;
+}
+
+
+size_t ZipExtractor::zipWrite(void *_opaque, mz_uint64 _fileOfs, const void *_buf, size_t _n)
+{
+    ZipWrite *write = (ZipWrite*) _opaque;
+    return (*write)(_buf, _n) ? _n : 0;         // Anything else than _n stops miniz
+}
+
+
+bool ZipExtractor::open(const std::string &_zipFile)
+{
+    close();
+
+    memset(&archive, 0, sizeof(archive));
+    archive.m_pAlloc = zipAlloc;
+    archive.m_pFree = zipFree;
+    archive.m_pRealloc = zipRealloc;
+    archive.m_pAlloc_opaque = this;
+
+    isOpen = mz_zip_reader_init_file(&archive, _zipFile.c_str(), 0);
+    return isOpen;
+}
+
+
+void ZipExtractor::close(void)
+{
+    if (isOpen) {
+        mz_zip_reader_end(&archive);
+        isOpen = false;
+    }
+}
+
+
+int ZipExtractor::getEntryCount(void)
+{
+    return isOpen ? (int)mz_zip_reader_get_num_files(&archive) : 0;
+}
+
+
+bool ZipExtractor::getEntry(int _index, ZipEntry *_entry)
+{
+    mz_zip_archive_file_stat fileStat;
+
+    if (!isOpen || !mz_zip_reader_file_stat(&archive, _index, &fileStat)) {
+        return false;
+    }
+
+    _entry->name = fileStat.m_filename;
+    _entry->size = fileStat.m_uncomp_size;
+    _entry->isDirectory = fileStat.m_is_directory;
+    return true;
+}
+
+
+bool ZipExtractor::extract(int _index, ZipWrite _write)
+{
+    return isOpen && mz_zip_reader_extract_to_callback(&archive, _index, zipWrite, &_write, 0);
+}
+
+
+bool ZipExtractor::extractToFile(int _index, const std::string &_file)
+{
+    FILE *file = fopen(_file.c_str(), "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    bool ok = extract(_index, [file](const void *_data, size_t _len) {
+        return fwrite(_data, 1, _len, file) == _len;
+    });
+
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+
+std::string ZipExtractor::getError(void)
+{
+    return mz_zip_get_error_string(mz_zip_get_last_error(&archive));
+}
+
+
+/*******************************************************************
+ * ZipStreamReader
+ *******************************************************************/
+#define ZIP_LOCAL_HEADER_SIG        0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG      0x02014b50
+#define ZIP_END_OF_CENTRAL_DIR_SIG  0x06054b50
+#define ZIP_DATA_DESCRIPTOR_SIG     0x08074b50
+#define ZIP_LOCAL_HEADER_LEN        30
+
+#define ZIP_FLAG_ENCRYPTED          0x0001
+#define ZIP_FLAG_DATA_DESCRIPTOR    0x0008
+#define ZIP_METHOD_STORED           0
+#define ZIP_METHOD_DEFLATED         8
+#define ZIP_EXTRA_ZIP64             0x0001
+
+
+static uint16_t zipRead16(const uint8_t *_p)
+{
+    return _p[0] | (_p[1] << 8);
+}
+
+
+static uint32_t zipRead32(const uint8_t *_p)
+{
+    return _p[0] | (_p[1] << 8) | (_p[2] << 16) | ((uint32_t)_p[3] << 24);
+}
+
+
+static uint64_t zipRead64(const uint8_t *_p)
+{
+    return zipRead32(_p) | ((uint64_t)zipRead32(_p + 4) << 32);
+}
+
+
+ZipStreamReader::ZipStreamReader(ZipStreamHandler _handler) : handler(_handler)
+{
+    inflator = (tinfl_decompressor*) malloc(sizeof(tinfl_decompressor));
+    dictionary = (uint8_t*) malloc(TINFL_LZ_DICT_SIZE);
+
+    if ((inflator == NULL) || (dictionary == NULL)) {
+        fail("Not enough memory to inflate");
+    }
+}
+
+
+ZipStreamReader::~ZipStreamReader()
+{
+    if (entryWrite) {
+        handler.end(entry, false);
+    }
+
+    free(inflator);
+    free(dictionary);
+}
+
+
+bool ZipStreamReader::fail(const std::string &_error)
+{
+    if (entryWrite) {                   // Let the handler clean up the unfinished entry
+        entryWrite = nullptr;
+        handler.end(entry, false);
+    }
+
+    error = _error;
+    state = ZIP_FAILED;
+    return false;
+}
+
+
+bool ZipStreamReader::feed(const void *_data, size_t _len)
+{
+    const uint8_t *data = (const uint8_t*) _data;
+
+    while (_len > 0) {
+        State before = state;
+        size_t used;
+
+        switch (state) {
+            case ZIP_HEADER:        used = feedHeader(data, _len); break;
+            case ZIP_NAME:          used = feedName(data, _len); break;
+            case ZIP_DATA:          used = (method == ZIP_METHOD_STORED) ? feedStored(data, _len) : feedDeflated(data, _len); break;
+            case ZIP_DESCRIPTOR:    used = feedDescriptor(data, _len); break;
+            case ZIP_DONE:          return true;        // Central directory, everything is known already
+            default:                return false;
+        }
+
+        if (state == ZIP_FAILED) {
+            return false;
+        }
+        if ((used == 0) && (state == before)) {
+            return fail("Inflating " + entry.name + " makes no progress");
+        }
+
+        data += used;
+        _len -= used;
+    }
+
+    return true;
+}
+
+
+bool ZipStreamReader::finish(void)
+{
+    if (state == ZIP_DONE) {
+        return true;
+    }
+    if (state == ZIP_FAILED) {
+        return false;
+    }
+    return fail("ZIP file is incomplete");
+}
+
+
+size_t ZipStreamReader::feedHeader(const uint8_t *_data, size_t _len)
+{
+    size_t part = std::min(_len, (size_t)ZIP_LOCAL_HEADER_LEN - fixedLen);
+    memcpy(fixed + fixedLen, _data, part);
+    fixedLen += part;
+
+    if ((fixedLen >= 4) && (zipRead32(fixed) != ZIP_LOCAL_HEADER_SIG)) {
+        uint32_t signature = zipRead32(fixed);
+        if ((signature == ZIP_CENTRAL_HEADER_SIG) || (signature == ZIP_END_OF_CENTRAL_DIR_SIG)) {
+            state = ZIP_DONE;           // All entries passed
+            return part;
+        }
+        fail("Not a ZIP file or damaged (no local header)");
+        return part;
+    }
+
+    if (fixedLen < ZIP_LOCAL_HEADER_LEN) {
+        return part;
+    }
+
+    uint16_t flags = zipRead16(fixed + 6);
+    uint32_t compressedSize = zipRead32(fixed + 18);
+    uint32_t size = zipRead32(fixed + 22);
+
+    method = zipRead16(fixed + 8);
+    expectedCrc = zipRead32(fixed + 14);
+    nameLen = zipRead16(fixed + 26);
+    extraLen = zipRead16(fixed + 28);
+    hasDescriptor = (flags & ZIP_FLAG_DATA_DESCRIPTOR) != 0;
+    fixedLen = 0;
+
+    if (flags & ZIP_FLAG_ENCRYPTED) {
+        fail("Encrypted ZIP files are not supported");
+    }
+    else if ((method != ZIP_METHOD_STORED) && (method != ZIP_METHOD_DEFLATED)) {
+        fail("Compression method " + std::to_string(method) + " is not supported");
+    }
+    else if ((method == ZIP_METHOD_STORED) && hasDescriptor) {
+        fail("Stored entries without size are not supported");     // The end could not be found
+    }
+    else {
+        // 0xFFFFFFFF: ZIP64, the sizes are in the extra field
+        zip64 = (compressedSize == 0xFFFFFFFF) || (size == 0xFFFFFFFF);
+        remaining = compressedSize;
+        entry.size = size;
+        name.clear();
+        state = ZIP_NAME;
+    }
+
+    return part;
+}
+
+
+size_t ZipStreamReader::feedName(const uint8_t *_data, size_t _len)
+{
+    size_t part = std::min(_len, nameLen + extraLen - name.size());
+    name.append((const char*) _data, part);
+
+    if (name.size() == nameLen + extraLen) {
+        const uint8_t *extra = (const uint8_t*) name.data() + nameLen;
+
+        // Only the ZIP64 sizes are needed from the extra field
+        for (size_t pos = 0; zip64 && (pos + 4 <= extraLen); pos += 4 + zipRead16(extra + pos + 2)) {
+            if ((zipRead16(extra + pos) == ZIP_EXTRA_ZIP64) && (zipRead16(extra + pos + 2) >= 16) && (pos + 20 <= extraLen)) {
+                entry.size = zipRead64(extra + pos + 4);
+                remaining = zipRead64(extra + pos + 12);
+                break;
+            }
+        }
+
+        name.resize(nameLen);
+        startEntry();
+    }
+
+    return part;
+}
+
+
+bool ZipStreamReader::startEntry(void)
+{
+    entry.name = name;
+    entry.isDirectory = (name.length() > 0) && (name.back() == '/');
+    crc = (uint32_t) mz_crc32(0, NULL, 0);
+
+    if (!entry.isDirectory && handler.begin) {
+        entryWrite = handler.begin(entry);
+    }
+
+    if (method == ZIP_METHOD_DEFLATED) {
+        tinfl_init(inflator);
+        dictionaryOfs = 0;
+    }
+
+    state = ZIP_DATA;
+    if (!hasDescriptor && (remaining == 0)) {
+        return endEntry();
+    }
+    return true;
+}
+
+
+bool ZipStreamReader::output(const uint8_t *_data, size_t _len)
+{
+    crc = (uint32_t) mz_crc32(crc, _data, _len);
+
+    if (entryWrite && !entryWrite(_data, _len)) {
+        return fail("Writing " + entry.name + " failed");
+    }
+    return true;
+}
+
+
+size_t ZipStreamReader::feedStored(const uint8_t *_data, size_t _len)
+{
+    size_t part = (size_t) std::min((uint64_t)_len, remaining);
+
+    if (!output(_data, part)) {
+        return part;
+    }
+
+    remaining -= part;
+    if (remaining == 0) {
+        endEntry();
+    }
+    return part;
+}
+
+
+size_t ZipStreamReader::feedDeflated(const uint8_t *_data, size_t _len)
+{
+    size_t consumed = 0;
+
+    while (state == ZIP_DATA) {
+        size_t inBytes = _len - consumed;
+        if (!hasDescriptor) {
+            inBytes = (size_t) std::min((uint64_t)inBytes, remaining);
+        }
+        // Without more input the inflator has to finish, else it waits for the next part
+        bool moreInput = hasDescriptor || (inBytes < remaining);
+        size_t outBytes = TINFL_LZ_DICT_SIZE - dictionaryOfs;
+
+        tinfl_status status = tinfl_decompress(inflator, _data + consumed, &inBytes, dictionary, dictionary + dictionaryOfs,
+                                               &outBytes, moreInput ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+        consumed += inBytes;
+        if (!hasDescriptor) {
+            remaining -= inBytes;
+        }
+
+        if ((outBytes > 0) && !output(dictionary + dictionaryOfs, outBytes)) {
+            break;
+        }
+        dictionaryOfs = (dictionaryOfs + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+        if (status == TINFL_STATUS_DONE) {
+            endEntry();
+        }
+        else if (status < 0) {
+            fail("Inflating " + entry.name + " failed (" + std::to_string(status) + ")");
+        }
+        else if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+            break;
+        }
+        // TINFL_STATUS_HAS_MORE_OUTPUT: the dictionary got filled, continue with the same input
+    }
+
+    return consumed;
+}
+
+
+size_t ZipStreamReader::feedDescriptor(const uint8_t *_data, size_t _len)
+{
+    // The signature of the data descriptor is optional, ZIP64 entries have 8 byte sizes
+    size_t descriptorLen = zip64 ? 20 : 12;
+    size_t needed = ((fixedLen >= 4) && (zipRead32(fixed) == ZIP_DATA_DESCRIPTOR_SIG)) ? descriptorLen + 4 : descriptorLen;
+    size_t part = std::min(_len, ((fixedLen < 4) ? 4 : needed) - fixedLen);
+
+    memcpy(fixed + fixedLen, _data, part);
+    fixedLen += part;
+
+    if (fixedLen >= 4) {
+        needed = (zipRead32(fixed) == ZIP_DATA_DESCRIPTOR_SIG) ? descriptorLen + 4 : descriptorLen;
+        if (fixedLen == needed) {
+            const uint8_t *descriptor = fixed + needed - descriptorLen;
+            expectedCrc = zipRead32(descriptor);
+            entry.size = zip64 ? zipRead64(descriptor + 12) : zipRead32(descriptor + 8);
+            fixedLen = 0;
+            endEntry();
+        }
+    }
+
+    return part;
+}
+
+
+bool ZipStreamReader::endEntry(void)
+{
+    if (hasDescriptor && (state == ZIP_DATA)) {
+        state = ZIP_DESCRIPTOR;         // CRC and size follow the data
+        fixedLen = 0;
+        return true;
+    }
+
+    bool ok = (crc == expectedCrc) && (remaining == 0);
+    bool written = true;
+
+    if (entryWrite) {
+        entryWrite = nullptr;
+        written = handler.end(entry, ok);
+    }
+
+    state = ZIP_HEADER;
+    fixedLen = 0;
+
+    if (!ok) {
+        return fail(entry.name + " is damaged (CRC mismatch)");
+    }
+    if (!written) {
+        return fail("Completing " + entry.name + " failed");
+    }
+    return true;
+}
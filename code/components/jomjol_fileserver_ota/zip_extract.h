@@ -0,0 +1,122 @@
+#pragma once
+
+#ifndef ZIPEXTRACT_H
+#define ZIPEXTRACT_H
+
+#include <stdint.h>
+#include <string>
+#include <functional>
+
+#include "miniz.h"
+
+
+struct ZipEntry {
+    std::string name;
+    uint64_t size;              // Uncompressed
+    bool isDirectory;
+};
+
+// Gets the uncompressed data of an entry piece by piece, false aborts the extraction
+typedef std::function<bool(const void *_data, size_t _len)> ZipWrite;
+
+
+/* Extracts the entries of a ZIP file without having a complete entry in memory.
+ * The archive is opened once, miniz inflates into its 32 kB dictionary and every filled part of it
+ * is handed to the writer (file, OTA partition, ...). The memory needed is independent of the size
+ * of the entries: the central directory, the read buffer (max. 64 kB) and the dictionary.
+ * All allocations of miniz go through this class, getPeakAllocation() reports the maximum. */
+class ZipExtractor {
+public:
+    ZipExtractor();
+    ~ZipExtractor();
+
+    ZipExtractor(const ZipExtractor&) = delete;
+    ZipExtractor& operator=(const ZipExtractor&) = delete;
+
+    bool open(const std::string &_zipFile);
+    void close(void);
+
+    int getEntryCount(void);
+    bool getEntry(int _index, ZipEntry *_entry);
+
+    bool extract(int _index, ZipWrite _write);
+    bool extractToFile(int _index, const std::string &_file);
+
+    std::string getError(void);
+    size_t getPeakAllocation(void) { return peakAllocated; };
+
+private:
+    mz_zip_archive archive;
+    bool isOpen = false;
+    size_t allocated = 0;
+    size_t peakAllocated = 0;
+
+    static void *zipAlloc(void *_opaque, size_t _items, size_t _size);
+    static void zipFree(void *_opaque, void *_address);
+    static void *zipRealloc(void *_opaque, void *_address, size_t _items, size_t _size);
+    static size_t zipWrite(void *_opaque, mz_uint64 _fileOfs, const void *_buf, size_t _n);
+};
+
+
+struct ZipStreamHandler {
+    std::function<ZipWrite(const ZipEntry &_entry)> begin;      // Returns an empty ZipWrite to skip the entry
+    std::function<bool(const ZipEntry &_entry, bool _ok)> end;  // _ok: complete and CRC matches, false aborts
+};
+
+
+/* Extracts a ZIP file while it is received (HTTP upload), the archive is never stored.
+ * The central directory is at the end of the file, so the entries are taken from their local headers
+ * in the order they appear. Entries with a data descriptor (sizes unknown in the local header) are
+ * supported if they are deflated, the end of the deflate stream marks the end of the entry (zip -, ZIP64).
+ * Needs the inflate state and its 32 kB dictionary, independent of the size of the archive. */
+class ZipStreamReader {
+public:
+    ZipStreamReader(ZipStreamHandler _handler);
+    ~ZipStreamReader();
+
+    ZipStreamReader(const ZipStreamReader&) = delete;
+    ZipStreamReader& operator=(const ZipStreamReader&) = delete;
+
+    bool feed(const void *_data, size_t _len);     // Next part of the archive, false on any error
+    bool finish(void);                              // All data fed, false if the archive is incomplete
+
+    std::string getError(void) { return error; };
+
+private:
+    enum State { ZIP_HEADER, ZIP_NAME, ZIP_DATA, ZIP_DESCRIPTOR, ZIP_DONE, ZIP_FAILED };
+
+    ZipStreamHandler handler;
+    State state = ZIP_HEADER;
+    std::string error;
+
+    uint8_t fixed[30];                  // Local header / data descriptor
+    size_t fixedLen = 0;
+    std::string name;
+    size_t nameLen = 0;
+    size_t extraLen = 0;
+
+    ZipEntry entry;
+    ZipWrite entryWrite;
+    uint16_t method = 0;
+    bool hasDescriptor = false;
+    bool zip64 = false;
+    uint32_t crc = 0;
+    uint32_t expectedCrc = 0;
+    uint64_t remaining = 0;             // Compressed bytes left (known sizes only)
+
+    tinfl_decompressor *inflator = NULL;
+    uint8_t *dictionary = NULL;
+    size_t dictionaryOfs = 0;
+
+    bool fail(const std::string &_error);
+    bool startEntry(void);
+    bool output(const uint8_t *_data, size_t _len);
+    bool endEntry(void);
+    size_t feedHeader(const uint8_t *_data, size_t _len);
+    size_t feedName(const uint8_t *_data, size_t _len);
+    size_t feedStored(const uint8_t *_data, size_t _len);
+    size_t feedDeflated(const uint8_t *_data, size_t _len);
+    size_t feedDescriptor(const uint8_t *_data, size_t _len);
+};
+
+#endif //ZIPEXTRACT_H
@@ -0,0 +1,249 @@
+#include "zip_stream.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "miniz.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#include "psram.h"
+#else
+#include <stdlib.h>
+#endif
+
+
+static void *zip_directory_realloc(void *_ptr, size_t _size)
+{
+#ifdef ESP_PLATFORM
+    return realloc_psram_heap("ZipDirectory", _ptr, _size, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+#else
+    return realloc(_ptr, _size);
+#endif
+}
+
+
+static void zip_directory_free(void *_ptr)
+{
+    if (_ptr == NULL) {
+        return;
+    }
+#ifdef ESP_PLATFORM
+    free_psram_heap("ZipDirectory", _ptr);
+#else
+    free(_ptr);
+#endif
+}
+
+
+static void put16(std::string &_out, uint16_t _value)
+{
+    _out.push_back(_value & 0xFF);
+    _out.push_back(_value >> 8);
+}
+
+
+static void put32(std::string &_out, uint32_t _value)
+{
+    put16(_out, _value & 0xFFFF);
+    put16(_out, _value >> 16);
+}
+
+
+ZipStreamWriter::ZipStreamWriter(FileStreamSink _sink) : sink(_sink)
+{
+    buffer.reserve(ZIP_STREAM_BUFFER_SIZE);
+}
+
+
+ZipStreamWriter::~ZipStreamWriter()
+{
+    zip_directory_free(entries);
+    zip_directory_free(names);
+}
+
+
+/* Room for one more entry and _names more bytes of names, both blocks grow by doubling */
+bool ZipStreamWriter::reserve(size_t _names)
+{
+    if (entryCount == entryCapacity) {
+        size_t capacity = (entryCapacity > 0) ? 2 * entryCapacity : 64;
+        Entry *grown = (Entry*) zip_directory_realloc(entries, capacity * sizeof(Entry));
+        if (grown == NULL) {
+            return false;
+        }
+        entries = grown;
+        entryCapacity = capacity;
+    }
+
+    if (namesSize + _names > namesCapacity) {
+        size_t capacity = std::max(2 * namesCapacity, namesSize + _names + 1024);
+        char *grown = (char*) zip_directory_realloc(names, capacity);
+        if (grown == NULL) {
+            return false;
+        }
+        names = grown;
+        namesCapacity = capacity;
+    }
+    return true;
+}
+
+
+void ZipStreamWriter::emit(const void *_data, size_t _len)
+{
+    if (failed) {
+        return;
+    }
+
+    if (_len >= ZIP_STREAM_BUFFER_SIZE) {
+        failed = !flush() || !sink((const char*) _data, _len);
+    }
+    else {
+        if (buffer.size() + _len > ZIP_STREAM_BUFFER_SIZE) {
+            flush();
+        }
+        buffer.append((const char*) _data, _len);
+    }
+    written += _len;
+}
+
+
+bool ZipStreamWriter::flush(void)
+{
+    if (!failed && !buffer.empty()) {
+        failed = !sink(buffer.data(), buffer.size());
+    }
+    buffer.clear();
+    return !failed;
+}
+
+
+bool ZipStreamWriter::beginEntry(const std::string &_name, const struct tm *_modified)
+{
+    if (inEntry && !endEntry()) {
+        return false;
+    }
+
+    if (failed || (_name.length() > UINT16_MAX) || !reserve(_name.length())) {
+        failed = true;
+        return false;
+    }
+
+    Entry entry;
+    entry.nameOffset = namesSize;
+    entry.nameLength = _name.length();
+    entry.crc = MZ_CRC32_INIT;
+    entry.size = 0;
+    entry.offset = written;
+
+    if (_modified && (_modified->tm_year >= 80)) {
+        entry.dosTime = (_modified->tm_hour << 11) | (_modified->tm_min << 5) | (_modified->tm_sec / 2);
+        entry.dosDate = ((_modified->tm_year - 80) << 9) | ((_modified->tm_mon + 1) << 5) | _modified->tm_mday;
+    }
+    else {
+        entry.dosTime = 0;
+        entry.dosDate = (1 << 5) | 1;   // 1980-01-01
+    }
+
+    // Local file header, CRC and sizes follow in the data descriptor (flag bit 3)
+    std::string header;
+    put32(header, 0x04034b50);
+    put16(header, 20);                  // Version needed to extract
+    put16(header, 0x0008);              // Flags
+    put16(header, 0);                   // Stored
+    put16(header, entry.dosTime);
+    put16(header, entry.dosDate);
+    put32(header, 0);                   // CRC
+    put32(header, 0);                   // Compressed size
+    put32(header, 0);                   // Uncompressed size
+    put16(header, _name.length());
+    put16(header, 0);                   // Extra field length
+    header += _name;
+
+    memcpy(names + namesSize, _name.data(), _name.length());
+    namesSize += _name.length();
+    entries[entryCount++] = entry;
+    inEntry = true;
+    emit(header.data(), header.size());
+    return !failed;
+}
+
+
+bool ZipStreamWriter::write(const void *_data, size_t _len)
+{
+    if (!inEntry) {
+        return false;
+    }
+
+    Entry &entry = entries[entryCount - 1];
+    entry.crc = mz_crc32(entry.crc, (const unsigned char*) _data, _len);
+    entry.size += _len;
+    emit(_data, _len);
+    return !failed;
+}
+
+
+bool ZipStreamWriter::endEntry(void)
+{
+    if (!inEntry) {
+        return false;
+    }
+    inEntry = false;
+
+    const Entry &entry = entries[entryCount - 1];
+    std::string descriptor;
+    put32(descriptor, 0x08074b50);
+    put32(descriptor, entry.crc);
+    put32(descriptor, entry.size);
+    put32(descriptor, entry.size);
+    emit(descriptor.data(), descriptor.size());
+    return !failed;
+}
+
+
+bool ZipStreamWriter::finish(void)
+{
+    if (inEntry && !endEntry()) {
+        return false;
+    }
+
+    uint32_t directoryOffset = written;
+    std::string header;
+
+    for (size_t i = 0; i < entryCount; ++i) {
+        const Entry &entry = entries[i];
+        header.clear();
+        put32(header, 0x02014b50);
+        put16(header, 20);              // Version made by
+        put16(header, 20);              // Version needed to extract
+        put16(header, 0x0008);
+        put16(header, 0);
+        put16(header, entry.dosTime);
+        put16(header, entry.dosDate);
+        put32(header, entry.crc);
+        put32(header, entry.size);
+        put32(header, entry.size);
+        put16(header, entry.nameLength);
+        put16(header, 0);               // Extra field length
+        put16(header, 0);               // Comment length
+        put16(header, 0);               // Disk number
+        put16(header, 0);               // Internal attributes
+        put32(header, 0);               // External attributes
+        put32(header, entry.offset);
+        header.append(names + entry.nameOffset, entry.nameLength);
+        emit(header.data(), header.size());
+    }
+
+    header.clear();
+    put32(header, 0x06054b50);
+    put16(header, 0);
+    put16(header, 0);
+    put16(header, entryCount);
+    put16(header, entryCount);
+    put32(header, written - directoryOffset);
+    put32(header, directoryOffset);
+    put16(header, 0);                   // Comment length
+    emit(header.data(), header.size());
+
+    return flush();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef ZIPSTREAM_H
+#define ZIPSTREAM_H
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+
+#include "file_stream.h"
+#include "../../include/defines.h"
+
+
+/* Writes a ZIP archive to a sink while it gets created, e.g. as chunked HTTP response.
+ * The entries are stored without compression (the images are JPGs anyway), their CRC and size
+ * follow the data in a data descriptor, so nothing has to be known in advance or seeked back to.
+ * Small pieces (headers) are collected up to ZIP_STREAM_BUFFER_SIZE bytes before they go to the sink.
+ * Only the central directory stays in memory until finish(): 20 bytes per entry plus its name, both in
+ * one block each in the PSRAM (no allocation per entry). */
+class ZipStreamWriter {
+public:
+    explicit ZipStreamWriter(FileStreamSink _sink);
+    ~ZipStreamWriter();
+
+    ZipStreamWriter(const ZipStreamWriter&) = delete;
+    ZipStreamWriter& operator=(const ZipStreamWriter&) = delete;
+
+    bool beginEntry(const std::string &_name, const struct tm *_modified = NULL);
+    bool write(const void *_data, size_t _len);
+    bool endEntry(void);
+
+    // Writes the central directory, the archive is complete afterwards
+    bool finish(void);
+
+    bool ok(void) { return !failed; };
+    int getEntryCount(void) { return entryCount; };
+
+private:
+    struct Entry {
+        uint32_t nameOffset;    // In names
+        uint16_t nameLength;
+        uint16_t dosTime;
+        uint16_t dosDate;
+        uint32_t crc;
+        uint32_t size;
+        uint32_t offset;
+    };
+
+    FileStreamSink sink;
+    Entry *entries = NULL;
+    size_t entryCount = 0;
+    size_t entryCapacity = 0;
+    char *names = NULL;
+    size_t namesSize = 0;
+    size_t namesCapacity = 0;
+    std::string buffer;
+    uint32_t written = 0;       // Bytes of the archive so far
+    bool inEntry = false;
+    bool failed = false;
+
+    void emit(const void *_data, size_t _len);
+    bool flush(void);
+    bool reserve(size_t _names);
+};
+
+#endif //ZIPSTREAM_H
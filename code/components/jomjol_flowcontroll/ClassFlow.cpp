@@ -58,6 +58,30 @@ bool ClassFlow::ReadParameter(FILE* pfile, string &aktparamgraph)
 	return false;
 }
 
+bool ClassFlow::ReadConfigSection(ConfigSection &_section)
+{
+	string aktparamgraph = _section.name.toString();
+	FILE* pfile = NULL;
+
+	if (_section.body.len > 0)
+	{
+		pfile = fmemopen((void*)_section.body.str, _section.body.len, "r");
+		if (pfile == NULL)
+		{
+			ESP_LOGE(TAG, "Failed to open section %s", aktparamgraph.c_str());
+			return false;
+		}
+	}
+
+	bool result = ReadParameter(pfile, aktparamgraph);
+
+	if (pfile)
+	{
+		fclose(pfile);
+	}
+	return result;
+}
+
 bool ClassFlow::doFlow(string time)
 {
 	return false;
@@ -95,10 +119,8 @@ bool ClassFlow::getNextLine(FILE* pfile, string *rt)
 	if (!fgets(zw, 1024, pfile))
 	{
 		*rt = "";
-		ESP_LOGD(TAG, "END OF FILE");
 		return false;
 	}
-	ESP_LOGD(TAG, "%s", zw);
 	*rt = zw;
 	*rt = trim(*rt);
 	while ((zw[0] == ';' || zw[0] == '#' || (rt->size() == 0)) && !(zw[1] == '['))
@@ -106,7 +128,6 @@ bool ClassFlow::getNextLine(FILE* pfile, string *rt)
 		*rt = "";
 		if (!fgets(zw, 1024, pfile))
 			return false;
-		ESP_LOGD(TAG, "%s", zw);
 		*rt = zw;
 		*rt = trim(*rt);
 	}
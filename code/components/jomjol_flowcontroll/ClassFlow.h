@@ -6,12 +6,16 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <memory>
 
 #include "Helper.h"
 #include "CImageBasis.h"
+#include "configParser.h"
 
 using namespace std;
 
+struct NumberPost;
+
 struct HTMLInfo
 {
 	float val;
@@ -38,16 +42,31 @@ protected:
 
 	bool disabled;
 
+	// Parameters of the config section, filled once in the constructor by steps which override ReadConfigSection()
+	ConfigParamTable configParams;
+
 public:
 	ClassFlow(void);
 	ClassFlow(std::vector<ClassFlow*> * lfc);
 	ClassFlow(std::vector<ClassFlow*> * lfc, ClassFlow *_prev);	
+	virtual ~ClassFlow() {};
 	
 	virtual bool ReadParameter(FILE* pfile, string &aktparamgraph);
+	// Reads one section of the parsed config.ini. Steps which have no parameter table (configParams)
+	// yet get the section passed to their line based ReadParameter() from memory.
+	virtual bool ReadConfigSection(ConfigSection &_section);
 	virtual bool doFlow(string time);
 	virtual string getHTMLSingleStep(string host);
 	virtual string name(){return "ClassFlow";};
 
+	// Steps which only publish results (MQTT, InfluxDB, ...) can be run decoupled from the
+	// flow task on a snapshot of the numbers (see ClassFlowControll::PipelinedPublishing)
+	virtual bool isPublisher(){return false;};
+	virtual bool doPublish(string time, std::vector<NumberPost*>* numbers){return doFlow(time);};
+	// Publishers which upload the image get an encoded copy, taken by the flow task when the round gets queued
+	virtual std::shared_ptr<CJpegData> createPublishImage(std::vector<NumberPost*>* numbers){return nullptr;};
+	virtual bool doPublishWithImage(string time, std::vector<NumberPost*>* numbers, CJpegData *image){return doPublish(time, numbers);};
+
 };
 
 #endif //CLASSFLOW_H
\ No newline at end of file
@@ -7,6 +7,8 @@
 
 #include "CTfLiteClass.h"
 #include "ClassLogFile.h"
+#include "parallel_for.h"
+#include "metrics_registry.h"
 #include "esp_log.h"
 #include "../../include/defines.h"
 
@@ -33,6 +35,49 @@ ClassFlowCNNGeneral::ClassFlowCNNGeneral(ClassFlowAlignment *_flowalign, t_CNNTy
     CNNType = _cnntype;
     flowpostalignment = _flowalign;
     imagesRetention = 5;
+
+    SetupConfigParams();
+}
+
+
+void ClassFlowCNNGeneral::SetupConfigParams(void) {
+    configParams.add("ROIImagesLocation", [this](const ConfigEntry &_entry) {
+        imagesLocation = "/sdcard" + _entry.asString();
+        isLogImage = true;
+    });
+    configParams.add("ROIImagesFormat", [this](const ConfigEntry &_entry) {
+        imagesPacked = _entry.value().equalsIgnoreCase("PACKED");
+    });
+    configParams.add("LogImageSelect", [this](const ConfigEntry &_entry) {
+        LogImageSelect = _entry.asString();
+        isLogImageSelect = true;
+    });
+    configParams.add("ROIImagesRetention", [this](const ConfigEntry &_entry) {
+        if (_entry.isNumeric()) {
+            imagesRetention = _entry.asInt();
+        }
+    });
+    configParams.addString("Model", &cnnmodelfile);
+    configParams.addFloat("CNNGoodThreshold", &CNNGoodThreshold);
+    configParams.addBool("SaveAllFiles", &SaveAllFiles);
+
+    // All other lines are ROIs: "<number>.<roi> x y dx dy [CCW]"
+    configParams.setDefault([this](const ConfigEntry &_entry) {
+        if (_entry.valueCount() < 4) {
+            return;
+        }
+
+        general* _analog = GetGENERAL(_entry.key.toString(), true);
+        roi* neuroi = _analog->ROI[_analog->ROI.size()-1];
+        neuroi->posx = _entry.asInt(0);
+        neuroi->posy = _entry.asInt(1);
+        neuroi->deltax = _entry.asInt(2);
+        neuroi->deltay = _entry.asInt(3);
+        neuroi->CCW = _entry.value(4).equalsIgnoreCase("TRUE");
+        neuroi->result_float = -1;
+        neuroi->image = NULL;
+        neuroi->image_org = NULL;
+    });
 }
 
 string ClassFlowCNNGeneral::getReadout(int _analog = 0, bool _extendedResolution, int prev, float _before_narrow_Analog, float AnalogToDigitTransitionStart) {
@@ -300,81 +345,19 @@ int ClassFlowCNNGeneral::PointerEvalAnalogNew(float number, int numeral_preceder
     return result;
 }
 
-bool ClassFlowCNNGeneral::ReadParameter(FILE* pfile, string& aktparamgraph) {
-    std::vector<string> splitted;
-
-    aktparamgraph = trim(aktparamgraph);
-
-    if (aktparamgraph.size() == 0) {
-        if (!this->GetNextParagraph(pfile, aktparamgraph)) {
-            return false;
-        }
-    }
-
-    if ((toUpper(aktparamgraph) != "[ANALOG]") && (toUpper(aktparamgraph) != ";[ANALOG]") 
-        && (toUpper(aktparamgraph) != "[DIGIT]") && (toUpper(aktparamgraph) != ";[DIGIT]")
-        && (toUpper(aktparamgraph) != "[DIGITS]") && (toUpper(aktparamgraph) != ";[DIGITS]")) {      
+bool ClassFlowCNNGeneral::ReadConfigSection(ConfigSection &_section) {
+    if (!_section.isNamed("[Analog]") && !_section.isNamed("[Digit]") && !_section.isNamed("[Digits]")) {
         // Paragraph passt nicht
         return false;
     }
 
-    if (aktparamgraph[0] == ';') {
+    if (_section.disabled) {
         disabled = true;
-        while (getNextLine(pfile, &aktparamgraph) && !isNewParagraph(aktparamgraph));
         ESP_LOGD(TAG, "[Analog/Digit] is disabled!");
         return true;
     }
 
-    while (this->getNextLine(pfile, &aktparamgraph) && !this->isNewParagraph(aktparamgraph)) {
-        splitted = ZerlegeZeile(aktparamgraph);
-        if ((toUpper(splitted[0]) == "ROIIMAGESLOCATION") && (splitted.size() > 1)) {
-            this->imagesLocation = "/sdcard" + splitted[1];
-            this->isLogImage = true;
-        }
-        
-        if ((toUpper(splitted[0]) == "LOGIMAGESELECT") && (splitted.size() > 1)) {
-            LogImageSelect = splitted[1];
-            isLogImageSelect = true;            
-        }
-
-        if ((toUpper(splitted[0]) == "ROIIMAGESRETENTION") && (splitted.size() > 1)) {
-            if (isStringNumeric(splitted[1])) {
-                this->imagesRetention = std::stoi(splitted[1]);
-            }
-        }
-
-        if ((toUpper(splitted[0]) == "MODEL") && (splitted.size() > 1)) {
-            this->cnnmodelfile = splitted[1];
-        }
-        
-        if ((toUpper(splitted[0]) == "CNNGOODTHRESHOLD") && (splitted.size() > 1)) {
-            if (isStringNumeric(splitted[1])) {
-                CNNGoodThreshold = std::stof(splitted[1]);
-            }
-        }
-        
-        if (splitted.size() >= 5) {
-            general* _analog = GetGENERAL(splitted[0], true);
-            roi* neuroi = _analog->ROI[_analog->ROI.size()-1];
-            neuroi->posx = std::stoi(splitted[1]);
-            neuroi->posy = std::stoi(splitted[2]);
-            neuroi->deltax = std::stoi(splitted[3]);
-            neuroi->deltay = std::stoi(splitted[4]);
-            neuroi->CCW = false;
-            
-            if (splitted.size() >= 6) {
-                neuroi->CCW = toUpper(splitted[5]) == "TRUE";
-            }
-            
-            neuroi->result_float = -1;
-            neuroi->image = NULL;
-            neuroi->image_org = NULL;
-        }
-
-        if ((toUpper(splitted[0]) == "SAVEALLFILES") && (splitted.size() > 1)) {
-            SaveAllFiles = alphanumericToBoolean(splitted[1]);
-        }
-    }
+    configParams.apply(_section);
 
     if (!getNetworkParameter()) {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "An error occured on setting up the Network -> Disabling it!");
@@ -382,12 +365,20 @@ bool ClassFlowCNNGeneral::ReadParameter(FILE* pfile, string& aktparamgraph) {
         return false;
     }
 
+    int nanFamily = metricsRegistry.addFamily("roi_nan_total", "digit ROIs which could not be read (N) since device startup", METRIC_COUNTER);
+    bool isDigitModel = (CNNType != Analogue) && (CNNType != Analogue100);
+
     for (int _ana = 0; _ana < GENERAL.size(); ++_ana) {
         for (int i = 0; i < GENERAL[_ana]->ROI.size(); ++i) {
             GENERAL[_ana]->ROI[i]->image = new CImageBasis("ROI " + GENERAL[_ana]->ROI[i]->name, 
                     modelxsize, modelysize, modelchannel);
             GENERAL[_ana]->ROI[i]->image_org = new CImageBasis("ROI " + GENERAL[_ana]->ROI[i]->name + " original",
                     GENERAL[_ana]->ROI[i]->deltax, GENERAL[_ana]->ROI[i]->deltay, 3);
+
+            if (isDigitModel) {
+                GENERAL[_ana]->ROI[i]->nanMetric = metricsRegistry.addSeries(nanFamily,
+                        metricsLabel("sequence", GENERAL[_ana]->name) + "," + metricsLabel("roi", GENERAL[_ana]->ROI[i]->name));
+            }
         }
     }
 
@@ -506,29 +497,37 @@ bool ClassFlowCNNGeneral::doAlignAndCut(string time) {
 
     CAlignAndCutImage *caic = flowpostalignment->GetAlignAndCutImage();    
 
+    // Every ROI has its own images -> cut and resize them on both cores
+    std::vector<roi*> rois;
     for (int _ana = 0; _ana < GENERAL.size(); ++_ana) {
         for (int i = 0; i < GENERAL[_ana]->ROI.size(); ++i) {
-            ESP_LOGD(TAG, "General %d - Align&Cut", i);
-            
-            caic->CutAndSave(GENERAL[_ana]->ROI[i]->posx, GENERAL[_ana]->ROI[i]->posy, GENERAL[_ana]->ROI[i]->deltax, GENERAL[_ana]->ROI[i]->deltay, GENERAL[_ana]->ROI[i]->image_org);
-            if (SaveAllFiles) {
-                if (GENERAL[_ana]->name == "default") {
-                    GENERAL[_ana]->ROI[i]->image_org->SaveToFile(FormatFileName("/sdcard/img_tmp/" + GENERAL[_ana]->ROI[i]->name + ".jpg"));
-                }
-                else {
-                    GENERAL[_ana]->ROI[i]->image_org->SaveToFile(FormatFileName("/sdcard/img_tmp/" + GENERAL[_ana]->name + "_" + GENERAL[_ana]->ROI[i]->name + ".jpg"));
-                }
-            } 
+            rois.push_back(GENERAL[_ana]->ROI[i]);
+        }
+    }
 
-            GENERAL[_ana]->ROI[i]->image_org->Resize(modelxsize, modelysize, GENERAL[_ana]->ROI[i]->image);
-            if (SaveAllFiles) {
-                if (GENERAL[_ana]->name == "default") {
-                    GENERAL[_ana]->ROI[i]->image->SaveToFile(FormatFileName("/sdcard/img_tmp/" + GENERAL[_ana]->ROI[i]->name + ".jpg"));
-                }
-                else {
-                    GENERAL[_ana]->ROI[i]->image->SaveToFile(FormatFileName("/sdcard/img_tmp/" + GENERAL[_ana]->name + "_" + GENERAL[_ana]->ROI[i]->name + ".jpg"));
-                }
-            } 
+    parallel_for(0, rois.size(), [&](int _start, int _end) {
+        for (int i = _start; i < _end; ++i) {
+            caic->CutAndSave(rois[i]->posx, rois[i]->posy, rois[i]->deltax, rois[i]->deltay, rois[i]->image_org);
+            rois[i]->image_org->Resize(modelxsize, modelysize, rois[i]->image);
+        }
+    });
+
+    if (!SaveAllFiles) {
+        return true;
+    }
+
+    for (int _ana = 0; _ana < GENERAL.size(); ++_ana) {
+        for (int i = 0; i < GENERAL[_ana]->ROI.size(); ++i) {
+            ESP_LOGD(TAG, "General %d - Save", i);
+
+            if (GENERAL[_ana]->name == "default") {
+                GENERAL[_ana]->ROI[i]->image_org->SaveToFile(FormatFileName("/sdcard/img_tmp/" + GENERAL[_ana]->ROI[i]->name + ".jpg"));
+                GENERAL[_ana]->ROI[i]->image->SaveToFile(FormatFileName("/sdcard/img_tmp/" + GENERAL[_ana]->ROI[i]->name + ".jpg"));
+            }
+            else {
+                GENERAL[_ana]->ROI[i]->image_org->SaveToFile(FormatFileName("/sdcard/img_tmp/" + GENERAL[_ana]->name + "_" + GENERAL[_ana]->ROI[i]->name + ".jpg"));
+                GENERAL[_ana]->ROI[i]->image->SaveToFile(FormatFileName("/sdcard/img_tmp/" + GENERAL[_ana]->name + "_" + GENERAL[_ana]->ROI[i]->name + ".jpg"));
+            }
         }
     }
 
@@ -829,6 +828,10 @@ bool ClassFlowCNNGeneral::doNeuralNetwork(string time) {
                 default:
                     break;
             }
+
+            if (isNaNResult(GENERAL[n]->ROI[roi])) {
+                metricsRegistry.inc(GENERAL[n]->ROI[roi]->nanMetric);
+            }
         }
     }
 
@@ -837,6 +840,15 @@ bool ClassFlowCNNGeneral::doNeuralNetwork(string time) {
     return true;
 }
 
+/* Same condition as the "N" of getReadoutRawString() and getReadout() */
+bool ClassFlowCNNGeneral::isNaNResult(roi *_roi) {
+    if (CNNType == Digit) {
+        return (_roi->result_klasse < 0) || (_roi->result_klasse >= 10);
+    }
+
+    return (_roi->result_float < 0) || (_roi->result_float >= 10);
+}
+
 bool ClassFlowCNNGeneral::isExtendedResolution(int _number) {
     if (CNNType == Digit) {
         return false;
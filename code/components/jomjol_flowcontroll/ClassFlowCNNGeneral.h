@@ -41,14 +41,16 @@ protected:
 
 
     bool doNeuralNetwork(string time); 
+    bool isNaNResult(roi *_roi);
     bool doAlignAndCut(string time);
 
     bool getNetworkParameter();
+    void SetupConfigParams(void);
 
 public:
     ClassFlowCNNGeneral(ClassFlowAlignment *_flowalign, t_CNNType _cnntype = AutoDetect);
 
-    bool ReadParameter(FILE* pfile, string& aktparamgraph);
+    bool ReadConfigSection(ConfigSection &_section);
     bool doFlow(string time);
 
     string getHTMLSingleStep(string host);
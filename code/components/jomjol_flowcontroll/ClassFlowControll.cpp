@@ -4,6 +4,7 @@
 #include "read_wlanini.h"
 
 #include "freertos/task.h"
+#include "esp_timer.h"
 
 #include <sys/stat.h>
 
@@ -27,6 +28,7 @@ extern "C" {
 #include "server_help.h"
 #include "MainFlowControl.h"
 #include "basic_auth.h"
+#include "metrics_registry.h"
 #include "../../include/defines.h"
 
 static const char* TAG = "FLOWCTRL";
@@ -213,17 +215,29 @@ bool ClassFlowControll::StartMQTTService()
 }
 #endif //ENABLE_MQTT
 
+ClassFlowControll::ClassFlowControll(void)
+{
+    SetupConfigParams();
+}
+
+
 void ClassFlowControll::SetInitialParameter(void)
 {
     AutoStart = true;
     SetupModeActive = false;
     AutoInterval = 10; // Minutes
+    AlignToClock = false;
+    OverrunPolicy = OverrunImmediate;
     flowdigit = NULL;
     flowanalog = NULL;
     flowpostprocessing = NULL;
     flowsensors = NULL;
     disabled = false;
     aktRunNr = 0;
+    PipelinedPublishing = true;
+    publishQueue = NULL;
+    publishTask = NULL;
+    publishStopped = NULL;
     aktstatus = "Flow task not yet created";
     aktstatusWithTime = aktstatus;
 }
@@ -345,43 +359,74 @@ void ClassFlowControll::InitFlow(std::string config)
         //MQTTPublish(mqttServer_getMainTopic() + "/" + "status", "Initialization", 1, false); // Right now, not possible -> MQTT Service is going to be started later
     //#endif //ENABLE_MQTT
     
-    string line;
-    flowpostprocessing = NULL;
+    DeinitFlow();
 
     ClassFlow* cfc;
-    FILE* pFile;
-    config = FormatFileName(config);
-    pFile = fopen(config.c_str(), "r");
+    ConfigParser parser;
 
-    line = "";
-
-    char zw[1024];
-	
-    if (pFile != NULL) {
-        fgets(zw, 1024, pFile);
-        ESP_LOGD(TAG, "%s", zw);
-        line = std::string(zw);
+    // The whole file gets read and tokenized once, each step only gets its section
+    if (!parser.Load(FormatFileName(config))) {
+        return;
     }
 
-    while ((line.size() > 0) && !(feof(pFile))) {
-        cfc = CreateClassFlow(line);
-        // printf("Name: %s\n", cfc->name().c_str());
+    for (auto &section : parser.getSections()) {
+        cfc = CreateClassFlow(section.name.toString());
 	    
         if (cfc) {
-            ESP_LOGE(TAG, "Start ReadParameter (%s)", line.c_str());
-            cfc->ReadParameter(pFile, line);
-        }
-        else {
-            line = "";
-		
-            if (fgets(zw, 1024, pFile) && !feof(pFile)) {
-                ESP_LOGD(TAG, "Read: %s", zw);
-                line = std::string(zw);
-            }
+            ESP_LOGD(TAG, "Start ReadParameter (%s)", section.name.toString().c_str());
+            cfc->ReadConfigSection(section);
         }
     }
 
-    fclose(pFile);
+    registerStepMetrics();
+}
+
+
+/* Deletes all steps. The publish task gets stopped first: it publishes the rounds which are still
+ * queued and then ends, so no round refers to a deleted step. The MQTT server forgets the numbers
+ * and the sensors before they get deleted, doInit() sets them again. */
+void ClassFlowControll::DeinitFlow(void)
+{
+    #ifdef ENABLE_MQTT
+        mqttServer_clearFlowReferences();
+    #endif //ENABLE_MQTT
+
+    StopPublishTask();
+
+    for (int i = 0; i < FlowControll.size(); ++i) {
+        delete FlowControll[i];
+    }
+    FlowControll.clear();
+
+    flowtakeimage = NULL;
+    flowalignment = NULL;
+    flowanalog = NULL;
+    flowdigit = NULL;
+    flowpostprocessing = NULL;
+    flowsensors = NULL;
+    stepMetrics.clear();
+}
+
+
+/* One duration histogram per step, exposed on /metrics */
+void ClassFlowControll::registerStepMetrics(void)
+{
+    static const double buckets[] = {0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60};
+    int family = metricsRegistry.addFamily("flow_step_duration_seconds", "duration of the flow steps in seconds", METRIC_HISTOGRAM,
+                                           buckets, sizeof(buckets) / sizeof(buckets[0]));
+
+    stepMetrics.clear();
+    for (int i = 0; i < FlowControll.size(); ++i) {
+        // "ClassFlowTakeImage" -> "TakeImage", both CNN steps get told apart
+        std::string step = FlowControll[i]->name().substr(std::string("ClassFlow").length());
+        if (FlowControll[i] == flowanalog) {
+            step = "Analog";
+        }
+        else if (FlowControll[i] == flowdigit) {
+            step = "Digit";
+        }
+        stepMetrics.push_back(metricsRegistry.addSeries(family, metricsLabel("step", step)));
+    }
 }
 
 std::string* ClassFlowControll::getActStatusWithTime()
@@ -424,6 +469,7 @@ bool ClassFlowControll::doFlow(string time)
     std::string zw_time;
     int repeat = 0;
     int qos = 1;
+    bool publishPending = false;
 
     #ifdef DEBUG_DETAIL_ON 
         LogFile.WriteHeapInfo("ClassFlowControll::doFlow - Start");
@@ -438,6 +484,11 @@ bool ClassFlowControll::doFlow(string time)
     //checkNtpStatus(0);
 
     for (int i = 0; i < FlowControll.size(); ++i) {
+        if (PipelinedPublishing && FlowControll[i]->isPublisher()) {
+            publishPending = true;      // Gets published after the round from a snapshot, see QueuePublishRound()
+            continue;
+        }
+
         zw_time = getCurrentTimeString("%H:%M:%S");
         aktstatus = TranslateAktstatus(FlowControll[i]->name());
         aktstatusWithTime = aktstatus + " (" + zw_time + ")";
@@ -451,7 +502,11 @@ bool ClassFlowControll::doFlow(string time)
             LogFile.WriteHeapInfo(zw);
         #endif
 
-        if (!FlowControll[i]->doFlow(time)) {
+        int64_t start = esp_timer_get_time();
+        bool stepDone = FlowControll[i]->doFlow(time);
+        metricsRegistry.observe(stepMetrics[i], (esp_timer_get_time() - start) / 1000000.0);
+
+        if (!stepDone) {
             repeat++;
             LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Fehler im vorheriger Schritt - wird zum " + to_string(repeat) + ". Mal wiederholt");
             if (i) { i -= 1; }   // vPrevious step must be repeated (probably take pictures)
@@ -471,6 +526,10 @@ bool ClassFlowControll::doFlow(string time)
         #endif
     }
 
+    if (publishPending) {
+        QueuePublishRound(time);
+    }
+
     zw_time = getCurrentTimeString("%H:%M:%S");
     aktstatus = "Flow finished";
     aktstatusWithTime = aktstatus + " (" + zw_time + ")";
@@ -483,6 +542,122 @@ bool ClassFlowControll::doFlow(string time)
 }
 
 
+/* Hands a snapshot of the current results over to the publish task, so the network I/O of
+ * MQTT, InfluxDB and Webhook does not delay the next round. Only the most recent rounds are
+ * kept, if the broker or server is slower than the flow the oldest pending round gets dropped. */
+bool ClassFlowControll::QueuePublishRound(std::string time)
+{
+    if (publishQueue == NULL) {
+        publishQueue = xQueueCreate(FLOW_PUBLISH_QUEUE_LENGTH, sizeof(PublishRound*));
+        publishStopped = xSemaphoreCreateBinary();
+    }
+
+    if ((publishQueue != NULL) && (publishStopped != NULL) && (publishTask == NULL)) {
+        BaseType_t xReturned = xTaskCreatePinnedToCore(&task_publish, "task_publish", FLOW_PUBLISH_TASK_STACKSIZE, 
+                                                       this, tskIDLE_PRIORITY+1, &publishTask, tskNO_AFFINITY);
+        if (xReturned != pdPASS) {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Creation of task_publish failed, publishing inline");
+            publishTask = NULL;
+        }
+    }
+
+    PublishRound *round = new PublishRound;
+    round->time = time;
+
+    if (flowpostprocessing) {
+        std::vector<NumberPost*> *numbers = flowpostprocessing->GetNumbers();
+        for (int i = 0; i < (*numbers).size(); ++i) {
+            round->numbers.push_back(*(*numbers)[i]);
+        }
+    }
+
+    for (int i = 0; i < FlowControll.size(); ++i) {
+        if (FlowControll[i]->isPublisher()) {
+            round->publishers.push_back(FlowControll[i]);
+            round->images.push_back(FlowControll[i]->createPublishImage(flowpostprocessing ? flowpostprocessing->GetNumbers() : NULL));
+            round->publisherMetrics.push_back((i < stepMetrics.size()) ? stepMetrics[i] : -1);
+        }
+    }
+
+    if ((publishQueue == NULL) || (publishTask == NULL)) {
+        doPublish(round);
+        delete round;
+        return false;
+    }
+
+    if (xQueueSend(publishQueue, &round, 0) != pdTRUE) {
+        PublishRound *oldest = NULL;
+        if (xQueueReceive(publishQueue, &oldest, 0) == pdTRUE) {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Publishing is behind, dropped results of round " + oldest->time);
+            delete oldest;
+        }
+
+        if (xQueueSend(publishQueue, &round, 0) != pdTRUE) {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Publish queue full, dropped results of round " + round->time);
+            delete round;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+void ClassFlowControll::doPublish(PublishRound *round)
+{
+    std::vector<NumberPost*> numbers;
+    for (int i = 0; i < round->numbers.size(); ++i) {
+        numbers.push_back(&round->numbers[i]);
+    }
+
+    // Only the snapshot gets used here, the flow task already works on the next round
+    for (int i = 0; i < round->publishers.size(); ++i) {
+        int64_t start = esp_timer_get_time();
+
+        if (!round->publishers[i]->doPublishWithImage(round->time, &numbers, round->images[i].get())) {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, round->publishers[i]->name() + ": Publishing of round " + round->time + " failed");
+        }
+
+        metricsRegistry.observe(round->publisherMetrics[i], (esp_timer_get_time() - start) / 1000000.0);
+    }
+}
+
+
+/* Ends the publish task after it published the queued rounds, it gets started again with the next round */
+void ClassFlowControll::StopPublishTask(void)
+{
+    if (publishTask == NULL) {
+        return;
+    }
+
+    PublishRound *stop = NULL;      // NULL round = end of the task
+    xQueueSend(publishQueue, &stop, portMAX_DELAY);
+    xSemaphoreTake(publishStopped, portMAX_DELAY);
+    publishTask = NULL;
+}
+
+
+void ClassFlowControll::task_publish(void *pvParameter)
+{
+    ClassFlowControll *cfc = (ClassFlowControll*) pvParameter;
+    PublishRound *round = NULL;
+
+    while (true) {
+        if (xQueueReceive(cfc->publishQueue, &round, portMAX_DELAY) == pdTRUE) {
+            if (round == NULL) {
+                break;
+            }
+
+            cfc->doPublish(round);
+            delete round;
+        }
+    }
+
+    xSemaphoreGive(cfc->publishStopped);
+    vTaskDelete(NULL);
+}
+
+
 string ClassFlowControll::getReadoutAll(int _type)
 {
     std::string out = "";
@@ -579,99 +754,106 @@ bool ClassFlowControll::UpdatePrevalue(std::string _newvalue, std::string _numbe
     }
 }
 
-bool ClassFlowControll::ReadParameter(FILE* pfile, string& aktparamgraph)
+bool ClassFlowControll::ReadConfigSection(ConfigSection &_section)
 {
-    std::vector<string> splitted;
-    aktparamgraph = trim(aktparamgraph);
-
-    if (aktparamgraph.size() == 0) {
-        if (!this->GetNextParagraph(pfile, aktparamgraph)) {
-            return false;
-        }
-    }
-
-    if ((toUpper(aktparamgraph).compare("[AUTOTIMER]") != 0) && (toUpper(aktparamgraph).compare("[DEBUG]") != 0) &&
-        (toUpper(aktparamgraph).compare("[SYSTEM]") != 0 && (toUpper(aktparamgraph).compare("[DATALOGGING]") != 0))) {     
-        // Paragraph passt nicht zu Debug oder DataLogging
+    if (_section.disabled || (!_section.name.equalsIgnoreCase("[AutoTimer]") && !_section.name.equalsIgnoreCase("[Debug]") &&
+                              !_section.name.equalsIgnoreCase("[System]") && !_section.name.equalsIgnoreCase("[DataLogging]"))) {
+        // Paragraph passt nicht zu AutoTimer, Debug, System oder DataLogging
         return false;
     }
 
-    while (this->getNextLine(pfile, &aktparamgraph) && !this->isNewParagraph(aktparamgraph)) {
-        splitted = ZerlegeZeile(aktparamgraph, " =");
+    configParams.apply(_section);
+    return true;
+}
 
-        if ((toUpper(splitted[0]) == "INTERVAL") && (splitted.size() > 1)) {
-            if (isStringNumeric(splitted[1])) {
-                AutoInterval = std::stof(splitted[1]);
-            }
-        }
 
-        if ((toUpper(splitted[0]) == "DATALOGACTIVE") && (splitted.size() > 1)) {
-            LogFile.SetDataLogToSD(alphanumericToBoolean(splitted[1]));
+/* Parameters of [AutoTimer], [DataLogging], [Debug] and [System] */
+void ClassFlowControll::SetupConfigParams(void)
+{
+    // [AutoTimer]
+    configParams.addFloat("Interval", &AutoInterval);
+    configParams.addBool("AlignToClock", &AlignToClock);
+    configParams.add("OverrunPolicy", [this](const ConfigEntry &_entry) {
+        ConfigToken value = _entry.value();
+        if (value.equalsIgnoreCase("Skip")) {
+            OverrunPolicy = OverrunSkip;
         }
-
-        if ((toUpper(splitted[0]) == "DATAFILESRETENTION") && (splitted.size() > 1)) {
-            if (isStringNumeric(splitted[1])) {
-                LogFile.SetDataLogRetention(std::stoi(splitted[1]));
-            }
+        else if (value.equalsIgnoreCase("Coalesce")) {
+            OverrunPolicy = OverrunCoalesce;
+        }
+        else if (value.equalsIgnoreCase("Immediate")) {
+            OverrunPolicy = OverrunImmediate;
+        }
+        else {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Unknown OverrunPolicy: " + value.toString() + ", using Immediate");
+            OverrunPolicy = OverrunImmediate;
+        }
+    });
+    configParams.addBool("PipelinedPublishing", &PipelinedPublishing);
+
+    // [DataLogging]
+    configParams.add("DataLogActive", [](const ConfigEntry &_entry) {
+        LogFile.SetDataLogToSD(_entry.asBool());
+    });
+    configParams.add("DataFilesRetention", [](const ConfigEntry &_entry) {
+        if (_entry.isNumeric()) {
+            LogFile.SetDataLogRetention(_entry.asInt());
+        }
+    });
+
+    // [Debug]
+    configParams.add("LogLevel", [](const ConfigEntry &_entry) {
+        /* matches esp_log_level_t */
+        ConfigToken value = _entry.value();
+        if (value.equalsIgnoreCase("TRUE") || value.equalsIgnoreCase("2")) {
+            LogFile.setLogLevel(ESP_LOG_WARN);
+        }
+        else if (value.equalsIgnoreCase("FALSE") || value.equalsIgnoreCase("0") || value.equalsIgnoreCase("1")) {
+            LogFile.setLogLevel(ESP_LOG_ERROR);
+        }
+        else if (value.equalsIgnoreCase("3")) {
+            LogFile.setLogLevel(ESP_LOG_INFO);
+        }
+        else if (value.equalsIgnoreCase("4")) {
+            LogFile.setLogLevel(ESP_LOG_DEBUG);
         }
 
-        if ((toUpper(splitted[0]) == "LOGLEVEL") && (splitted.size() > 1)) {
-            /* matches esp_log_level_t */
-            if ((toUpper(splitted[1]) == "TRUE") || (toUpper(splitted[1]) == "2")) {
-                LogFile.setLogLevel(ESP_LOG_WARN);
-            }
-            else if ((toUpper(splitted[1]) == "FALSE") || (toUpper(splitted[1]) == "0") || (toUpper(splitted[1]) == "1")) {
-                LogFile.setLogLevel(ESP_LOG_ERROR);
-            }
-            else if (toUpper(splitted[1]) == "3") {
-                LogFile.setLogLevel(ESP_LOG_INFO);
-            }
-            else if (toUpper(splitted[1]) == "4") {
-                LogFile.setLogLevel(ESP_LOG_DEBUG);
-            }
-
-            /* If system reboot was not triggered by user and reboot was caused by execption -> keep log level to DEBUG */
-            if (!getIsPlannedReboot() && (esp_reset_reason() == ESP_RST_PANIC)) {
-                LogFile.setLogLevel(ESP_LOG_DEBUG);
-            }
+        /* If system reboot was not triggered by user and reboot was caused by execption -> keep log level to DEBUG */
+        if (!getIsPlannedReboot() && (esp_reset_reason() == ESP_RST_PANIC)) {
+            LogFile.setLogLevel(ESP_LOG_DEBUG);
         }
-	    
-        if ((toUpper(splitted[0]) == "LOGFILESRETENTION") && (splitted.size() > 1)) {
-            if (isStringNumeric(splitted[1])) {
-                LogFile.SetLogFileRetention(std::stoi(splitted[1]));
-            }
+    });
+    configParams.add("LogfilesRetention", [](const ConfigEntry &_entry) {
+        if (_entry.isNumeric()) {
+            LogFile.SetLogFileRetention(_entry.asInt());
         }
+    });
+
+    // [System]
+    /* TimeServer and TimeZone got already read from the config, see setupTime () */
 
-        /* TimeServer and TimeZone got already read from the config, see setupTime () */
+    #if (defined WLAN_USE_ROAMING_BY_SCANNING || (defined WLAN_USE_MESH_ROAMING && defined WLAN_USE_MESH_ROAMING_ACTIVATE_CLIENT_TRIGGERED_QUERIES))
+    configParams.add("RSSIThreshold", [](const ConfigEntry &_entry) {
+        int RSSIThresholdTMP = _entry.asInt();
+        RSSIThresholdTMP = min(0, max(-100, RSSIThresholdTMP)); // Verify input limits (-100 - 0)
         
-        #if (defined WLAN_USE_ROAMING_BY_SCANNING || (defined WLAN_USE_MESH_ROAMING && defined WLAN_USE_MESH_ROAMING_ACTIVATE_CLIENT_TRIGGERED_QUERIES))
-        if ((toUpper(splitted[0]) == "RSSITHRESHOLD") && (splitted.size() > 1)) {
-            int RSSIThresholdTMP = atoi(splitted[1].c_str());
-            RSSIThresholdTMP = min(0, max(-100, RSSIThresholdTMP)); // Verify input limits (-100 - 0)
-            
-            if (ChangeRSSIThreshold(WLAN_CONFIG_FILE, RSSIThresholdTMP)) {
-                // reboot necessary so that the new wlan.ini is also used !!!
-                fclose(pfile);
-                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Rebooting to activate new RSSITHRESHOLD ...");
-                doReboot();
-            }
+        if (ChangeRSSIThreshold(WLAN_CONFIG_FILE, RSSIThresholdTMP)) {
+            // reboot necessary so that the new wlan.ini is also used !!!
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Rebooting to activate new RSSITHRESHOLD ...");
+            doReboot();
         }
-        #endif
+    });
+    #endif
 
-        if ((toUpper(splitted[0]) == "HOSTNAME") && (splitted.size() > 1)) {
-            if (ChangeHostName(WLAN_CONFIG_FILE, splitted[1])) {
-                // reboot necessary so that the new wlan.ini is also used !!!
-                fclose(pfile);
-                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Rebooting to activate new HOSTNAME...");             
-                doReboot();
-            }
+    configParams.add("Hostname", [](const ConfigEntry &_entry) {
+        if (ChangeHostName(WLAN_CONFIG_FILE, _entry.asString())) {
+            // reboot necessary so that the new wlan.ini is also used !!!
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Rebooting to activate new HOSTNAME...");             
+            doReboot();
         }
+    });
 
-        if ((toUpper(splitted[0]) == "SETUPMODE") && (splitted.size() > 1)) {
-            SetupModeActive = alphanumericToBoolean(splitted[1]);        
-        }
-    }
-    return true;
+    configParams.addBool("SetupMode", &SetupModeActive);
 }
 
 int ClassFlowControll::CleanTempFolder() {
@@ -803,31 +985,6 @@ esp_err_t ClassFlowControll::GetJPGStream(std::string _fn, httpd_req_t *req)
                 if (flowalignment && flowalignment->AlgROI) {
                     std::string filename = "/sdcard/html/Flowstate_take_image.jpg";
                     result = send_file(req, filename);
-                    /*
-                    FILE* file = fopen("/sdcard/html/Flowstate_take_image.jpg", "rb");    
-
-                    if (!file) {
-                        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "File /sdcard/html/Flowstate_take_image.jpg not found");
-                        return ESP_FAIL;
-                    }
-
-                    fseek(file, 0, SEEK_END);
-                    flowalignment->AlgROI->size = ftell(file); // how long is the file ?
-                    fseek(file, 0, SEEK_SET); // reset
-                    
-                    if (flowalignment->AlgROI->size > MAX_JPG_SIZE) {
-                        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "File /sdcard/html/Flowstate_take_image.jpg (" + std::to_string(flowalignment->AlgROI->size) +
-                                                                ") > allocated buffer (" + std::to_string(MAX_JPG_SIZE) + ")");
-                        fclose(file);
-                        return ESP_FAIL;
-                    }
-
-                    fread(flowalignment->AlgROI->data, flowalignment->AlgROI->size, 1, file);
-                    fclose(file);
-
-                    httpd_resp_set_type(req, "image/jpeg");
-                    result = httpd_resp_send(req, (const char *)flowalignment->AlgROI->data, flowalignment->AlgROI->size);
-                    */
                 }
                 else {
                     LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ClassFlowControll::GetJPGStream: alg_roi.jpg cannot be served -> alg.jpg is going to be served!");
@@ -841,9 +998,14 @@ esp_err_t ClassFlowControll::GetJPGStream(std::string _fn, httpd_req_t *req)
                 }
             }
             else {
-                if (flowalignment && flowalignment->AlgROI) {
+                if (flowalignment && flowalignment->AlgROI && (flowalignment->AlgROI->getSize() > 0)) {
                     httpd_resp_set_type(req, "image/jpeg");
-                    result = httpd_resp_send(req, (const char *)flowalignment->AlgROI->data, flowalignment->AlgROI->size);
+                    // Page by page from the JPG, without copying it
+                    bool sent = flowalignment->AlgROI->forEachChunk([req](const char *_data, size_t _len) {
+                        return httpd_resp_send_chunk(req, _data, _len) == ESP_OK;
+                    });
+                    httpd_resp_send_chunk(req, NULL, 0);
+                    result = sent ? ESP_OK : ESP_FAIL;
                 }
                 else {
                     LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "ClassFlowControll::GetJPGStream: alg_roi.jpg cannot be served -> alg.jpg is going to be served!");
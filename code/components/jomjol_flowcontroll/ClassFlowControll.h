@@ -5,6 +5,11 @@
 
 #include <string>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
 #include "ClassFlow.h"
 #include "ClassFlowTakeImage.h"
 #include "ClassFlowAlignment.h"
@@ -23,6 +28,23 @@
 #include "ClassFlowCNNGeneral.h"
 #include "ClassFlowSensors.h"
 
+// What to do with the ticks which passed while a round was still running
+enum t_OverrunPolicy {
+	OverrunSkip,        // Wait for the next regular tick
+	OverrunCoalesce,    // Missed ticks are merged into one round which starts immediately, the schedule keeps its phase
+	OverrunImmediate    // Start the next round immediately and restart the schedule from there (behaviour of earlier versions)
+};
+
+// Immutable copy of the results of one round, handed over to the publish task
+struct PublishRound
+{
+	std::string time;
+	std::vector<NumberPost> numbers;
+	std::vector<ClassFlow*> publishers;		// Steps to run, stay valid until DeinitFlow() (waits for the publish task)
+	std::vector<std::shared_ptr<CJpegData>> images;	// Per publisher, see ClassFlow::createPublishImage()
+	std::vector<int> publisherMetrics;		// Their series of the duration histogram, stepMetrics gets cleared by InitFlow()
+};
+
 class ClassFlowControll :
     public ClassFlow
 {
@@ -39,23 +61,41 @@ protected:
 
 	bool AutoStart;
 	float AutoInterval;
+	bool AlignToClock;
+	t_OverrunPolicy OverrunPolicy;
 	void SetInitialParameter(void);	
+	void SetupConfigParams(void);
 	std::string aktstatusWithTime;
 	std::string aktstatus;
 	int aktRunNr;
 
+	bool PipelinedPublishing;
+	QueueHandle_t publishQueue;
+	TaskHandle_t publishTask;
+	SemaphoreHandle_t publishStopped;		// Given by the publish task when it ends
+	bool QueuePublishRound(std::string time);
+	void StopPublishTask(void);
+	static void task_publish(void *pvParameter);
+
+	std::vector<int> stepMetrics;		// Series of the duration histogram, same index as FlowControll
+	void registerStepMetrics(void);
+
 public:
 	bool SetupModeActive;
 
+	ClassFlowControll(void);
+
 	void InitFlow(std::string config);
+	void DeinitFlow(void);
 	bool doFlow(string time);
 	void doFlowTakeImageOnly(string time);
+	void doPublish(PublishRound *round);
 	bool getStatusSetupModus(){return SetupModeActive;};
 	string getReadout(bool _rawvalue, bool _noerror, int _number);
 	string getReadoutAll(int _type);	
 	bool UpdatePrevalue(std::string _newvalue, std::string _numbers, bool _extern);
 	string GetPrevalue(std::string _number = "");	
-	bool ReadParameter(FILE* pfile, string& aktparamgraph);	
+	bool ReadConfigSection(ConfigSection &_section);
 	string getJSON();
 	const std::vector<NumberPost*> &getNumbers();
 	string getNumbersName();
@@ -75,6 +115,8 @@ public:
 	bool getIsAutoStart();
 	void setAutoStartInterval(long &_interval);
 	float getAutoInterval() { return AutoInterval; }  // Get flow interval in minutes
+	bool getAlignToClock() { return AlignToClock; }
+	t_OverrunPolicy getOverrunPolicy() { return OverrunPolicy; }
 
 	std::string* getActStatusWithTime();
 	std::string* getActStatus();
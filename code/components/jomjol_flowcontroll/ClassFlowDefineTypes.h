@@ -16,6 +16,7 @@ struct roi {
     bool isReject, CCW;
     string name;
     CImageBasis *image, *image_org;
+    int nanMetric = -1;         // Counter series of the "N" results of a digit, see metrics_registry.h
 };
 
 /**
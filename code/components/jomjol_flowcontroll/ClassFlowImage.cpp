@@ -14,16 +14,32 @@ extern "C" {
 #include "time_sntp.h"
 #include "ClassLogFile.h"
 #include "CImageBasis.h"
+#include "image_log_store.h"
 #include "esp_log.h"
 #include "../../include/defines.h"
 
 static const char* TAG = "FLOWIMAGE";
 
 
+/**
+ * @brief Appends the JPG to the image log segment while it gets encoded
+ */
+class ImageLogJpegSink : public CJpegSink
+{
+    private:
+        ImageLogStore *store;
+
+    public:
+        explicit ImageLogJpegSink(ImageLogStore *_store) : store(_store) {};
+        void write(const uint8_t *_data, size_t _len) override {failed = failed || !store->Write(_data, _len);};
+};
+
+
 ClassFlowImage::ClassFlowImage(const char* logTag)
 {
 	this->logTag = logTag;
 	isLogImage = false;
+    imagesPacked = false;
     disabled = false;
     this->imagesRetention = 5;
 }
@@ -32,6 +48,7 @@ ClassFlowImage::ClassFlowImage(std::vector<ClassFlow*> * lfc, const char* logTag
 {
 	this->logTag = logTag;
 	isLogImage = false;
+    imagesPacked = false;
     disabled = false;
     this->imagesRetention = 5;
 }
@@ -40,6 +57,7 @@ ClassFlowImage::ClassFlowImage(std::vector<ClassFlow*> * lfc, ClassFlow *_prev,
 {
 	this->logTag = logTag;
 	isLogImage = false;
+    imagesPacked = false;
     disabled = false;
     this->imagesRetention = 5;
 }
@@ -50,6 +68,10 @@ string ClassFlowImage::CreateLogFolder(string time) {
 		return "";
 
 	string logPath = imagesLocation + "/" + time.LOGFILE_TIME_FORMAT_DATE_EXTR + "/" + time.LOGFILE_TIME_FORMAT_HOUR_EXTR;
+    if (imagesPacked) {
+        logPath = imagesLocation;       // The segments of all days are in the same folder
+    }
+
     isLogImage = mkdir_r(logPath.c_str(), S_IRWXU) == 0;
     if (!isLogImage) {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Can't create log folder for analog images. Path " + logPath);
@@ -67,21 +89,37 @@ void ClassFlowImage::LogImage(string logPath, string name, float *resultFloat, i
 
 	if (resultFloat != NULL) {
         if (*resultFloat < 0)
-            sprintf(buf, "N.N_");
+            sprintf(buf, "N.N");
         else
         {
-            sprintf(buf, "%.1f_", *resultFloat);
-            if (strcmp(buf, "10.0_") == 0)
-                sprintf(buf, "0.0_");
+            sprintf(buf, "%.1f", *resultFloat);
+            if (strcmp(buf, "10.0") == 0)
+                sprintf(buf, "0.0");
         }
             
 	} else if (resultInt != NULL) {
-		sprintf(buf, "%d_", *resultInt);
+		sprintf(buf, "%d", *resultInt);
 	} else {
 		buf[0] = '\0';
 	}
 
-	string nm = logPath + "/" + buf + name + "_" + time + ".jpg";
+    if (imagesPacked) {
+        ImageLogStore store(logPath);
+        ImageLogJpegSink sink(&store);
+
+        ESP_LOGD(logTag, "append to image log: %s, %s", name.c_str(), time.c_str());
+        if (store.Begin(time, name, buf)) {
+            if (_img->writeToSinkAsJPG(&sink)) {
+                store.Commit();
+            }
+            else {
+                store.Abort();
+            }
+        }
+        return;
+    }
+
+	string nm = logPath + "/" + (buf[0] != '\0' ? string(buf) + "_" : "") + name + "_" + time + ".jpg";
 	nm = FormatFileName(nm);
 	string output = "/sdcard/img_tmp/" + name + ".jpg";
 	output = FormatFileName(output);
@@ -113,6 +151,13 @@ void ClassFlowImage::RemoveOldLogs()
     //ESP_LOGD(TAG, "file name to compare: %s", cmpfilename);
 	string folderName = string(cmpfilename).LOGFILE_TIME_FORMAT_DATE_EXTR;
 
+    if (imagesPacked) {
+        ImageLogStore store(imagesLocation);
+        int deleted = store.RemoveOlderThan(folderName);
+        ESP_LOGD(TAG, "Image log days deleted: %d", deleted);
+        return;
+    }
+
     DIR *dir = opendir(imagesLocation.c_str());
     if (!dir) {
         ESP_LOGE(TAG, "Failed to stat dir: %s", imagesLocation.c_str());
@@ -12,6 +12,7 @@ class ClassFlowImage : public ClassFlow
 protected:
 	string imagesLocation;
     bool isLogImage;
+    bool imagesPacked;              // Images get appended to a segment per day (ImageLogStore) instead of one file each
     unsigned short imagesRetention;
 	const char* logTag;
 
@@ -30,6 +30,8 @@ void ClassFlowInfluxDB::SetInitialParameter(void)
     ListFlowControll = NULL; 
     disabled = false;
     InfluxDBenable = false;
+
+    SetupConfigParams();
 }       
 
 ClassFlowInfluxDB::ClassFlowInfluxDB()
@@ -68,50 +70,12 @@ ClassFlowInfluxDB::ClassFlowInfluxDB(std::vector<ClassFlow*>* lfc, ClassFlow *_p
 }
 
 
-bool ClassFlowInfluxDB::ReadParameter(FILE* pfile, string& aktparamgraph)
+bool ClassFlowInfluxDB::ReadConfigSection(ConfigSection &_section)
 {
-    std::vector<string> splitted;
-
-    aktparamgraph = trim(aktparamgraph);
-
-    if (aktparamgraph.size() == 0)
-        if (!this->GetNextParagraph(pfile, aktparamgraph))
-            return false;
-
-    if (toUpper(aktparamgraph).compare("[INFLUXDB]") != 0) 
+    if (_section.disabled || !_section.isNamed("[InfluxDB]"))
         return false;
 
-    while (this->getNextLine(pfile, &aktparamgraph) && !this->isNewParagraph(aktparamgraph))
-    {
-        ESP_LOGD(TAG, "while loop reading line: %s", aktparamgraph.c_str());
-        splitted = ZerlegeZeile(aktparamgraph);
-        std::string _param = GetParameterName(splitted[0]);
-
-        if ((toUpper(_param) == "USER") && (splitted.size() > 1))
-        {
-            this->user = splitted[1];
-        }  
-        if ((toUpper(_param) == "PASSWORD") && (splitted.size() > 1))
-        {
-            this->password = splitted[1];
-        }               
-        if ((toUpper(_param) == "URI") && (splitted.size() > 1))
-        {
-            this->uri = splitted[1];
-        }
-        if (((toUpper(_param) == "DATABASE")) && (splitted.size() > 1))
-        {
-            this->database = splitted[1];
-        }
-        if (((toUpper(_param) == "MEASUREMENT")) && (splitted.size() > 1))
-        {
-            handleMeasurement(splitted[0], splitted[1]);
-        }
-        if (((toUpper(_param) == "FIELD")) && (splitted.size() > 1))
-        {
-            handleFieldname(splitted[0], splitted[1]);
-        }
-    }
+    configParams.apply(_section);
 
     if ((uri.length() > 0) && (database.length() > 0)) 
     { 
@@ -131,7 +95,27 @@ bool ClassFlowInfluxDB::ReadParameter(FILE* pfile, string& aktparamgraph)
     return true;
 }
 
+void ClassFlowInfluxDB::SetupConfigParams(void)
+{
+    configParams.setNumberPrefix(true);
+    configParams.addString("User", &user);
+    configParams.addString("Password", &password);
+    configParams.addString("Uri", &uri);
+    configParams.addString("Database", &database);
+    configParams.add("Measurement", [this](const ConfigEntry &_entry) {
+        handleMeasurement(_entry.key.toString(), _entry.asString());
+    });
+    configParams.add("Field", [this](const ConfigEntry &_entry) {
+        handleFieldname(_entry.key.toString(), _entry.asString());
+    });
+}
+
 bool ClassFlowInfluxDB::doFlow(string zwtime)
+{
+    return doPublish(zwtime, flowpostprocessing ? flowpostprocessing->GetNumbers() : NULL);
+}
+
+bool ClassFlowInfluxDB::doPublish(string zwtime, std::vector<NumberPost*>* NUMBERS)
 {
     if (!InfluxDBenable)
         return true;
@@ -146,10 +130,8 @@ bool ClassFlowInfluxDB::doFlow(string zwtime)
     string zw = "";
     string namenumber = "";
 
-    if (flowpostprocessing)
+    if (NUMBERS)
     {
-        std::vector<NumberPost*>* NUMBERS = flowpostprocessing->GetNumbers();
-
         for (int i = 0; i < (*NUMBERS).size(); ++i)
         {
             measurement = (*NUMBERS)[i]->MeasurementV1;
@@ -160,28 +142,22 @@ bool ClassFlowInfluxDB::doFlow(string zwtime)
             resulttimestamp = (*NUMBERS)[i]->timeStamp;
             timeutc = (*NUMBERS)[i]->timeStampTimeUTC;
 
-            if ((*NUMBERS)[i]->FieldV1.length() > 0)
-            {
-                namenumber = (*NUMBERS)[i]->FieldV1;
-            }
-            else
-            {
-                namenumber = (*NUMBERS)[i]->name;
-                if (namenumber == "default")
-                    namenumber = "value";
-                else
-                    namenumber = namenumber + "/value";
-            }
+            namenumber = InfluxDBFieldName((*NUMBERS)[i]->FieldV1, (*NUMBERS)[i]->name, "value");
 
             if (result.length() > 0)   
-//////////////////////// NEW //////////////////////////            
-//                InfluxDBPublish(measurement, namenumber, result, timeutc);
-                influxDB.InfluxDBPublish(measurement, namenumber, result, timeutc);
-//////////////////////// NEW //////////////////////////
+                influxDB.InfluxDBAddPoint(measurement, namenumber, result, timeutc);
 
+            // Raw and rate go into the same batch, e.g. "main/raw" and "main/rate" next to "main/value"
+            if (InfluxDBIsNumber(resultraw))
+                influxDB.InfluxDBAddPoint(measurement, InfluxDBFieldName((*NUMBERS)[i]->FieldV1, (*NUMBERS)[i]->name, "raw"), resultraw, timeutc);
 
+            if (InfluxDBIsNumber(resultrate))
+                influxDB.InfluxDBAddPoint(measurement, InfluxDBFieldName((*NUMBERS)[i]->FieldV1, (*NUMBERS)[i]->name, "rate"), resultrate, timeutc);
         }
     }
+
+    // All numbers (and the sensor values collected since the last round) in one request
+    influxDB.InfluxDBFlush();
    
     OldValue = result;
     
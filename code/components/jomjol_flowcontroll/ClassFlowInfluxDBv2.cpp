@@ -31,6 +31,8 @@ void ClassFlowInfluxDBv2::SetInitialParameter(void)
     ListFlowControll = NULL; 
     disabled = false;
     InfluxDBenable = false;
+
+    SetupConfigParams();
 }       
 
 ClassFlowInfluxDBv2::ClassFlowInfluxDBv2()
@@ -69,51 +71,12 @@ ClassFlowInfluxDBv2::ClassFlowInfluxDBv2(std::vector<ClassFlow*>* lfc, ClassFlow
 }
 
 
-bool ClassFlowInfluxDBv2::ReadParameter(FILE* pfile, string& aktparamgraph)
+bool ClassFlowInfluxDBv2::ReadConfigSection(ConfigSection &_section)
 {
-    std::vector<string> splitted;
-
-    aktparamgraph = trim(aktparamgraph);
-    printf("akt param: %s\n", aktparamgraph.c_str());
-
-    if (aktparamgraph.size() == 0)
-        if (!this->GetNextParagraph(pfile, aktparamgraph))
-            return false;
-
-    if (toUpper(aktparamgraph).compare("[INFLUXDBV2]") != 0) 
+    if (_section.disabled || !_section.isNamed("[InfluxDBv2]"))
         return false;
 
-    while (this->getNextLine(pfile, &aktparamgraph) && !this->isNewParagraph(aktparamgraph))
-    {
-//        ESP_LOGD(TAG, "while loop reading line: %s", aktparamgraph.c_str());
-        splitted = ZerlegeZeile(aktparamgraph);
-        std::string _param = GetParameterName(splitted[0]);
-
-        if ((toUpper(_param) == "ORG") && (splitted.size() > 1))
-        {
-            this->dborg = splitted[1];
-        }  
-        if ((toUpper(_param) == "TOKEN") && (splitted.size() > 1))
-        {
-            this->dbtoken = splitted[1];
-        }               
-        if ((toUpper(_param) == "URI") && (splitted.size() > 1))
-        {
-            this->uri = splitted[1];
-        }
-        if (((toUpper(_param) == "FIELD")) && (splitted.size() > 1))
-        {
-            handleFieldname(splitted[0], splitted[1]);
-        }
-        if (((toUpper(_param) == "MEASUREMENT")) && (splitted.size() > 1))
-        {
-            handleMeasurement(splitted[0], splitted[1]);
-        }
-        if (((toUpper(splitted[0]) == "BUCKET")) && (splitted.size() > 1))
-        {
-            this->bucket = splitted[1];
-        }
-    }
+    configParams.apply(_section);
 
     printf("uri:         %s\n", uri.c_str());
     printf("org:         %s\n", dborg.c_str());
@@ -140,6 +103,21 @@ bool ClassFlowInfluxDBv2::ReadParameter(FILE* pfile, string& aktparamgraph)
     return true;
 }
 
+void ClassFlowInfluxDBv2::SetupConfigParams(void)
+{
+    configParams.setNumberPrefix(true);
+    configParams.addString("Org", &dborg);
+    configParams.addString("Token", &dbtoken);
+    configParams.addString("Uri", &uri);
+    configParams.addString("Bucket", &bucket);
+    configParams.add("Field", [this](const ConfigEntry &_entry) {
+        handleFieldname(_entry.key.toString(), _entry.asString());
+    });
+    configParams.add("Measurement", [this](const ConfigEntry &_entry) {
+        handleMeasurement(_entry.key.toString(), _entry.asString());
+    });
+}
+
 /*
 string ClassFlowInfluxDBv2::GetInfluxDBMeasurement()
 {
@@ -193,6 +171,11 @@ void ClassFlowInfluxDBv2::handleMeasurement(string _decsep, string _value)
 
 
 bool ClassFlowInfluxDBv2::doFlow(string zwtime)
+{
+    return doPublish(zwtime, flowpostprocessing ? flowpostprocessing->GetNumbers() : NULL);
+}
+
+bool ClassFlowInfluxDBv2::doPublish(string zwtime, std::vector<NumberPost*>* NUMBERS)
 {
     if (!InfluxDBenable)
         return true;
@@ -208,10 +191,8 @@ bool ClassFlowInfluxDBv2::doFlow(string zwtime)
     string namenumber = "";
 
 
-    if (flowpostprocessing)
+    if (NUMBERS)
     {
-        std::vector<NumberPost*>* NUMBERS = flowpostprocessing->GetNumbers();
-
         for (int i = 0; i < (*NUMBERS).size(); ++i)
         {
             measurement = (*NUMBERS)[i]->MeasurementV2;
@@ -223,26 +204,24 @@ bool ClassFlowInfluxDBv2::doFlow(string zwtime)
             resulttimeutc = (*NUMBERS)[i]->timeStampTimeUTC;
 
 
-            if ((*NUMBERS)[i]->FieldV2.length() > 0)
-            {
-                namenumber = (*NUMBERS)[i]->FieldV2;
-            }
-            else
-            {
-                namenumber = (*NUMBERS)[i]->name;
-                if (namenumber == "default")
-                    namenumber = "value";
-                else
-                    namenumber = namenumber + "/value";
-            }
+            namenumber = InfluxDBFieldName((*NUMBERS)[i]->FieldV2, (*NUMBERS)[i]->name, "value");
             
             printf("vor sende Influx_DB_V2 - namenumber. %s, result: %s, timestampt: %s", namenumber.c_str(), result.c_str(), resulttimestamp.c_str());
 
             if (result.length() > 0)   
-                influxdb.InfluxDBPublish(measurement, namenumber, result, resulttimeutc);
-//                InfluxDB_V2_Publish(measurement, namenumber, result, resulttimeutc);
+                influxdb.InfluxDBAddPoint(measurement, namenumber, result, resulttimeutc);
+
+            // Raw and rate go into the same batch, e.g. "main/raw" and "main/rate" next to "main/value"
+            if (InfluxDBIsNumber(resultraw))
+                influxdb.InfluxDBAddPoint(measurement, InfluxDBFieldName((*NUMBERS)[i]->FieldV2, (*NUMBERS)[i]->name, "raw"), resultraw, resulttimeutc);
+
+            if (InfluxDBIsNumber(resultrate))
+                influxdb.InfluxDBAddPoint(measurement, InfluxDBFieldName((*NUMBERS)[i]->FieldV2, (*NUMBERS)[i]->name, "rate"), resultrate, resulttimeutc);
         }
     }
+
+    // All numbers (and the sensor values collected since the last round) in one request
+    influxdb.InfluxDBFlush();
    
     OldValue = result;
     
@@ -25,7 +25,8 @@ protected:
 
     InfluxDB influxdb;
 
-    void SetInitialParameter(void);     
+    void SetInitialParameter(void);
+    void SetupConfigParams(void);     
 
     void handleFieldname(string _decsep, string _value);   
     void handleMeasurement(string _decsep, string _value);
@@ -38,8 +39,10 @@ public:
 
 //    string GetInfluxDBMeasurement();
 
-    bool ReadParameter(FILE* pfile, string& aktparamgraph);
+    bool ReadConfigSection(ConfigSection &_section);
     bool doFlow(string time);
+    bool isPublisher(){return true;};
+    bool doPublish(string time, std::vector<NumberPost*>* NUMBERS);
     string name(){return "ClassFlowInfluxDBv2";};
 };
 
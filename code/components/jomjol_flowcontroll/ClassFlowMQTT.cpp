@@ -10,6 +10,7 @@
 
 #include "time_sntp.h"
 #include "interface_mqtt.h"
+#include "mqtt_outbox.h"
 #include "ClassFlowPostProcessing.h"
 #include "ClassFlowControll.h"
 
@@ -48,11 +49,16 @@ void ClassFlowMQTT::SetInitialParameter(void)
     user = "";
     password = ""; 
     SetRetainFlag = false;
+    publishOnChange = false;
+    publishHeartbeat = 60;
+    batchFormat = MQTT_BATCH_FORMAT_NONE;
     previousElement = NULL;
     ListFlowControll = NULL; 
     disabled = false;
     keepAlive = 25*60;
     domoticzintopic = "";
+
+    SetupConfigParams();
 }       
 
 ClassFlowMQTT::ClassFlowMQTT()
@@ -91,129 +97,12 @@ ClassFlowMQTT::ClassFlowMQTT(std::vector<ClassFlow*>* lfc, ClassFlow *_prev)
 }
 
 
-bool ClassFlowMQTT::ReadParameter(FILE* pfile, string& aktparamgraph)
+bool ClassFlowMQTT::ReadConfigSection(ConfigSection &_section)
 {
-    std::vector<string> splitted;
-
-    aktparamgraph = trim(aktparamgraph);
-
-    if (aktparamgraph.size() == 0)
-        if (!this->GetNextParagraph(pfile, aktparamgraph))
-            return false;
-
-    if (toUpper(aktparamgraph).compare("[MQTT]") != 0)       // Paragraph does not fit MQTT
+    if (_section.disabled || !_section.isNamed("[MQTT]"))       // Paragraph does not fit MQTT
         return false;
 
-    while (this->getNextLine(pfile, &aktparamgraph) && !this->isNewParagraph(aktparamgraph))
-    {
-        splitted = ZerlegeZeile(aktparamgraph);
-        std::string _param = GetParameterName(splitted[0]);
-        if ((toUpper(_param) == "CACERT") && (splitted.size() > 1))
-        {
-            this->caCertFilename = "/sdcard" + splitted[1];
-        }
-        if ((toUpper(_param) == "VALIDATESERVERCERT") && (splitted.size() > 1))
-        {
-            validateServerCert = alphanumericToBoolean(splitted[1]);
-        }  
-        if ((toUpper(_param) == "CLIENTCERT") && (splitted.size() > 1))
-        {
-            this->clientCertFilename = "/sdcard" + splitted[1];
-        }  
-        if ((toUpper(_param) == "CLIENTKEY") && (splitted.size() > 1))
-        {
-            this->clientKeyFilename = "/sdcard" + splitted[1];
-        }  
-        if ((toUpper(_param) == "USER") && (splitted.size() > 1))
-        {
-            this->user = splitted[1];
-        }  
-        if ((toUpper(_param) == "PASSWORD") && (splitted.size() > 1))
-        {
-            this->password = splitted[1];
-        }               
-        if ((toUpper(_param) == "URI") && (splitted.size() > 1))
-        {
-            this->uri = splitted[1];
-        }
-        if ((toUpper(_param) == "RETAINMESSAGES") && (splitted.size() > 1))
-        {
-            SetRetainFlag = alphanumericToBoolean(splitted[1]);
-            setMqtt_Server_Retain(SetRetainFlag);
-        }
-        if ((toUpper(_param) == "HOMEASSISTANTDISCOVERY") && (splitted.size() > 1))
-        {
-            if (toUpper(splitted[1]) == "TRUE")
-                SetHomeassistantDiscoveryEnabled(true);  
-        }
-        if ((toUpper(_param) == "METERTYPE") && (splitted.size() > 1)) {
-        /* Use meter type for the device class 
-           Make sure it is a listed one on https://developers.home-assistant.io/docs/core/entity/sensor/#available-device-classes */
-            if (toUpper(splitted[1]) == "WATER_M3") {
-                mqttServer_setMeterType("water", "m³", "h", "m³/h");
-            }
-            else if (toUpper(splitted[1]) == "WATER_L") {
-                mqttServer_setMeterType("water", "L", "h", "L/h");
-            }
-            else if (toUpper(splitted[1]) == "WATER_FT3") {
-                mqttServer_setMeterType("water", "ft³", "min", "ft³/min"); // min = Minutes
-            }
-            else if (toUpper(splitted[1]) == "WATER_GAL") {
-                mqttServer_setMeterType("water", "gal", "h", "gal/h");
-            }
-            else if (toUpper(splitted[1]) == "WATER_GAL_MIN") {
-                mqttServer_setMeterType("water", "gal", "min", "gal/min"); // min = Minutes
-            }
-            else if (toUpper(splitted[1]) == "GAS_M3") {
-                mqttServer_setMeterType("gas", "m³", "h", "m³/h");
-            }
-            else if (toUpper(splitted[1]) == "GAS_FT3") {
-                mqttServer_setMeterType("gas", "ft³", "min", "ft³/min"); // min = Minutes
-            }
-            else if (toUpper(splitted[1]) == "ENERGY_WH") {
-                mqttServer_setMeterType("energy", "Wh", "h", "W");
-            }
-            else if (toUpper(splitted[1]) == "ENERGY_KWH") {
-                mqttServer_setMeterType("energy", "kWh", "h", "kW");
-            }
-            else if (toUpper(splitted[1]) == "ENERGY_MWH") {
-                mqttServer_setMeterType("energy", "MWh", "h", "MW");
-            }
-            else if (toUpper(splitted[1]) == "ENERGY_GJ") {
-                mqttServer_setMeterType("energy", "GJ", "h", "GJ/h");
-            }
-            else if (toUpper(splitted[1]) == "TEMPERATURE_C") {
-                mqttServer_setMeterType("temperature", "°C", "min", "°C/min"); // min = Minutes
-            }
-            else if (toUpper(splitted[1]) == "TEMPERATURE_F") {
-                mqttServer_setMeterType("temperature", "°F", "min", "°F/min"); // min = Minutes
-            }
-            else if (toUpper(splitted[1]) == "TEMPERATURE_K") {
-                mqttServer_setMeterType("temperature", "K", "min", "K/m"); // min = Minutes
-            }
-        }
-
-        if ((toUpper(_param) == "CLIENTID") && (splitted.size() > 1))
-        {
-            this->clientname = splitted[1];
-        }
-
-        if (((toUpper(_param) == "TOPIC") || (toUpper(splitted[0]) == "MAINTOPIC")) && (splitted.size() > 1))
-        {
-            maintopic = splitted[1];
-        }
-
-        if (((toUpper(_param) == "DOMOTICZTOPICIN")) && (splitted.size() > 1))
-        {
-            this->domoticzintopic = splitted[1];
-        }
-
-        if (((toUpper(_param) == "DOMOTICZIDX")) && (splitted.size() > 1))
-        {
-            handleIdx(splitted[0], splitted[1]);
-        }
-        
-    }
+    configParams.apply(_section);
 
     /* Note:
      * Originally, we started the MQTT client here.
@@ -222,11 +111,93 @@ bool ClassFlowMQTT::ReadParameter(FILE* pfile, string& aktparamgraph)
 
     mqttServer_setMainTopic(maintopic);
     mqttServer_setDmoticzInTopic(domoticzintopic);
+    MQTTsetPublishOnChange(publishOnChange, publishHeartbeat);
 
     return true;
 }
 
 
+/* Meter types for the device class of Home Assistant
+   Make sure it is a listed one on https://developers.home-assistant.io/docs/core/entity/sensor/#available-device-classes */
+struct MQTTMeterType {
+    const char *name;
+    const char *deviceClass;
+    const char *unit;
+    const char *timeUnit;
+    const char *rateUnit;
+};
+
+static const MQTTMeterType meterTypes[] = {
+    {"WATER_M3",      "water",       "m³",  "h",   "m³/h"},
+    {"WATER_L",       "water",       "L",   "h",   "L/h"},
+    {"WATER_FT3",     "water",       "ft³", "min", "ft³/min"},     // min = Minutes
+    {"WATER_GAL",     "water",       "gal", "h",   "gal/h"},
+    {"WATER_GAL_MIN", "water",       "gal", "min", "gal/min"},     // min = Minutes
+    {"GAS_M3",        "gas",         "m³",  "h",   "m³/h"},
+    {"GAS_FT3",       "gas",         "ft³", "min", "ft³/min"},     // min = Minutes
+    {"ENERGY_WH",     "energy",      "Wh",  "h",   "W"},
+    {"ENERGY_KWH",    "energy",      "kWh", "h",   "kW"},
+    {"ENERGY_MWH",    "energy",      "MWh", "h",   "MW"},
+    {"ENERGY_GJ",     "energy",      "GJ",  "h",   "GJ/h"},
+    {"TEMPERATURE_C", "temperature", "°C",  "min", "°C/min"},      // min = Minutes
+    {"TEMPERATURE_F", "temperature", "°F",  "min", "°F/min"},      // min = Minutes
+    {"TEMPERATURE_K", "temperature", "K",   "min", "K/m"},         // min = Minutes
+};
+
+
+void ClassFlowMQTT::SetupConfigParams(void)
+{
+    configParams.setNumberPrefix(true);
+
+    configParams.add("CACert", [this](const ConfigEntry &_entry) {
+        caCertFilename = "/sdcard" + _entry.asString();
+    });
+    configParams.addBool("ValidateServerCert", &validateServerCert);
+    configParams.add("ClientCert", [this](const ConfigEntry &_entry) {
+        clientCertFilename = "/sdcard" + _entry.asString();
+    });
+    configParams.add("ClientKey", [this](const ConfigEntry &_entry) {
+        clientKeyFilename = "/sdcard" + _entry.asString();
+    });
+    configParams.addString("User", &user);
+    configParams.addString("Password", &password);
+    configParams.addString("Uri", &uri);
+    configParams.add("RetainMessages", [this](const ConfigEntry &_entry) {
+        SetRetainFlag = _entry.asBool();
+        setMqtt_Server_Retain(SetRetainFlag);
+    });
+    configParams.add("HomeassistantDiscovery", [](const ConfigEntry &_entry) {
+        if (_entry.value().equalsIgnoreCase("TRUE"))
+            SetHomeassistantDiscoveryEnabled(true);
+    });
+    configParams.addBool("PublishOnChange", &publishOnChange);
+    configParams.addInt("PublishHeartbeat", &publishHeartbeat);
+    configParams.add("BatchPublishing", [this](const ConfigEntry &_entry) {
+        if (_entry.value().equalsIgnoreCase("JSON"))
+            batchFormat = MQTT_BATCH_FORMAT_JSON;
+        else if (_entry.value().equalsIgnoreCase("MSGPACK"))
+            batchFormat = MQTT_BATCH_FORMAT_MSGPACK;
+        else
+            batchFormat = MQTT_BATCH_FORMAT_NONE;
+    });
+    configParams.add("MeterType", [](const ConfigEntry &_entry) {
+        for (const MQTTMeterType &meterType : meterTypes) {
+            if (_entry.value().equalsIgnoreCase(meterType.name)) {
+                mqttServer_setMeterType(meterType.deviceClass, meterType.unit, meterType.timeUnit, meterType.rateUnit);
+                break;
+            }
+        }
+    });
+    configParams.addString("ClientID", &clientname);
+    configParams.addString("Topic", &maintopic);
+    configParams.addString("MainTopic", &maintopic);
+    configParams.addString("DomoticzTopicIn", &domoticzintopic);
+    configParams.add("DomoticzIDX", [this](const ConfigEntry &_entry) {
+        handleIdx(_entry.key.toString(), _entry.asString());
+    });
+}
+
+
 bool ClassFlowMQTT::Start(float AutoInterval) 
 {
     roundInterval = AutoInterval; // Minutes
@@ -252,6 +223,12 @@ bool ClassFlowMQTT::Start(float AutoInterval)
 
 
 bool ClassFlowMQTT::doFlow(string zwtime)
+{
+    return doPublish(zwtime, flowpostprocessing ? flowpostprocessing->GetNumbers() : NULL);
+}
+
+
+bool ClassFlowMQTT::doPublish(string zwtime, std::vector<NumberPost*>* NUMBERS)
 {
     bool success;
     std::string result;
@@ -273,10 +250,12 @@ bool ClassFlowMQTT::doFlow(string zwtime)
 
     success = publishSystemData(qos);
 
-    if (flowpostprocessing && getMQTTisConnected())
+    if (NUMBERS && getMQTTisConnected() && (batchFormat != MQTT_BATCH_FORMAT_NONE))
+    {
+        success |= publishBatch(zwtime, NUMBERS, qos);
+    }
+    else if (NUMBERS && getMQTTisConnected())
     {
-        std::vector<NumberPost*>* NUMBERS = flowpostprocessing->GetNumbers();
-
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Publishing MQTT topics...");
 
         for (int i = 0; i < (*NUMBERS).size(); ++i)
@@ -330,7 +309,7 @@ bool ClassFlowMQTT::doFlow(string zwtime)
             if (resulttimestamp.length() > 0)
                 success |= MQTTPublish(namenumber + "timestamp", resulttimestamp, qos, SetRetainFlag);
 
-            std::string json = flowpostprocessing->getJsonFromNumber(i, "\n");
+            std::string json = ClassFlowPostProcessing::getJsonFromNumber((*NUMBERS)[i], "\n");
             success |= MQTTPublish(namenumber + "json", json, qos, SetRetainFlag);
         }
     }
@@ -357,9 +336,76 @@ bool ClassFlowMQTT::doFlow(string zwtime)
     if (!success) {
         LogFile.WriteToFile(ESP_LOG_WARN, TAG, "One or more MQTT topics failed to be published!");
     }
+
+    outbox_stats_t outboxStats;
+    outbox_get_stats(NULL, &outboxStats);
+    if (outboxStats.items > 0) {
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "MQTT outbox: " + std::to_string(outboxStats.items) + " message(s), " +
+                            std::to_string(outboxStats.bytes) + " of " + std::to_string(outboxStats.budget) + " bytes, " +
+                            std::to_string(outboxStats.rejected) + " rejected since startup");
+    }
+
+    if (publishOnChange) {
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Messages published: " + std::to_string(MQTTgetPublishedCount()) +
+                            ", suppressed (unchanged): " + std::to_string(MQTTgetSuppressedCount()));
+    }
     
     return true;
 }
+
+
+/* Publishes all numbers and sensor readings of the round as one message to <maintopic>/batch */
+bool ClassFlowMQTT::publishBatch(string zwtime, std::vector<NumberPost*>* NUMBERS, int qos)
+{
+    bool success = false;
+    MQTTBatchPayload payload(batchFormat);
+
+    payload.beginMap();
+    payload.key("time");
+    payload.addString(zwtime);
+
+    payload.key("numbers");
+    payload.beginMap();
+    for (int i = 0; i < (*NUMBERS).size(); ++i)
+    {
+        NumberPost* number = (*NUMBERS)[i];
+
+        payload.key(number->name);
+        payload.beginMap();
+        payload.key("value");           payload.addValue(number->ReturnValue);
+        payload.key("raw");             payload.addValue(number->ReturnRawValue);
+        payload.key("pre");             payload.addValue(number->ReturnPreValue);
+        payload.key("error");           payload.addValue(number->ErrorMessageText);
+        payload.key("rate");            payload.addValue(number->ReturnRateValue);
+        payload.key("rate_per_time_unit");
+        if ((number->ReturnRateValue.length() > 0) && (getTimeUnit() == "h"))
+            payload.addValue(to_string(number->FlowRateAct * 60)); // per minutes => per hour
+        else
+            payload.addValue(number->ReturnRateValue);
+        payload.key("rate_per_digitization_round");
+        payload.addValue(number->ReturnChangeAbsolute);
+        payload.key("timestamp");       payload.addValue(number->timeStamp);
+        payload.endMap();
+
+        // Domoticz expects its own message per number
+        if ((domoticzintopic.length() > 0) && (number->ReturnValue.length() > 0)) {
+            std::string domoticzpayload = "{\"command\":\"udevice\",\"idx\":" + number->DomoticzIdx + ",\"svalue\":\""+ number->ReturnValue + "\"}";
+            success |= MQTTPublish(domoticzintopic, domoticzpayload, qos, SetRetainFlag);
+        }
+    }
+    payload.endMap();
+
+    mqttServer_addSensorsToBatch(payload);
+    payload.endMap();
+
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Publishing " + std::to_string(payload.getData().length()) + " bytes batch of " +
+                        std::to_string((*NUMBERS).size()) + " number(s)");
+
+    success |= MQTTPublish(maintopic + "/batch", payload.getData(), qos, SetRetainFlag);
+    return success;
+}
+
+
 void ClassFlowMQTT::handleIdx(string _decsep, string _value)
 {
     string _digit, _decpos;
@@ -8,6 +8,7 @@
 #include "ClassFlow.h"
 
 #include "ClassFlowPostProcessing.h"
+#include "mqtt_batch_payload.h"
 
 #include <string>
 
@@ -22,11 +23,16 @@ protected:
     std::string caCertFilename, clientCertFilename, clientKeyFilename;
     bool validateServerCert;
     bool SetRetainFlag;
+    bool publishOnChange;
+    int publishHeartbeat; // Minutes
+    MQTTBatchFormat batchFormat;
     int keepAlive; // Seconds
     float roundInterval; // Minutes
     std::string maintopic, domoticzintopic; 
 	void SetInitialParameter(void);        
+    void SetupConfigParams(void);
     void handleIdx(string _decsep, string _value);   
+    bool publishBatch(string time, std::vector<NumberPost*>* NUMBERS, int qos);
 
 public:
     ClassFlowMQTT();
@@ -35,8 +41,10 @@ public:
 
     bool Start(float AutoInterval);
 
-    bool ReadParameter(FILE* pfile, string& aktparamgraph);
+    bool ReadConfigSection(ConfigSection &_section);
     bool doFlow(string time);
+    bool isPublisher(){return true;};
+    bool doPublish(string time, std::vector<NumberPost*>* NUMBERS);
     string name(){return "ClassFlowMQTT";};
 };
 #endif //CLASSFFLOWMQTT_H
@@ -49,29 +49,33 @@ std::string ClassFlowPostProcessing::GetJSON(std::string _lineend) {
 }
 
 string ClassFlowPostProcessing::getJsonFromNumber(int i, std::string _lineend) {
+    return getJsonFromNumber(NUMBERS[i], _lineend);
+}
+
+string ClassFlowPostProcessing::getJsonFromNumber(NumberPost *_number, std::string _lineend) {
     std::string json = "";
 
     json += "  {" + _lineend;
 
-    if (NUMBERS[i]->ReturnValue.length() > 0) {
-        json += "    \"value\": \"" + NUMBERS[i]->ReturnValue + "\"," + _lineend;
+    if (_number->ReturnValue.length() > 0) {
+        json += "    \"value\": \"" + _number->ReturnValue + "\"," + _lineend;
     }
     else {
         json += "    \"value\": \"\"," + _lineend;
     }
 
-    json += "    \"raw\": \"" + NUMBERS[i]->ReturnRawValue + "\"," + _lineend;
-    json += "    \"pre\": \"" + NUMBERS[i]->ReturnPreValue + "\"," + _lineend;
-    json += "    \"error\": \"" + NUMBERS[i]->ErrorMessageText + "\"," + _lineend;
+    json += "    \"raw\": \"" + _number->ReturnRawValue + "\"," + _lineend;
+    json += "    \"pre\": \"" + _number->ReturnPreValue + "\"," + _lineend;
+    json += "    \"error\": \"" + _number->ErrorMessageText + "\"," + _lineend;
 
-    if (NUMBERS[i]->ReturnRateValue.length() > 0) {
-        json += "    \"rate\": \"" + NUMBERS[i]->ReturnRateValue + "\"," + _lineend;
+    if (_number->ReturnRateValue.length() > 0) {
+        json += "    \"rate\": \"" + _number->ReturnRateValue + "\"," + _lineend;
     }
     else {
         json += "    \"rate\": \"\"," + _lineend;
     }
 
-    json += "    \"timestamp\": \"" + NUMBERS[i]->timeStamp + "\"" + _lineend;
+    json += "    \"timestamp\": \"" + _number->timeStamp + "\"" + _lineend;
     json += "  }" + _lineend;
 
     return json;
@@ -328,6 +332,8 @@ ClassFlowPostProcessing::ClassFlowPostProcessing(std::vector<ClassFlow*>* lfc, C
             flowTakeImage = (ClassFlowTakeImage*) (*ListFlowControll)[i];
         }
     }
+
+    SetupConfigParams();
 }
 
 void ClassFlowPostProcessing::handleDecimalExtendedResolution(string _decsep, string _value) {
@@ -553,79 +559,14 @@ void ClassFlowPostProcessing::handlecheckDigitIncreaseConsistency(std::string _d
     }
 }
 
-bool ClassFlowPostProcessing::ReadParameter(FILE* pfile, string& aktparamgraph) {
-    std::vector<string> splitted;
-    int _n;
-
-    aktparamgraph = trim(aktparamgraph);
-
-    if (aktparamgraph.size() == 0) {
-        if (!this->GetNextParagraph(pfile, aktparamgraph)) {
-            return false;
-        }
-    }
-
+bool ClassFlowPostProcessing::ReadConfigSection(ConfigSection &_section) {
     // Paragraph does not fit PostProcessing
-    if (aktparamgraph.compare("[PostProcessing]") != 0) {
+    if (_section.disabled || !_section.isNamed("[PostProcessing]")) {
         return false;
     }
 
     InitNUMBERS();
-
-    while (this->getNextLine(pfile, &aktparamgraph) && !this->isNewParagraph(aktparamgraph)) {
-        splitted = ZerlegeZeile(aktparamgraph);
-        std::string _param = GetParameterName(splitted[0]);
-
-        if ((toUpper(_param) == "EXTENDEDRESOLUTION") && (splitted.size() > 1)) {
-            handleDecimalExtendedResolution(splitted[0], splitted[1]);
-        }
-
-        if ((toUpper(_param) == "DECIMALSHIFT") && (splitted.size() > 1)) {
-            handleDecimalSeparator(splitted[0], splitted[1]);
-        }
-	    
-        if ((toUpper(_param) == "ANALOGTODIGITTRANSITIONSTART") && (splitted.size() > 1)) {
-            handleAnalogToDigitTransitionStart(splitted[0], splitted[1]);
-        }
-	    
-        if ((toUpper(_param) == "MAXRATEVALUE") && (splitted.size() > 1)) {
-            handleMaxRateValue(splitted[0], splitted[1]);
-        }
-	    
-        if ((toUpper(_param) == "MAXRATETYPE") && (splitted.size() > 1)) {
-            handleMaxRateType(splitted[0], splitted[1]);
-        }
-	    
-        if ((toUpper(_param) == "PREVALUEUSE") && (splitted.size() > 1)) {
-            PreValueUse = alphanumericToBoolean(splitted[1]);
-        }
-		
-        if ((toUpper(_param) == "CHANGERATETHRESHOLD") && (splitted.size() > 1)) {
-            handleChangeRateThreshold(splitted[0], splitted[1]);
-        }
-	    
-        if ((toUpper(_param) == "CHECKDIGITINCREASECONSISTENCY") && (splitted.size() > 1)) {
-            handlecheckDigitIncreaseConsistency(splitted[0], splitted[1]);
-        }
-			
-        if ((toUpper(_param) == "ALLOWNEGATIVERATES") && (splitted.size() > 1)) {
-            handleAllowNegativeRate(splitted[0], splitted[1]);
-        }
-			
-        if ((toUpper(_param) == "ERRORMESSAGE") && (splitted.size() > 1)) {
-            ErrorMessage = alphanumericToBoolean(splitted[1]);
-        }
-			
-        if ((toUpper(_param) == "IGNORELEADINGNAN") && (splitted.size() > 1)) {
-            handleIgnoreLeadingNaN(splitted[0], splitted[1]);
-        }
-
-        if ((toUpper(_param) == "PREVALUEAGESTARTUP") && (splitted.size() > 1)) {
-            if (isStringNumeric(splitted[1])) {
-                PreValueAgeStartup = std::stoi(splitted[1]);
-            }
-        }
-    }
+    configParams.apply(_section);
 
     if (PreValueUse) {
         return LoadPreValue();
@@ -634,6 +575,32 @@ bool ClassFlowPostProcessing::ReadParameter(FILE* pfile, string& aktparamgraph)
     return true;
 }
 
+void ClassFlowPostProcessing::SetupConfigParams(void) {
+    // Keys are "<number>.<param>", the handlers apply the value to this number or to all ("default")
+    typedef void (ClassFlowPostProcessing::*NumberHandler)(string _decsep, string _value);
+    auto addNumberParam = [this](const char *_key, NumberHandler _handler) {
+        configParams.add(_key, [this, _handler](const ConfigEntry &_entry) {
+            (this->*_handler)(_entry.key.toString(), _entry.asString());
+        });
+    };
+
+    configParams.setNumberPrefix(true);
+
+    addNumberParam("ExtendedResolution", &ClassFlowPostProcessing::handleDecimalExtendedResolution);
+    addNumberParam("DecimalShift", &ClassFlowPostProcessing::handleDecimalSeparator);
+    addNumberParam("AnalogToDigitTransitionStart", &ClassFlowPostProcessing::handleAnalogToDigitTransitionStart);
+    addNumberParam("MaxRateValue", &ClassFlowPostProcessing::handleMaxRateValue);
+    addNumberParam("MaxRateType", &ClassFlowPostProcessing::handleMaxRateType);
+    addNumberParam("ChangeRateThreshold", &ClassFlowPostProcessing::handleChangeRateThreshold);
+    addNumberParam("CheckDigitIncreaseConsistency", &ClassFlowPostProcessing::handlecheckDigitIncreaseConsistency);
+    addNumberParam("AllowNegativeRates", &ClassFlowPostProcessing::handleAllowNegativeRate);
+    addNumberParam("IgnoreLeadingNaN", &ClassFlowPostProcessing::handleIgnoreLeadingNaN);
+
+    configParams.addBool("PreValueUse", &PreValueUse);
+    configParams.addBool("ErrorMessage", &ErrorMessage);
+    configParams.addInt("PreValueAgeStartup", &PreValueAgeStartup);
+}
+
 void ClassFlowPostProcessing::InitNUMBERS() {
     int anzDIGIT = 0;
     int anzANALOG = 0;
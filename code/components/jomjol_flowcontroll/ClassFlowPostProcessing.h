@@ -43,6 +43,7 @@ protected:
     void handleIgnoreLeadingNaN(string _decsep, string _value);
     void handleChangeRateThreshold(string _decsep, string _value);
     void handlecheckDigitIncreaseConsistency(std::string _decsep, std::string _value);
+    void SetupConfigParams(void);
 
     void WriteDataLog(int _index);
 
@@ -52,7 +53,7 @@ public:
 
     ClassFlowPostProcessing(std::vector<ClassFlow*>* lfc, ClassFlowCNNGeneral *_analog, ClassFlowCNNGeneral *_digit);
     virtual ~ClassFlowPostProcessing(){};
-    bool ReadParameter(FILE* pfile, string& aktparamgraph);
+    bool ReadConfigSection(ConfigSection &_section);
     bool doFlow(string time);
     string getReadout(int _number);
     string getReadoutParam(bool _rawValue, bool _noerror, int _number = 0);
@@ -61,6 +62,7 @@ public:
     string getReadoutTimeStamp(int _number = 0);
     void SavePreValue();
     string getJsonFromNumber(int i, std::string _lineend);
+    static string getJsonFromNumber(NumberPost *_number, std::string _lineend);
     string GetPreValue(std::string _number = "");
     bool SetPreValue(double zw, string _numbers, bool _extern = false);
 
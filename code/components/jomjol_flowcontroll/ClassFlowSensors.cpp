@@ -91,37 +91,34 @@ void ClassFlowSensors::SetInitialParameter(void)
     _flowController = nullptr;
     _initialized = false;
     _configParsed = false;
+    _parsedConfig = nullptr;
+
+    SetupConfigParams();
 }
 
-bool ClassFlowSensors::ReadParameter(FILE* pfile, std::string& aktparamgraph)
+bool ClassFlowSensors::ReadConfigSection(ConfigSection &_section)
 {
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "ReadParameter called");
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "ReadConfigSection called");
     
     // Check if this is a sensor section ([SHT3x] or [DS18B20])
-    aktparamgraph = trim(aktparamgraph);
-    
-    if (aktparamgraph.size() == 0) {
-        if (!this->GetNextParagraph(pfile, aktparamgraph)) {
-            return false;
-        }
+    if (_section.disabled) {
+        return false;
     }
     
-    std::string upperGraph = toUpper(aktparamgraph);
-    std::string sensorType;
-    
-    if (upperGraph.compare("[SHT3X]") == 0) {
-        sensorType = "SHT3x";
-    } else if (upperGraph.compare("[DS18B20]") == 0) {
-        sensorType = "DS18B20";
+    if (_section.isNamed("[SHT3x]")) {
+        _parsedType = "SHT3x";
+    } else if (_section.isNamed("[DS18B20]")) {
+        _parsedType = "DS18B20";
     } else {
         // Not a sensor section
         return false;
     }
     
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Found sensor section: " + aktparamgraph);
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Found sensor section: " + _section.name.toString());
     
     // Get or create configuration for this sensor type
-    SensorConfig& config = _sensorConfigs[sensorType];
+    SensorConfig& config = _sensorConfigs[_parsedType];
+    _parsedConfig = &config;
     
     // Section found uncommented - enable the sensor (section comment/uncomment is the way to enable/disable)
     config.enable = true;
@@ -132,77 +129,104 @@ bool ClassFlowSensors::ReadParameter(FILE* pfile, std::string& aktparamgraph)
         config.influxMeasurement = "environment";
     }
     
-    // Parse parameters from the file
-    while (this->getNextLine(pfile, &aktparamgraph) && !this->isNewParagraph(aktparamgraph)) {
-        std::vector<std::string> splitted = ZerlegeZeile(aktparamgraph);
-        if (splitted.size() < 2) {
-            continue;
+    configParams.apply(_section);
+    _parsedConfig = nullptr;
+    
+    _configParsed = true;
+    
+    return true;
+}
+
+void ClassFlowSensors::SetupConfigParams(void)
+{
+    // The setters write to the config of the section which is read right now (_parsedConfig)
+    auto isTrue = [](const ConfigEntry &_entry) {
+        return _entry.value().equalsIgnoreCase("TRUE") || _entry.value().equalsIgnoreCase("1");
+    };
+    
+    configParams.add("Interval", [this](const ConfigEntry &_entry) {
+        if (!safeParseInt(_entry.asString(), _parsedConfig->interval)) {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, _parsedType + ": Invalid interval value: " + _entry.asString());
         }
-        
-        std::string param = toUpper(splitted[0]);
-        std::string value = splitted[1];
-        
-        if (param == "INTERVAL") {
-            if (!safeParseInt(value, config.interval)) {
-                LogFile.WriteToFile(ESP_LOG_WARN, TAG, sensorType + ": Invalid interval value: " + value);
-            }
-        } else if (param == "MQTT_ENABLE") {
-            config.mqttEnable = (toUpper(value) == "TRUE" || value == "1");
-        } else if (param == "MQTT_TOPIC") {
-            config.mqttTopic = value;
-        } else if (param == "INFLUXDB_ENABLE") {
-            config.influxEnable = (toUpper(value) == "TRUE" || value == "1");
-        } else if (param == "INFLUXDB_MEASUREMENT") {
-            config.influxMeasurement = value;
-        } else if (sensorType == "SHT3x") {
-            // SHT3x-specific parameters
-            if (param == "ADDRESS") {
-                unsigned long tempAddress;
-                // Support both hex (0x44) and decimal (68) formats
-                int base = 0; // auto-detect base
-                if (value.find("0x") == 0 || value.find("0X") == 0) {
-                    base = 16;
-                }
-                if (safeParseULong(value, tempAddress, base)) {
-                    if (tempAddress <= 0xFF) {
-                        config.sht3xAddress = static_cast<uint8_t>(tempAddress);
-                    } else {
-                        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "SHT3x: Address out of range: " + value);
-                    }
-                } else {
-                    LogFile.WriteToFile(ESP_LOG_WARN, TAG, "SHT3x: Invalid address value: " + value);
-                }
-            } else if (param == "I2C_FREQUENCY") {
-                unsigned long tempFreq;
-                if (safeParseULong(value, tempFreq, 10)) {
-                    if (tempFreq <= UINT32_MAX) {
-                        config.i2cFreq = static_cast<uint32_t>(tempFreq);
-                    } else {
-                        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "SHT3x: I2C frequency out of range: " + value);
-                    }
-                } else {
-                    LogFile.WriteToFile(ESP_LOG_WARN, TAG, "SHT3x: Invalid I2C frequency value: " + value);
-                }
+    });
+    configParams.add("AggregationWindow", [this](const ConfigEntry &_entry) {
+        if (!safeParseInt(_entry.asString(), _parsedConfig->aggregationWindow) || _parsedConfig->aggregationWindow < 0) {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, _parsedType + ": Invalid AggregationWindow value: " + _entry.asString());
+            _parsedConfig->aggregationWindow = 0;  // Fallback to publishing every reading
+        }
+    });
+    configParams.add("MQTT_Enable", [this, isTrue](const ConfigEntry &_entry) {
+        _parsedConfig->mqttEnable = isTrue(_entry);
+    });
+    configParams.add("MQTT_Topic", [this](const ConfigEntry &_entry) {
+        _parsedConfig->mqttTopic = _entry.asString();
+    });
+    configParams.add("InfluxDB_Enable", [this, isTrue](const ConfigEntry &_entry) {
+        _parsedConfig->influxEnable = isTrue(_entry);
+    });
+    configParams.add("InfluxDB_Measurement", [this](const ConfigEntry &_entry) {
+        _parsedConfig->influxMeasurement = _entry.asString();
+    });
+    
+    // SHT3x-specific parameters
+    configParams.add("Address", [this](const ConfigEntry &_entry) {
+        if (_parsedType != "SHT3x") {
+            return;
+        }
+        std::string value = _entry.asString();
+        unsigned long tempAddress;
+        // Support both hex (0x44) and decimal (68) formats
+        int base = 0; // auto-detect base
+        if (value.find("0x") == 0 || value.find("0X") == 0) {
+            base = 16;
+        }
+        if (safeParseULong(value, tempAddress, base)) {
+            if (tempAddress <= 0xFF) {
+                _parsedConfig->sht3xAddress = static_cast<uint8_t>(tempAddress);
+            } else {
+                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "SHT3x: Address out of range: " + value);
             }
-        } else if (sensorType == "DS18B20") {
-            // DS18B20-specific parameters
-            if (param == "EXPECTEDSENSORS") {
-                if (safeParseInt(value, config.expectedSensors)) {
-                    // Validate: must be -1 (auto-detect) or positive integer (>0)
-                    if (config.expectedSensors < -1 || config.expectedSensors == 0) {
-                        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "DS18B20: ExpectedSensors must be -1 (auto-detect) or positive, got: " + value);
-                        config.expectedSensors = -1;  // Fallback to auto-detect
-                    }
-                } else {
-                    LogFile.WriteToFile(ESP_LOG_WARN, TAG, "DS18B20: Invalid ExpectedSensors value: " + value);
-                }
+        } else {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "SHT3x: Invalid address value: " + value);
+        }
+    });
+    configParams.add("I2C_Frequency", [this](const ConfigEntry &_entry) {
+        if (_parsedType != "SHT3x") {
+            return;
+        }
+        std::string value = _entry.asString();
+        unsigned long tempFreq;
+        if (safeParseULong(value, tempFreq, 10)) {
+            if (tempFreq <= UINT32_MAX) {
+                _parsedConfig->i2cFreq = static_cast<uint32_t>(tempFreq);
+            } else {
+                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "SHT3x: I2C frequency out of range: " + value);
             }
+        } else {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "SHT3x: Invalid I2C frequency value: " + value);
         }
-    }
+    });
     
-    _configParsed = true;
-    
-    return true;
+    // DS18B20-specific parameters
+    configParams.add("ExpectedSensors", [this](const ConfigEntry &_entry) {
+        if (_parsedType != "DS18B20") {
+            return;
+        }
+        if (safeParseInt(_entry.asString(), _parsedConfig->expectedSensors)) {
+            // Validate: must be -1 (auto-detect) or positive integer (>0)
+            if (_parsedConfig->expectedSensors < -1 || _parsedConfig->expectedSensors == 0) {
+                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "DS18B20: ExpectedSensors must be -1 (auto-detect) or positive, got: " + _entry.asString());
+                _parsedConfig->expectedSensors = -1;  // Fallback to auto-detect
+            }
+        } else {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "DS18B20: Invalid ExpectedSensors value: " + _entry.asString());
+        }
+    });
+    configParams.add("ParallelConversion", [this, isTrue](const ConfigEntry &_entry) {
+        if (_parsedType == "DS18B20") {
+            _parsedConfig->parallelConversion = isTrue(_entry);
+        }
+    });
 }
 
 void ClassFlowSensors::initializeEarly()
@@ -315,7 +339,7 @@ bool ClassFlowSensors::doFlow(std::string time)
     }
     
     // Update sensors that are in "follow flow" mode (interval = -1)
-    // Sensors with custom intervals are handled by their own periodic tasks
+    // Sensors with custom intervals are read by the sensor scheduler on their own
     _sensorManager->update(flowIntervalSeconds);
     
     return true;
@@ -19,7 +19,7 @@ public:
     ClassFlowSensors(std::vector<ClassFlow*>* lfc, ClassFlow *_prev);
     virtual ~ClassFlowSensors();
     
-    bool ReadParameter(FILE* pfile, std::string& aktparamgraph) override;
+    bool ReadConfigSection(ConfigSection &_section) override;
     bool doFlow(std::string time) override;
     std::string name() override { return "ClassFlowSensors"; }
     
@@ -44,6 +44,7 @@ public:
     
 protected:
     void SetInitialParameter(void) override;
+    void SetupConfigParams(void);
     
 private:
     std::unique_ptr<SensorManager> _sensorManager;
@@ -53,6 +54,8 @@ private:
     // Store configuration for all sensor types
     std::map<std::string, SensorConfig> _sensorConfigs;
     bool _configParsed;
+    SensorConfig* _parsedConfig;    // Config of the section which is read right now
+    std::string _parsedType;
 };
 
 #endif // CLASSFLOWSENSORS_H
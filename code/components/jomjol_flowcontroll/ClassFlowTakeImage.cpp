@@ -94,6 +94,11 @@ bool ClassFlowTakeImage::ReadParameter(FILE *pfile, string &aktparamgraph)
             isLogImage = true;
         }
 
+        else if ((toUpper(splitted[0]) == "RAWIMAGESFORMAT") && (splitted.size() > 1))
+        {
+            imagesPacked = (toUpper(splitted[1]) == "PACKED");
+        }
+
         else if ((toUpper(splitted[0]) == "RAWIMAGESRETENTION") && (splitted.size() > 1))
         {
             if (isStringNumeric(splitted[1]))
@@ -595,10 +600,10 @@ esp_err_t ClassFlowTakeImage::SendRawJPG(httpd_req_t *req)
     return Camera.CaptureToHTTP(req, flash_duration);
 }
 
-ImageData *ClassFlowTakeImage::SendRawImage(void)
+CJpegData *ClassFlowTakeImage::SendRawImage(void)
 {
     CImageBasis *zw = new CImageBasis("SendRawImage", rawImage);
-    ImageData *id;
+    CJpegData *id;
     int flash_duration = (int)(CCstatus.WaitBeforePicture * 1000);
     Camera.CaptureToBasisImage(zw, flash_duration);
     time(&TimeImageTaken);
@@ -31,7 +31,7 @@ public:
     time_t getTimeImageTaken(void);
     string name() { return "ClassFlowTakeImage"; };
 
-    ImageData *SendRawImage(void);
+    CJpegData *SendRawImage(void);
     esp_err_t SendRawJPG(httpd_req_t *req);
 
     ~ClassFlowTakeImage(void);
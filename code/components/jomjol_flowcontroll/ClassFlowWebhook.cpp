@@ -28,6 +28,8 @@ void ClassFlowWebhook::SetInitialParameter(void)
     disabled = false;
     WebhookEnable = false;
     WebhookUploadImg = 0;
+
+    SetupConfigParams();
 }       
 
 ClassFlowWebhook::ClassFlowWebhook()
@@ -75,48 +77,13 @@ ClassFlowWebhook::ClassFlowWebhook(std::vector<ClassFlow*>* lfc, ClassFlow *_pre
 }
 
 
-bool ClassFlowWebhook::ReadParameter(FILE* pfile, string& aktparamgraph)
+bool ClassFlowWebhook::ReadConfigSection(ConfigSection &_section)
 {
-    std::vector<string> splitted;
-
-    aktparamgraph = trim(aktparamgraph);
-    printf("akt param: %s\n", aktparamgraph.c_str());
-
-    if (aktparamgraph.size() == 0)
-        if (!this->GetNextParagraph(pfile, aktparamgraph))
-            return false;
-
-    if (toUpper(aktparamgraph).compare("[WEBHOOK]") != 0) 
+    if (_section.disabled || !_section.isNamed("[Webhook]"))
         return false;
 
-    
+    configParams.apply(_section);
 
-    while (this->getNextLine(pfile, &aktparamgraph) && !this->isNewParagraph(aktparamgraph))
-    {
-        ESP_LOGD(TAG, "while loop reading line: %s", aktparamgraph.c_str());
-        splitted = ZerlegeZeile(aktparamgraph);
-        std::string _param = GetParameterName(splitted[0]);
-            
-        if ((toUpper(_param) == "URI") && (splitted.size() > 1))
-        {
-            this->uri = splitted[1];
-        }
-        if (((toUpper(_param) == "APIKEY")) && (splitted.size() > 1))
-        {
-            this->apikey = splitted[1];
-        }
-        if (((toUpper(_param) == "UPLOADIMG")) && (splitted.size() > 1))
-        {
-            if (toUpper(splitted[1]) == "1")
-            {
-                this->WebhookUploadImg = 1;
-            } else if (toUpper(splitted[1]) == "2")
-            {
-                this->WebhookUploadImg = 2;
-            }
-        }
-    }
-    
     WebhookInit(uri,apikey);
     WebhookEnable = true;
     LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Webhook Enabled for Uri " + uri);
@@ -125,6 +92,23 @@ bool ClassFlowWebhook::ReadParameter(FILE* pfile, string& aktparamgraph)
     return true;
 }
 
+void ClassFlowWebhook::SetupConfigParams(void)
+{
+    configParams.setNumberPrefix(true);
+    configParams.addString("Uri", &uri);
+    configParams.addString("ApiKey", &apikey);
+    configParams.add("UploadImg", [this](const ConfigEntry &_entry) {
+        if (_entry.value().equalsIgnoreCase("1"))
+        {
+            WebhookUploadImg = 1;
+        }
+        else if (_entry.value().equalsIgnoreCase("2"))
+        {
+            WebhookUploadImg = 2;
+        }
+    });
+}
+
 
 void ClassFlowWebhook::handleMeasurement(string _decsep, string _value)
 {
@@ -150,20 +134,67 @@ void ClassFlowWebhook::handleMeasurement(string _decsep, string _value)
 
 
 bool ClassFlowWebhook::doFlow(string zwtime)
+{
+    return doPublish(zwtime, flowpostprocessing ? flowpostprocessing->GetNumbers() : NULL);
+}
+
+
+bool ClassFlowWebhook::doPublish(string zwtime, std::vector<NumberPost*>* NUMBERS)
+{
+    std::shared_ptr<CJpegData> image = createPublishImage(NUMBERS);
+    return doPublishWithImage(zwtime, NUMBERS, image.get());
+}
+
+
+/* Encoded copy of the aligned image, so the upload does not hold the image lock of the flow */
+std::shared_ptr<CJpegData> ClassFlowWebhook::createPublishImage(std::vector<NumberPost*>* NUMBERS)
+{
+    if (!WebhookEnable || !NUMBERS || !flowAlignment || (WebhookUploadImg == 0))
+        return nullptr;
+
+    if (WebhookUploadImg != 1) {        // Only with errors
+        bool numbersWithError = false;
+        for (int i = 0; i < (*NUMBERS).size(); ++i) {
+            numbersWithError |= (*NUMBERS)[i]->ErrorMessage;
+        }
+        if (!numbersWithError)
+            return nullptr;
+    }
+
+    std::shared_ptr<CJpegData> image = std::make_shared<CJpegData>();
+
+#ifdef ALGROI_LOAD_FROM_MEM_AS_JPG
+    if (flowAlignment->AlgROI && (flowAlignment->AlgROI->getSize() > 0)) {
+        bool copied = flowAlignment->AlgROI->forEachChunk([&image](const char *_data, size_t _len) {   // Already encoded with the ROIs
+            return image->append((const uint8_t*) _data, _len);
+        });
+        return copied ? image : nullptr;
+    }
+#endif
+
+    if (flowAlignment->ImageBasis && flowAlignment->ImageBasis->ImageOkay()) {
+        if (flowAlignment->ImageBasis->writeToMemoryAsJPG(image.get(), 90))       // Aligned image
+            return image;
+    }
+
+    LogFile.WriteToFile(ESP_LOG_WARN, TAG, "No image for the upload");
+    return nullptr;
+}
+
+
+bool ClassFlowWebhook::doPublishWithImage(string zwtime, std::vector<NumberPost*>* NUMBERS, CJpegData *image)
 {
     if (!WebhookEnable)
         return true;
 
-    if (flowpostprocessing)
+    if (NUMBERS)
     {
         printf("vor sende WebHook");
-        bool numbersWithError = WebhookPublish(flowpostprocessing->GetNumbers());
+        WebhookPublish(NUMBERS);
 
-        #ifdef ALGROI_LOAD_FROM_MEM_AS_JPG
-            if ((WebhookUploadImg == 1 || (WebhookUploadImg != 0 && numbersWithError)) && flowAlignment && flowAlignment->AlgROI) {
-                WebhookUploadPic(flowAlignment->AlgROI);
-            }
-        #endif
+        if (image && (image->getSize() > 0)) {
+            WebhookUploadPic(image);
+        }
     }
        
     return true;
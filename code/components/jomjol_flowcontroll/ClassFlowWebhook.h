@@ -23,7 +23,8 @@ protected:
     bool WebhookEnable;
     int WebhookUploadImg;
 
-    void SetInitialParameter(void); 
+    void SetInitialParameter(void);
+    void SetupConfigParams(void); 
 
     void handleFieldname(string _decsep, string _value);   
     void handleMeasurement(string _decsep, string _value);
@@ -34,8 +35,12 @@ public:
     ClassFlowWebhook(std::vector<ClassFlow*>* lfc);
     ClassFlowWebhook(std::vector<ClassFlow*>* lfc, ClassFlow *_prev);
 
-    bool ReadParameter(FILE* pfile, string& aktparamgraph);
+    bool ReadConfigSection(ConfigSection &_section);
     bool doFlow(string time);
+    bool isPublisher(){return true;};
+    bool doPublish(string time, std::vector<NumberPost*>* NUMBERS);
+    std::shared_ptr<CJpegData> createPublishImage(std::vector<NumberPost*>* NUMBERS);
+    bool doPublishWithImage(string time, std::vector<NumberPost*>* NUMBERS, CJpegData *image);
     string name(){return "ClassFlowWebhook";};
 };
 
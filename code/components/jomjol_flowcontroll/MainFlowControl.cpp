@@ -26,6 +26,16 @@
 
 #ifdef ENABLE_MQTT
 #include "server_mqtt.h"
+#include "interface_mqtt.h"
+#include "mqtt_outbox.h"
+#endif
+
+#ifdef ENABLE_INFLUXDB
+#include "interface_influxdb.h"
+#endif
+
+#ifdef ENABLE_WEBHOOK
+#include "interface_webhook.h"
 #endif
 
 #include "server_file.h"
@@ -383,6 +393,12 @@ esp_err_t handler_init(httpd_req_t *req)
 #endif
 
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    if (flowisrunning) {    // InitFlow() deletes the steps the running round uses
+        httpd_resp_send(req, "Flow is running, try again later<br>", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
+
     const char *resp_str = "Init started<br>";
     httpd_resp_send(req, resp_str, HTTPD_RESP_USE_STRLEN);
 
@@ -526,12 +542,94 @@ esp_err_t handler_json(httpd_req_t *req)
     return ESP_OK;
 }
 
+#define METRICS_PREFIX "ai_on_the_edge_device"
+
+static struct {
+    int cpuTemperature, rssi, heapFree, uptime, rounds;
+    int publishFailures[3];
+#ifdef ENABLE_MQTT
+    int mqttSent, mqttSuppressed, mqttOutboxBytes, mqttOutboxDropped;
+#endif
+} deviceMetrics;
+
+
+/* Registers the device metrics once, the values get updated on every scrape */
+static void registerDeviceMetrics(void)
+{
+    deviceMetrics.cpuTemperature = metricsRegistry.addSeries(metricsRegistry.addFamily("cpu_temperature_celsius", "current cpu temperature in celsius", METRIC_GAUGE));
+    deviceMetrics.rssi = metricsRegistry.addSeries(metricsRegistry.addFamily("rssi_dbm", "current WiFi signal strength in dBm", METRIC_GAUGE));
+    deviceMetrics.heapFree = metricsRegistry.addSeries(metricsRegistry.addFamily("memory_heap_free_bytes", "available heap memory", METRIC_GAUGE));
+    deviceMetrics.uptime = metricsRegistry.addSeries(metricsRegistry.addFamily("uptime_seconds", "device uptime in seconds", METRIC_GAUGE));
+    deviceMetrics.rounds = metricsRegistry.addSeries(metricsRegistry.addFamily("rounds_total", "data aquisition rounds since device startup", METRIC_COUNTER));
+
+    int failures = metricsRegistry.addFamily("publish_failures_total", "messages or requests which could not be published since device startup", METRIC_COUNTER);
+    for (int i = 0; i < 3; ++i) {
+        deviceMetrics.publishFailures[i] = -1;
+    }
+#ifdef ENABLE_MQTT
+    deviceMetrics.publishFailures[0] = metricsRegistry.addSeries(failures, metricsLabel("target", "mqtt"));
+
+    // MQTT messages, suppressed ones were unchanged and retained (see [MQTT] PublishOnChange)
+    deviceMetrics.mqttSent = metricsRegistry.addSeries(metricsRegistry.addFamily("mqtt_messages_sent_total", "MQTT messages published since device startup", METRIC_COUNTER));
+    deviceMetrics.mqttSuppressed = metricsRegistry.addSeries(metricsRegistry.addFamily("mqtt_messages_suppressed_total", "unchanged MQTT messages not published since device startup", METRIC_COUNTER));
+    deviceMetrics.mqttOutboxBytes = metricsRegistry.addSeries(metricsRegistry.addFamily("mqtt_outbox_bytes", "MQTT messages waiting to be sent or acknowledged", METRIC_GAUGE));
+    deviceMetrics.mqttOutboxDropped = metricsRegistry.addSeries(metricsRegistry.addFamily("mqtt_outbox_dropped_total", "MQTT messages dropped from the full outbox", METRIC_COUNTER));
+#endif
+#ifdef ENABLE_INFLUXDB
+    deviceMetrics.publishFailures[1] = metricsRegistry.addSeries(failures, metricsLabel("target", "influxdb"));
+#endif
+#ifdef ENABLE_WEBHOOK
+    deviceMetrics.publishFailures[2] = metricsRegistry.addSeries(failures, metricsLabel("target", "webhook"));
+#endif
+}
+
+
+/* The counters kept by the modules themselves are only copied on a scrape */
+static void updateDeviceMetrics(void)
+{
+    metricsRegistry.set(deviceMetrics.cpuTemperature, (int)temperatureRead());
+    metricsRegistry.set(deviceMetrics.rssi, get_WIFI_RSSI());
+    metricsRegistry.set(deviceMetrics.heapFree, getESPHeapSize());
+    metricsRegistry.set(deviceMetrics.uptime, (long)getUpTime());
+    metricsRegistry.set(deviceMetrics.rounds, countRounds);
+
+#ifdef ENABLE_MQTT
+    metricsRegistry.set(deviceMetrics.publishFailures[0], MQTTgetFailedCount());
+    metricsRegistry.set(deviceMetrics.mqttSent, MQTTgetPublishedCount());
+    metricsRegistry.set(deviceMetrics.mqttSuppressed, MQTTgetSuppressedCount());
+
+    outbox_stats_t outboxStats;
+    outbox_get_stats(NULL, &outboxStats);
+    int outboxDropped = 0;
+    for (int i = 0; i < OUTBOX_PRIORITY_COUNT; ++i) {
+        outboxDropped += outboxStats.dropped[i];
+    }
+    metricsRegistry.set(deviceMetrics.mqttOutboxBytes, outboxStats.bytes);
+    metricsRegistry.set(deviceMetrics.mqttOutboxDropped, outboxDropped + outboxStats.rejected);
+#endif
+#ifdef ENABLE_INFLUXDB
+    metricsRegistry.set(deviceMetrics.publishFailures[1], InfluxDBgetFailedCount());
+#endif
+#ifdef ENABLE_WEBHOOK
+    metricsRegistry.set(deviceMetrics.publishFailures[2], WebhookGetFailedCount());
+#endif
+}
+
+
+static bool sendMetricsChunk(void *_context, const char *_data, size_t _len)
+{
+    return (httpd_resp_send_chunk((httpd_req_t *)_context, _data, _len) == ESP_OK);
+}
+
+
 /**
  * Generates a http response containing the OpenMetrics (https://openmetrics.io/) text wire format 
  * according to https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md#text-format.
  * 
  * A MetricFamily with a Metric for each Sequence is provided. If no valid value is available, the metric is not provided.
- * MetricPoints are provided without a timestamp. Additional metrics with some device information is also provided.
+ * MetricPoints are provided without a timestamp. Additional metrics with some device information, step durations,
+ * publish failures, "N" digits per ROI and the alignment SAD come from the registry (metrics_registry.h).
+ * The response is rendered chunk by chunk from a fixed buffer (METRICS_CHUNK_SIZE).
  * 
  * The metric name prefix is 'ai_on_the_edge_device_'.
  * 
@@ -555,28 +653,21 @@ esp_err_t handler_openmetrics(httpd_req_t *req)
         httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
         httpd_resp_set_type(req, "text/plain"); // application/openmetrics-text is not yet supported by prometheus so we use text/plain for now
 
-        const string metricNamePrefix = "ai_on_the_edge_device";
+        static char buffer[METRICS_CHUNK_SIZE];     // Only one request at a time is handled by the web server
+        MetricsWriter writer(buffer, sizeof(buffer), sendMetricsChunk, req);
 
         // get current measurement (flow)
-        string response = createSequenceMetrics(metricNamePrefix, flowctrl.getNumbers());
-
-        // CPU Temperature
-        response += createMetric(metricNamePrefix + "_cpu_temperature_celsius", "current cpu temperature in celsius", "gauge", std::to_string((int)temperatureRead())); 
-
-        // WiFi signal strength
-        response += createMetric(metricNamePrefix + "_rssi_dbm", "current WiFi signal strength in dBm", "gauge", std::to_string(get_WIFI_RSSI())); 
+        writeSequenceMetrics(writer, METRICS_PREFIX, flowctrl.getNumbers());
 
-        // memory info
-        response += createMetric(metricNamePrefix + "_memory_heap_free_bytes", "available heap memory", "gauge", std::to_string(getESPHeapSize())); 
+        updateDeviceMetrics();
+        metricsRegistry.render(writer, METRICS_PREFIX);
 
-        // device uptime
-        response += createMetric(metricNamePrefix + "_uptime_seconds", "device uptime in seconds", "gauge", std::to_string((long)getUpTime())); 
-
-        // data aquisition round
-        response += createMetric(metricNamePrefix + "_rounds_total", "data aquisition rounds since device startup", "counter", std::to_string(countRounds));
-
-        // the response always contains at least the metadata (HELP, TYPE) for the MetricFamily so no length check is needed
-        httpd_resp_send(req, response.c_str(), response.length());
+        // an empty chunk terminates the response, a failed chunk means the connection is gone already
+        if (!writer.finish()) {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Failed to send /metrics");
+            return ESP_FAIL;
+        }
+        httpd_resp_send_chunk(req, NULL, 0);
     }
     else
     {
@@ -1592,9 +1683,25 @@ esp_err_t handler_sensors(httpd_req_t *req)
         }
     }
     
+    // Optional: /sensors?history=<minutes> returns the buffered readings instead of the last values
+    int historyMinutes = -1;
+    char _query[50];
+    char _value[10];
+    if (httpd_req_get_url_query_str(req, _query, sizeof(_query)) == ESP_OK &&
+        httpd_query_key_value(_query, "history", _value, sizeof(_value)) == ESP_OK) {
+        historyMinutes = atoi(_value);
+        if (historyMinutes < 0) {
+            historyMinutes = 0;
+        }
+    }
+
     std::string jsonResponse;
     if (sensorFlow && sensorFlow->getSensorManager()) {
-        jsonResponse = sensorFlow->getSensorManager()->getJSON();
+        if (historyMinutes >= 0) {
+            jsonResponse = sensorFlow->getSensorManager()->getHistoryJSON(historyMinutes);
+        } else {
+            jsonResponse = sensorFlow->getSensorManager()->getJSON();
+        }
     } else {
         jsonResponse = "{\"error\":\"No sensors configured\"}";
     }
@@ -1706,9 +1813,112 @@ esp_err_t handler_prevalue(httpd_req_t *req)
     return ESP_OK;
 }
 
+/* Returns the start of the next round (esp_timer time in us) after the current round.
+ * _roundPlanned is the time the round was planned for and gets updated to the tick of the next round.
+ * Only ticks after the planned one count as missed, so a round which started late or off the schedule
+ * (first round, manual start) is no overrun just because a tick passed while it was running. */
+static int64_t getNextRoundStart(int64_t &_roundPlanned, int64_t _now)
+{
+    int64_t interval = (int64_t)auto_interval * 1000;
+    t_OverrunPolicy policy = flowctrl.getOverrunPolicy();
+
+    if (interval <= 0) {
+        _roundPlanned = _now;
+        return _now;
+    }
+
+    // Ticks on full multiples of the interval on the wall clock, e.g. every :00 of a minute
+    if (flowctrl.getAlignToClock() && getTimeIsSet()) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        int64_t wallNow = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+        int64_t wallPlanned = wallNow - (_now - _roundPlanned);
+        // Tick the round belongs to: its own one, or the next one for an off-grid round
+        int64_t plannedTick = ((wallPlanned - (int64_t)FLOW_SCHEDULE_TOLERANCE_MS * 1000) / interval + 1) * interval;
+        int64_t nextTick = (wallNow / interval + 1) * interval;
+        int64_t missed = std::max((int64_t)0, (nextTick - plannedTick) / interval - 1);
+
+        _roundPlanned = _now + (nextTick - wallNow);
+
+        if (missed > 0) {
+            if (policy == OverrunSkip) {
+                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Round took longer than the interval, skipped " + std::to_string(missed) + " round(s)");
+                return _roundPlanned;
+            }
+            // The grid is fixed to the wall clock, so Coalesce and Immediate are the same here
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Round took longer than the interval, next round starts immediately");
+            return _now;
+        }
+
+        return _roundPlanned;
+    }
+
+    // Ticks relative to the first round (or the last manual start)
+    int64_t next = _roundPlanned + interval;
+
+    if (next > _now) {
+        _roundPlanned = next;
+        return next;
+    }
+
+    int64_t missed = (_now - next) / interval + 1;
+
+    switch (policy) {
+        case OverrunSkip:
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Round took longer than the interval, skipped " + std::to_string(missed) + " round(s)");
+            _roundPlanned = next + missed * interval;
+            return _roundPlanned;
+
+        case OverrunCoalesce:
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Round took longer than the interval, next round starts immediately");
+            _roundPlanned = next + (missed - 1) * interval; // Keep the phase of the schedule
+            return _now;
+
+        default: // OverrunImmediate
+            _roundPlanned = _now;
+            return _now;
+    }
+}
+
+
+/* Everything which is not needed for the readout itself. Gets done in the idle time between two rounds. */
+static void doHousekeeping(void)
+{
+#ifdef DEBUG_DETAIL_ON
+    ESP_LOGD(TAG, "Remove older log files");
+#endif
+    LogFile.RemoveOldLogFile();
+    LogFile.RemoveOldDataLog();
+
+    // CPU Temp -> Logfile
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "CPU Temperature: " + std::to_string((int)temperatureRead()) + "°C");
+
+    // WIFI Signal Strength (RSSI) -> Logfile
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "WIFI Signal (RSSI): " + std::to_string(get_WIFI_RSSI()) + "dBm");
+
+    // Check if time is synchronized (if NTP is configured)
+    if (getUseNtp() && !getTimeIsSet())
+    {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Time server is configured, but time is not yet set!");
+        StatusLED(TIME_CHECK, 1, false);
+    }
+
+#if (defined WLAN_USE_MESH_ROAMING && defined WLAN_USE_MESH_ROAMING_ACTIVATE_CLIENT_TRIGGERED_QUERIES)
+    wifiRoamingQuery();
+#endif
+
+// Scan channels and check if an AP with better RSSI is available, then disconnect and try to reconnect to AP with better RSSI
+// NOTE: Scan is done in blocking mode and this takes ca. 1,5 - 2s.
+#ifdef WLAN_USE_ROAMING_BY_SCANNING
+    wifiRoamByScanning();
+#endif
+}
+
+
 void task_autodoFlow(void *pvParameter)
 {
-    int64_t fr_start, fr_delta_ms;
+    int64_t roundPlanned;
+    int housekeepingPostponed = 0;
 
     bTaskAutoFlowCreated = true;
 
@@ -1745,6 +1955,8 @@ void task_autodoFlow(void *pvParameter)
         LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Autostart is not enabled -> Not starting Flow");
     }
 
+    roundPlanned = esp_timer_get_time(); // First round starts immediately
+
     while (autostartIsEnabled)
     {
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "----------------------------------------------------------------"); // Clear separation between runs
@@ -1753,7 +1965,6 @@ void task_autodoFlow(void *pvParameter)
         std::string _zw = "Round #" + std::to_string(++countRounds) + " started";
         LogFile.WriteToFile(ESP_LOG_INFO, TAG, _zw);
 
-        fr_start = esp_timer_get_time();
 
         if (flowisrunning)
         {
@@ -1768,46 +1979,40 @@ void task_autodoFlow(void *pvParameter)
 #endif
             flowisrunning = true;
             doflow();
-#ifdef DEBUG_DETAIL_ON
-            ESP_LOGD(TAG, "Remove older log files");
-#endif
-            LogFile.RemoveOldLogFile();
-            LogFile.RemoveOldDataLog();
         }
 
         // Round finished -> Logfile
         LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Round #" + std::to_string(countRounds) + " completed (" + std::to_string(getUpTime() - roundStartTime) + " seconds)");
 
-        // CPU Temp -> Logfile
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "CPU Temperature: " + std::to_string((int)temperatureRead()) + "°C");
-
-        // WIFI Signal Strength (RSSI) -> Logfile
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "WIFI Signal (RSSI): " + std::to_string(get_WIFI_RSSI()) + "dBm");
+        int64_t now = esp_timer_get_time();
+        int64_t nextRound = getNextRoundStart(roundPlanned, now);
 
-        // Check if time is synchronized (if NTP is configured)
-        if (getUseNtp() && !getTimeIsSet())
+        // Housekeeping only if it does not delay the next round, but do not postpone it forever
+        if ((((nextRound - now) / 1000) >= FLOW_HOUSEKEEPING_MIN_IDLE_MS) || (housekeepingPostponed >= FLOW_HOUSEKEEPING_MAX_POSTPONED))
         {
-            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Time server is configured, but time is not yet set!");
-            StatusLED(TIME_CHECK, 1, false);
+            doHousekeeping();
+            housekeepingPostponed = 0;
+        }
+        else
+        {
+            housekeepingPostponed++;
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Not enough idle time, housekeeping postponed");
         }
 
-#if (defined WLAN_USE_MESH_ROAMING && defined WLAN_USE_MESH_ROAMING_ACTIVATE_CLIENT_TRIGGERED_QUERIES)
-        wifiRoamingQuery();
-#endif
-
-// Scan channels and check if an AP with better RSSI is available, then disconnect and try to reconnect to AP with better RSSI
-// NOTE: Keep this direct before the following task delay, because scan is done in blocking mode and this takes ca. 1,5 - 2s.
-#ifdef WLAN_USE_ROAMING_BY_SCANNING
-        wifiRoamByScanning();
-#endif
-
-        fr_delta_ms = (esp_timer_get_time() - fr_start) / 1000;
+        now = esp_timer_get_time();
 
-        if (auto_interval > fr_delta_ms)
+        if (nextRound > now)
         {
-            const TickType_t xDelay = (auto_interval - fr_delta_ms) / portTICK_PERIOD_MS;
-            ESP_LOGD(TAG, "Autoflow: sleep for: %ldms", (long)xDelay);
+            // Round up and add one tick, a delay of n ticks can end up to one tick early
+            const TickType_t xDelay = ((nextRound - now) / 1000 + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS + 1;
+            ESP_LOGD(TAG, "Autoflow: sleep for: %ldms", (long)(xDelay * portTICK_PERIOD_MS));
             vTaskDelay(xDelay);
+
+            if (esp_timer_get_time() < nextRound)
+            {
+                // Delay got aborted by a manual start (REST API, MQTT) -> interval restarts from now
+                roundPlanned = esp_timer_get_time();
+            }
         }
     }
 
@@ -1845,6 +2050,8 @@ void register_server_main_flow_task_uri(httpd_handle_t server)
 {
     ESP_LOGI(TAG, "server_main_flow_task - Registering URI handlers");
 
+    registerDeviceMetrics();
+
     httpd_uri_t camuri = {};
     camuri.method = HTTP_GET;
 
@@ -0,0 +1,414 @@
+#include "http_client_pool.h"
+
+#include <string.h>
+#include <algorithm>
+
+#ifdef ESP_PLATFORM
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+    #include "freertos/queue.h"
+    #include "esp_timer.h"
+    #include "esp_http_client.h"
+
+    #include "ClassLogFile.h"
+
+    static const char *TAG = "HTTPPOOL";
+#endif
+
+struct HttpPoolJob {
+    HttpPoolRequest *request;
+    HttpPoolCompletion done;
+};
+
+
+HttpClientPool::HttpClientPool(const HttpPoolTransport &_transport, int _maxConnections, int64_t _idleTimeoutUs)
+{
+    transport = _transport;
+    maxConnections = std::max(_maxConnections, 1);
+    idleTimeoutUs = _idleTimeoutUs;
+}
+
+
+HttpClientPool::~HttpClientPool()
+{
+    closeAll();
+}
+
+
+std::string HttpClientPool::hostKey(const std::string &_url)
+{
+    std::string scheme = "http";
+    size_t hostStart = 0;
+    size_t pos = _url.find("://");
+
+    if (pos != std::string::npos) {
+        scheme = _url.substr(0, pos);
+        std::transform(scheme.begin(), scheme.end(), scheme.begin(), ::tolower);
+        hostStart = pos + 3;
+    }
+
+    size_t hostEnd = _url.find_first_of("/?#", hostStart);
+    std::string host = _url.substr(hostStart, (hostEnd == std::string::npos) ? std::string::npos : hostEnd - hostStart);
+
+    size_t at = host.find('@');         // user:password@host
+    if (at != std::string::npos) {
+        host = host.substr(at + 1);
+    }
+
+    if (host.find(':') == std::string::npos) {
+        host += (scheme == "https") ? ":443" : ":80";
+    }
+
+    std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+    return scheme + "://" + host;
+}
+
+
+HttpClientPool::Connection *HttpClientPool::acquire(const std::string &_key)
+{
+    std::lock_guard<std::mutex> lock(poolLock);
+    int64_t now = transport.now();
+
+    // Servers close idle connections anyway, better to start with a new one than to run into a reset
+    for (int i = connections.size() - 1; i >= 0; --i) {
+        if (!connections[i]->busy && (now - connections[i]->lastUsedUs > idleTimeoutUs)) {
+            closeConnection(connections[i]);
+            connections.erase(connections.begin() + i);
+        }
+    }
+
+    for (auto connection : connections) {
+        if (!connection->busy && (connection->key == _key)) {
+            connection->busy = true;
+            reused++;
+            return connection;
+        }
+    }
+
+    // Make room by closing the least recently used idle connection, if all are busy the pool grows for a moment
+    if ((int)connections.size() >= maxConnections) {
+        auto lru = connections.end();
+        for (auto it = connections.begin(); it != connections.end(); ++it) {
+            if (!(*it)->busy && ((lru == connections.end()) || ((*it)->lastUsedUs < (*lru)->lastUsedUs))) {
+                lru = it;
+            }
+        }
+        if (lru != connections.end()) {
+            closeConnection(*lru);
+            connections.erase(lru);
+        }
+    }
+
+    void *handle = transport.open(_key);
+    if (handle == NULL) {
+        return NULL;
+    }
+
+    Connection *connection = new Connection;
+    connection->key = _key;
+    connection->handle = handle;
+    connection->busy = true;
+    connection->lastUsedUs = now;
+    connections.push_back(connection);
+    opened++;
+    return connection;
+}
+
+
+void HttpClientPool::release(Connection *_connection, bool _keep)
+{
+    std::lock_guard<std::mutex> lock(poolLock);
+
+    _connection->busy = false;
+    _connection->lastUsedUs = transport.now();
+
+    if (!_keep || ((int)connections.size() > maxConnections)) {
+        closeConnection(_connection);
+        connections.erase(std::remove(connections.begin(), connections.end(), _connection), connections.end());
+    }
+}
+
+
+void HttpClientPool::closeConnection(Connection *_connection)
+{
+    transport.close(_connection->handle);
+    delete _connection;
+}
+
+
+HttpPoolResult HttpClientPool::perform(const HttpPoolRequest &_request)
+{
+    HttpPoolResult result;
+
+    Connection *connection = acquire(hostKey(_request.url));
+    if (connection == NULL) {
+        return result;
+    }
+
+    bool keep = transport.perform(connection->handle, _request, result);
+    release(connection, keep);
+    return result;
+}
+
+
+void HttpClientPool::closeAll(void)
+{
+    std::lock_guard<std::mutex> lock(poolLock);
+
+    for (int i = connections.size() - 1; i >= 0; --i) {
+        if (!connections[i]->busy) {
+            closeConnection(connections[i]);
+            connections.erase(connections.begin() + i);
+        }
+    }
+}
+
+
+int HttpClientPool::getOpenConnections(void)
+{
+    std::lock_guard<std::mutex> lock(poolLock);
+    return connections.size();
+}
+
+
+#ifdef ESP_PLATFORM
+
+void HttpClientPool::task_http_pool(void *pvParameter)
+{
+    HttpClientPool *pool = (HttpClientPool*) pvParameter;
+    HttpPoolJob *job = NULL;
+
+    while (true) {
+        if (xQueueReceive((QueueHandle_t)pool->queue, &job, portMAX_DELAY) == pdTRUE) {
+            HttpPoolResult result = pool->perform(*job->request);
+            if (job->done) {
+                job->done(result);
+            }
+            delete job->request;
+            delete job;
+        }
+    }
+}
+
+
+bool HttpClientPool::submit(HttpPoolRequest *_request, HttpPoolCompletion _done)
+{
+    {
+        std::lock_guard<std::mutex> lock(poolLock);
+
+        if (queue == NULL) {
+            queue = xQueueCreate(HTTP_POOL_QUEUE_LENGTH, sizeof(HttpPoolJob*));
+        }
+
+        if ((queue != NULL) && (task == NULL)) {
+            BaseType_t xReturned = xTaskCreatePinnedToCore(&task_http_pool, "http_pool", HTTP_POOL_TASK_STACKSIZE,
+                                                           this, tskIDLE_PRIORITY+1, (TaskHandle_t*)&task, tskNO_AFFINITY);
+            if (xReturned != pdPASS) {
+                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Creation of task_http_pool failed");
+                task = NULL;
+            }
+        }
+    }
+
+    HttpPoolJob *job = new HttpPoolJob;
+    job->request = _request;
+    job->done = _done;
+
+    if ((task == NULL) || (xQueueSend((QueueHandle_t)queue, &job, 0) != pdTRUE)) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Request queue full, dropped request to " + hostKey(_request->url));
+        delete job->request;
+        delete job;
+        return false;
+    }
+
+    return true;
+}
+
+
+/*******************************************************************
+ * esp_http_client transport
+ *******************************************************************/
+struct EspHttpConnection {
+    esp_http_client_handle_t client;
+    std::vector<std::string> headers;   // Set by the last request, removed before the next one
+};
+
+// All requests share one buffer for the start of the response, so they are performed one at a time
+static std::mutex responseLock;
+static char responseBuffer[HTTP_POOL_RESPONSE_SIZE];
+static int responseLen = 0;
+
+
+static esp_err_t http_pool_event_handler(esp_http_client_event_t *evt)
+{
+    switch (evt->event_id) {
+        case HTTP_EVENT_ON_CONNECTED:
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Connected");
+            break;
+        case HTTP_EVENT_ON_DATA:
+            if (responseLen < (int)sizeof(responseBuffer) - 1) {
+                int len = std::min(evt->data_len, (int)sizeof(responseBuffer) - 1 - responseLen);
+                memcpy(responseBuffer + responseLen, evt->data, len);
+                responseLen += len;
+            }
+            break;
+        case HTTP_EVENT_DISCONNECTED:
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Disconnected");
+            break;
+        default:
+            break;
+    }
+    return ESP_OK;
+}
+
+
+static void *http_pool_open(const std::string &_hostKey)
+{
+    esp_http_client_config_t config = {};
+    config.url = _hostKey.c_str();
+    config.user_agent = "ESP32 Meter reader";
+    config.event_handler = http_pool_event_handler;
+    config.buffer_size = MAX_HTTP_OUTPUT_BUFFER;
+    config.keep_alive_enable = true;
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    config.save_client_session = true;      // A reconnect resumes the TLS session instead of a full handshake
+#endif
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to initialize HTTP client for " + _hostKey);
+        return NULL;
+    }
+
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "New connection to " + _hostKey);
+    EspHttpConnection *connection = new EspHttpConnection;
+    connection->client = client;
+    return connection;
+}
+
+
+static void http_pool_close(void *_connection)
+{
+    EspHttpConnection *connection = (EspHttpConnection*) _connection;
+    esp_http_client_cleanup(connection->client);
+    delete connection;
+}
+
+
+/* Sends the body in chunks while streamBody creates it. esp_http_client sets "Transfer-Encoding: chunked"
+ * for an unknown length, the chunks have to be framed here. The caller removes the header again. */
+static esp_err_t http_pool_perform_streamed(esp_http_client_handle_t _client, const HttpPoolRequest &_request)
+{
+    esp_err_t err = esp_http_client_open(_client, -1);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    bool written = _request.streamBody([_client](const char *_data, size_t _len) {
+        if (_len == 0) {        // An empty chunk would end the body
+            return true;
+        }
+
+        char size[12];
+        int sizeLen = snprintf(size, sizeof(size), "%x\r\n", (unsigned int)_len);
+
+        return (esp_http_client_write(_client, size, sizeLen) == sizeLen) &&
+               (esp_http_client_write(_client, _data, _len) == (int)_len) &&
+               (esp_http_client_write(_client, "\r\n", 2) == 2);
+    });
+
+    if (!written || (esp_http_client_write(_client, "0\r\n\r\n", 5) != 5)) {
+        esp_http_client_close(_client);
+        return ESP_FAIL;
+    }
+
+    if (esp_http_client_fetch_headers(_client) < 0) {
+        esp_http_client_close(_client);
+        return ESP_FAIL;
+    }
+
+    // Read the rest of the response (into responseBuffer), so the connection can be used again
+    esp_http_client_flush_response(_client, NULL);
+    return ESP_OK;
+}
+
+
+static bool http_pool_perform(void *_connection, const HttpPoolRequest &_request, HttpPoolResult &_result)
+{
+    static const esp_http_client_method_t methods[] = {HTTP_METHOD_GET, HTTP_METHOD_POST, HTTP_METHOD_PUT};
+    EspHttpConnection *connection = (EspHttpConnection*) _connection;
+    esp_http_client_handle_t client = connection->client;
+
+    for (auto &header : connection->headers) {
+        esp_http_client_delete_header(client, header.c_str());
+    }
+    connection->headers.clear();
+
+    esp_http_client_set_url(client, _request.url.c_str());
+    esp_http_client_set_method(client, methods[_request.method]);
+
+    for (auto &header : _request.headers) {
+        esp_http_client_set_header(client, header.first.c_str(), header.second.c_str());
+        connection->headers.push_back(header.first);
+    }
+
+    if (_request.user.empty()) {
+        esp_http_client_set_authtype(client, HTTP_AUTH_TYPE_NONE);
+    }
+    else {
+        esp_http_client_set_username(client, _request.user.c_str());
+        esp_http_client_set_password(client, _request.password.c_str());
+        esp_http_client_set_authtype(client, HTTP_AUTH_TYPE_BASIC);
+    }
+
+    std::lock_guard<std::mutex> lock(responseLock);
+    responseLen = 0;
+
+    if (_request.streamBody) {
+        esp_http_client_set_post_field(client, NULL, 0);
+        _result.err = http_pool_perform_streamed(client, _request);
+        // Added by esp_http_client_open(-1), it would stay on the kept connection for the next requests
+        esp_http_client_delete_header(client, "Transfer-Encoding");
+    }
+    else {
+        if (!_request.ownedBody.empty()) {
+            esp_http_client_set_post_field(client, _request.ownedBody.data(), _request.ownedBody.length());
+        }
+        else {
+            esp_http_client_set_post_field(client, _request.body, _request.bodyLen);
+        }
+
+        _result.err = esp_http_client_perform(client);
+    }
+
+    if (_result.err != ESP_OK) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Request to " + HttpClientPool::hostKey(_request.url) + " failed: " +
+                            std::string(esp_err_to_name(_result.err)));
+        return false;       // Start with a new connection next time
+    }
+
+    _result.status = esp_http_client_get_status_code(client);
+    _result.response.assign(responseBuffer, responseLen);
+    return true;
+}
+
+
+HttpClientPool &getHttpClientPool(void)
+{
+    static HttpClientPool pool({http_pool_open, http_pool_close, http_pool_perform, esp_timer_get_time});
+    return pool;
+}
+
+#else // Host build
+
+bool HttpClientPool::submit(HttpPoolRequest *_request, HttpPoolCompletion _done)
+{
+    HttpPoolResult result = perform(*_request);
+    if (_done) {
+        _done(result);
+    }
+    delete _request;
+    return true;
+}
+
+#endif // ESP_PLATFORM
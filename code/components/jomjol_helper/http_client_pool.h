@@ -0,0 +1,112 @@
+#pragma once
+#ifndef HTTP_CLIENT_POOL_H
+#define HTTP_CLIENT_POOL_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <functional>
+
+#include "../../include/defines.h"
+
+/* Keeps the HTTP connections of the exporters (InfluxDB, Webhook, ...) open between the rounds.
+ * The connections are keyed by scheme, host and port. A request takes an idle connection to its
+ * host or opens a new one and gives it back afterwards, so the TCP (and TLS) handshake is only
+ * done once as long as the server keeps the connection alive. Connections which were idle for
+ * idleTimeoutUs get closed, if maxConnections are open the least recently used idle one gets
+ * closed for a new host.
+ * submit() hands the request to the worker task of the pool, the completion gets called there.
+ * On a host build (no ESP_PLATFORM) submitted requests are performed right away. */
+
+enum HttpPoolMethod {
+    HTTP_POOL_GET,
+    HTTP_POOL_POST,
+    HTTP_POOL_PUT
+};
+
+
+typedef std::function<bool(const char *_data, size_t _len)> HttpPoolWrite;   // false -> connection is broken
+
+
+struct HttpPoolRequest {
+    std::string url;
+    HttpPoolMethod method = HTTP_POOL_POST;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string user;                   // Basic authentication, if set
+    std::string password;
+    const char *body = NULL;            // Not copied, has to be valid until perform() returns
+    size_t bodyLen = 0;
+    std::string ownedBody;              // Used instead of body if set, e.g. for submit()
+    std::function<bool(const HttpPoolWrite &_write)> streamBody;   // Used instead of body if set, writes the body
+                                                                    // while it gets created (chunked transfer encoding)
+};
+
+
+struct HttpPoolResult {
+    int err = -1;                       // esp_err_t of the request, 0 = ESP_OK
+    int status = 0;                     // HTTP status code
+    std::string response;               // Start of the response body (max. HTTP_POOL_RESPONSE_SIZE), e.g. for error messages
+
+    bool ok() const { return (err == 0) && (status >= 200) && (status < 300); };
+};
+
+typedef std::function<void(const HttpPoolResult &_result)> HttpPoolCompletion;
+
+
+// How the pool opens, uses and closes a connection, replaced by a stand-in in the tests
+struct HttpPoolTransport {
+    std::function<void*(const std::string &_hostKey)> open;
+    std::function<void(void *_connection)> close;
+    std::function<bool(void *_connection, const HttpPoolRequest &_request, HttpPoolResult &_result)> perform;  // false -> connection is broken
+    std::function<int64_t(void)> now;   // Microseconds
+};
+
+
+class HttpClientPool {
+public:
+    HttpClientPool(const HttpPoolTransport &_transport, int _maxConnections = HTTP_POOL_MAX_CONNECTIONS,
+                   int64_t _idleTimeoutUs = (int64_t)HTTP_POOL_IDLE_TIMEOUT_S * 1000000);
+    ~HttpClientPool();
+
+    HttpPoolResult perform(const HttpPoolRequest &_request);
+    bool submit(HttpPoolRequest *_request, HttpPoolCompletion _done);  // Takes ownership, false if the queue is full
+    void closeAll(void);                // e.g. after the parameters of a server changed
+
+    int getOpened(void) { return opened; };         // Connections opened since startup
+    int getReused(void) { return reused; };         // Requests which were sent on an already open connection
+    int getOpenConnections(void);
+
+    static std::string hostKey(const std::string &_url);   // "http://host:port"
+
+private:
+    struct Connection {
+        std::string key;
+        void *handle;
+        bool busy;
+        int64_t lastUsedUs;
+    };
+
+    HttpPoolTransport transport;
+    int maxConnections;
+    int64_t idleTimeoutUs;
+
+    std::mutex poolLock;
+    std::vector<Connection*> connections;
+    int opened = 0;
+    int reused = 0;
+
+    void *queue = NULL;                 // QueueHandle_t of the worker task
+    void *task = NULL;                  // TaskHandle_t
+
+    Connection *acquire(const std::string &_key);
+    void release(Connection *_connection, bool _keep);
+    void closeConnection(Connection *_connection);
+    static void task_http_pool(void *pvParameter);
+};
+
+
+// Pool on esp_http_client which is shared by all exporters
+HttpClientPool &getHttpClientPool(void);
+
+#endif // HTTP_CLIENT_POOL_H
@@ -0,0 +1,282 @@
+#include "image_log_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <dirent.h>
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef ESP_PLATFORM
+#include "ClassLogFile.h"
+
+static const char *TAG = "IMAGELOG";
+#endif
+
+// Index record as it is stored in the .idx file
+struct ImageLogIndexEntry {
+    char time[16];
+    char name[28];
+    char result[8];
+    uint32_t offset;
+    uint32_t length;
+};
+
+static_assert(sizeof(ImageLogIndexEntry) == 60, "Index record size must not change, it is the file format");
+
+
+static void copyField(char *_target, size_t _size, const std::string &_value)
+{
+    memset(_target, 0, _size);
+    strncpy(_target, _value.c_str(), _size - 1);
+}
+
+
+static bool isDayFile(const char *_name, const char *_extension)
+{
+    if ((strlen(_name) != 12) || (strcmp(_name + 8, _extension) != 0)) {
+        return false;
+    }
+    for (int i = 0; i < 8; ++i) {
+        if ((_name[i] < '0') || (_name[i] > '9')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+std::string ImageLogRecord::getFileName(void) const
+{
+    if (result.empty()) {
+        return name + "_" + time + ".jpg";
+    }
+    return result + "_" + name + "_" + time + ".jpg";
+}
+
+
+ImageLogStore::ImageLogStore(const std::string &_directory)
+{
+    directory = _directory;
+    segment = NULL;
+    failed = false;
+}
+
+
+ImageLogStore::~ImageLogStore()
+{
+    Abort();
+}
+
+
+std::string ImageLogStore::DayFile(const std::string &_day, const char *_extension)
+{
+    return directory + "/" + _day + _extension;
+}
+
+
+bool ImageLogStore::Begin(const std::string &_time, const std::string &_name, const std::string &_result)
+{
+    Abort();
+
+    if (_time.length() < 8) {
+        return false;
+    }
+    day = _time.LOGFILE_TIME_FORMAT_DATE_EXTR;
+
+    segment = fopen(DayFile(day, ".seg").c_str(), "ab");
+    if (!segment) {
+#ifdef ESP_PLATFORM
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Can't open segment " + DayFile(day, ".seg"));
+#endif
+        return false;
+    }
+    fseek(segment, 0, SEEK_END);
+
+    pending.time = _time;
+    pending.name = _name;
+    pending.result = _result;
+    pending.offset = ftell(segment);
+    pending.length = 0;
+    failed = false;
+    return true;
+}
+
+
+bool ImageLogStore::Write(const void *_data, size_t _len)
+{
+    if (!segment || failed) {
+        return false;
+    }
+
+    if (fwrite(_data, 1, _len, segment) != _len) {
+        failed = true;
+        return false;
+    }
+    pending.length += _len;
+    return true;
+}
+
+
+bool ImageLogStore::Commit(void)
+{
+    if (!segment) {
+        return false;
+    }
+
+    failed = (fclose(segment) != 0) || failed;
+    segment = NULL;
+
+    if (failed || (pending.length == 0)) {
+#ifdef ESP_PLATFORM
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to write " + pending.getFileName() + " to " + DayFile(day, ".seg"));
+#endif
+        return false;
+    }
+
+    ImageLogIndexEntry entry;
+    copyField(entry.time, sizeof(entry.time), pending.time);
+    copyField(entry.name, sizeof(entry.name), pending.name);
+    copyField(entry.result, sizeof(entry.result), pending.result);
+    entry.offset = pending.offset;
+    entry.length = pending.length;
+
+    FILE *index = fopen(DayFile(day, ".idx").c_str(), "ab");
+    if (!index) {
+#ifdef ESP_PLATFORM
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Can't open index " + DayFile(day, ".idx"));
+#endif
+        return false;
+    }
+    bool written = (fwrite(&entry, sizeof(entry), 1, index) == 1);
+    written = (fclose(index) == 0) && written;
+    return written;
+}
+
+
+void ImageLogStore::Abort(void)
+{
+    if (segment) {
+        fclose(segment);
+        segment = NULL;
+    }
+}
+
+
+std::vector<std::string> ImageLogStore::ListDays(void)
+{
+    std::vector<std::string> days;
+
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) {
+        return days;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (isDayFile(entry->d_name, ".idx")) {
+            days.push_back(std::string(entry->d_name, 8));
+        }
+    }
+    closedir(dir);
+
+    std::sort(days.begin(), days.end());
+    return days;
+}
+
+
+bool ImageLogStore::ReadIndex(const std::string &_day, std::vector<ImageLogRecord> &_records)
+{
+    _records.clear();
+
+    FILE *index = fopen(DayFile(_day, ".idx").c_str(), "rb");
+    if (!index) {
+        return false;
+    }
+
+    ImageLogIndexEntry entry;
+    ImageLogRecord record;
+
+    // A record which did not get written completely is ignored
+    while (fread(&entry, sizeof(entry), 1, index) == 1) {
+        entry.time[sizeof(entry.time) - 1] = '\0';
+        entry.name[sizeof(entry.name) - 1] = '\0';
+        entry.result[sizeof(entry.result) - 1] = '\0';
+
+        record.time = entry.time;
+        record.name = entry.name;
+        record.result = entry.result;
+        record.offset = entry.offset;
+        record.length = entry.length;
+        _records.push_back(record);
+    }
+    fclose(index);
+    return true;
+}
+
+
+bool ImageLogStore::ReadImage(const std::string &_day, const ImageLogRecord &_record, ImageLogSink _sink)
+{
+    FILE *pFile = fopen(DayFile(_day, ".seg").c_str(), "rb");
+    if (!pFile) {
+        return false;
+    }
+
+    if (fseek(pFile, _record.offset, SEEK_SET) != 0) {
+        fclose(pFile);
+        return false;
+    }
+
+    char *buffer = (char*) malloc(IMAGE_LOG_READ_CHUNK);
+    if (!buffer) {
+        fclose(pFile);
+        return false;
+    }
+
+    size_t remaining = _record.length;
+    bool ok = true;
+
+    while (ok && (remaining > 0)) {
+        size_t len = std::min(remaining, (size_t)IMAGE_LOG_READ_CHUNK);
+        ok = (fread(buffer, 1, len, pFile) == len) && _sink(buffer, len);
+        remaining -= len;
+    }
+
+    free(buffer);
+    fclose(pFile);
+    return ok;
+}
+
+
+int ImageLogStore::RemoveOlderThan(const std::string &_day)
+{
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) {
+        return 0;
+    }
+
+    struct dirent *entry;
+    std::vector<std::string> files;
+    int removed = 0;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if ((isDayFile(entry->d_name, ".seg") || isDayFile(entry->d_name, ".idx")) &&
+            (strncmp(entry->d_name, _day.c_str(), 8) < 0)) {
+            files.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+
+    for (const std::string &file : files) {
+        if ((unlink((directory + "/" + file).c_str()) == 0) && (file.compare(8, 4, ".idx") == 0)) {
+            removed++;
+        }
+    }
+    return removed;
+}
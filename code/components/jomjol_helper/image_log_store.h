@@ -0,0 +1,64 @@
+#pragma once
+#ifndef IMAGE_LOG_STORE_H
+#define IMAGE_LOG_STORE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "../../include/defines.h"
+
+/* Packed alternative to one JPG file per image in <location>/YYYYMMDD/HH/.
+ * The images of a day get appended to one segment file (<location>/YYYYMMDD.seg), every image gets
+ * a fixed size record in the index file of the day (<location>/YYYYMMDD.idx) with its time, ROI name,
+ * result and position in the segment. FAT only has to handle two growing files per day instead of
+ * thousands of small ones and the retention drops whole days by deleting two files.
+ * The image data gets written before its index record, an image which did not get its index record
+ * (power loss) is just unused space in the segment. */
+
+struct ImageLogRecord {
+    std::string time;           // LOGFILE_TIME_FORMAT, e.g. 20240131-235959
+    std::string name;           // ROI name, "raw" for the source image
+    std::string result;         // e.g. "7.3" or "N.N", empty if there is none
+    uint32_t offset;            // Position in the segment
+    uint32_t length;
+
+    std::string getFileName(void) const;        // Same name as the image gets in the folder layout
+};
+
+typedef std::function<bool(const char *_data, size_t _len)> ImageLogSink;     // false aborts the reading
+
+
+class ImageLogStore {
+public:
+    explicit ImageLogStore(const std::string &_directory);
+    ~ImageLogStore();
+
+    ImageLogStore(const ImageLogStore&) = delete;
+    ImageLogStore& operator=(const ImageLogStore&) = delete;
+
+    // Writing one image: Begin(), Write() as often as needed, Commit() adds the index record
+    bool Begin(const std::string &_time, const std::string &_name, const std::string &_result);
+    bool Write(const void *_data, size_t _len);
+    bool Commit(void);
+    void Abort(void);
+
+    std::vector<std::string> ListDays(void);                     // YYYYMMDD, sorted
+    bool ReadIndex(const std::string &_day, std::vector<ImageLogRecord> &_records);
+    bool ReadImage(const std::string &_day, const ImageLogRecord &_record, ImageLogSink _sink);
+
+    int RemoveOlderThan(const std::string &_day);               // Returns the number of removed days
+
+private:
+    std::string directory;
+    FILE *segment;
+    bool failed;
+    std::string day;
+    ImageLogRecord pending;
+
+    std::string DayFile(const std::string &_day, const char *_extension);
+};
+
+#endif // IMAGE_LOG_STORE_H
@@ -0,0 +1,232 @@
+#include "parallel_for.h"
+
+#include <algorithm>
+
+#ifdef ESP_PLATFORM
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+    #include "freertos/semphr.h"
+
+    #include "ClassLogFile.h"
+    #include "../../include/defines.h"
+#else
+    #include <thread>
+    #include <vector>
+#endif
+
+/* Number of chunks the range [_start, _end) gets split into */
+static int parallel_for_chunks(int _start, int _end, int _workers, int _minChunk)
+{
+    _minChunk = std::max(_minChunk, 1);
+    return std::max(std::min((_end - _start) / _minChunk, _workers), 1);
+}
+
+
+/* Bounds of chunk _index; the chunks are contiguous and in order of the plain loop */
+static void parallel_for_chunk(int _start, int _end, int _chunks, int _index, int &_chunkStart, int &_chunkEnd)
+{
+    long long count = _end - _start;
+    _chunkStart = _start + (int)((count * _index) / _chunks);
+    _chunkEnd = _start + (int)((count * (_index + 1)) / _chunks);
+}
+
+
+#ifdef ESP_PLATFORM
+
+static const char* TAG = "PARALLEL";
+
+struct ParallelForWorker {
+    TaskHandle_t task = NULL;
+    SemaphoreHandle_t done = NULL;
+    const ParallelForBody *body = NULL;
+    int start = 0;
+    int end = 0;
+};
+
+static ParallelForWorker workers[portNUM_PROCESSORS];
+static SemaphoreHandle_t poolLock = NULL;
+static bool poolStarted = false;
+static bool poolEnabled = true;
+static bool stackWarned = false;
+
+
+static void task_parallel_for_worker(void *pvParameter)
+{
+    ParallelForWorker *worker = (ParallelForWorker*) pvParameter;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        (*worker->body)(worker->start, worker->end);
+        xSemaphoreGive(worker->done);
+    }
+}
+
+
+bool parallel_for_init(void)
+{
+    if (poolStarted) {
+        return true;
+    }
+
+    if (portNUM_PROCESSORS < 2) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Single core, loops are not split");
+        return false;
+    }
+
+    poolLock = xSemaphoreCreateMutex();
+    if (poolLock == NULL) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to create pool lock, loops are not split");
+        return false;
+    }
+
+    for (int core = 0; core < portNUM_PROCESSORS; ++core) {
+        workers[core].done = xSemaphoreCreateBinary();
+        if (workers[core].done == NULL) {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to create worker semaphore, loops are not split");
+            return false;
+        }
+
+        BaseType_t xReturned = xTaskCreatePinnedToCore(&task_parallel_for_worker, "parallel_for", PARALLEL_FOR_TASK_STACKSIZE,
+                                                       &workers[core], PARALLEL_FOR_TASK_PRIORITY, &workers[core].task, core);
+        if (xReturned != pdPASS) {
+            LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to create worker for core " + std::to_string(core) + ", loops are not split");
+            return false;
+        }
+    }
+
+    poolStarted = true;
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Started " + std::to_string(portNUM_PROCESSORS) + " workers");
+    return true;
+}
+
+
+int parallel_for_workers(void)
+{
+    return (poolStarted && poolEnabled) ? portNUM_PROCESSORS : 1;
+}
+
+
+void parallel_for_enable(bool _enable)
+{
+    poolEnabled = _enable;
+}
+
+
+int parallel_for_stack_free(void)
+{
+    if (!poolStarted) {
+        return -1;
+    }
+
+    int stackFree = PARALLEL_FOR_TASK_STACKSIZE;
+    for (int core = 0; core < portNUM_PROCESSORS; ++core) {
+        stackFree = std::min(stackFree, (int)uxTaskGetStackHighWaterMark(workers[core].task));
+    }
+    return stackFree;
+}
+
+
+void parallel_for(int _start, int _end, const ParallelForBody &_body, int _minChunk)
+{
+    int chunks = parallel_for_chunks(_start, _end, parallel_for_workers(), _minChunk);
+
+    // Pool busy (nested call or another task) -> just run it here, the result is the same
+    if ((chunks < 2) || (xSemaphoreTake(poolLock, 0) != pdTRUE)) {
+        _body(_start, _end);
+        return;
+    }
+
+    // Chunk 0 runs on the calling task, the others on the workers of the other cores
+    int ownCore = xPortGetCoreID();
+    ParallelForWorker *dispatched[portNUM_PROCESSORS];
+    int anzDispatched = 0;
+
+    for (int core = 0; (core < portNUM_PROCESSORS) && (anzDispatched < chunks - 1); ++core) {
+        if (core == ownCore) {
+            continue;
+        }
+
+        ParallelForWorker *worker = &workers[core];
+        worker->body = &_body;
+        parallel_for_chunk(_start, _end, chunks, anzDispatched + 1, worker->start, worker->end);
+        dispatched[anzDispatched++] = worker;
+        xTaskNotifyGive(worker->task);
+    }
+
+    int ownStart, ownEnd;
+    parallel_for_chunk(_start, _end, chunks, 0, ownStart, ownEnd);
+    _body(ownStart, ownEnd);
+
+    for (int i = 0; i < anzDispatched; ++i) {
+        xSemaphoreTake(dispatched[i]->done, portMAX_DELAY);
+        dispatched[i]->body = NULL;
+    }
+
+    xSemaphoreGive(poolLock);
+
+    // The bodies can log (SD card), so keep an eye on the stack of the workers
+    if (!stackWarned) {
+        int stackFree = parallel_for_stack_free();
+        if (stackFree < PARALLEL_FOR_TASK_STACK_MIN_FREE) {
+            stackWarned = true;
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Worker stack almost used up, only " + std::to_string(stackFree) +
+                                                   " bytes left. Increase PARALLEL_FOR_TASK_STACKSIZE!");
+        }
+    }
+}
+
+#else // Host build
+
+static bool poolEnabled = true;
+
+
+bool parallel_for_init(void)
+{
+    return true;
+}
+
+
+int parallel_for_workers(void)
+{
+    return poolEnabled ? std::max((int)std::thread::hardware_concurrency(), 1) : 1;
+}
+
+
+void parallel_for_enable(bool _enable)
+{
+    poolEnabled = _enable;
+}
+
+
+int parallel_for_stack_free(void)
+{
+    return -1;
+}
+
+
+void parallel_for(int _start, int _end, const ParallelForBody &_body, int _minChunk)
+{
+    int chunks = parallel_for_chunks(_start, _end, parallel_for_workers(), _minChunk);
+
+    if (chunks < 2) {
+        _body(_start, _end);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < chunks; ++i) {
+        int chunkStart, chunkEnd;
+        parallel_for_chunk(_start, _end, chunks, i, chunkStart, chunkEnd);
+        threads.emplace_back([&_body, chunkStart, chunkEnd]() { _body(chunkStart, chunkEnd); });
+    }
+
+    int ownStart, ownEnd;
+    parallel_for_chunk(_start, _end, chunks, 0, ownStart, ownEnd);
+    _body(ownStart, ownEnd);
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+#endif // ESP_PLATFORM
@@ -0,0 +1,26 @@
+#pragma once
+#ifndef PARALLEL_FOR_h
+#define PARALLEL_FOR_h
+
+#include <functional>
+
+
+/* Splits the work of a loop over both cores of the ESP32.
+ * A fixed pool of one worker per core gets started once by parallel_for_init(). The calling task
+ * processes the chunk of its own core itself, the workers of the other cores the remaining ones.
+ * The range gets split into contiguous chunks, so a body which computes each index independently
+ * produces exactly the same result as the plain loop.
+ * If the pool is not started, already in use (e.g. nested call or second task) or the range is
+ * too small, the body simply gets called once for the whole range on the calling task.
+ * parallel_for_enable(false) runs every loop on the calling task, e.g. to compare the results.
+ * On a host build (no ESP_PLATFORM) the chunks are run with std::thread. */
+
+typedef std::function<void(int _start, int _end)> ParallelForBody;   // Processes [_start, _end)
+
+bool parallel_for_init(void);
+int parallel_for_workers(void);
+void parallel_for_enable(bool _enable);
+int parallel_for_stack_free(void);      // Smallest free stack of the workers in bytes since start, -1 without pool
+void parallel_for(int _start, int _end, const ParallelForBody &_body, int _minChunk = 1);
+
+#endif // PARALLEL_FOR_h
@@ -0,0 +1,241 @@
+#include "publish_spool.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "Helper.h"
+#include "ClassLogFile.h"
+
+static const char *TAG = "SPOOL";
+
+struct SpoolRecordHeader {
+    uint32_t len;
+    uint32_t time;
+};
+
+
+PublishSpool::PublishSpool(std::string _name, long _segmentSize, int _maxSegments)
+{
+    directory = std::string(SPOOL_ROOT) + "/" + _name;
+    segmentSize = _segmentSize;
+    maxSegments = _maxSegments;
+    initialized = false;
+    firstSeq = 1;
+    lastSeq = 0;
+    readOffset = 0;
+    writeSize = 0;
+    droppedSegments = 0;
+}
+
+
+std::string PublishSpool::SegmentFile(uint32_t _seq)
+{
+    char name[16];
+    snprintf(name, sizeof(name), "/%08u.seg", (unsigned int)_seq);
+    return directory + name;
+}
+
+
+/* Picks up the segments left from before a reboot. The directory only gets created with the first
+ * Append(), so nothing is written to the SD card as long as everything gets published. */
+void PublishSpool::Init(void)
+{
+    if (initialized) {
+        return;
+    }
+    initialized = true;
+
+    DIR *dir = opendir(directory.c_str());
+    if (dir) {
+        struct dirent *entry;
+        unsigned int seq;
+        bool found = false;
+
+        while ((entry = readdir(dir)) != NULL) {
+            if (sscanf(entry->d_name, "%u.seg", &seq) != 1) {
+                continue;
+            }
+            if (!found || (seq < firstSeq)) {
+                firstSeq = seq;
+            }
+            if (!found || (seq > lastSeq)) {
+                lastSeq = seq;
+            }
+            found = true;
+        }
+        closedir(dir);
+    }
+
+    if (firstSeq > lastSeq) {
+        return;
+    }
+
+    FILE *pFile = fopen((directory + "/cursor").c_str(), "r");
+    if (pFile) {
+        unsigned int seq;
+        long offset;
+        if ((fscanf(pFile, "%u %ld", &seq, &offset) == 2) && (seq == firstSeq)) {
+            readOffset = offset;
+        }
+        fclose(pFile);
+    }
+
+    // The last record might be incomplete (power loss), so appending continues in a new segment
+    writeSize = segmentSize;
+
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, directory + ": " + std::to_string(lastSeq - firstSeq + 1) + " segment(s) left to replay");
+}
+
+
+void PublishSpool::SaveCursor(void)
+{
+    FILE *pFile = fopen((directory + "/cursor").c_str(), "w");
+    if (pFile == NULL) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to save cursor of " + directory);
+        return;
+    }
+    fprintf(pFile, "%u %ld\n", (unsigned int)firstSeq, readOffset);
+    fclose(pFile);
+}
+
+
+void PublishSpool::RemoveSegment(uint32_t _seq)
+{
+    unlink(SegmentFile(_seq).c_str());
+}
+
+
+bool PublishSpool::isEmpty(void)
+{
+    Init();
+    return (firstSeq > lastSeq);
+}
+
+
+bool PublishSpool::Append(const std::string &_payload, time_t _time)
+{
+    Init();
+
+    long recordSize = sizeof(SpoolRecordHeader) + _payload.size();
+
+    if (firstSeq > lastSeq) {
+        MakeDir(directory);
+        lastSeq = firstSeq;
+        readOffset = 0;
+        writeSize = 0;
+    }
+    else if ((writeSize > 0) && (writeSize + recordSize > segmentSize)) {
+        lastSeq++;
+        writeSize = 0;
+
+        if ((int)(lastSeq - firstSeq + 1) > maxSegments) {
+            RemoveSegment(firstSeq);
+            firstSeq++;
+            readOffset = 0;
+            droppedSegments++;
+            SaveCursor();
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, directory + " is full, dropped oldest segment (" +
+                                std::to_string(droppedSegments) + " in total)");
+        }
+    }
+
+    FILE *pFile = fopen(SegmentFile(lastSeq).c_str(), "ab");
+    if (pFile == NULL) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to open " + SegmentFile(lastSeq));
+        return false;
+    }
+
+    SpoolRecordHeader header;
+    header.len = _payload.size();
+    header.time = (uint32_t)_time;
+
+    bool ok = (fwrite(&header, sizeof(header), 1, pFile) == 1) &&
+              (fwrite(_payload.data(), 1, _payload.size(), pFile) == _payload.size());
+    fclose(pFile);
+
+    if (!ok) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to write " + SegmentFile(lastSeq));
+        writeSize = segmentSize;        // Do not append behind a partial record
+        return false;
+    }
+
+    writeSize += recordSize;
+    return true;
+}
+
+
+int PublishSpool::Replay(size_t _maxBytes, const SpoolSender &_send)
+{
+    if (isEmpty()) {
+        return 0;
+    }
+
+    std::vector<SpoolRecord> records;
+    size_t bytes = 0;
+    uint32_t seq = firstSeq;
+    long offset = readOffset;
+    bool full = false;
+
+    while (!full) {
+        FILE *pFile = fopen(SegmentFile(seq).c_str(), "rb");
+
+        if (pFile) {
+            fseek(pFile, offset, SEEK_SET);
+
+            SpoolRecordHeader header;
+            while ((fread(&header, sizeof(header), 1, pFile) == 1) && (header.len <= (uint32_t)segmentSize)) {
+                if (!records.empty() && (bytes + header.len > _maxBytes)) {
+                    full = true;
+                    break;
+                }
+
+                SpoolRecord record;
+                record.time = header.time;
+                record.payload.resize(header.len);
+                if (fread(&record.payload[0], 1, header.len, pFile) != header.len) {
+                    break;      // Incomplete record at the end of the segment
+                }
+
+                records.push_back(record);
+                bytes += header.len;
+                offset += sizeof(header) + header.len;
+            }
+            fclose(pFile);
+        }
+
+        if (full || (seq == lastSeq)) {
+            break;
+        }
+        seq++;
+        offset = 0;
+    }
+
+    if (!records.empty() && !_send(records)) {
+        return -1;
+    }
+
+    for (uint32_t s = firstSeq; s < seq; ++s) {
+        RemoveSegment(s);
+    }
+    firstSeq = seq;
+    readOffset = offset;
+
+    if (!full && (seq == lastSeq)) {
+        // Everything delivered
+        RemoveSegment(seq);
+        firstSeq = lastSeq + 1;
+        readOffset = 0;
+        writeSize = 0;
+        unlink((directory + "/cursor").c_str());
+    }
+    else {
+        SaveCursor();
+    }
+
+    if (!records.empty()) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Replayed " + std::to_string(records.size()) + " record(s) from " + directory);
+    }
+    return records.size();
+}
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef PUBLISH_SPOOL_H
+#define PUBLISH_SPOOL_H
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "../../include/defines.h"
+
+/* Store-and-forward buffer on the SD card for data which could not be published.
+ * The records get appended to segment files (/sdcard/spool/<name>/<seq>.seg, each record is a
+ * small header + payload). If the spool exceeds maxSegments segments, the oldest segment
+ * gets dropped. Replay() hands the oldest records to the sender as one batch and only moves the
+ * read position (kept in "cursor") forward if the sender succeeded, so the records are delivered
+ * in the order they got appended, also across a reboot.
+ * A spool is used by one task only (the task which publishes). */
+
+struct SpoolRecord {
+    time_t time;
+    std::string payload;
+};
+
+typedef std::function<bool(const std::vector<SpoolRecord> &_records)> SpoolSender;    // true if delivered
+
+
+class PublishSpool {
+public:
+    PublishSpool(std::string _name, long _segmentSize = SPOOL_SEGMENT_SIZE, int _maxSegments = SPOOL_MAX_SEGMENTS);
+
+    bool Append(const std::string &_payload, time_t _time);
+    int Replay(size_t _maxBytes, const SpoolSender &_send);     // Returns the number of delivered records, -1 if the sender failed
+
+    bool isEmpty(void);
+    int getDroppedSegments(void) { return droppedSegments; };
+
+private:
+    std::string directory;
+    long segmentSize;
+    int maxSegments;
+    bool initialized;
+    uint32_t firstSeq;          // Oldest segment, the spool is empty if firstSeq > lastSeq
+    uint32_t lastSeq;           // Segment which gets appended to
+    long readOffset;            // Position in the oldest segment
+    long writeSize;             // Size of the newest segment
+    int droppedSegments;
+
+    void Init(void);
+    std::string SegmentFile(uint32_t _seq);
+    void SaveCursor(void);
+    void RemoveSegment(uint32_t _seq);
+};
+
+#endif // PUBLISH_SPOOL_H
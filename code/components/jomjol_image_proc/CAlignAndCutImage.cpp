@@ -20,7 +20,7 @@ CAlignAndCutImage::CAlignAndCutImage(std::string _name, CImageBasis *_org, CImag
     bpp = _org->bpp;
     externalImage = true;   
 
-    islocked = false; 
+    lockOwner = _org;       // Shares the buffer of _org -> lock through _org
 
     ImageTMP = _temp;
 }
@@ -39,6 +39,8 @@ bool CAlignAndCutImage::Align(RefInfo *_temp1, RefInfo *_temp2)
     int r0_x, r0_y, r1_x, r1_y;
     bool isSimilar1, isSimilar2;
 
+    CImageWriteLock lock(this);     // Readers must not see a partially aligned image
+
     CFindTemplate* ft = new CFindTemplate("align", rgb_image, channels, width, height, bpp);
 
     r0_x = _temp1->target_x;
@@ -114,7 +116,7 @@ void CAlignAndCutImage::CutAndSave(std::string _template1, int x1, int y1, int d
     stbi_uc* p_target;
     stbi_uc* p_source;
 
-    RGBImageLock();
+    RGBImageLockRead();
 
     for (int x = x1; x < x2; ++x)
         for (int y = y1; y < y2; ++y)
@@ -132,7 +134,7 @@ void CAlignAndCutImage::CutAndSave(std::string _template1, int x1, int y1, int d
 #endif
     
 
-    RGBImageRelease();
+    RGBImageReleaseRead();
 
     stbi_image_free(odata);
 }
@@ -156,7 +158,7 @@ void CAlignAndCutImage::CutAndSave(int x1, int y1, int dx, int dy, CImageBasis *
     }
 
     uint8_t* odata = _target->RGBImageLock();
-    RGBImageLock();
+    RGBImageLockRead();
 
     stbi_uc* p_target;
     stbi_uc* p_source;
@@ -170,7 +172,7 @@ void CAlignAndCutImage::CutAndSave(int x1, int y1, int dx, int dy, CImageBasis *
                 p_target[_channels] = p_source[_channels];
         }
 
-    RGBImageRelease();
+    RGBImageReleaseRead();
     _target->RGBImageRelease();
 }
 
@@ -193,7 +195,7 @@ CImageBasis* CAlignAndCutImage::CutAndSave(int x1, int y1, int dx, int dy)
     stbi_uc* p_target;
     stbi_uc* p_source;
 
-    RGBImageLock();
+    RGBImageLockRead();
 
     for (int x = x1; x < x2; ++x)
         for (int y = y1; y < y2; ++y)
@@ -205,7 +207,7 @@ CImageBasis* CAlignAndCutImage::CutAndSave(int x1, int y1, int dx, int dy)
         }
 
     CImageBasis* rs = new CImageBasis("CutAndSave", odata, channels, dx, dy, bpp);
-    RGBImageRelease();
+    RGBImageReleaseRead();
     rs->SetIndepended();
     return rs;
 }
@@ -2,9 +2,11 @@
 
 #include "ClassLogFile.h"
 #include "Helper.h"
+#include "parallel_for.h"
 #include "../../include/defines.h"
 
 #include <esp_log.h>
+#include <vector>
 
 static const char* TAG = "C FIND TEMPL";
 
@@ -14,6 +16,7 @@ static const char* TAG = "C FIND TEMPL";
 bool CFindTemplate::FindTemplate(RefInfo *_ref)
 {
     uint8_t* rgb_template;
+    _ref->found_SAD = -1;
 
     if (file_size(_ref->image_file.c_str()) == 0) {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, _ref->image_file + " is empty!");
@@ -85,6 +88,7 @@ bool CFindTemplate::FindTemplate(RefInfo *_ref)
 #endif
         _ref->found_x = _ref->fastalg_x;
         _ref->found_y = _ref->fastalg_y;
+        _ref->found_SAD = SAD;        // Already calculated by CalculateSimularities()
 
         stbi_image_free(rgb_template);
         
@@ -94,38 +98,69 @@ bool CFindTemplate::FindTemplate(RefInfo *_ref)
 //    ESP_LOGD(TAG, "FindTemplate 04");
 
 
-    double aktSAD;
     double minSAD = pow(tpl_width * tpl_height * 255, 2);
 
-    RGBImageLock();
+    RGBImageLockRead();
 
 //    ESP_LOGD(TAG, "FindTemplate 05");
-    int xouter, youter, tpl_x, tpl_y, _ch;
     int _anzchannels = channels;
     if (_ref->alignment_algo == 0)  // 0 = "Default" (nur R-Kanal)
         _anzchannels = 1;
 
-    for (xouter = ow_start; xouter <= ow_stop; xouter++)
-        for (youter = oh_start; youter <= oh_stop; ++youter)
-        {
-            aktSAD = 0;
-            for (tpl_x = 0; tpl_x < tpl_width; tpl_x++)
-                for (tpl_y = 0; tpl_y < tpl_height; tpl_y++)
-                {
-                    stbi_uc* p_org = rgb_image + (channels * ((youter + tpl_y) * width + (xouter + tpl_x)));
-                    stbi_uc* p_tpl = rgb_template + (channels * (tpl_y * tpl_width + tpl_x));
-                    for (_ch = 0; _ch < _anzchannels; ++_ch)
+    // The rows of the search window get split over both cores. Each part keeps its first best position
+    // (x outer, y inner like a single search), on equal SAD the merge prefers the smaller x, then the
+    // smaller y. So the result is exactly the one of a search over the whole window.
+    struct SearchResult {
+        bool found = false;
+        double minSAD;
+        int x, y;
+    };
+    std::vector<SearchResult> results(oh_stop - oh_start + 1);
+
+    parallel_for(oh_start, oh_stop + 1, [&](int _ystart, int _yend)
+    {
+        SearchResult &result = results[_ystart - oh_start];
+        result.minSAD = minSAD;
+
+        for (int xouter = ow_start; xouter <= ow_stop; xouter++)
+            for (int youter = _ystart; youter < _yend; ++youter)
+            {
+                double aktSAD = 0;
+                for (int tpl_x = 0; tpl_x < tpl_width; tpl_x++)
+                    for (int tpl_y = 0; tpl_y < tpl_height; tpl_y++)
                     {
-                        aktSAD += pow(p_tpl[_ch] - p_org[_ch], 2);
+                        stbi_uc* p_org = rgb_image + (channels * ((youter + tpl_y) * width + (xouter + tpl_x)));
+                        stbi_uc* p_tpl = rgb_template + (channels * (tpl_y * tpl_width + tpl_x));
+                        for (int _ch = 0; _ch < _anzchannels; ++_ch)
+                        {
+                            aktSAD += pow(p_tpl[_ch] - p_org[_ch], 2);
+                        }
                     }
+                if (aktSAD < result.minSAD)
+                {
+                    result.minSAD = aktSAD;
+                    result.x = xouter;
+                    result.y = youter;
+                    result.found = true;
                 }
-            if (aktSAD < minSAD)
-            {
-                minSAD = aktSAD;
-                _ref->found_x = xouter;
-                _ref->found_y = youter;
             }
+    });
+
+    for (auto &result : results)
+    {
+        if (!result.found)
+            continue;
+
+        bool isFirstOfEqual = (result.x < _ref->found_x) || ((result.x == _ref->found_x) && (result.y < _ref->found_y));
+        if ((result.minSAD < minSAD) || ((result.minSAD == minSAD) && isFirstOfEqual))
+        {
+            minSAD = result.minSAD;
+            _ref->found_x = result.x;
+            _ref->found_y = result.y;
         }
+    }
+
+    _ref->found_SAD = sqrt(minSAD) / (tpl_width * tpl_height * _anzchannels);
 
 //    ESP_LOGD(TAG, "FindTemplate 06");
 
@@ -150,7 +185,7 @@ bool CFindTemplate::FindTemplate(RefInfo *_ref)
     LogFile.WriteToDedicatedFile("/sdcard/alignment.txt", zw);
 #endif*/
 
-    RGBImageRelease();
+    RGBImageReleaseRead();
     stbi_image_free(rgb_template);
     
 //    ESP_LOGD(TAG, "FindTemplate 08");
@@ -19,31 +19,209 @@ using namespace std;
 
 static const char *TAG = "C IMG BASIS";
 
-bool jpgFileTooLarge = false;   // JPG creation verfication
+//#define DEBUG_DETAIL_ON
 
 
-//#define DEBUG_DETAIL_ON
+void CImageBasis::InitLock()
+{
+    lockState = xSemaphoreCreateMutex();
+    lockReleased = xEventGroupCreate();
 
+    if ((lockState == NULL) || (lockReleased == NULL)) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "InitLock: Can't create image lock (" + name + ")");
+    }
+}
 
-uint8_t * CImageBasis::RGBImageLock(int _waitmaxsec)
+
+CImageBasis* CImageBasis::LockTarget()
 {
-    if (islocked)
-    {
-        #ifdef DEBUG_DETAIL_ON   
-                ESP_LOGD(TAG, "Image is locked: sleep for: %ds", _waitmaxsec);
-        #endif
-        TickType_t xDelay;
-        xDelay = 1000 / portTICK_PERIOD_MS;
-        for (int i = 0; i <= _waitmaxsec; ++i)
-        {
-            vTaskDelay( xDelay ); 
-            if (!islocked)
+    CImageBasis *target = this;
+
+    while (target->lockOwner != NULL) {
+        target = target->lockOwner;
+    }
+
+    return target;
+}
+
+
+CImageBasis::LockReader* CImageBasis::FindReader(TaskHandle_t _task)
+{
+    for (int i = 0; i < LOCK_MAX_READERS; ++i) {
+        if (readers[i].task == _task) {
+            return &readers[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/* Called with lockState taken, returns with lockState taken (also after a timeout).
+ * Every waiting task owns one bit of lockReleased, which it clears before it gives lockState.
+ * A release sets the bits of all waiting tasks, so a wakeup can not get lost. */
+bool CImageBasis::WaitForRelease(TickType_t _deadline)
+{
+    TickType_t remaining = _deadline - xTaskGetTickCount();
+
+    if ((remaining == 0) || (remaining > portMAX_DELAY / 2)) {     // Deadline reached
+        return false;
+    }
+
+    EventBits_t bit = 0;
+    for (int i = 0; i < LOCK_MAX_WAITERS; ++i) {
+        if ((waiterBits & (1 << i)) == 0) {
+            bit = 1 << i;
+            break;
+        }
+    }
+
+    if (bit == 0) {     // All bits in use -> check again with the next tick
+        xSemaphoreGive(lockState);
+        vTaskDelay(1);
+        xSemaphoreTake(lockState, portMAX_DELAY);
+        return true;
+    }
+
+    waiterBits |= bit;
+    xEventGroupClearBits(lockReleased, bit);
+    xSemaphoreGive(lockState);
+
+    xEventGroupWaitBits(lockReleased, bit, pdTRUE, pdFALSE, remaining);
+
+    xSemaphoreTake(lockState, portMAX_DELAY);
+    waiterBits &= ~bit;
+    return true;
+}
+
+
+void CImageBasis::WakeWaiters()
+{
+    if (waiterBits != 0) {
+        xEventGroupSetBits(lockReleased, waiterBits);
+    }
+}
+
+
+bool CImageBasis::AcquireWrite(int _waitmaxsec)
+{
+    CImageBasis *target = LockTarget();
+
+    if ((target->lockState == NULL) || (target->lockReleased == NULL)) {
+        return false;
+    }
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    TickType_t deadline = xTaskGetTickCount() + (_waitmaxsec * 1000) / portTICK_PERIOD_MS;
+    bool locked = false;
+    bool waiting = false;
+
+    xSemaphoreTake(target->lockState, portMAX_DELAY);
+
+    if (target->writerTask == self) {   // Nested lock of the owning task
+        target->writerDepth++;
+        xSemaphoreGive(target->lockState);
+        return true;
+    }
+
+    if (target->FindReader(self) != NULL) {     // Would wait for itself
+        xSemaphoreGive(target->lockState);
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "RGBImageLock: Task holds a read lock, can't lock for writing (" + target->name + ")");
+        return false;
+    }
+
+    while (true) {
+        if ((target->writerTask == NULL) && (target->readerCount == 0)) {
+            target->writerTask = self;
+            target->writerDepth = 1;
+            locked = true;
+            break;
+        }
+
+        if (!waiting) {     // From now on new readers wait
+            target->writersWaiting++;
+            waiting = true;
+        }
+
+        if (!target->WaitForRelease(deadline)) {
+            break;
+        }
+    }
+
+    if (waiting) {
+        target->writersWaiting--;
+        if (!locked) {      // Readers might wait for this writer
+            target->WakeWaiters();
+        }
+    }
+
+    xSemaphoreGive(target->lockState);
+
+    if (!locked) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "RGBImageLock: Timeout after " + std::to_string(_waitmaxsec) + "s (" + target->name + ")");
+    }
+    return locked;
+}
+
+
+bool CImageBasis::AcquireRead(int _waitmaxsec)
+{
+    CImageBasis *target = LockTarget();
+
+    if ((target->lockState == NULL) || (target->lockReleased == NULL)) {
+        return false;
+    }
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    TickType_t deadline = xTaskGetTickCount() + (_waitmaxsec * 1000) / portTICK_PERIOD_MS;
+    bool locked = false;
+
+    xSemaphoreTake(target->lockState, portMAX_DELAY);
+
+    while (true) {
+        if (target->writerTask == self) {   // The writer may read its own image
+            target->writerDepth++;
+            locked = true;
+            break;
+        }
+
+        LockReader *reader = target->FindReader(self);
+        if (reader != NULL) {   // Nested read, must not wait for a waiting writer
+            reader->depth++;
+            locked = true;
+            break;
+        }
+
+        if ((target->writerTask == NULL) && (target->writersWaiting == 0)) {
+            reader = target->FindReader(NULL);
+            if (reader != NULL) {
+                reader->task = self;
+                reader->depth = 1;
+                target->readerCount++;
+                locked = true;
                 break;
+            }
+        }
+
+        if (!target->WaitForRelease(deadline)) {
+            break;
         }
     }
 
-    if (islocked)
+    xSemaphoreGive(target->lockState);
+
+    if (!locked) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "RGBImageLockRead: Timeout after " + std::to_string(_waitmaxsec) + "s (" + target->name + ")");
+    }
+    return locked;
+}
+
+
+uint8_t * CImageBasis::RGBImageLock(int _waitmaxsec)
+{
+    if (!AcquireWrite(_waitmaxsec)) {
         return NULL;
+    }
 
     return rgb_image;
 }
@@ -51,118 +229,163 @@ uint8_t * CImageBasis::RGBImageLock(int _waitmaxsec)
 
 void CImageBasis::RGBImageRelease()
 {
-    islocked = false;
+    CImageBasis *target = LockTarget();
+
+    if (target->lockState == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(target->lockState, portMAX_DELAY);
+
+    if ((target->writerTask == xTaskGetCurrentTaskHandle()) && (--target->writerDepth == 0)) {
+        target->writerTask = NULL;
+        target->WakeWaiters();
+    }
+
+    xSemaphoreGive(target->lockState);
 }
 
 
-uint8_t * CImageBasis::RGBImageGet()
+uint8_t * CImageBasis::RGBImageLockRead(int _waitmaxsec)
 {
+    if (!AcquireRead(_waitmaxsec)) {
+        return NULL;
+    }
+
     return rgb_image;
 }
 
 
-void writejpghelp(void *context, void *data, int size)
+void CImageBasis::RGBImageReleaseRead()
 {
-//    ESP_LOGD(TAG, "Size all: %d, size %d", ((ImageData*)context)->size, size);
-    ImageData* _zw = (ImageData*) context;
-    uint8_t *voidstart = _zw->data;
-    uint8_t *datastart = (uint8_t*) data;
-    
-    if ((_zw->size < MAX_JPG_SIZE)) {   // Abort copy to prevent buffer overflow
-        voidstart += _zw->size;
+    CImageBasis *target = LockTarget();
+
+    if (target->lockState == NULL) {
+        return;
+    }
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
 
-        for (int i = 0; i < size; ++i)
-            *(voidstart + i) = *(datastart + i);
+    xSemaphoreTake(target->lockState, portMAX_DELAY);
 
-        _zw->size += size;
+    if (target->writerTask == self) {
+        if (--target->writerDepth == 0) {
+            target->writerTask = NULL;
+            target->WakeWaiters();
+        }
     }
     else {
-        jpgFileTooLarge = true;
+        LockReader *reader = target->FindReader(self);
+
+        if ((reader != NULL) && (--reader->depth == 0)) {
+            reader->task = NULL;
+            if (--target->readerCount == 0) {   // Last reader lets waiting writers in
+                target->WakeWaiters();
+            }
+        }
     }
+
+    xSemaphoreGive(target->lockState);
 }
 
 
-ImageData* CImageBasis::writeToMemoryAsJPG(const int quality)
+uint8_t * CImageBasis::RGBImageGet()
 {
-    ImageData* ii = new ImageData;
+    return rgb_image;
+}
 
-    RGBImageLock();
-    stbi_write_jpg_to_func(writejpghelp, ii, width, height, channels, rgb_image, quality);
-    RGBImageRelease();
 
-    if (jpgFileTooLarge) {
-        jpgFileTooLarge = false;
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "writeToMemoryAsJPG: Creation aborted! JPG size > preallocated buffer: " + std::to_string(MAX_JPG_SIZE));
+void CJpegChunkSink::write(const uint8_t *_data, size_t _len)
+{
+    while ((_len > 0) && !failed) {
+        if (used == HTTP_BUFFER_SENT) {     // Buffer full -> send it
+            failed = !sendChunk(buf, used);
+            used = 0;
+        }
+
+        size_t part = std::min(_len, HTTP_BUFFER_SENT - used);
+        memcpy(buf + used, _data, part);
+        used += part;
+        _data += part;
+        _len -= part;
     }
-    return ii;
 }
 
 
-void CImageBasis::writeToMemoryAsJPG(ImageData* i, const int quality)
+bool CJpegChunkSink::finish()
 {
-    ImageData* ii = new ImageData;
-    
-    RGBImageLock();
-    stbi_write_jpg_to_func(writejpghelp, ii, width, height, channels, rgb_image, quality);
-    RGBImageRelease();
-
-    if (jpgFileTooLarge) {
-        jpgFileTooLarge = false;
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "writeToMemoryAsJPG: Creation aborted! JPG size > preallocated buffer: " + std::to_string(MAX_JPG_SIZE));
+    if ((used > 0) && !failed) {             // Still send the rest
+        failed = !sendChunk(buf, used);
     }
-    memCopy((uint8_t*) ii, (uint8_t*) i, sizeof(ImageData));
-    delete ii;
+    used = 0;
+    return !failed;
 }
 
 
-struct SendJPGHTTP
+static void writejpgtosinkhelp(void *context, void *data, int size)
 {
-    httpd_req_t *req;
-    esp_err_t res;
-    char buf[HTTP_BUFFER_SENT];
-    int size = 0;
-};
+    ((CJpegSink*) context)->write((const uint8_t*) data, size);
+}
 
 
-inline void writejpgtohttphelp(void *context, void *data, int size)
+/**
+ * @brief Encodes the image as JPG and hands the output to the sink while encoding,
+ *        so the complete JPG is never in memory unless the sink keeps it.
+ *
+ * @return false if the image is locked or the sink lost data
+ */
+bool CImageBasis::writeToSinkAsJPG(CJpegSink *_sink, const int quality)
 {
-    SendJPGHTTP* _send = (SendJPGHTTP*) context;
-    if ((_send->size + size) >= HTTP_BUFFER_SENT)     // data no longer fits in buffer
-    {
-        if (httpd_resp_send_chunk(_send->req, _send->buf, _send->size) != ESP_OK) 
-        {
-                    ESP_LOGE(TAG, "File sending failed!");
-                    _send->res = ESP_FAIL;  
-        }
-        _send->size = 0;      
+    CImageReadLock lock(this);
+
+    if (!lock.locked()) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "writeToSinkAsJPG: Image is locked (" + name + ")");
+        return false;
     }
-    std::memcpy((void*) (&(_send->buf[0]) + _send->size), data, size);
-    _send->size+= size;
-} 
 
+    stbi_write_jpg_to_func(writejpgtosinkhelp, _sink, width, height, channels, rgb_image, quality);
+    return _sink->finish();
+}
 
-esp_err_t CImageBasis::SendJPGtoHTTP(httpd_req_t *_req, const int quality)
+
+CJpegData* CImageBasis::writeToMemoryAsJPG(const int quality)
 {
-    SendJPGHTTP ii;
-    ii.req = _req;
-    ii.res = ESP_OK;
-    ii.size = 0;
+    CJpegData* jpeg = new CJpegData;
+    writeToMemoryAsJPG(jpeg, quality);
+    return jpeg;
+}
 
-    RGBImageLock();
-    stbi_write_jpg_to_func(writejpgtohttphelp, &ii, width, height, channels, rgb_image, quality);
 
-    if (ii.size > 0)
-    {
-        if (httpd_resp_send_chunk(_req, (char*) ii.buf, ii.size) != ESP_OK)             //still send the rest
-        {
-            ESP_LOGE(TAG, "File sending failed!");
-            ii.res = ESP_FAIL;  
-        }
+/**
+ * @brief Encodes the image into new pages, the content of _jpeg gets replaced once the JPG is complete.
+ *        Until then, readers of _jpeg still get the previous JPG.
+ */
+bool CImageBasis::writeToMemoryAsJPG(CJpegData* _jpeg, const int quality)
+{
+    CJpegData encoded;
+    CJpegMemorySink sink(&encoded);
+
+    if (!writeToSinkAsJPG(&sink, quality)) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "writeToMemoryAsJPG: Creation aborted! Not enough memory for the JPG (" +
+                            std::to_string(encoded.getSize()) + " bytes so far)");
+        return false;
     }
 
-    RGBImageRelease();
+    _jpeg->take(&encoded);
+    return true;
+}
+
 
-    return ii.res;
+esp_err_t CImageBasis::SendJPGtoHTTP(httpd_req_t *_req, const int quality)
+{
+    CJpegHttpdSink sink(_req);
+
+    if (!writeToSinkAsJPG(&sink, quality)) {
+        ESP_LOGE(TAG, "File sending failed!");
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
 }  
 
 
@@ -218,7 +441,7 @@ void CImageBasis::setPixelColor(int x, int y, int r, int g, int b)
 {
     stbi_uc* p_source;
 
-    RGBImageLock();
+    // No locking per pixel: callers (drawRect, drawLine, ...) hold the writer lock
     p_source = rgb_image + (channels * (y * width + x));
     p_source[0] = r;
     if ( channels > 2)
@@ -226,7 +449,6 @@ void CImageBasis::setPixelColor(int x, int y, int r, int g, int b)
         p_source[1] = g;
         p_source[2] = b;
     }
-    RGBImageRelease();
 }
 
 
@@ -369,7 +591,7 @@ CImageBasis::CImageBasis(string _name)
     width = 0;
     height = 0;
     channels = 0;    
-    islocked = false;
+    InitLock();
 }
 
 
@@ -500,15 +722,16 @@ void CImageBasis::crop_image(unsigned short cropLeft, unsigned short cropRight,
 CImageBasis::CImageBasis(string _name, CImageBasis *_copyfrom) 
 {
     name = _name;
-    islocked = false;
+    InitLock();
     externalImage = false;
+
+    CImageReadLock lock(_copyfrom);     // Source might be modified by the flow at the same time
+
     channels = _copyfrom->channels;
     width = _copyfrom->width;
     height = _copyfrom->height;
     bpp = _copyfrom->bpp;
 
-    RGBImageLock();
-
     #ifdef DEBUG_DETAIL_ON 
         LogFile.WriteHeapInfo("CImageBasis_copyfrom - Start");
     #endif
@@ -527,12 +750,10 @@ CImageBasis::CImageBasis(string _name, CImageBasis *_copyfrom)
     {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "CImageBasis-Copyfrom: Can't allocate enough memory: " + std::to_string(memsize));
         LogFile.WriteHeapInfo("CImageBasis-Copyfrom");
-        RGBImageRelease();
         return;
     }
 
     memCopy(_copyfrom->rgb_image, rgb_image, memsize);
-    RGBImageRelease();
 
     #ifdef DEBUG_DETAIL_ON 
         LogFile.WriteHeapInfo("CImageBasis_copyfrom - done");
@@ -543,15 +764,13 @@ CImageBasis::CImageBasis(string _name, CImageBasis *_copyfrom)
 CImageBasis::CImageBasis(string _name, int _width, int _height, int _channels)
 {
     name = _name;
-    islocked = false;
+    InitLock();
     externalImage = false;
     channels = _channels;
     width = _width;
     height = _height;
     bpp = _channels;
 
-    RGBImageLock();
-
      #ifdef DEBUG_DETAIL_ON 
         LogFile.WriteHeapInfo("CImageBasis_width,height,ch - Start");
     #endif
@@ -564,12 +783,9 @@ CImageBasis::CImageBasis(string _name, int _width, int _height, int _channels)
     {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "CImageBasis-width,height,ch: Can't allocate enough memory: " + std::to_string(memsize));
         LogFile.WriteHeapInfo("CImageBasis-width,height,ch");
-        RGBImageRelease();
         return;
     }
 
-    RGBImageRelease();
-
     #ifdef DEBUG_DETAIL_ON 
         LogFile.WriteHeapInfo("CImageBasis_width,height,ch - done");
     #endif
@@ -579,7 +795,7 @@ CImageBasis::CImageBasis(string _name, int _width, int _height, int _channels)
 CImageBasis::CImageBasis(string _name, std::string _image)
 {
     name = _name;
-    islocked = false;
+    InitLock();
     channels = 3;
     externalImage = false;
     filename = _image;
@@ -589,8 +805,6 @@ CImageBasis::CImageBasis(string _name, std::string _image)
         return;
     }
 
-    RGBImageLock();
-
     #ifdef DEBUG_DETAIL_ON 
         LogFile.WriteHeapInfo("CImageBasis_image - Start");
     #endif
@@ -600,11 +814,8 @@ CImageBasis::CImageBasis(string _name, std::string _image)
     if (rgb_image == NULL) {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "CImageBasis-image: Failed to load " + _image + "! Is it corrupted?");
         LogFile.WriteHeapInfo("CImageBasis-image");
-        RGBImageRelease();
         return;
     }
-    
-    RGBImageRelease();
 
     #ifdef DEBUG_DETAIL_ON 
         std::string zw = "CImageBasis after load " + _image;
@@ -626,7 +837,7 @@ bool CImageBasis::ImageOkay(){
 CImageBasis::CImageBasis(string _name, uint8_t* _rgb_image, int _channels, int _width, int _height, int _bpp)
 {
     name = _name;
-    islocked = false;
+    InitLock();
     rgb_image = _rgb_image;
     channels = _channels;
     width = _width;
@@ -674,8 +885,12 @@ void CImageBasis::Contrast(float _contrast)  //input range [-100..100]
 
 CImageBasis::~CImageBasis()
 {
-    RGBImageLock();
-
+    // Wait for pending readers (e.g. HTTP streaming) to finish
+    if ((LockTarget()->lockState != NULL) && !AcquireWrite(60)) {
+        // A reader still uses the buffer and the lock -> better leak them than free them under its feet
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "~CImageBasis: Image still in use, leaking " + to_string(memsize) + " bytes (" + name + ")");
+        return;
+    }
 
     if (!externalImage) {
         if (name == "tmpImage") { // This image should be placed in the shared part of PSRAM
@@ -693,6 +908,13 @@ CImageBasis::~CImageBasis()
     }
 
     RGBImageRelease();
+
+    if (lockState) {
+        vSemaphoreDelete(lockState);
+    }
+    if (lockReleased) {
+        vEventGroupDelete(lockReleased);
+    }
 }
 
 
@@ -700,7 +922,7 @@ void CImageBasis::SaveToFile(std::string _imageout)
 {
     string typ = getFileType(_imageout);
 
-    RGBImageLock();
+    RGBImageLockRead();
 
     if ((typ == "jpg") || (typ == "JPG"))       // CAUTION PROBLEMATIC IN ESP32
     {
@@ -713,7 +935,7 @@ void CImageBasis::SaveToFile(std::string _imageout)
         stbi_write_bmp(_imageout.c_str(), width, height, channels, rgb_image);
     }
 #endif
-    RGBImageRelease();
+    RGBImageReleaseRead();
 }
 
 
@@ -745,11 +967,12 @@ void CImageBasis::Resize(int _new_dx, int _new_dy, CImageBasis *_target)
         return;
     }
 
-    RGBImageLock();
+    RGBImageLockRead();
+    uint8_t* odata = _target->RGBImageLock();
 
-    uint8_t* odata = _target->rgb_image;
     stbir_resize_uint8(rgb_image, width, height, 0, odata, _new_dx, _new_dy, 0, channels);
 
-    RGBImageRelease();
+    _target->RGBImageRelease();
+    RGBImageReleaseRead();
 }
 
@@ -5,9 +5,11 @@
 
 #include <stdint.h>
 #include <string>
+#include <functional>
 #include <esp_http_server.h>
 
 #include "../../include/defines.h"
+#include "CJpegData.h"
 
 #include <math.h>
 
@@ -17,10 +19,87 @@
 
 #include "esp_heap_caps.h"
 
-struct ImageData
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+
+/**
+ * @brief Receives the output of the JPEG encoder while it encodes, see CImageBasis::writeToSinkAsJPG()
+ */
+class CJpegSink
+{
+    protected:
+        bool failed = false;    // Once set, the rest of the data gets ignored (the encoder can not be aborted)
+
+    public:
+        virtual ~CJpegSink() {};
+        virtual void write(const uint8_t *_data, size_t _len) = 0;
+        virtual bool finish() {return !failed;};       // After the last write, false if data got lost
+};
+
+
+/**
+ * @brief Appends the JPG to a CJpegData, fails if no more page could be allocated
+ */
+class CJpegMemorySink : public CJpegSink
+{
+    private:
+        CJpegData *jpeg;
+
+    public:
+        explicit CJpegMemorySink(CJpegData *_jpeg) : jpeg(_jpeg) {};
+        void write(const uint8_t *_data, size_t _len) override {failed = failed || !jpeg->append(_data, _len);};
+};
+
+
+/**
+ * @brief Collects the JPG in chunks of HTTP_BUFFER_SENT bytes, each full chunk is handed to sendChunk()
+ */
+class CJpegChunkSink : public CJpegSink
+{
+    private:
+        char buf[HTTP_BUFFER_SENT];
+        size_t used = 0;
+
+    protected:
+        virtual bool sendChunk(const char *_data, size_t _len) = 0;
+
+    public:
+        void write(const uint8_t *_data, size_t _len) override;
+        bool finish() override;
+};
+
+
+/**
+ * @brief Sends the JPG as chunked response of the web server
+ */
+class CJpegHttpdSink : public CJpegChunkSink
+{
+    private:
+        httpd_req_t *req;
+
+    protected:
+        bool sendChunk(const char *_data, size_t _len) override {return httpd_resp_send_chunk(req, _data, _len) == ESP_OK;};
+
+    public:
+        explicit CJpegHttpdSink(httpd_req_t *_req) : req(_req) {};
+};
+
+
+/**
+ * @brief Hands the JPG chunk by chunk to a callback, e.g. the body of an HTTP client request
+ */
+class CJpegCallbackSink : public CJpegChunkSink
 {
-    uint8_t data[MAX_JPG_SIZE];
-    size_t size = 0;
+    private:
+        std::function<bool(const char *_data, size_t _len)> callback;
+
+    protected:
+        bool sendChunk(const char *_data, size_t _len) override {return callback(_data, _len);};
+
+    public:
+        explicit CJpegCallbackSink(std::function<bool(const char *_data, size_t _len)> _callback) : callback(_callback) {};
 };
 
 
@@ -36,15 +115,48 @@ class CImageBasis
         void memCopy(uint8_t* _source, uint8_t* _target, int _size);
         bool isInImage(int x, int y);
 
-        bool islocked;
+        // Reader/writer lock of rgb_image. Images which only wrap the buffer of another
+        // image (externalImage) forward all locking to that image via lockOwner.
+        // Writers are preferred: once a writer waits, only tasks which already read get in again,
+        // so the flow is not starved by back-to-back HTTP readers. Both locks are recursive per task.
+        static const int LOCK_MAX_READERS = 8;     // Tasks reading at the same time (httpd, flow, parallel_for workers)
+        static const int LOCK_MAX_WAITERS = 24;    // Usable bits of an event group
+
+        struct LockReader {
+            TaskHandle_t task;
+            int depth;
+        };
+
+        CImageBasis *lockOwner = NULL;
+        SemaphoreHandle_t lockState = NULL;         // Protects all fields below
+        EventGroupHandle_t lockReleased = NULL;     // One bit per waiting task, set by a release
+        EventBits_t waiterBits = 0;                 // Bits of lockReleased in use by waiting tasks
+        TaskHandle_t writerTask = NULL;
+        int writerDepth = 0;
+        int writersWaiting = 0;
+        int readerCount = 0;
+        LockReader readers[LOCK_MAX_READERS] = {};
+
+        void InitLock();
+        CImageBasis* LockTarget();
+        bool AcquireWrite(int _waitmaxsec);
+        bool AcquireRead(int _waitmaxsec);
+        LockReader* FindReader(TaskHandle_t _task);
+        bool WaitForRelease(TickType_t _deadline);
+        void WakeWaiters();
+
+        friend class CImageWriteLock;
+        friend class CImageReadLock;
 
     public:
         uint8_t* rgb_image = NULL;
         int channels;
         int width, height, bpp; 
 
-        uint8_t * RGBImageLock(int _waitmaxsec = 60);
+        uint8_t * RGBImageLock(int _waitmaxsec = 60);         // Exclusive (writer) access, recursive for the owning task
         void RGBImageRelease();
+        uint8_t * RGBImageLockRead(int _waitmaxsec = 60);     // Shared (reader) access, e.g. for HTTP JPEG streaming
+        void RGBImageReleaseRead();
         uint8_t * RGBImageGet();
 
         int getWidth(){return this->width;};   
@@ -79,8 +191,9 @@ class CImageBasis
 
         void LoadFromMemory(stbi_uc *_buffer, int len);
 
-        ImageData* writeToMemoryAsJPG(const int quality = 90);
-        void writeToMemoryAsJPG(ImageData* ii, const int quality = 90);
+        bool writeToSinkAsJPG(CJpegSink *_sink, const int quality = 90);
+        CJpegData* writeToMemoryAsJPG(const int quality = 90);
+        bool writeToMemoryAsJPG(CJpegData* _jpeg, const int quality = 90);
 
         esp_err_t SendJPGtoHTTP(httpd_req_t *req, const int quality = 90);   
 
@@ -92,5 +205,43 @@ class CImageBasis
 };
 
 
+/**
+ * @brief Scoped writer lock of a CImageBasis (see RGBImageLock)
+ */
+class CImageWriteLock
+{
+    private:
+        CImageBasis *image;
+        bool isLocked;
+
+    public:
+        explicit CImageWriteLock(CImageBasis *_image, int _waitmaxsec = 60) : image(_image) {isLocked = image->AcquireWrite(_waitmaxsec);};
+        ~CImageWriteLock() {if (isLocked) image->RGBImageRelease();};
+        bool locked() {return isLocked;};
+
+        CImageWriteLock(const CImageWriteLock&) = delete;
+        CImageWriteLock& operator=(const CImageWriteLock&) = delete;
+};
+
+
+/**
+ * @brief Scoped reader lock of a CImageBasis (see RGBImageLockRead)
+ */
+class CImageReadLock
+{
+    private:
+        CImageBasis *image;
+        bool isLocked;
+
+    public:
+        explicit CImageReadLock(CImageBasis *_image, int _waitmaxsec = 60) : image(_image) {isLocked = image->AcquireRead(_waitmaxsec);};
+        ~CImageReadLock() {if (isLocked) image->RGBImageReleaseRead();};
+        bool locked() {return isLocked;};
+
+        CImageReadLock(const CImageReadLock&) = delete;
+        CImageReadLock& operator=(const CImageReadLock&) = delete;
+};
+
+
 #endif //CIMAGEBASIS_H
 
@@ -0,0 +1,190 @@
+#include "CJpegData.h"
+
+#include <string.h>
+#include <algorithm>
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#include "psram.h"
+#else
+#include <stdlib.h>
+#endif
+
+
+/*******************************************************************
+ * Page pool
+ *******************************************************************/
+static std::mutex pagePoolLock;
+static std::vector<uint8_t*> freePages;
+
+
+static uint8_t *jpegPageAlloc()
+{
+    {
+        std::lock_guard<std::mutex> lock(pagePoolLock);
+        if (!freePages.empty()) {
+            uint8_t *page = freePages.back();
+            freePages.pop_back();
+            return page;
+        }
+    }
+
+#ifdef ESP_PLATFORM
+    return (uint8_t*) malloc_psram_heap("JpegPage", JPEG_PAGE_SIZE, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+#else
+    return (uint8_t*) malloc(JPEG_PAGE_SIZE);
+#endif
+}
+
+
+static void jpegPageFree(uint8_t *_page)
+{
+    {
+        std::lock_guard<std::mutex> lock(pagePoolLock);
+        if (freePages.size() < JPEG_PAGE_POOL_MAX) {
+            freePages.push_back(_page);
+            return;
+        }
+    }
+
+#ifdef ESP_PLATFORM
+    free_psram_heap("JpegPage", _page);
+#else
+    free(_page);
+#endif
+}
+
+
+int jpegPagePoolSize()
+{
+    std::lock_guard<std::mutex> lock(pagePoolLock);
+    return freePages.size();
+}
+
+
+void jpegPagePoolTrim(int _keep)
+{
+    std::vector<uint8_t*> trimmed;
+
+    {
+        std::lock_guard<std::mutex> lock(pagePoolLock);
+        while ((int)freePages.size() > std::max(_keep, 0)) {
+            trimmed.push_back(freePages.back());
+            freePages.pop_back();
+        }
+    }
+
+    for (auto page : trimmed) {
+#ifdef ESP_PLATFORM
+        free_psram_heap("JpegPage", page);
+#else
+        free(page);
+#endif
+    }
+}
+
+
+/*******************************************************************
+ * CJpegData
+ *******************************************************************/
+CJpegData::~CJpegData()
+{
+    clear();
+}
+
+
+bool CJpegData::append(const uint8_t *_data, size_t _len)
+{
+    std::lock_guard<std::mutex> lock(dataLock);
+
+    while (_len > 0) {
+        if (size == pages.size() * JPEG_PAGE_SIZE) {    // Last page full (or none yet)
+            uint8_t *page = jpegPageAlloc();
+            if (page == NULL) {
+                return false;
+            }
+            pages.push_back(std::shared_ptr<uint8_t>(page, jpegPageFree));
+        }
+
+        // A reader of the last page only reads the part which was there when it took its snapshot
+        size_t used = size % JPEG_PAGE_SIZE;
+        size_t part = std::min(_len, (size_t)JPEG_PAGE_SIZE - used);
+        memcpy(pages.back().get() + used, _data, part);
+        size += part;
+        _data += part;
+        _len -= part;
+    }
+
+    return true;
+}
+
+
+void CJpegData::take(CJpegData *_from)
+{
+    std::vector<std::shared_ptr<uint8_t>> oldPages;
+    int pageCount;
+
+    {
+        std::scoped_lock lock(dataLock, _from->dataLock);
+        oldPages.swap(pages);
+        pages.swap(_from->pages);
+        size = _from->size;
+        _from->size = 0;
+        pageCount = pages.size();
+    }
+
+    // The old pages go back to the pool (or later, if a reader still sends them). The pool only
+    // keeps what the next JPG of this size needs, so a single large JPG does not hold the PSRAM.
+    oldPages.clear();
+    jpegPagePoolTrim(pageCount + 1);
+}
+
+
+void CJpegData::clear()
+{
+    std::vector<std::shared_ptr<uint8_t>> oldPages;
+
+    {
+        std::lock_guard<std::mutex> lock(dataLock);
+        oldPages.swap(pages);
+        size = 0;
+    }
+}
+
+
+size_t CJpegData::getSize()
+{
+    std::lock_guard<std::mutex> lock(dataLock);
+    return size;
+}
+
+
+bool CJpegData::forEachChunk(std::function<bool(const char *_data, size_t _len)> _chunk)
+{
+    std::vector<std::shared_ptr<uint8_t>> snapshot;
+    size_t rest;
+
+    {
+        std::lock_guard<std::mutex> lock(dataLock);
+        snapshot = pages;
+        rest = size;
+    }
+
+    for (auto &page : snapshot) {
+        size_t len = std::min(rest, (size_t)JPEG_PAGE_SIZE);
+        if (!_chunk((const char*) page.get(), len)) {
+            return false;
+        }
+        rest -= len;
+    }
+
+    return true;
+}
+
+
+bool CJpegData::writeToFile(FILE *_file)
+{
+    return forEachChunk([_file](const char *_data, size_t _len) {
+        return fwrite(_data, 1, _len, _file) == _len;
+    });
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#ifndef CJPEGDATA_H
+#define CJPEGDATA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+
+#include "../../include/defines.h"
+
+
+/**
+ * @brief An encoded JPG, stored as a chain of JPEG_PAGE_SIZE pages.
+ *
+ * The pages come from a pool in the PSRAM, so the buffer grows with the JPG instead of reserving
+ * the maximum size, and the pages of the previous round get reused (no heap fragmentation).
+ * The content is handed to the HTTP server, the webhook or a file page by page without copying it.
+ * The pages are reference counted: a reader works on its own list of them, so a slow client
+ * neither blocks take() nor loses its pages, they go back to the pool once it is done.
+ */
+class CJpegData
+{
+    private:
+        std::mutex dataLock;                // Only held to change or copy the list of pages
+        std::vector<std::shared_ptr<uint8_t>> pages;
+        size_t size = 0;
+
+    public:
+        CJpegData() {};
+        ~CJpegData();
+
+        CJpegData(const CJpegData&) = delete;
+        CJpegData& operator=(const CJpegData&) = delete;
+
+        bool append(const uint8_t *_data, size_t _len);     // false if no page could be allocated
+        void take(CJpegData *_from);                        // Replaces the content, _from is empty afterwards
+        void clear();
+
+        size_t getSize();
+        // Calls _chunk for every page in order, stops if it returns false. Works on a snapshot of the
+        // pages, the content may get replaced meanwhile.
+        bool forEachChunk(std::function<bool(const char *_data, size_t _len)> _chunk);
+        bool writeToFile(FILE *_file);
+};
+
+
+// Pages which are kept in the pool for the next JPG (see JPEG_PAGE_POOL_MAX)
+int jpegPagePoolSize();
+// Frees the free pages above _keep, e.g. after the JPG got smaller
+void jpegPagePoolTrim(int _keep);
+
+#endif //CJPEGDATA_H
@@ -1,5 +1,6 @@
 #include <string>
 #include "CRotateImage.h"
+#include "parallel_for.h"
 #include "psram.h"
 
 static const char *TAG = "C ROTATE IMG";
@@ -14,7 +15,7 @@ CRotateImage::CRotateImage(std::string _name, CImageBasis *_org, CImageBasis *_t
     externalImage = true;   
     ImageTMP = _temp;   
     ImageOrg = _org; 
-    islocked = false;
+    lockOwner = _org;       // Shares the buffer of _org -> lock through _org
     doflip = _flip;
 }
 
@@ -73,35 +74,39 @@ void CRotateImage::Rotate(float _angle, int _centerx, int _centery)
     }
     
 
-    int x_source, y_source;
-    stbi_uc* p_target;
-    stbi_uc* p_source;
-
     RGBImageLock();
 
-    for (int x = 0; x < width; ++x)
-        for (int y = 0; y < height; ++y)
-        {
-            p_target = odata + (channels * (y * width + x));
+    // Each target pixel only depends on the source image -> split into horizontal bands over both cores
+    parallel_for(0, height, [&](int _ystart, int _yend)
+    {
+        int x_source, y_source;
+        stbi_uc* p_target;
+        stbi_uc* p_source;
 
-            x_source = int(m[0][0] * x + m[0][1] * y);
-            y_source = int(m[1][0] * x + m[1][1] * y);
+        for (int y = _ystart; y < _yend; ++y)
+            for (int x = 0; x < width; ++x)
+            {
+                p_target = odata + (channels * (y * width + x));
 
-            x_source += int(m[0][2]);
-            y_source += int(m[1][2]);
+                x_source = int(m[0][0] * x + m[0][1] * y);
+                y_source = int(m[1][0] * x + m[1][1] * y);
 
-            if ((x_source >= 0) && (x_source < org_width) && (y_source >= 0) && (y_source < org_height))
-            {
-                p_source = rgb_image + (channels * (y_source * org_width + x_source));
-                for (int _channels = 0; _channels < channels; ++_channels)
-                    p_target[_channels] = p_source[_channels];
-            }
-            else
-            {
-                for (int _channels = 0; _channels < channels; ++_channels)
-                    p_target[_channels] = 255;
+                x_source += int(m[0][2]);
+                y_source += int(m[1][2]);
+
+                if ((x_source >= 0) && (x_source < org_width) && (y_source >= 0) && (y_source < org_height))
+                {
+                    p_source = rgb_image + (channels * (y_source * org_width + x_source));
+                    for (int _channels = 0; _channels < channels; ++_channels)
+                        p_target[_channels] = p_source[_channels];
+                }
+                else
+                {
+                    for (int _channels = 0; _channels < channels; ++_channels)
+                        p_target[_channels] = 255;
+                }
             }
-        }
+    }, ROTATE_PARALLEL_MIN_ROWS);
 
     //    memcpy(rgb_image, odata, memsize);
     memCopy(odata, rgb_image, memsize);
@@ -173,56 +178,60 @@ void CRotateImage::RotateAntiAliasing(float _angle, int _centerx, int _centery)
     }
     
 
-    int x_source_1, y_source_1, x_source_2, y_source_2;
-    float x_source, y_source;
-    float quad_ul, quad_ur, quad_ol, quad_or;
-    stbi_uc* p_target;
-    stbi_uc *p_source_ul, *p_source_ur, *p_source_ol, *p_source_or;
-
     RGBImageLock();
 
-    for (int x = 0; x < width; ++x)
-        for (int y = 0; y < height; ++y)
-        {
-            p_target = odata + (channels * (y * width + x));
+    // Each target pixel only depends on the source image -> split into horizontal bands over both cores
+    parallel_for(0, height, [&](int _ystart, int _yend)
+    {
+        int x_source_1, y_source_1, x_source_2, y_source_2;
+        float x_source, y_source;
+        float quad_ul, quad_ur, quad_ol, quad_or;
+        stbi_uc* p_target;
+        stbi_uc *p_source_ul, *p_source_ur, *p_source_ol, *p_source_or;
+
+        for (int y = _ystart; y < _yend; ++y)
+            for (int x = 0; x < width; ++x)
+            {
+                p_target = odata + (channels * (y * width + x));
 
-            x_source = (m[0][0] * x + m[0][1] * y);
-            y_source = (m[1][0] * x + m[1][1] * y);
+                x_source = (m[0][0] * x + m[0][1] * y);
+                y_source = (m[1][0] * x + m[1][1] * y);
 
-            x_source += (m[0][2]);
-            y_source += (m[1][2]);
+                x_source += (m[0][2]);
+                y_source += (m[1][2]);
 
-            x_source_1 = (int)x_source;
-            x_source_2 = x_source_1 + 1;
-            y_source_1 = (int)y_source;
-            y_source_2 = y_source_1 + 1;
+                x_source_1 = (int)x_source;
+                x_source_2 = x_source_1 + 1;
+                y_source_1 = (int)y_source;
+                y_source_2 = y_source_1 + 1;
 
-            quad_ul = (x_source_2 - x_source) * (y_source_2 - y_source);
-            quad_ur = (1- (x_source_2 - x_source)) * (y_source_2 - y_source);
-            quad_or = (x_source_2 - x_source) * (1-(y_source_2 - y_source));
-            quad_ol = (1- (x_source_2 - x_source)) * (1-(y_source_2 - y_source));
+                quad_ul = (x_source_2 - x_source) * (y_source_2 - y_source);
+                quad_ur = (1- (x_source_2 - x_source)) * (y_source_2 - y_source);
+                quad_or = (x_source_2 - x_source) * (1-(y_source_2 - y_source));
+                quad_ol = (1- (x_source_2 - x_source)) * (1-(y_source_2 - y_source));
 
 
-            if ((x_source_1 >= 0) && (x_source_2 < org_width) && (y_source_1 >= 0) && (y_source_2 < org_height))
-            {
-                p_source_ul = rgb_image + (channels * (y_source_1 * org_width + x_source_1));
-                p_source_ur = rgb_image + (channels * (y_source_1 * org_width + x_source_2));
-                p_source_or = rgb_image + (channels * (y_source_2 * org_width + x_source_1));
-                p_source_ol = rgb_image + (channels * (y_source_2 * org_width + x_source_2));
-                for (int _channels = 0; _channels < channels; ++_channels)
+                if ((x_source_1 >= 0) && (x_source_2 < org_width) && (y_source_1 >= 0) && (y_source_2 < org_height))
                 {
-                    p_target[_channels] = (int)((float)p_source_ul[_channels] * quad_ul
-                                                + (float)p_source_ur[_channels] * quad_ur
-                                                + (float)p_source_or[_channels] * quad_or
-                                                + (float)p_source_ol[_channels] * quad_ol);
+                    p_source_ul = rgb_image + (channels * (y_source_1 * org_width + x_source_1));
+                    p_source_ur = rgb_image + (channels * (y_source_1 * org_width + x_source_2));
+                    p_source_or = rgb_image + (channels * (y_source_2 * org_width + x_source_1));
+                    p_source_ol = rgb_image + (channels * (y_source_2 * org_width + x_source_2));
+                    for (int _channels = 0; _channels < channels; ++_channels)
+                    {
+                        p_target[_channels] = (int)((float)p_source_ul[_channels] * quad_ul
+                                                    + (float)p_source_ur[_channels] * quad_ur
+                                                    + (float)p_source_or[_channels] * quad_or
+                                                    + (float)p_source_ol[_channels] * quad_ol);
+                    }
+                }
+                else
+                {
+                    for (int _channels = 0; _channels < channels; ++_channels)
+                        p_target[_channels] = 255;
                 }
             }
-            else
-            {
-                for (int _channels = 0; _channels < channels; ++_channels)
-                    p_target[_channels] = 255;
-            }
-        }
+    }, ROTATE_PARALLEL_MIN_ROWS);
 
     //    memcpy(rgb_image, odata, memsize);
     memCopy(odata, rgb_image, memsize);
@@ -265,32 +274,35 @@ void CRotateImage::Translate(int _dx, int _dy)
 
 
 
-    int x_source, y_source;
-    stbi_uc* p_target;
-    stbi_uc* p_source;
-
     RGBImageLock();
 
-    for (int x = 0; x < width; ++x)
-        for (int y = 0; y < height; ++y)
-        {
-            p_target = odata + (channels * (y * width + x));
-
-            x_source = x - _dx;
-            y_source = y - _dy;
+    parallel_for(0, height, [&](int _ystart, int _yend)
+    {
+        int x_source, y_source;
+        stbi_uc* p_target;
+        stbi_uc* p_source;
 
-            if ((x_source >= 0) && (x_source < width) && (y_source >= 0) && (y_source < height))
+        for (int y = _ystart; y < _yend; ++y)
+            for (int x = 0; x < width; ++x)
             {
-                p_source = rgb_image + (channels * (y_source * width + x_source));
-                for (int _channels = 0; _channels < channels; ++_channels)
-                    p_target[_channels] = p_source[_channels];
-            }
-            else
-            {
-                for (int _channels = 0; _channels < channels; ++_channels)
-                    p_target[_channels] = 255;
+                p_target = odata + (channels * (y * width + x));
+
+                x_source = x - _dx;
+                y_source = y - _dy;
+
+                if ((x_source >= 0) && (x_source < width) && (y_source >= 0) && (y_source < height))
+                {
+                    p_source = rgb_image + (channels * (y_source * width + x_source));
+                    for (int _channels = 0; _channels < channels; ++_channels)
+                        p_target[_channels] = p_source[_channels];
+                }
+                else
+                {
+                    for (int _channels = 0; _channels < channels; ++_channels)
+                        p_target[_channels] = 255;
+                }
             }
-        }
+    }, ROTATE_PARALLEL_MIN_ROWS);
 
     //    memcpy(rgb_image, odata, memsize);
     memCopy(odata, rgb_image, memsize);
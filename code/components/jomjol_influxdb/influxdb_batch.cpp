@@ -0,0 +1,128 @@
+#include "influxdb_batch.h"
+
+#include <stdio.h>
+
+#ifdef ESP_PLATFORM
+    #include "ClassLogFile.h"
+
+    static const char *TAG = "INFLUXDB";
+#endif
+
+
+InfluxDBBatch::InfluxDBBatch(size_t _maxBatchSize, size_t _maxBufferSize)
+{
+    maxBatchSize = _maxBatchSize;
+    maxBufferSize = _maxBufferSize;
+}
+
+
+void InfluxDBBatch::addPoint(const std::string &_measurement, const std::string &_key, const std::string &_content, long int _timeUTC)
+{
+    std::string line = _measurement + " " + _key + "=" + _content;
+
+    if (_timeUTC > 0) {
+        char nowTimestamp[32];
+        snprintf(nowTimestamp, sizeof(nowTimestamp), " %ld000000000", _timeUTC);       // UTC
+        line += nowTimestamp;
+    }
+    line += "\n";
+
+    std::lock_guard<std::mutex> lock(bufferLock);
+    pending += line;
+    limitBuffer(pending);
+}
+
+
+/* Drops the oldest lines until the buffer fits into maxBufferSize */
+void InfluxDBBatch::limitBuffer(std::string &_buffer)
+{
+    size_t start = 0;
+
+    while (_buffer.size() - start > maxBufferSize) {
+        size_t lineEnd = _buffer.find('\n', start);
+        start = (lineEnd == std::string::npos) ? _buffer.size() : lineEnd + 1;
+        droppedLines++;
+    }
+
+    if (start > 0) {
+        _buffer.erase(0, start);
+#ifdef ESP_PLATFORM
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Buffer full, dropped oldest points (" + std::to_string(droppedLines) + " in total)");
+#endif
+    }
+}
+
+
+int InfluxDBBatch::flush(const Sender &_send)
+{
+    std::string work;
+
+    {
+        // Points added while sending go into the next flush
+        std::lock_guard<std::mutex> lock(bufferLock);
+        work.swap(retry);
+        work += pending;
+        pending.clear();
+    }
+
+    int accepted = 0;
+    size_t start = 0;
+
+    while (start < work.size()) {
+        // Take as many complete lines as fit, but at least one
+        size_t end = work.size();
+        if (end - start > maxBatchSize) {
+            end = work.rfind('\n', start + maxBatchSize - 1);
+            end = ((end == std::string::npos) || (end < start)) ? work.find('\n', start) : end;
+            end = (end == std::string::npos) ? work.size() : end + 1;
+        }
+
+        InfluxDBSendResult result = _send(work.substr(start, end - start));
+
+        if (result == INFLUXDB_SEND_RETRY) {
+            std::lock_guard<std::mutex> lock(bufferLock);
+            retry = work.substr(start);
+            limitBuffer(retry);
+            break;
+        }
+
+        if (result == INFLUXDB_SEND_OK) {
+            accepted++;
+        }
+        start = end;
+    }
+
+    return accepted;
+}
+
+
+std::string InfluxDBBatch::takeRetry(void)
+{
+    std::string lines;
+
+    std::lock_guard<std::mutex> lock(bufferLock);
+    lines.swap(retry);
+    return lines;
+}
+
+
+void InfluxDBBatch::restoreRetry(const std::string &_lines)
+{
+    std::lock_guard<std::mutex> lock(bufferLock);
+    retry.insert(0, _lines);
+    limitBuffer(retry);
+}
+
+
+size_t InfluxDBBatch::getPendingSize(void)
+{
+    std::lock_guard<std::mutex> lock(bufferLock);
+    return pending.size();
+}
+
+
+size_t InfluxDBBatch::getRetrySize(void)
+{
+    std::lock_guard<std::mutex> lock(bufferLock);
+    return retry.size();
+}
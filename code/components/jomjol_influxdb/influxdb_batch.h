@@ -0,0 +1,49 @@
+#pragma once
+
+#ifndef INFLUXDB_BATCH_H
+#define INFLUXDB_BATCH_H
+
+#include <string>
+#include <mutex>
+#include <functional>
+
+/* Result of sending one batch to the server */
+enum InfluxDBSendResult {
+    INFLUXDB_SEND_OK,           // Accepted by the server
+    INFLUXDB_SEND_RETRY,        // Not sent or server error -> keep the lines and send them with the next flush
+    INFLUXDB_SEND_DROP          // Rejected by the server (e.g. malformed line or wrong credentials) -> sending again will not help
+};
+
+/* Collects line protocol points and sends them with as few requests as possible.
+ * Points can be added from any task (e.g. sensors), flush() is called from one task only.
+ * A flush sends the retry buffer and all pending points, split into bodies of at most
+ * maxBatchSize bytes at line boundaries. If a body can not be sent, it and all following
+ * lines are kept in the retry buffer. Pending points and retry buffer are each limited to
+ * maxBufferSize bytes, the oldest lines get dropped first. */
+class InfluxDBBatch {
+public:
+    typedef std::function<InfluxDBSendResult(const std::string &_body)> Sender;
+
+    InfluxDBBatch(size_t _maxBatchSize, size_t _maxBufferSize);
+
+    void addPoint(const std::string &_measurement, const std::string &_key, const std::string &_content, long int _timeUTC);
+    int flush(const Sender &_send);             // Returns the number of bodies accepted by the server
+    std::string takeRetry(void);                // Removes and returns the lines kept for retry
+    void restoreRetry(const std::string &_lines);   // Puts lines taken by takeRetry() back in front
+
+    size_t getPendingSize(void);
+    size_t getRetrySize(void);
+    int getDroppedLines(void) { return droppedLines; };
+
+private:
+    std::mutex bufferLock;
+    std::string pending;
+    std::string retry;
+    size_t maxBatchSize;
+    size_t maxBufferSize;
+    int droppedLines = 0;
+
+    void limitBuffer(std::string &_buffer);
+};
+
+#endif //INFLUXDB_BATCH_H
@@ -3,81 +3,78 @@
 
 #include "esp_log.h"
 #include <time.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "ClassLogFile.h"
-#include "esp_http_client.h"
 #include "time_sntp.h"
+#include "http_client_pool.h"
 #include "../../include/defines.h"
 
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
 static const char *TAG = "INFLUXDB";
 
 /**
- * @brief Global InfluxDB instance for sensor publishing.
- * 
- * This global instance is used by sensor components to publish data to InfluxDB.
+ * @brief All initialized InfluxDB instances, sensor values get added to each of them.
  */
-InfluxDB influxDB;
+static std::vector<InfluxDB*> influxDBInstances;
+static std::mutex influxDBInstancesLock;
+static std::atomic<uint32_t> sendFailed(0);
+static TaskHandle_t xHandleTaskSensorFlush = NULL;
+
 
 /**
- * @brief Buffer to store the HTTP response.
- * 
- * This character array is used to store the output of an HTTP response.
- * The size of the buffer is defined by the constant MAX_HTTP_OUTPUT_BUFFER.
+ * @brief Sends the sensor points, sensors are read by their own tasks and should not wait for the next round.
  */
-char response_buffer[MAX_HTTP_OUTPUT_BUFFER] = {0};
+static void task_influxdb_sensor_flush(void *pvParameter)
+{
+    while (true) {
+        vTaskDelay((INFLUXDB_SENSOR_FLUSH_INTERVAL_S * 1000) / portTICK_PERIOD_MS);
+        InfluxDB::InfluxDBFlushSensorPoints();
+    }
+}
 
 
-/**
- * @brief HTTP event handler callback function.
- *
- * This function handles various HTTP client events and logs appropriate messages.
- *
- * @param evt Pointer to the HTTP client event structure.
- * @return esp_err_t ESP_OK on success.
- *
- * Event types handled:
- * - HTTP_EVENT_ERROR: Logs an error message when an HTTP error is encountered.
- * - HTTP_EVENT_ON_CONNECTED: Logs a message when the HTTP client successfully connects.
- * - HTTP_EVENT_HEADERS_SENT: Logs a message when all request headers are sent.
- * - HTTP_EVENT_ON_HEADER: Logs the received header key and value.
- * - HTTP_EVENT_ON_DATA: Logs the length of the received data.
- * - HTTP_EVENT_ON_FINISH: Logs a message when the HTTP client finishes the request.
- * - HTTP_EVENT_DISCONNECTED: Logs a message when the HTTP client disconnects.
- * - HTTP_EVENT_REDIRECT: Logs a message when an HTTP redirect occurs.
- */
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
+static void startSensorFlushTask()
 {
-    switch(evt->event_id)
-    {
-        case HTTP_EVENT_ERROR:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client Error encountered");
-            break;
-        case HTTP_EVENT_ON_CONNECTED:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client connected");
-            ESP_LOGI(TAG, "HTTP Client Connected");
-            break;
-        case HTTP_EVENT_HEADERS_SENT:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client sent all request headers");
-            break;
-        case HTTP_EVENT_ON_HEADER:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Header: key=" + std::string(evt->header_key) + ", value="  + std::string(evt->header_value));
-            break;
-        case HTTP_EVENT_ON_DATA:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client data recevied: len=" + std::to_string(evt->data_len));
-            break;
-        case HTTP_EVENT_ON_FINISH:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client finished");
-            break;
-         case HTTP_EVENT_DISCONNECTED:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client Disconnected");
-            break;
-        case HTTP_EVENT_REDIRECT:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Redirect");
-            break;
+    if (xHandleTaskSensorFlush != NULL) {
+        return;
+    }
+
+    BaseType_t xReturned = xTaskCreatePinnedToCore(&task_influxdb_sensor_flush, "influxdb_flush", INFLUXDB_FLUSH_TASK_STACKSIZE,
+                                                   NULL, tskIDLE_PRIORITY+1, &xHandleTaskSensorFlush, tskNO_AFFINITY);
+    if (xReturned != pdPASS) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Creation of task_influxdb_sensor_flush failed, sensor points get sent with the next round");
+        xHandleTaskSensorFlush = NULL;
     }
-    return ESP_OK;
 }
 
 
+InfluxDB::InfluxDB() : batch(INFLUXDB_BATCH_MAX_SIZE, INFLUXDB_BUFFER_MAX_SIZE)
+{
+}
+
+
+InfluxDB::~InfluxDB()
+{
+    {
+        std::lock_guard<std::mutex> lock(influxDBInstancesLock);
+        influxDBInstances.erase(std::remove(influxDBInstances.begin(), influxDBInstances.end(), this), influxDBInstances.end());
+    }
+
+    // The sensor flush task might still be sending the batch of this instance
+    std::lock_guard<std::mutex> flush(flushLock);
+    InfluxDBdestroy();
+
+    if (spool) {
+        delete spool;
+    }
+}
+
 
 /**
  * @brief Initializes the InfluxDB connection with version 1 settings.
@@ -90,11 +87,27 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
  * @param _password The password for authentication.
  */
 void InfluxDB::InfluxDBInitV1(std::string _influxDBURI, std::string _database, std::string _user, std::string _password) {
+    // Not while the sensor flush task sends or a sensor adds a point
+    std::lock_guard<std::mutex> flush(flushLock);
+    std::lock_guard<std::mutex> lock(influxDBInstancesLock);
+
     version = INFLUXDB_V1;
     influxDBURI = _influxDBURI;
     database = _database;
     user = _user;
     password = _password;
+    apiURI = influxDBURI + "/write?db=" + database;
+
+    InfluxDBdestroy();      // Parameters might have changed, reconnect with the next flush
+
+    if (!spool) {
+        spool = new PublishSpool("influxdb");
+    }
+
+    if (std::find(influxDBInstances.begin(), influxDBInstances.end(), this) == influxDBInstances.end()) {
+        influxDBInstances.push_back(this);
+    }
+    startSensorFlushTask();
 }
 
 /**
@@ -109,153 +122,280 @@ void InfluxDB::InfluxDBInitV1(std::string _influxDBURI, std::string _database, s
  * @param _token The authentication token for accessing the InfluxDB server.
  */
 void InfluxDB::InfluxDBInitV2(std::string _influxDBURI, std::string _bucket, std::string _org, std::string _token) {
+    // Not while the sensor flush task sends or a sensor adds a point
+    std::lock_guard<std::mutex> flush(flushLock);
+    std::lock_guard<std::mutex> lock(influxDBInstancesLock);
+
     version = INFLUXDB_V2;
     influxDBURI = _influxDBURI;
     bucket = _bucket;
     org = _org;
     token = _token;
+    apiURI = influxDBURI + "/api/v2/write?org=" + org + "&bucket=" + bucket;
+    authorization = "Token " + token;
+
+    InfluxDBdestroy();      // Parameters might have changed, reconnect with the next flush
+
+    if (!spool) {
+        spool = new PublishSpool("influxdbv2");
+    }
+
+    if (std::find(influxDBInstances.begin(), influxDBInstances.end(), this) == influxDBInstances.end()) {
+        influxDBInstances.push_back(this);
+    }
+    startSensorFlushTask();
 }
 
 /**
- * @brief Establishes an HTTP connection to the InfluxDB server.
- *
- * This function configures and initializes an HTTP client to connect to the InfluxDB server.
- * It sets up the necessary parameters such as the URL, event handler, buffer size, and user data.
- * Depending on the InfluxDB version, it also configures the authentication type and credentials.
- *
- * @note This function destroys any existing HTTP client before initializing a new one.
+ * @brief Closes the kept connections of the HTTP client pool.
  *
- * @param None
- * @return None
+ * The next request opens a new connection, e.g. with the changed parameters of the server.
  */
-void InfluxDB::connectHTTP() {
-    esp_http_client_config_t config = {};
-
-    config.url = influxDBURI.c_str();
-    config.event_handler = http_event_handler;
-    config.buffer_size = MAX_HTTP_OUTPUT_BUFFER;
-    config.user_data = response_buffer;
+void InfluxDB::InfluxDBdestroy() {
+    getHttpClientPool().closeAll();
+}
 
 
+/**
+ * @brief Sends one line protocol body with a POST request on a connection of the HTTP client pool.
+ *
+ * @param _body One or more lines in line protocol, separated by '\n'.
+ * @return INFLUXDB_SEND_OK if the server accepted the body, INFLUXDB_SEND_RETRY if the server
+ *         could not be reached or had a temporary problem, INFLUXDB_SEND_DROP if it rejected the data.
+ */
+InfluxDBSendResult InfluxDB::sendBody(const std::string &_body) {
+    HttpPoolRequest request;
+    request.url = apiURI;
+    request.headers.push_back({"Content-Type", "text/plain"});
     switch (version) {
         case INFLUXDB_V1:
-            config.auth_type = HTTP_AUTH_TYPE_BASIC;
-            config.username = user.c_str();
-            config.password = password.c_str();
+            request.user = user;
+            request.password = password;
             break;
         case INFLUXDB_V2:
+            request.headers.push_back({"Authorization", authorization});
             break;
     }
+    request.body = _body.c_str();
+    request.bodyLen = _body.length();
 
-    InfluxDBdestroy();
-    httpClient = esp_http_client_init(&config);
-    if (!httpClient) {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to initialize HTTP client");
-    } else {
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "HTTP client initialized successfully");
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "sending " + std::to_string(_body.length()) + " bytes to influxdb:\n" + _body);
+
+    HttpPoolResult result = getHttpClientPool().perform(request);
+
+    if (result.err != ESP_OK) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to publish data: " + std::string(esp_err_to_name(result.err)));
+        sendFailed++;
+        return INFLUXDB_SEND_RETRY;
+    }
+
+    if (result.ok()) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Data published successfully (" + std::to_string(_body.length()) + " bytes)");
+        return INFLUXDB_SEND_OK;
     }
+
+    if ((result.status >= 500) || (result.status == 429)) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Server not ready (HTTP status " + std::to_string(result.status) + "), retrying with next round");
+        sendFailed++;
+        return INFLUXDB_SEND_RETRY;
+    }
+
+    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Data rejected by server (HTTP status " + std::to_string(result.status) + ", " +
+                        result.response + "): " + _body);
+    sendFailed++;
+    return INFLUXDB_SEND_DROP;
 }
 
 
-/**
- * @brief Destroys the InfluxDB instance by cleaning up the HTTP client.
- *
- * This function checks if the HTTP client is initialized. If it is, it cleans up the HTTP client
- * and logs the cleanup action. The HTTP client pointer is then set to NULL.
- */
-void InfluxDB::InfluxDBdestroy() {
-    if (httpClient) {
-        esp_http_client_cleanup(httpClient);
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "HTTP client cleaned up");
-        httpClient = NULL;
+uint32_t InfluxDBgetFailedCount() {
+    return sendFailed;
+}
+
+
+std::string InfluxDBFieldName(const std::string &_field, const std::string &_number, const std::string &_type) {
+    if (_field.length() > 0) {
+        return (_type == "value") ? _field : _field + "_" + _type;
+    }
+
+    if (_number == "default") {
+        return _type;
+    }
+
+    return _number + "/" + _type;
+}
+
+
+bool InfluxDBIsNumber(const std::string &_content) {
+    if (_content.empty()) {
+        return false;
     }
+
+    char *end = NULL;
+    strtod(_content.c_str(), &end);
+    return (*end == '\0');
 }
 
+
 /**
- * @brief Publishes data to an InfluxDB instance.
- *
- * This function sends a measurement, key, and content to an InfluxDB server.
- * It supports both InfluxDB v1 and v2 APIs.
+ * @brief Adds a data point to the batch of the current round.
  *
  * @param _measurement The measurement name to publish.
  * @param _key The key associated with the measurement.
  * @param _content The content or value to publish.
- * @param _timeUTC The timestamp in UTC. If greater than 0, it will be included in the payload.
- *
- * The function logs the process and handles HTTP communication with the InfluxDB server.
- * It constructs the appropriate API URI based on the InfluxDB version and sends the data
- * using an HTTP POST request.
+ * @param _timeUTC The timestamp in UTC. If greater than 0, it will be included in the line.
  */
-void InfluxDB::InfluxDBPublish(std::string _measurement, std::string _key, std::string _content, long int _timeUTC) {
+void InfluxDB::InfluxDBAddPoint(std::string _measurement, std::string _key, std::string _content, long int _timeUTC) {
     // Skip publishing if InfluxDB is not configured (URI is empty)
     if (influxDBURI.empty()) {
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "InfluxDB URI not configured, skipping publish");
         return;
     }
-    
-    std::string apiURI;        
-    std::string payload;
-    char nowTimestamp[21];
 
-    connectHTTP();
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "InfluxDBAddPoint - Key: " + _key + ", Content: " + _content + ", timeUTC: " + std::to_string(_timeUTC));
+    batch.addPoint(_measurement, _key, _content, _timeUTC);
+}
 
 
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "InfluxDBPublish - Key: " + _key + ", Content: " + _content + ", timeUTC: " + std::to_string(_timeUTC));
+/**
+ * @brief Sends all collected data points to the InfluxDB server.
+ *
+ * The points are sent as line protocol bodies of at most INFLUXDB_BATCH_MAX_SIZE bytes, normally
+ * this is a single POST request per round. Lines which could not be sent are moved to the spool
+ * on the SD card. Once the server is reachable again, the spooled lines get replayed after the
+ * live points, at most SPOOL_REPLAY_MAX_BYTES per round.
+ *
+ * @return true if nothing is left for a retry.
+ */
+bool InfluxDB::InfluxDBFlush() {
+    std::lock_guard<std::mutex> lock(flushLock);
+    return flushBatch();
+}
 
-    if (_timeUTC > 0)
-    {
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Timestamp (UTC): " + std::to_string(_timeUTC));
-        sprintf(nowTimestamp,"%ld000000000", _timeUTC);           // UTC
-        payload = _measurement + " " + _key + "=" + _content + " " + nowTimestamp;
+
+/**
+ * @brief Sends the batch and handles the retry and the spool, flushLock has to be held.
+ */
+bool InfluxDB::flushBatch() {
+    if (influxDBURI.empty()) {
+        return true;
     }
-    else
-    {
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "no timestamp given");
-        payload = _measurement + " " + _key + "=" + _content;
+
+    batch.flush([this](const std::string &_body) { return sendBody(_body); });
+
+    if (batch.getRetrySize() > 0) {
+        spoolRetry();
+        return false;
     }
 
-    payload.shrink_to_fit();
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "sending line to influxdb:" + payload);
+    replaySpool();
+    return true;
+}
 
-    esp_err_t err;
 
-    switch (version) {
-        case INFLUXDB_V1: 
-            apiURI = influxDBURI + "/write?db=" + database;
-            apiURI.shrink_to_fit();
-
-            esp_http_client_set_url(httpClient, apiURI.c_str());
-            esp_http_client_set_method(httpClient, HTTP_METHOD_POST);
-            esp_http_client_set_header(httpClient, "Content-Type", "text/plain");
-            esp_http_client_set_post_field(httpClient, payload.c_str(), payload.length());
-
-            err = esp_http_client_perform(httpClient);
-            if (err == ESP_OK) {
-                LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Data published successfully: " + payload);
-            } else {
-                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to publish data: " + std::string(esp_err_to_name(err)));
-            }
-            break;
+/**
+ * @brief Moves the lines which could not be sent from RAM to the spool, one record per line.
+ *        If the SD card is not writable, the remaining lines stay in RAM.
+ */
+void InfluxDB::spoolRetry() {
+    std::string lines = batch.takeRetry();
+    time_t now = time(NULL);
+    size_t start = 0;
+
+    while (start < lines.size()) {
+        size_t end = lines.find('\n', start);
+        end = (end == std::string::npos) ? lines.size() : end + 1;
 
-        case INFLUXDB_V2:        
-            apiURI = influxDBURI + "/api/v2/write?org=" + org + "&bucket=" + bucket;
-            apiURI.shrink_to_fit();
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "apiURI: " + apiURI);
-
-            esp_http_client_set_url(httpClient, apiURI.c_str());
-            esp_http_client_set_method(httpClient, HTTP_METHOD_POST);
-            esp_http_client_set_header(httpClient, "Content-Type", "text/plain");
-            std::string _zw = "Token " + token;
-            esp_http_client_set_header(httpClient, "Authorization", _zw.c_str());
-            esp_http_client_set_post_field(httpClient, payload.c_str(), payload.length());
-            err = ESP_ERROR_CHECK_WITHOUT_ABORT(esp_http_client_perform(httpClient));
-            if (err == ESP_OK) {
-                LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Data published successfully: " + payload);
-            } else {
-                LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Failed to publish data: " + std::string(esp_err_to_name(err)));
+        if (!spool || !spool->Append(lines.substr(start, end - start), now)) {
+            batch.restoreRetry(lines.substr(start));
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, std::to_string(lines.size() - start) + " bytes kept in RAM for retry");
+            return;
+        }
+        start = end;
+    }
+
+    LogFile.WriteToFile(ESP_LOG_WARN, TAG, std::to_string(lines.size()) + " bytes spooled for retry");
+}
+
+
+/**
+ * @brief Sends the oldest spooled lines as one batch.
+ */
+void InfluxDB::replaySpool() {
+    if (!spool || spool->isEmpty()) {
+        return;
+    }
+
+    spool->Replay(SPOOL_REPLAY_MAX_BYTES, [this](const std::vector<SpoolRecord> &_records) {
+        std::string body;
+        for (auto &record : _records) {
+            body += record.payload;
+        }
+        // Rejected lines would block the spool forever, so only a retry keeps them
+        return (sendBody(body) != INFLUXDB_SEND_RETRY);
+    });
+}
+
+
+/**
+ * @brief Publishes a single data point to an InfluxDB instance.
+ *
+ * Together with the data point, all points still waiting in the batch get sent.
+ *
+ * @param _measurement The measurement name to publish.
+ * @param _key The key associated with the measurement.
+ * @param _content The content or value to publish.
+ * @param _timeUTC The timestamp in UTC. If greater than 0, it will be included in the payload.
+ */
+void InfluxDB::InfluxDBPublish(std::string _measurement, std::string _key, std::string _content, long int _timeUTC) {
+    InfluxDBAddPoint(_measurement, _key, _content, _timeUTC);
+    InfluxDBFlush();
+}
+
+
+/**
+ * @brief Sends the points waiting in the batch of every instance, called by the sensor flush task.
+ *
+ * An instance which is already sending (e.g. the numbers of the round) is skipped, its points go
+ * out with that request anyway. The flush locks are taken while the list is locked, so an instance
+ * can not be deleted before its flush is done, but sensors can add points while the requests run.
+ */
+void InfluxDB::InfluxDBFlushSensorPoints() {
+    std::vector<std::pair<InfluxDB*, std::unique_lock<std::mutex>>> pending;
+
+    {
+        std::lock_guard<std::mutex> lock(influxDBInstancesLock);
+
+        for (auto instance : influxDBInstances) {
+            std::unique_lock<std::mutex> flush(instance->flushLock, std::try_to_lock);
+            if (flush.owns_lock() && (instance->batch.getPendingSize() > 0)) {
+                pending.emplace_back(instance, std::move(flush));
             }
-        break;
+        }
+    }
+
+    for (auto &entry : pending) {
+        entry.first->flushBatch();
+    }
+}
+
+
+/**
+ * @brief Adds a sensor value to every configured InfluxDB instance.
+ *
+ * Sensors are read by their own tasks, so the value does not get sent immediately but by the
+ * sensor flush task or together with the numbers of the next round.
+ */
+void InfluxDBAddSensorPoint(std::string _measurement, std::string _key, std::string _content, long int _timeUTC) {
+    std::lock_guard<std::mutex> lock(influxDBInstancesLock);
+
+    if (influxDBInstances.empty()) {
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "InfluxDB not configured, skipping sensor value");
+        return;
+    }
+
+    for (auto instance : influxDBInstances) {
+        instance->InfluxDBAddPoint(_measurement, _key, _content, _timeUTC);
     }
 }
 
-#endif //ENABLE_INFLUXDB
+#endif //ENABLE_INFLUXDB
\ No newline at end of file
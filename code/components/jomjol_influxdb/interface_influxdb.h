@@ -7,12 +7,15 @@
 #include <string>
 #include <map>
 #include <functional>
+#include <mutex>
 
 
 #include <string>
-#include "esp_http_client.h"
 #include "esp_log.h"
 
+#include "influxdb_batch.h"
+#include "publish_spool.h"
+
 
 enum InfluxDBVersion {
     INFLUXDB_V1,
@@ -51,11 +54,18 @@ enum InfluxDBVersion {
  * @var InfluxDBVersion version
  * Version of the InfluxDB server (v1.x or v2.x).
  * 
- * @var esp_http_client_handle_t httpClient
- * HTTP client handle for making requests to the InfluxDB server.
+ * @var std::string apiURI
+ * Write endpoint of the server. The requests are sent on a kept connection of the shared
+ * HTTP client pool (see http_client_pool.h).
+ * 
+ * @var InfluxDBBatch batch
+ * Points of the current round and the lines which could not be sent yet.
  * 
- * @var void connectHTTP()
- * Establishes an HTTP connection to the InfluxDB server.
+ * @var PublishSpool *spool
+ * Lines which could not be sent, kept on the SD card until the server is reachable again.
+ * 
+ * @var std::mutex flushLock
+ * Held while the batch gets sent, by the round and by the sensor flush task.
  * 
  * @public
  * @fn void InfluxDBInitV1(std::string _influxDBURI, std::string _database, std::string _user, std::string _password)
@@ -65,10 +75,19 @@ enum InfluxDBVersion {
  * Initializes the connection parameters for InfluxDB v2.x.
  * 
  * @fn void InfluxDBdestroy()
- * Destroys the InfluxDB connection.
+ * Closes the kept connections, the next request opens a new one.
+ * 
+ * @fn void InfluxDBAddPoint(std::string _measurement, std::string _key, std::string _content, long int _timeUTC)
+ * Adds a data point to the batch, it gets sent with the next InfluxDBFlush().
+ * 
+ * @fn bool InfluxDBFlush()
+ * Sends all collected data points with as few POST requests as possible.
  * 
  * @fn void InfluxDBPublish(std::string _measurement, std::string _key, std::string _content, long int _timeUTC)
- * Publishes data to the InfluxDB server.
+ * Publishes a single data point to the InfluxDB server (InfluxDBAddPoint() + InfluxDBFlush()).
+ * 
+ * @fn static void InfluxDBFlushSensorPoints()
+ * Sends the points waiting in the batch of every instance, skips instances which are already sending.
  * 
  * @param _measurement The measurement name.
  * @param _key The key for the data point.
@@ -92,22 +111,53 @@ private:
 
     InfluxDBVersion version;
 
-    esp_http_client_handle_t httpClient = NULL;
+    std::string apiURI = "";
+    std::string authorization = "";
+
+    InfluxDBBatch batch;
+    PublishSpool *spool = NULL;
+    std::mutex flushLock;
 
-    void connectHTTP();
+    bool flushBatch();
+    void spoolRetry();
+    void replaySpool();
+    InfluxDBSendResult sendBody(const std::string &_body);
 
 public:
+    InfluxDB();
+    ~InfluxDB();
+
     // Initialize the InfluxDB connection parameters
     void InfluxDBInitV1(std::string _influxDBURI, std::string _database, std::string _user, std::string _password);
     void InfluxDBInitV2(std::string _influxDBURI, std::string _bucket, std::string _org, std::string _token);
 
     // Destroy the InfluxDB connection
     void InfluxDBdestroy();
+    // Collect data points and send them in one request
+    void InfluxDBAddPoint(std::string _measurement, std::string _key, std::string _content, long int _timeUTC);
+    bool InfluxDBFlush();
     // Publish data to the InfluxDB server
     void InfluxDBPublish(std::string _measurement, std::string _key, std::string _content, long int _timeUTC);
+
+    static void InfluxDBFlushSensorPoints();
 };
 
 
+// Adds a sensor value to the batch of every configured InfluxDB (v1 and v2), it gets sent within
+// INFLUXDB_SENSOR_FLUSH_INTERVAL_S or with the next round, whatever comes first
+void InfluxDBAddSensorPoint(std::string _measurement, std::string _key, std::string _content, long int _timeUTC);
+
+// Field name of a number: "value", "raw" or "rate" for the default number, "<number>/<type>" for the others.
+// A configured field (FieldV1/FieldV2) replaces the name of the value, raw and rate get "_raw" and "_rate" appended.
+std::string InfluxDBFieldName(const std::string &_field, const std::string &_number, const std::string &_type);
+
+// Only plain numbers are written, e.g. a raw value with 'N' would get the whole request rejected
+bool InfluxDBIsNumber(const std::string &_content);
+
+// Requests which were not accepted by the server (all instances) since startup
+uint32_t InfluxDBgetFailedCount();
+
+
 
 #endif //INTERFACE_INFLUXDB_H
 #endif //ENABLE_INFLUXDB
\ No newline at end of file
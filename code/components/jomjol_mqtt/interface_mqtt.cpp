@@ -1,21 +1,20 @@
 #ifdef ENABLE_MQTT
 #include "interface_mqtt.h"
 
+#include <algorithm>
+#include <atomic>
+#include <string.h>
 #include "esp_log.h"
-#if DEBUG_DETAIL_ON
-    #include "esp_timer.h"
-#endif
+#include "esp_timer.h"
 #include "connect_wlan.h"
 #include "mqtt_client.h"
 #include "ClassLogFile.h"
 #include "MainFlowControl.h"
 #include "cJSON.h"
+#include "mqtt_publish_cache.h"
+#include "mqtt_outbox.h"
 #include "../../include/defines.h"
 
-#if DEBUG_DETAIL_ON
-#include "esp_timer.h"
-#endif
-
 static const char *TAG = "MQTT IF";
 
 std::map<std::string, std::function<void()>>* connectFunktionMap = NULL;  
@@ -40,6 +39,79 @@ int keepalive;
 bool SetRetainFlag;
 void (*callbackOnConnected)(std::string, bool) = NULL;
 
+static MQTTPublishCache publishCache;
+static std::atomic<uint32_t> publishFailed(0);
+
+
+void MQTTsetPublishOnChange(bool _enable, int _heartbeatMinutes)
+{
+    publishCache.setHeartbeat(_enable ? (int64_t)std::max(_heartbeatMinutes, 1) * 60 * 1000000 : 0);
+
+    if (_enable) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Unchanged retained topics get republished only every " + 
+                            std::to_string(std::max(_heartbeatMinutes, 1)) + " min");
+    }
+}
+
+
+uint32_t MQTTgetPublishedCount()
+{
+    return publishCache.getSent();
+}
+
+
+uint32_t MQTTgetSuppressedCount()
+{
+    return publishCache.getSuppressed();
+}
+
+
+uint32_t MQTTgetFailedCount()
+{
+    return publishFailed;
+}
+
+
+void MQTTresetPublishCache()
+{
+    publishCache.clear();
+}
+
+
+/* Class of a topic for the outbox, if it is full the least important messages get dropped first */
+static outbox_priority_t classifyOutboxTopic(const char *topic, int topic_len)
+{
+    static const char *diagnosticTopics[] = {LWT_TOPIC, "uptime", "freeMem", "wifiRSSI", "CPUtemp",
+                                             "fwVersion", "MAC", "IP", "hostname", "interval"};
+    const char *discoveryPrefix = "homeassistant/";
+
+    if ((topic_len >= (int)strlen(discoveryPrefix)) && (strncmp(topic, discoveryPrefix, strlen(discoveryPrefix)) == 0)) {
+        return OUTBOX_PRIORITY_DISCOVERY;
+    }
+
+    // Last level of the topic, e.g. "value" of "watermeter/main/value"
+    const char *field = topic;
+    for (int i = 0; i < topic_len; ++i) {
+        if (topic[i] == '/') {
+            field = &topic[i + 1];
+        }
+    }
+    int field_len = topic_len - (field - topic);
+
+    if ((field_len == 5) && (strncmp(field, "error", 5) == 0)) {
+        return OUTBOX_PRIORITY_ERROR;
+    }
+
+    for (const char *diagnosticTopic : diagnosticTopics) {
+        if ((field_len == (int)strlen(diagnosticTopic)) && (strncmp(field, diagnosticTopic, field_len) == 0)) {
+            return OUTBOX_PRIORITY_DIAGNOSTIC;
+        }
+    }
+
+    return OUTBOX_PRIORITY_VALUE;
+}
+
+
 bool MQTTPublish(std::string _key, std::string _content, int qos, bool retained_flag) 
 {
     if (!mqtt_enabled) {                            // MQTT sevice not started / configured (MQTT_Init not called before)      
@@ -47,7 +119,8 @@ bool MQTTPublish(std::string _key, std::string _content, int qos, bool retained_
     }
 
     if (failedOnRound == getCountFlowRounds()) {    // we already failed in this round, do not retry until the next round
-        return true; // Fail quietly
+        publishFailed++;
+        return false; // Fail quietly (no log), the caller must not assume it got published (e.g. discovery registry)
     }
 
     #ifdef DEBUG_DETAIL_ON  
@@ -57,10 +130,15 @@ bool MQTTPublish(std::string _key, std::string _content, int qos, bool retained_
     MQTT_Init(); // Re-Init client if not initialized yet/anymore
 
     if (mqtt_initialized && mqtt_connected) {
+        // Retained and unchanged -> the broker has it already
+        if (retained_flag && publishCache.isUnchanged(_key, _content, esp_timer_get_time())) {
+            return true;
+        }
+
         #ifdef DEBUG_DETAIL_ON 
             long long int starttime = esp_timer_get_time();
         #endif
-        int msg_id = esp_mqtt_client_publish(client, _key.c_str(), _content.c_str(), 0, qos, retained_flag);
+        int msg_id = esp_mqtt_client_publish(client, _key.c_str(), _content.data(), _content.length(), qos, retained_flag);
         #ifdef DEBUG_DETAIL_ON 
             ESP_LOGD(TAG, "Publish msg_id %d in %lld ms", msg_id, (esp_timer_get_time() - starttime)/1000);
         #endif
@@ -69,18 +147,32 @@ bool MQTTPublish(std::string _key, std::string _content, int qos, bool retained_
             #ifdef DEBUG_DETAIL_ON 
                 starttime = esp_timer_get_time();
             #endif
-            msg_id = esp_mqtt_client_publish(client, _key.c_str(), _content.c_str(), 0, qos, retained_flag);
+            msg_id = esp_mqtt_client_publish(client, _key.c_str(), _content.data(), _content.length(), qos, retained_flag);
             #ifdef DEBUG_DETAIL_ON 
                 ESP_LOGD(TAG, "Publish msg_id %d in %lld ms", msg_id, (esp_timer_get_time() - starttime)/1000);
             #endif
             if (msg_id == -1) {
+                publishFailed++;
+
+                // Discovery and diagnostics get rejected first by a full outbox, the values of the round may still fit
+                outbox_priority_t priority = classifyOutboxTopic(_key.c_str(), _key.length());
+                if ((priority == OUTBOX_PRIORITY_DISCOVERY) || (priority == OUTBOX_PRIORITY_DIAGNOSTIC)) {
+                    LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Failed to publish topic '" + _key + "', skipped");
+                    return false;
+                }
+
                 LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to publish topic '" + _key + "', skipping all MQTT publishings in this round!");
                 failedOnRound = getCountFlowRounds();
                 return false;
             }
         }
 
-        if (_content.length() > 80) { // Truncate message if too long
+        publishCache.published(_key, _content, esp_timer_get_time());
+
+        if (std::any_of(_content.begin(), _content.end(), [](char c) { return ((unsigned char)c < 0x20) && (c != '\n'); })) {
+            _content = "<binary, " + std::to_string(_content.length()) + " bytes>"; // e.g. MessagePack batch
+        }
+        else if (_content.length() > 80) { // Truncate message if too long
             _content.resize(80);
             _content.append("..");
         }
@@ -90,6 +182,7 @@ bool MQTTPublish(std::string _key, std::string _content, int qos, bool retained_
     }
     else {
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Publish skipped. Client not initalized or not connected. (topic: " + _key + ")");
+        publishFailed++;
         return false;
     }
 }
@@ -105,6 +198,7 @@ static esp_err_t mqtt_event_handler_cb(esp_mqtt_event_handle_t event) {
             MQTTReconnectCnt = 0;
             mqtt_initialized = true;
             mqtt_connected = true;
+            publishCache.clear();       // The broker might have lost the retained messages or published the LWT
             MQTTconnected();
             break;
         
@@ -338,6 +432,7 @@ int MQTT_Init() {
         LogFile.WriteHeapInfo("MQTT Client Init");
     #endif
 
+    outbox_configure(MQTT_OUTBOX_BUDGET, MQTT_OUTBOX_SLAB_ITEMS, classifyOutboxTopic);
     client = esp_mqtt_client_init(&mqtt_cfg);
     if (client)
     {
@@ -5,6 +5,7 @@
 #ifndef INTERFACE_MQTT_H
 #define INTERFACE_MQTT_H
 
+#include <stdint.h>
 #include <string>
 #include <map>
 #include <functional>
@@ -18,6 +19,12 @@ void MQTTdestroy_client(bool _disable);
 
 bool MQTTPublish(std::string _key, std::string _content, int qos, bool retained_flag = 1);            // retained Flag as Standart
 
+void MQTTsetPublishOnChange(bool _enable, int _heartbeatMinutes);
+uint32_t MQTTgetPublishedCount();
+uint32_t MQTTgetSuppressedCount();
+uint32_t MQTTgetFailedCount();      // Messages which could not be handed to the client
+void MQTTresetPublishCache();      // Next publish of every topic goes out, even if unchanged
+
 bool getMQTTisEnabled();
 bool getMQTTisConnected();
 
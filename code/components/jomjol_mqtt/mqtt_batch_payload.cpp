@@ -0,0 +1,324 @@
+#include "mqtt_batch_payload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+
+bool MQTTBatchIsNumber(const std::string &_value)
+{
+    const char *p = _value.c_str();
+
+    if (*p == '-') {
+        p++;
+    }
+
+    // No leading zeros
+    if (*p == '0') {
+        p++;
+    }
+    else if (isdigit((unsigned char)*p)) {
+        while (isdigit((unsigned char)*p)) {
+            p++;
+        }
+    }
+    else {
+        return false;
+    }
+
+    if (*p == '.') {
+        p++;
+        if (!isdigit((unsigned char)*p)) {
+            return false;
+        }
+        while (isdigit((unsigned char)*p)) {
+            p++;
+        }
+    }
+
+    if ((*p == 'e') || (*p == 'E')) {
+        p++;
+        if ((*p == '+') || (*p == '-')) {
+            p++;
+        }
+        if (!isdigit((unsigned char)*p)) {
+            return false;
+        }
+        while (isdigit((unsigned char)*p)) {
+            p++;
+        }
+    }
+
+    return (*p == '\0');
+}
+
+
+MQTTBatchPayload::MQTTBatchPayload(MQTTBatchFormat _format)
+{
+    format = _format;
+}
+
+
+void MQTTBatchPayload::writeBigEndian(uint64_t _value, int _bytes)
+{
+    for (int i = _bytes - 1; i >= 0; --i) {
+        data += (char)((_value >> (8 * i)) & 0xFF);
+    }
+}
+
+
+/* Separators and element counting, called before every value and container */
+void MQTTBatchPayload::beginElement(void)
+{
+    if (afterKey) {             // Value of a map entry, key() did the counting already
+        afterKey = false;
+        return;
+    }
+
+    if (!stack.empty()) {
+        if ((format == MQTT_BATCH_FORMAT_JSON) && (stack.back().count > 0)) {
+            data += ',';
+        }
+        stack.back().count++;
+    }
+}
+
+
+void MQTTBatchPayload::beginContainer(bool _isMap)
+{
+    beginElement();
+
+    Container container;
+    container.headerPos = data.size();
+    container.count = 0;
+    container.isMap = _isMap;
+    stack.push_back(container);
+
+    if (format == MQTT_BATCH_FORMAT_JSON) {
+        data += _isMap ? '{' : '[';
+    }
+    else {
+        data.append(5, '\0');   // Placeholder for the largest header (map32/array32), see endContainer()
+    }
+}
+
+
+void MQTTBatchPayload::endContainer(void)
+{
+    if (stack.empty()) {
+        return;
+    }
+
+    Container container = stack.back();
+    stack.pop_back();
+
+    if (format == MQTT_BATCH_FORMAT_JSON) {
+        data += container.isMap ? '}' : ']';
+        return;
+    }
+
+    // Replace the placeholder with the smallest header which fits the count
+    std::string header;
+    if (container.count < 16) {
+        header += (char)((container.isMap ? 0x80 : 0x90) | container.count);
+    }
+    else if (container.count <= 0xFFFF) {
+        header += (char)(container.isMap ? 0xde : 0xdc);
+        header += (char)(container.count >> 8);
+        header += (char)(container.count & 0xFF);
+    }
+    else {
+        header += (char)(container.isMap ? 0xdf : 0xdd);
+        for (int i = 3; i >= 0; --i) {
+            header += (char)((container.count >> (8 * i)) & 0xFF);
+        }
+    }
+    data.replace(container.headerPos, 5, header);
+}
+
+
+void MQTTBatchPayload::beginMap(void)
+{
+    beginContainer(true);
+}
+
+
+void MQTTBatchPayload::endMap(void)
+{
+    endContainer();
+}
+
+
+void MQTTBatchPayload::beginArray(void)
+{
+    beginContainer(false);
+}
+
+
+void MQTTBatchPayload::endArray(void)
+{
+    endContainer();
+}
+
+
+void MQTTBatchPayload::key(const std::string &_key)
+{
+    afterKey = false;
+    beginElement();
+
+    if (format == MQTT_BATCH_FORMAT_JSON) {
+        writeJsonString(_key);
+        data += ':';
+    }
+    else {
+        writeMsgPackString(_key);
+    }
+
+    afterKey = true;
+}
+
+
+void MQTTBatchPayload::writeJsonString(const std::string &_value)
+{
+    data += '"';
+    for (unsigned char c : _value) {
+        if ((c == '"') || (c == '\\')) {
+            data += '\\';
+            data += (char)c;
+        }
+        else if (c == '\n') {
+            data += "\\n";
+        }
+        else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            data += escaped;
+        }
+        else {
+            data += (char)c;
+        }
+    }
+    data += '"';
+}
+
+
+void MQTTBatchPayload::writeMsgPackString(const std::string &_value)
+{
+    size_t len = _value.size();
+
+    if (len < 32) {
+        data += (char)(0xa0 | len);
+    }
+    else if (len <= 0xFF) {
+        data += (char)0xd9;
+        writeBigEndian(len, 1);
+    }
+    else if (len <= 0xFFFF) {
+        data += (char)0xda;
+        writeBigEndian(len, 2);
+    }
+    else {
+        data += (char)0xdb;
+        writeBigEndian(len, 4);
+    }
+    data += _value;
+}
+
+
+void MQTTBatchPayload::addString(const std::string &_value)
+{
+    beginElement();
+
+    if (format == MQTT_BATCH_FORMAT_JSON) {
+        writeJsonString(_value);
+    }
+    else {
+        writeMsgPackString(_value);
+    }
+}
+
+
+void MQTTBatchPayload::addInt(int64_t _value)
+{
+    beginElement();
+
+    if (format == MQTT_BATCH_FORMAT_JSON) {
+        data += std::to_string((long long)_value);
+    }
+    else if ((_value >= -32) && (_value <= 127)) {      // positive/negative fixint
+        data += (char)(int8_t)_value;
+    }
+    else if ((_value >= INT32_MIN) && (_value <= INT32_MAX)) {
+        data += (char)0xd2;
+        writeBigEndian((uint32_t)(int32_t)_value, 4);
+    }
+    else {
+        data += (char)0xd3;
+        writeBigEndian((uint64_t)_value, 8);
+    }
+}
+
+
+void MQTTBatchPayload::addFloat(float _value)
+{
+    if (isnan(_value) || isinf(_value)) {
+        addNull();
+        return;
+    }
+
+    beginElement();
+
+    if (format == MQTT_BATCH_FORMAT_JSON) {
+        char number[24];
+        snprintf(number, sizeof(number), "%g", _value);
+        data += number;
+    }
+    else {
+        uint32_t bits;
+        memcpy(&bits, &_value, sizeof(bits));
+        data += (char)0xca;
+        writeBigEndian(bits, 4);
+    }
+}
+
+
+void MQTTBatchPayload::addNull(void)
+{
+    beginElement();
+    data += (format == MQTT_BATCH_FORMAT_JSON) ? "null" : "\xc0";
+}
+
+
+void MQTTBatchPayload::addValue(const std::string &_value)
+{
+    if (_value.empty()) {
+        addNull();
+        return;
+    }
+
+    if (!MQTTBatchIsNumber(_value)) {
+        addString(_value);
+        return;
+    }
+
+    if (format == MQTT_BATCH_FORMAT_JSON) {
+        beginElement();
+        data += _value;             // Keeps the number of decimals of the string
+        return;
+    }
+
+    if ((_value.find_first_of(".eE") == std::string::npos) && (_value.size() < 19)) {
+        addInt(strtoll(_value.c_str(), NULL, 10));
+        return;
+    }
+
+    double number = strtod(_value.c_str(), NULL);
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+
+    beginElement();
+    data += (char)0xcb;                 // float64, the values of a meter might need more digits than float32 has
+    writeBigEndian(bits, 8);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#ifndef MQTT_BATCH_PAYLOAD_H
+#define MQTT_BATCH_PAYLOAD_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* Serializes everything a round produces into one payload (see [MQTT] BatchPublishing).
+ * The same calls produce either compact JSON or MessagePack, e.g.
+ *   payload.beginMap(); payload.key("value"); payload.addValue("123.45"); payload.endMap();
+ * MessagePack is binary and length prefixed (strings, maps and arrays carry their size), the
+ * element counts of maps and arrays get filled in by endMap()/endArray(). */
+
+enum MQTTBatchFormat {
+    MQTT_BATCH_FORMAT_NONE = 0,     // Batch publishing disabled, every field gets its own topic
+    MQTT_BATCH_FORMAT_JSON,
+    MQTT_BATCH_FORMAT_MSGPACK
+};
+
+class MQTTBatchPayload {
+public:
+    MQTTBatchPayload(MQTTBatchFormat _format);
+
+    void beginMap(void);
+    void endMap(void);
+    void beginArray(void);
+    void endArray(void);
+    void key(const std::string &_key);
+
+    void addString(const std::string &_value);
+    void addInt(int64_t _value);
+    void addFloat(float _value);
+    void addNull(void);
+    void addValue(const std::string &_value);   // Numbers as number, empty string as null, everything else as string
+
+    const std::string &getData(void) { return data; };
+    MQTTBatchFormat getFormat(void) { return format; };
+
+private:
+    struct Container {
+        size_t headerPos;
+        uint32_t count;
+        bool isMap;
+    };
+
+    MQTTBatchFormat format;
+    std::string data;
+    std::vector<Container> stack;
+    bool afterKey = false;
+
+    void beginContainer(bool _isMap);
+    void endContainer(void);
+    void beginElement(void);
+    void writeBigEndian(uint64_t _value, int _bytes);
+    void writeJsonString(const std::string &_value);
+    void writeMsgPackString(const std::string &_value);
+};
+
+bool MQTTBatchIsNumber(const std::string &_value);      // Valid JSON number, e.g. "-12.5", but not "012" or "1,5"
+
+#endif //MQTT_BATCH_PAYLOAD_H
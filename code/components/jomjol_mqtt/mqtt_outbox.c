@@ -1,18 +1,59 @@
 /* This is a modification of https://github.com/espressif/esp-mqtt/blob/master/lib/mqtt_outbox.c
  * to use the PSRAM instead of the internal heap.
+ * The outbox got a byte budget, a preallocated slab for the items, an arena for the message data and
+ * priority classes, so it does not grow without limit while the broker is not reachable (see mqtt_outbox.h).
 */
 #include "mqtt_outbox.h"
 #include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
 #include "sys/queue.h"
 #include "esp_log.h"
-#include "esp_heap_caps.h"
+#include "../../include/defines.h"
+
+#ifdef ESP_PLATFORM
+    #include "esp_heap_caps.h"
+    #include "freertos/FreeRTOS.h"
+#endif
 
 /* Enable this to use the PSRAM for MQTT Publishing.
  * This saves 10 kBytes of RAM, see https://github.com/jomjol/AI-on-the-edge-device/pull/2113
  * However we can run into PSRAM fragmentation issues, leading to insufficient large blocks to load the model.
- * See https://github.com/jomjol/AI-on-the-edge-device/issues/2200 */
-#define USE_PSRAM
+ * See https://github.com/jomjol/AI-on-the-edge-device/issues/2200
+ * The items come from one slab and the message data from one arena of the size of the budget, both get
+ * allocated with the outbox, so publishing does not allocate anything. */
+#ifdef ESP_PLATFORM
+    #define USE_PSRAM
+#endif
+
+#ifdef USE_PSRAM
+    #define OUTBOX_CALLOC(n, size) heap_caps_calloc(n, size, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM)
+    #define OUTBOX_MALLOC(size) heap_caps_malloc(size, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM)
+    #define OUTBOX_FREE(p) heap_caps_free(p)
+#else
+    #define OUTBOX_CALLOC(n, size) calloc(n, size)
+    #define OUTBOX_MALLOC(size) malloc(size)
+    #define OUTBOX_FREE(p) free(p)
+#endif
+
+/* The stats are read by other tasks (e.g. /metrics), the outbox itself is only used by the MQTT client */
+#ifdef ESP_PLATFORM
+    static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+    #define OUTBOX_STATS_LOCK() portENTER_CRITICAL(&statsLock)
+    #define OUTBOX_STATS_UNLOCK() portEXIT_CRITICAL(&statsLock)
+#else
+    #define OUTBOX_STATS_LOCK()
+    #define OUTBOX_STATS_UNLOCK()
+#endif
+
+#ifndef STAILQ_FOREACH_SAFE     // Missing in the sys/queue.h of some host libcs
+#define STAILQ_FOREACH_SAFE(var, head, field, tvar)                 \
+    for ((var) = STAILQ_FIRST((head));                              \
+         (var) && ((tvar) = STAILQ_NEXT((var), field), 1);          \
+         (var) = (tvar))
+#endif
+
+#define MQTT_MSG_TYPE_PUBLISH 3
 
 #ifdef CONFIG_MQTT_CUSTOM_OUTBOX
 static const char *TAG = "outbox";
@@ -23,62 +64,233 @@ typedef struct outbox_item {
     int msg_id;
     int msg_type;
     int msg_qos;
+    outbox_priority_t priority;
     outbox_tick_t tick;
     pending_state_t pending;
     STAILQ_ENTRY(outbox_item) next;
 } outbox_item_t;
 
-STAILQ_HEAD(outbox_list_t, outbox_item);
+STAILQ_HEAD(outbox_item_list_t, outbox_item);
+
+struct outbox_list_t {
+    struct outbox_item_list_t items;        // In order of enqueueing, the first one is the oldest
+    struct outbox_item_list_t free_items;
+    outbox_item_t *slab;
+    char *arena;                            // Message data, stats.budget bytes
+    outbox_stats_t stats;
+};
+
+static size_t configBudget = MQTT_OUTBOX_BUDGET;
+static int configSlabItems = MQTT_OUTBOX_SLAB_ITEMS;
+static outbox_classifier_t configClassifier = NULL;
+static outbox_handle_t activeOutbox = NULL;
+
+
+void outbox_configure(size_t budget, int slab_items, outbox_classifier_t classifier)
+{
+    configBudget = budget;
+    configSlabItems = (slab_items > 0) ? slab_items : 1;
+    configClassifier = classifier;
+}
+
+
+void outbox_get_stats(outbox_handle_t outbox, outbox_stats_t *stats)
+{
+    OUTBOX_STATS_LOCK();
+    if (outbox == NULL) {
+        outbox = activeOutbox;
+    }
+
+    if (outbox == NULL) {
+        memset(stats, 0, sizeof(outbox_stats_t));
+    }
+    else {
+        *stats = outbox->stats;
+    }
+    OUTBOX_STATS_UNLOCK();
+}
+
+
+/* Class of a message, the topic of a PUBLISH follows the fixed header (type, remaining length) */
+static outbox_priority_t outbox_classify(outbox_message_handle_t message)
+{
+    if (message->msg_type != MQTT_MSG_TYPE_PUBLISH) {
+        return OUTBOX_PRIORITY_CONTROL;
+    }
+
+    if (configClassifier == NULL) {
+        return OUTBOX_PRIORITY_VALUE;
+    }
+
+    int pos = 1;
+    while ((pos < message->len) && (pos < 5) && (message->data[pos] & 0x80)) {  // Remaining length, 1..4 bytes
+        pos++;
+    }
+    pos++;
+
+    if (pos + 2 > message->len) {
+        return OUTBOX_PRIORITY_VALUE;
+    }
+
+    int topic_len = (message->data[pos] << 8) | message->data[pos + 1];
+    if (pos + 2 + topic_len > message->len) {
+        return OUTBOX_PRIORITY_VALUE;
+    }
+
+    return configClassifier((const char *)&message->data[pos + 2], topic_len);
+}
+
+
+static void outbox_free_item(outbox_handle_t outbox, outbox_item_handle_t item)
+{
+    STAILQ_REMOVE(&outbox->items, item, outbox_item, next);
+    item->buffer = NULL;
+    OUTBOX_STATS_LOCK();
+    outbox->stats.bytes -= item->len;
+    outbox->stats.items--;
+    OUTBOX_STATS_UNLOCK();
+    STAILQ_INSERT_TAIL(&outbox->free_items, item, next);
+}
+
+
+/* First gap of the arena with len bytes which is not used by a message, NULL if there is none */
+static char *outbox_find_space(outbox_handle_t outbox, size_t len)
+{
+    size_t start = 0;
+    bool overlaps = true;
+
+    while (overlaps) {
+        overlaps = false;
+        outbox_item_handle_t item;
+        STAILQ_FOREACH(item, &outbox->items, next) {
+            size_t item_start = item->buffer - outbox->arena;
+            if ((item_start < start + len) && (start < item_start + item->len)) {
+                start = item_start + item->len;
+                overlaps = true;
+            }
+        }
+
+        if (start + len > outbox->stats.budget) {
+            return NULL;
+        }
+    }
+
+    return outbox->arena + start;
+}
+
+
+/* Oldest message of the least important class, which is not more important than _priority */
+static outbox_item_handle_t outbox_find_victim(outbox_handle_t outbox, outbox_priority_t priority)
+{
+    outbox_item_handle_t item, victim = NULL;
+    STAILQ_FOREACH(item, &outbox->items, next) {
+        if ((item->priority == OUTBOX_PRIORITY_CONTROL) || (item->priority < priority)) {
+            continue;
+        }
+        if ((victim == NULL) || (item->priority > victim->priority)) {
+            victim = item;
+        }
+    }
+    return victim;
+}
 
 
 outbox_handle_t outbox_init(void)
 {
-#ifdef USE_PSRAM
-    outbox_handle_t outbox = heap_caps_calloc(1, sizeof(struct outbox_list_t), MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-#else
-    outbox_handle_t outbox = calloc(1, sizeof(struct outbox_list_t));
-#endif
-    //ESP_MEM_CHECK(TAG, outbox, return NULL);
-    STAILQ_INIT(outbox);
+    outbox_handle_t outbox = OUTBOX_CALLOC(1, sizeof(struct outbox_list_t));
+    if (outbox == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate the outbox");
+        return NULL;
+    }
+
+    outbox->slab = OUTBOX_CALLOC(configSlabItems, sizeof(outbox_item_t));
+    outbox->arena = OUTBOX_MALLOC(configBudget);
+    if ((outbox->slab == NULL) || (outbox->arena == NULL)) {
+        ESP_LOGE(TAG, "Failed to allocate %d outbox items and %d bytes", configSlabItems, (int)configBudget);
+        OUTBOX_FREE(outbox->slab);
+        OUTBOX_FREE(outbox->arena);
+        OUTBOX_FREE(outbox);
+        return NULL;
+    }
+
+    STAILQ_INIT(&outbox->items);
+    STAILQ_INIT(&outbox->free_items);
+    for (int i = 0; i < configSlabItems; i++) {
+        STAILQ_INSERT_TAIL(&outbox->free_items, &outbox->slab[i], next);
+    }
+
+    outbox->stats.item_capacity = configSlabItems;
+    outbox->stats.budget = configBudget;
+    OUTBOX_STATS_LOCK();
+    activeOutbox = outbox;
+    OUTBOX_STATS_UNLOCK();
     return outbox;
 }
 
 outbox_item_handle_t outbox_enqueue(outbox_handle_t outbox, outbox_message_handle_t message, outbox_tick_t tick)
 {
-#ifdef USE_PSRAM
-    outbox_item_handle_t item = heap_caps_calloc(1, sizeof(outbox_item_t), MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-#else
-    outbox_item_handle_t item = calloc(1, sizeof(outbox_item_t));
-#endif
-    //ESP_MEM_CHECK(TAG, item, return NULL);
+    size_t len = message->len + message->remaining_len;
+    outbox_priority_t priority = outbox_classify(message);
+
+    if (len > outbox->stats.budget) {
+        OUTBOX_STATS_LOCK();
+        outbox->stats.rejected++;
+        OUTBOX_STATS_UNLOCK();
+        ESP_LOGW(TAG, "Message msgid=%d with %d bytes is larger than the outbox budget", message->msg_id, (int)len);
+        return NULL;
+    }
+
+    // Make room by dropping less (or equally) important messages
+    char *buffer = NULL;
+    while (STAILQ_EMPTY(&outbox->free_items) || ((buffer = outbox_find_space(outbox, len)) == NULL)) {
+        outbox_item_handle_t victim = outbox_find_victim(outbox, priority);
+        if (victim == NULL) {
+            OUTBOX_STATS_LOCK();
+            outbox->stats.rejected++;
+            OUTBOX_STATS_UNLOCK();
+            ESP_LOGW(TAG, "Outbox full (%d bytes, %d items), rejected msgid=%d", (int)outbox->stats.bytes, outbox->stats.items, message->msg_id);
+            return NULL;
+        }
+        ESP_LOGD(TAG, "DROPPED msgid=%d, priority=%d to make room for msgid=%d", victim->msg_id, victim->priority, message->msg_id);
+        OUTBOX_STATS_LOCK();
+        outbox->stats.dropped[victim->priority]++;
+        OUTBOX_STATS_UNLOCK();
+        outbox_free_item(outbox, victim);
+    }
+
+    outbox_item_handle_t item = STAILQ_FIRST(&outbox->free_items);
+    STAILQ_REMOVE_HEAD(&outbox->free_items, next);
+
+    item->buffer = buffer;
     item->msg_id = message->msg_id;
     item->msg_type = message->msg_type;
     item->msg_qos = message->msg_qos;
+    item->priority = priority;
     item->tick = tick;
-    item->len =  message->len + message->remaining_len;
+    item->len = len;
     item->pending = QUEUED;
-#ifdef USE_PSRAM
-    item->buffer = heap_caps_malloc(message->len + message->remaining_len, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-#else
-    item->buffer = malloc(message->len + message->remaining_len);
-#endif
-    /*ESP_MEM_CHECK(TAG, item->buffer, {
-        free(item);
-        return NULL;
-    });*/
     memcpy(item->buffer, message->data, message->len);
     if (message->remaining_data) {
         memcpy(item->buffer + message->len, message->remaining_data, message->remaining_len);
     }
-    STAILQ_INSERT_TAIL(outbox, item, next);
-    ESP_LOGD(TAG, "ENQUEUE msgid=%d, msg_type=%d, len=%d, size=%d", message->msg_id, message->msg_type, message->len + message->remaining_len, outbox_get_size(outbox));
+    STAILQ_INSERT_TAIL(&outbox->items, item, next);
+
+    OUTBOX_STATS_LOCK();
+    outbox->stats.items++;
+    outbox->stats.bytes += len;
+    if (outbox->stats.bytes > outbox->stats.bytes_peak) {
+        outbox->stats.bytes_peak = outbox->stats.bytes;
+    }
+    OUTBOX_STATS_UNLOCK();
+
+    ESP_LOGD(TAG, "ENQUEUE msgid=%d, msg_type=%d, len=%d, size=%d", message->msg_id, message->msg_type, (int)len, outbox_get_size(outbox));
     return item;
 }
 
 outbox_item_handle_t outbox_get(outbox_handle_t outbox, int msg_id)
 {
     outbox_item_handle_t item;
-    STAILQ_FOREACH(item, outbox, next) {
+    STAILQ_FOREACH(item, &outbox->items, next) {
         if (item->msg_id == msg_id) {
             return item;
         }
@@ -89,7 +301,7 @@ outbox_item_handle_t outbox_get(outbox_handle_t outbox, int msg_id)
 outbox_item_handle_t outbox_dequeue(outbox_handle_t outbox, pending_state_t pending, outbox_tick_t *tick)
 {
     outbox_item_handle_t item;
-    STAILQ_FOREACH(item, outbox, next) {
+    STAILQ_FOREACH(item, &outbox->items, next) {
         if (item->pending == pending) {
             if (tick) {
                 *tick = item->tick;
@@ -103,16 +315,9 @@ outbox_item_handle_t outbox_dequeue(outbox_handle_t outbox, pending_state_t pend
 esp_err_t outbox_delete_item(outbox_handle_t outbox, outbox_item_handle_t item_to_delete)
 {
     outbox_item_handle_t item;
-    STAILQ_FOREACH(item, outbox, next) {
+    STAILQ_FOREACH(item, &outbox->items, next) {
         if (item == item_to_delete) {
-            STAILQ_REMOVE(outbox, item, outbox_item, next);
-#ifdef USE_PSRAM
-            heap_caps_free(item->buffer);
-            heap_caps_free(item);
-#else
-            free(item->buffer);
-            free(item);
-#endif
+            outbox_free_item(outbox, item);
             return ESP_OK;
         }
     }
@@ -134,16 +339,9 @@ uint8_t *outbox_item_get_data(outbox_item_handle_t item,  size_t *len, uint16_t
 esp_err_t outbox_delete(outbox_handle_t outbox, int msg_id, int msg_type)
 {
     outbox_item_handle_t item, tmp;
-    STAILQ_FOREACH_SAFE(item, outbox, next, tmp) {
+    STAILQ_FOREACH_SAFE(item, &outbox->items, next, tmp) {
         if (item->msg_id == msg_id && (0xFF & (item->msg_type)) == msg_type) {
-            STAILQ_REMOVE(outbox, item, outbox_item, next);
-#ifdef USE_PSRAM
-            heap_caps_free(item->buffer);
-            heap_caps_free(item);
-#else
-            free(item->buffer);
-            free(item);
-#endif
+            outbox_free_item(outbox, item);
             ESP_LOGD(TAG, "DELETED msgid=%d, msg_type=%d, remain size=%d", msg_id, msg_type, outbox_get_size(outbox));
             return ESP_OK;
         }
@@ -154,16 +352,9 @@ esp_err_t outbox_delete(outbox_handle_t outbox, int msg_id, int msg_type)
 esp_err_t outbox_delete_msgid(outbox_handle_t outbox, int msg_id)
 {
     outbox_item_handle_t item, tmp;
-    STAILQ_FOREACH_SAFE(item, outbox, next, tmp) {
+    STAILQ_FOREACH_SAFE(item, &outbox->items, next, tmp) {
         if (item->msg_id == msg_id) {
-            STAILQ_REMOVE(outbox, item, outbox_item, next);
-#ifdef USE_PSRAM
-            heap_caps_free(item->buffer);
-            heap_caps_free(item);
-#else
-            free(item->buffer);
-            free(item);
-#endif
+            outbox_free_item(outbox, item);
         }
 
     }
@@ -200,16 +391,9 @@ esp_err_t outbox_set_tick(outbox_handle_t outbox, int msg_id, outbox_tick_t tick
 esp_err_t outbox_delete_msgtype(outbox_handle_t outbox, int msg_type)
 {
     outbox_item_handle_t item, tmp;
-    STAILQ_FOREACH_SAFE(item, outbox, next, tmp) {
+    STAILQ_FOREACH_SAFE(item, &outbox->items, next, tmp) {
         if (item->msg_type == msg_type) {
-            STAILQ_REMOVE(outbox, item, outbox_item, next);
-#ifdef USE_PSRAM
-            heap_caps_free(item->buffer);
-            heap_caps_free(item);
-#else
-            free(item->buffer);
-            free(item);
-#endif
+            outbox_free_item(outbox, item);
         }
 
     }
@@ -219,24 +403,13 @@ int outbox_delete_single_expired(outbox_handle_t outbox, outbox_tick_t current_t
 {
     int msg_id = -1;
     outbox_item_handle_t item;
-    STAILQ_FOREACH(item, outbox, next) {
+    STAILQ_FOREACH(item, &outbox->items, next) {
         if (current_tick - item->tick > timeout) {
-            STAILQ_REMOVE(outbox, item, outbox_item, next);
-
-#ifdef USE_PSRAM
-            heap_caps_free(item->buffer);
-#else
-            free(item->buffer);
-#endif
-
             msg_id = item->msg_id;
-
-#ifdef USE_PSRAM
-            heap_caps_free(item);
-#else
-            free(item);
-#endif
-
+            outbox_free_item(outbox, item);
+            OUTBOX_STATS_LOCK();
+            outbox->stats.expired++;
+            OUTBOX_STATS_UNLOCK();
             return msg_id;
         }
 
@@ -248,58 +421,57 @@ int outbox_delete_expired(outbox_handle_t outbox, outbox_tick_t current_tick, ou
 {
     int deleted_items = 0;
     outbox_item_handle_t item, tmp;
-    STAILQ_FOREACH_SAFE(item, outbox, next, tmp) {
+    STAILQ_FOREACH_SAFE(item, &outbox->items, next, tmp) {
         if (current_tick - item->tick > timeout) {
-            STAILQ_REMOVE(outbox, item, outbox_item, next);
-#ifdef USE_PSRAM
-            heap_caps_free(item->buffer);
-            heap_caps_free(item);
-#else
-            free(item->buffer);
-            free(item);
-#endif
+            outbox_free_item(outbox, item);
             deleted_items ++;
         }
 
     }
+    OUTBOX_STATS_LOCK();
+    outbox->stats.expired += deleted_items;
+    OUTBOX_STATS_UNLOCK();
     return deleted_items;
 }
 
 int outbox_get_size(outbox_handle_t outbox)
 {
-    int siz = 0;
-    outbox_item_handle_t item;
-    STAILQ_FOREACH(item, outbox, next) {
-        // Suppressing "use after free" warning as this could happen only if queue is in inconsistent state
-        // which never happens if STAILQ interface used
-        siz += item->len; // NOLINT(clang-analyzer-unix.Malloc)
-    }
-    return siz;
+    return outbox->stats.bytes;
 }
 
 void outbox_delete_all_items(outbox_handle_t outbox)
 {
     outbox_item_handle_t item, tmp;
-    STAILQ_FOREACH_SAFE(item, outbox, next, tmp) {
-        STAILQ_REMOVE(outbox, item, outbox_item, next);
-#ifdef USE_PSRAM
-            heap_caps_free(item->buffer);
-            heap_caps_free(item);
-#else
-            free(item->buffer);
-            free(item);
-#endif
+    STAILQ_FOREACH_SAFE(item, &outbox->items, next, tmp) {
+        outbox_free_item(outbox, item);
     }
 }
 void outbox_destroy(outbox_handle_t outbox)
 {
+    // No stats of a freed outbox
+    OUTBOX_STATS_LOCK();
+    if (activeOutbox == outbox) {
+        activeOutbox = NULL;
+    }
+    OUTBOX_STATS_UNLOCK();
+
     outbox_delete_all_items(outbox);
 
-#ifdef USE_PSRAM
-    heap_caps_free(outbox);
-#else
-    free(outbox);
-#endif
+    OUTBOX_FREE(outbox->arena);
+    OUTBOX_FREE(outbox->slab);
+    OUTBOX_FREE(outbox);
+}
+
+#else // The outbox of esp-mqtt is used, it has no budget
+
+void outbox_configure(size_t budget, int slab_items, outbox_classifier_t classifier)
+{
+}
+
+
+void outbox_get_stats(outbox_handle_t outbox, outbox_stats_t *stats)
+{
+    memset(stats, 0, sizeof(outbox_stats_t));
 }
 
 #endif /* CONFIG_MQTT_CUSTOM_OUTBOX */
@@ -6,6 +6,8 @@
 #ifndef _MQTT_OUTOBX_H_
 #define _MQTT_OUTOBX_H_
 //#include "platform.h"
+#include <stdint.h>
+#include <stddef.h>
 #include "esp_err.h"
 
 #ifdef  __cplusplus
@@ -36,6 +38,39 @@ typedef enum pending_state {
     CONFIRMED
 } pending_state_t;
 
+/* The outbox has a fixed byte budget and a slab of preallocated items (see outbox_configure()).
+ * If a new message does not fit, the oldest message of the least important class gets dropped,
+ * but never one which is more important than the new message. In that case the new message gets
+ * rejected (outbox_enqueue() returns NULL and the publish fails).
+ * Lower value = more important */
+typedef enum outbox_priority {
+    OUTBOX_PRIORITY_CONTROL = 0,    // Everything which is not a PUBLISH (SUBSCRIBE, PUBREL, ...)
+    OUTBOX_PRIORITY_VALUE,
+    OUTBOX_PRIORITY_ERROR,
+    OUTBOX_PRIORITY_DIAGNOSTIC,
+    OUTBOX_PRIORITY_DISCOVERY,
+    OUTBOX_PRIORITY_COUNT
+} outbox_priority_t;
+
+/* Returns the class of a PUBLISH, without classifier all of them are OUTBOX_PRIORITY_VALUE */
+typedef outbox_priority_t (*outbox_classifier_t)(const char *topic, int topic_len);
+
+typedef struct outbox_stats {
+    int items;
+    int item_capacity;                      // Size of the slab
+    size_t bytes;
+    size_t bytes_peak;
+    size_t budget;
+    int dropped[OUTBOX_PRIORITY_COUNT];     // Dropped to make room for a more (or equally) important message
+    int rejected;                           // New messages which did not fit
+    int expired;
+} outbox_stats_t;
+
+/* Only has an effect on outboxes created afterwards (the MQTT client creates it in esp_mqtt_client_init()) */
+void outbox_configure(size_t budget, int slab_items, outbox_classifier_t classifier);
+/* outbox == NULL -> the most recently created outbox */
+void outbox_get_stats(outbox_handle_t outbox, outbox_stats_t *stats);
+
 outbox_handle_t outbox_init(void);
 outbox_item_handle_t outbox_enqueue(outbox_handle_t outbox, outbox_message_handle_t message, outbox_tick_t tick);
 outbox_item_handle_t outbox_dequeue(outbox_handle_t outbox, pending_state_t pending, outbox_tick_t *tick);
@@ -0,0 +1,58 @@
+#include "mqtt_publish_cache.h"
+
+
+uint32_t MQTTPublishCache::hashPayload(const std::string &_payload)
+{
+    uint32_t hash = 2166136261u;            // FNV-1a
+    for (unsigned char c : _payload) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash ^ (uint32_t)_payload.size();
+}
+
+
+void MQTTPublishCache::setHeartbeat(int64_t _heartbeatUs)
+{
+    std::lock_guard<std::mutex> lock(cacheLock);
+    heartbeatUs = _heartbeatUs;
+    entries.clear();
+}
+
+
+bool MQTTPublishCache::isUnchanged(const std::string &_topic, const std::string &_payload, int64_t _nowUs)
+{
+    std::lock_guard<std::mutex> lock(cacheLock);
+
+    if (heartbeatUs <= 0) {
+        return false;
+    }
+
+    auto it = entries.find(_topic);
+    if ((it == entries.end()) || (it->second.hash != hashPayload(_payload)) || (_nowUs - it->second.lastSentUs >= heartbeatUs)) {
+        return false;
+    }
+
+    suppressed++;
+    return true;
+}
+
+
+void MQTTPublishCache::published(const std::string &_topic, const std::string &_payload, int64_t _nowUs)
+{
+    std::lock_guard<std::mutex> lock(cacheLock);
+
+    sent++;
+    if (heartbeatUs > 0) {
+        Entry &entry = entries[_topic];
+        entry.hash = hashPayload(_payload);
+        entry.lastSentUs = _nowUs;
+    }
+}
+
+
+void MQTTPublishCache::clear(void)
+{
+    std::lock_guard<std::mutex> lock(cacheLock);
+    entries.clear();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#ifndef MQTT_PUBLISH_CACHE_H
+#define MQTT_PUBLISH_CACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <mutex>
+
+/* Remembers a hash of the last payload published per topic.
+ * A retained message is already stored on the broker, so publishing the same payload again is
+ * only needed as a sign of life: unchanged payloads are suppressed until the heartbeat interval
+ * since the last real publish has passed. A heartbeat of 0 disables the suppression. */
+class MQTTPublishCache {
+public:
+    MQTTPublishCache(int64_t _heartbeatUs = 0) : heartbeatUs(_heartbeatUs) {};   // INT64_MAX -> only a changed payload gets published again
+
+    void setHeartbeat(int64_t _heartbeatUs);
+    bool isEnabled(void) { return heartbeatUs > 0; };
+
+    bool isUnchanged(const std::string &_topic, const std::string &_payload, int64_t _nowUs);  // true -> suppress
+    void published(const std::string &_topic, const std::string &_payload, int64_t _nowUs);
+    void clear(void);                           // e.g. after a reconnect, everything gets published again
+
+    uint32_t getSent(void) { return sent; };
+    uint32_t getSuppressed(void) { return suppressed; };
+
+private:
+    struct Entry {
+        uint32_t hash;
+        int64_t lastSentUs;
+    };
+
+    std::mutex cacheLock;
+    std::map<std::string, Entry> entries;
+    int64_t heartbeatUs;
+    uint32_t sent = 0;
+    uint32_t suppressed = 0;
+
+    static uint32_t hashPayload(const std::string &_payload);
+};
+
+#endif //MQTT_PUBLISH_CACHE_H
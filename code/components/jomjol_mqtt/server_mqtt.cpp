@@ -4,6 +4,8 @@
 #include <iomanip>
 #include <vector>
 #include <algorithm>
+#include <mutex>
+#include <string.h>
 
 #include "esp_log.h"
 #include "ClassLogFile.h"
@@ -14,6 +16,7 @@
 #include "time_sntp.h"
 #include "../../include/defines.h"
 #include "basic_auth.h"
+#include "mqtt_publish_cache.h"
 
 // Include sensor manager for HomeAssistant Discovery
 #include "../jomjol_sensors/sensor_manager.h"
@@ -30,8 +33,9 @@ extern const char* libfive_git_revision(void);
 extern const char* libfive_git_branch(void);
 extern std::string getFwVersion(void);
 
-std::vector<NumberPost*>* NUMBERS;
+std::vector<NumberPost*>* NUMBERS = NULL;
 SensorManager* sensorManager = nullptr;
+static std::mutex flowReferencesLock;       // NUMBERS and sensorManager, they belong to the flow steps
 bool HomeassistantDiscovery = false;
 std::string meterType = "";
 std::string valueUnit = "";
@@ -43,18 +47,33 @@ bool retainFlag;
 static std::string maintopic, domoticzintopic;
 bool sendingOf_DiscoveryAndStaticTopics_scheduled = true; // Set it to true to make sure it gets sent at least once after startup
 
+/* Discovery registry: hash of the config payload per discovery topic which got published since startup
+ * (or since HA came online the last time). Unchanged configs do not get published again, they are
+ * retained on the broker. No heartbeat, an entry only gets invalid by a changed payload or clear(). */
+static MQTTPublishCache discoveryRegistry(INT64_MAX);
+static bool discoveryIncomplete = false;    // At least one config did not get published, retry the missing ones
+
 
 
 void mqttServer_setParameter(std::vector<NumberPost*>* _NUMBERS, int _keepAlive, float _roundInterval) {
+    std::lock_guard<std::mutex> lock(flowReferencesLock);
     NUMBERS = _NUMBERS;
     keepAlive = _keepAlive;
     roundInterval = _roundInterval; 
 }
 
 void mqttServer_setSensorManager(SensorManager* _sensorManager) {
+    std::lock_guard<std::mutex> lock(flowReferencesLock);
     sensorManager = _sensorManager;
 }
 
+/* Waits for a running discovery or batch, afterwards nothing refers to the steps anymore */
+void mqttServer_clearFlowReferences(void) {
+    std::lock_guard<std::mutex> lock(flowReferencesLock);
+    NUMBERS = NULL;
+    sensorManager = nullptr;
+}
+
 void mqttServer_setMeterType(std::string _meterType, std::string _valueUnit, std::string _timeUnit,std::string _rateUnit) {
     meterType = _meterType;
     valueUnit = _valueUnit;
@@ -87,15 +106,18 @@ std::string getSensorBaseTopic(const std::string& customTopic, const std::string
 bool sendHomeAssistantDiscoveryTopic(std::string group, std::string field,
     std::string name, std::string icon, std::string unit, std::string deviceClass, std::string stateClass, std::string entityCategory,
     int qos, std::string discoveryBaseTopic = "", std::string sensorTypePrefix = "") {
-    std::string version = std::string(libfive_git_version());
+    static std::string version = "";
+    static std::string payload = "";    // Reused, so building a payload does not need to grow a new string every time
 
     if (version == "") {
-        version = std::string(libfive_git_branch()) + " (" + std::string(libfive_git_revision()) + ")";
+        version = std::string(libfive_git_version());
+        if (version == "") {
+            version = std::string(libfive_git_branch()) + " (" + std::string(libfive_git_revision()) + ")";
+        }
     }
     
     std::string topicFull;
     std::string configTopic;
-    std::string payload;
     std::string component;
 
     configTopic = field;
@@ -115,7 +137,7 @@ bool sendHomeAssistantDiscoveryTopic(std::string group, std::string field,
         }
         
         // For multiple meters, also update the name
-        if ((*NUMBERS).size() > 1) {
+        if ((NUMBERS != NULL) && ((*NUMBERS).size() > 1)) {
             name = group + " " + name;
         }
     }
@@ -150,72 +172,82 @@ bool sendHomeAssistantDiscoveryTopic(std::string group, std::string field,
     topicFull = "homeassistant/" + component + "/" + node_id + "/" + configTopic + "/config";
     
     /* See https://www.home-assistant.io/docs/mqtt/discovery/ */
-    payload = string("{")  +
-        "\"~\": \"" + baseTopic + "\","  +
-        "\"unique_id\": \"" + baseTopic + "-" + configTopic + "\","  +
-        "\"object_id\": \"" + baseTopic + "_" + configTopic + "\","  + // Default entity ID; required for HA <= 2025.10
-        "\"default_entity_id\": \"" + component + "." + baseTopic + "_" + configTopic + "\"," + // Default entity ID; required in HA >=2026.4
-        "\"name\": \"" + name + "\","  +
-        "\"icon\": \"mdi:" + icon + "\",";        
+    payload.clear();
+    payload.reserve(MQTT_DISCOVERY_PAYLOAD_SIZE);
+    payload.append("{\"~\": \"").append(baseTopic).append("\",");
+    payload.append("\"unique_id\": \"").append(baseTopic).append("-").append(configTopic).append("\",");
+    payload.append("\"object_id\": \"").append(baseTopic).append("_").append(configTopic).append("\","); // Default entity ID; required for HA <= 2025.10
+    payload.append("\"default_entity_id\": \"").append(component).append(".").append(baseTopic).append("_").append(configTopic).append("\","); // Default entity ID; required in HA >=2026.4
+    payload.append("\"name\": \"").append(name).append("\",");
+    payload.append("\"icon\": \"mdi:").append(icon).append("\",");
 
     if (group != "") {
         if (field == "problem") { // Special case: Binary sensor which is based on error topic
-            payload += "\"state_topic\": \"~/" + group + "/error\",";
-            payload += "\"value_template\": \"{{ 'OFF' if 'no error' in value else 'ON'}}\",";
+            payload.append("\"state_topic\": \"~/").append(group).append("/error\",");
+            payload.append("\"value_template\": \"{{ 'OFF' if 'no error' in value else 'ON'}}\",");
         }
         else {
-            payload += "\"state_topic\": \"~/" + group + "/" + field + "\",";
+            payload.append("\"state_topic\": \"~/").append(group).append("/").append(field).append("\",");
         }
     }
     else {
         if (field == "problem") { // Special case: Binary sensor which is based on error topic
-            payload += "\"state_topic\": \"~/error\",";
-            payload += "\"value_template\": \"{{ 'OFF' if 'no error' in value else 'ON'}}\",";
+            payload.append("\"state_topic\": \"~/error\",");
+            payload.append("\"value_template\": \"{{ 'OFF' if 'no error' in value else 'ON'}}\",");
         }
         else if (field == "flowstart") { // Special case: Button
-            payload += "\"cmd_t\":\"~/ctrl/flow_start\","; // Add command topic
+            payload.append("\"cmd_t\":\"~/ctrl/flow_start\","); // Add command topic
         }
         else {
-            payload += "\"state_topic\": \"~/" + field + "\",";
+            payload.append("\"state_topic\": \"~/").append(field).append("\",");
         }
     }
 
     if (unit != "") {
-        payload += "\"unit_of_meas\": \"" + unit + "\",";
+        payload.append("\"unit_of_meas\": \"").append(unit).append("\",");
     }
 
     if (deviceClass != "") {
-        payload += "\"device_class\": \"" + deviceClass + "\",";
+        payload.append("\"device_class\": \"").append(deviceClass).append("\",");
     }
 
     if (stateClass != "") {
-        payload += "\"state_class\": \"" + stateClass + "\",";
+        payload.append("\"state_class\": \"").append(stateClass).append("\",");
     } 
 
     if (entityCategory != "") {
-        payload += "\"entity_category\": \"" + entityCategory + "\",";
+        payload.append("\"entity_category\": \"").append(entityCategory).append("\",");
     } 
 
     // Availability topic: Always use maintopic for LWT (Last Will and Testament)
     // The actual connection status is published to maintopic/connection, not to custom sensor topics
-    payload += 
-        "\"availability_topic\": \"" + maintopic + "/" + std::string(LWT_TOPIC) + "\","  +
-        "\"payload_available\": \"" + LWT_CONNECTED + "\","  +
-        "\"payload_not_available\": \"" + LWT_DISCONNECTED + "\",";
+    payload.append("\"availability_topic\": \"").append(maintopic).append("/" LWT_TOPIC "\",");
+    payload.append("\"payload_available\": \"" LWT_CONNECTED "\",");
+    payload.append("\"payload_not_available\": \"" LWT_DISCONNECTED "\",");
 
     // Device info: Always use maintopic for identifiers and name to ensure all sensors
     // (including external ones with custom MQTT topics) are grouped under the parent device
-    payload += string("\"device\": {")  +
-        "\"identifiers\": [\"" + maintopic + "\"],"  +
-        "\"name\": \"" + maintopic + "\","  +
-        "\"model\": \"Meter Digitizer\","  +
-        "\"manufacturer\": \"AI on the Edge Device\","  +
-      "\"sw_version\": \"" + version + "\","  +
-      "\"configuration_url\": \"http://" + *getIPAddress() + "\""  +
-    "}"  +
-    "}";
-
-    return MQTTPublish(topicFull, payload, qos, true);
+    payload.append("\"device\": {");
+    payload.append(  "\"identifiers\": [\"").append(maintopic).append("\"],");
+    payload.append(  "\"name\": \"").append(maintopic).append("\",");
+    payload.append(  "\"model\": \"Meter Digitizer\",");
+    payload.append(  "\"manufacturer\": \"AI on the Edge Device\",");
+    payload.append(  "\"sw_version\": \"").append(version).append("\",");
+    payload.append(  "\"configuration_url\": \"http://").append(*getIPAddress()).append("\"");
+    payload.append("}}");
+
+    // Unchanged and already published -> HA has it (retained on the broker)
+    if (discoveryRegistry.isUnchanged(topicFull, payload, 0)) {
+        return true;
+    }
+
+    if (!MQTTPublish(topicFull, payload, qos, true)) {
+        discoveryIncomplete = true;
+        return false;
+    }
+
+    discoveryRegistry.published(topicFull, payload, 0);
+    return true;
 }
 
 bool MQTThomeassistantDiscovery(int qos) {  
@@ -226,8 +258,14 @@ bool MQTThomeassistantDiscovery(int qos) {
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(flowReferencesLock);
+
     LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Publishing Homeassistant Discovery topics (Meter Type: '" + meterType + "', Value Unit: '" + valueUnit + "' , Rate Unit: '" + rateUnit + "') ...");
 
+    uint32_t publishedBefore = discoveryRegistry.getSent();
+    uint32_t unchangedBefore = discoveryRegistry.getSuppressed();
+    discoveryIncomplete = false;
+
 	int aFreeInternalHeapSizeBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
 
     //                                                   Group | Field            | User Friendly Name | Icon                      | Unit | Device Class     | State Class  | Entity Category
@@ -244,7 +282,7 @@ bool MQTThomeassistantDiscovery(int qos) {
     allSendsSuccessed |= sendHomeAssistantDiscoveryTopic("",     "flowstart",       "Manual Flow Start", "timer-play-outline",        "",    "",               "",            "",           qos);
 
 
-    for (int i = 0; i < (*NUMBERS).size(); ++i) {
+    for (int i = 0; (NUMBERS != NULL) && (i < (*NUMBERS).size()); ++i) {
         std::string group = (*NUMBERS)[i]->name;
         if (group == "default") {
             group = "";
@@ -340,7 +378,9 @@ bool MQTThomeassistantDiscovery(int qos) {
         }
     }
 
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Successfully published all Homeassistant Discovery MQTT topics");
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Homeassistant Discovery: " + std::to_string(discoveryRegistry.getSent() - publishedBefore) +
+            " config(s) published, " + std::to_string(discoveryRegistry.getSuppressed() - unchangedBefore) + " unchanged" +
+            (discoveryIncomplete ? ", some failed and get retried in the next round" : ""));
 
     int aFreeInternalHeapSizeAfter = heap_caps_get_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
     int aMinFreeInternalHeapSize =  heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
@@ -393,6 +433,46 @@ bool publishSystemData(int qos) {
 }
 
 
+/* Latest readings of the external sensors, one entry per physical sensor like SensorManager::getJSON() */
+void mqttServer_addSensorsToBatch(MQTTBatchPayload &_payload) {
+    std::lock_guard<std::mutex> lock(flowReferencesLock);
+
+    if (!sensorManager || !sensorManager->isEnabled() || sensorManager->getSensors().empty()) {
+        return;
+    }
+
+    _payload.key("sensors");
+    _payload.beginArray();
+
+    for (const auto& sensor : sensorManager->getSensors()) {
+        if (sensor->getName() == "SHT3x") {
+            auto* sht3x = static_cast<SensorSHT3x*>(sensor.get());
+
+            _payload.beginMap();
+            _payload.key("name");           _payload.addString("SHT3x");
+            _payload.key("temperature");    _payload.addFloat(sht3x->getTemperature());
+            _payload.key("humidity");       _payload.addFloat(sht3x->getHumidity());
+            _payload.key("last_read");      _payload.addInt(sensor->getLastReadTime());
+            _payload.endMap();
+        }
+        else if (sensor->getName() == "DS18B20") {
+            auto* ds18b20 = static_cast<SensorDS18B20*>(sensor.get());
+
+            for (int i = 0; i < ds18b20->getSensorCount(); i++) {
+                _payload.beginMap();
+                _payload.key("name");           _payload.addString("DS18B20");
+                _payload.key("id");             _payload.addString(ds18b20->getRomId(i));
+                _payload.key("temperature");    _payload.addFloat(ds18b20->getTemperature(i));
+                _payload.key("last_read");      _payload.addInt(sensor->getLastReadTime());
+                _payload.endMap();
+            }
+        }
+    }
+
+    _payload.endArray();
+}
+
+
 bool publishStaticData(int qos) {
     bool allSendsSuccessed = false;
 
@@ -428,6 +508,8 @@ bool publishStaticData(int qos) {
 
 
 esp_err_t scheduleSendingDiscovery_and_static_Topics(httpd_req_t *req) {
+    discoveryRegistry.clear();      // Explicitly requested -> all configs, even the unchanged ones
+    MQTTresetPublishCache();
     sendingOf_DiscoveryAndStaticTopics_scheduled = true;
     char msg[] = "MQTT Homeassistant Discovery and Static Topics scheduled";
     httpd_resp_send(req, msg, strlen(msg));  
@@ -450,7 +532,8 @@ esp_err_t sendDiscovery_and_static_Topics(void) {
     success |= publishStaticData(1);
 
     if (success) { // Success, clear the flag
-        sendingOf_DiscoveryAndStaticTopics_scheduled = false;
+        // Retry the discovery configs which failed, the ones which got published are skipped by the registry
+        sendingOf_DiscoveryAndStaticTopics_scheduled = (HomeassistantDiscovery && discoveryIncomplete);
         return ESP_OK;
     }
     else {
@@ -481,8 +564,27 @@ std::string getTimeUnit(void) {
 }
 
 
+/* Home Assistant publishes "online" to its status topic when it (re)started, it then needs all
+ * discovery configs again. See https://www.home-assistant.io/integrations/mqtt/#birth-and-last-will-messages */
+bool mqtt_handler_homeassistant_status(std::string topic, char* data, int data_len) {
+    if ((data_len == 6) && (strncmp(data, "online", 6) == 0)) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Homeassistant is online, scheduling Discovery");
+        discoveryRegistry.clear();
+        MQTTresetPublishCache();
+        sendingOf_DiscoveryAndStaticTopics_scheduled = true;
+    }
+    return true;
+}
+
+
 void SetHomeassistantDiscoveryEnabled(bool enabled) {
     HomeassistantDiscovery = enabled;
+
+    if (enabled) {
+        MQTTregisterConnectFunction("ha-discovery", []() {
+            MQTTregisterSubscribeFunction(MQTT_DISCOVERY_STATUS_TOPIC, mqtt_handler_homeassistant_status);
+        });
+    }
 }
 
 
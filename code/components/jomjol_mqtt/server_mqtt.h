@@ -6,6 +6,7 @@
 #define SERVERMQTT_H
 
 #include "ClassFlowDefineTypes.h"
+#include "mqtt_batch_payload.h"
 
 // Forward declaration
 class SensorManager;
@@ -13,6 +14,7 @@ class SensorManager;
 void SetHomeassistantDiscoveryEnabled(bool enabled);
 void mqttServer_setParameter(std::vector<NumberPost*>* _NUMBERS, int interval, float roundInterval);
 void mqttServer_setSensorManager(SensorManager* sensorManager);
+void mqttServer_clearFlowReferences(void);      // Before the flow steps get deleted
 void mqttServer_setMeterType(std::string meterType, std::string valueUnit, std::string timeUnit,std::string rateUnit);
 void setMqtt_Server_Retain(bool SetRetainFlag);
 void mqttServer_setMainTopic( std::string maintopic);
@@ -24,6 +26,7 @@ std::string mqttServer_getMainTopic();
 void register_server_mqtt_uri(httpd_handle_t server);
 
 bool publishSystemData(int qos);
+void mqttServer_addSensorsToBatch(MQTTBatchPayload &_payload);
 
 std::string getTimeUnit(void);
 void GotConnected(std::string maintopic, bool SetRetainFlag);
@@ -0,0 +1,207 @@
+#include "ds18b20_bus_reader.h"
+
+// DS18B20 commands
+#define DS18B20_CMD_SKIP_ROM        0xCC
+#define DS18B20_CMD_MATCH_ROM       0x55
+#define DS18B20_CMD_CONVERT_T       0x44
+#define DS18B20_CMD_READ_SCRATCHPAD 0xBE
+
+uint8_t ds18b20_crc8(const uint8_t* data, int len)
+{
+    uint8_t crc = 0;
+    for (int i = 0; i < len; i++) {
+        uint8_t inByte = data[i];
+        for (int j = 0; j < 8; j++) {
+            uint8_t mix = (crc ^ inByte) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8C;
+            }
+            inByte >>= 1;
+        }
+    }
+    return crc;
+}
+
+int DS18B20BusReader::read(const std::vector<DS18B20RomId>& romIds, std::vector<float>& temperatures,
+                           std::vector<bool>& valid, bool parallel)
+{
+    for (int wait = start(romIds, parallel); wait != DONE; wait = step()) {
+        if (wait > 0) {
+            _bus.delayMs(wait);
+        }
+    }
+    return getResult(temperatures, valid);
+}
+
+int DS18B20BusReader::start(const std::vector<DS18B20RomId>& romIds, bool parallel)
+{
+    _stats = DS18B20ReadStats();
+    _romIds = romIds;
+    _temperatures.assign(romIds.size(), 0.0f);
+    _valid.assign(romIds.size(), false);
+    _parallel = parallel;
+    _sensor = 0;
+    _attempt = 0;
+    _readCount = 0;
+
+    if (_romIds.empty()) {
+        return finish();
+    }
+
+    _phase = CONVERT;
+    return step();
+}
+
+int DS18B20BusReader::step()
+{
+    switch (_phase) {
+        case CONVERT:
+            if (!startConversion(_parallel ? nullptr : &_romIds[_sensor])) {
+                return retry(CONVERT);
+            }
+            _waitedMs = 0;
+            _phase = WAIT_CONVERSION;
+            return POLL_INTERVAL_MS;
+
+        case WAIT_CONVERSION:
+            // After Skip ROM all sensors answer the read slot, the bus stays low until the slowest one is done
+            _waitedMs += POLL_INTERVAL_MS;
+            if (_bus.readBit()) {
+                _stats.conversionWaitMs += _waitedMs;
+                _phase = READ_SCRATCHPADS;
+                return SETTLE_MS;
+            }
+            if (_waitedMs >= CONVERSION_TIMEOUT_MS) {
+                _stats.conversionWaitMs += _waitedMs;
+                return retry(CONVERT);
+            }
+            return POLL_INTERVAL_MS;
+
+        case READ_SCRATCHPADS:
+            if (!_parallel) {
+                return readSensor(_sensor) ? nextSensor() : retry(READ_SCRATCHPADS);
+            }
+
+            for (size_t i = 0; i < _romIds.size(); i++) {
+                if (!_valid[i]) {
+                    readSensor(i);
+                }
+            }
+            if (_readCount == (int)_romIds.size()) {
+                return finish();
+            }
+            // The scratchpads keep the converted value, only a failed conversion is repeated
+            return retry(READ_SCRATCHPADS);
+
+        default:
+            return DONE;
+    }
+}
+
+int DS18B20BusReader::getResult(std::vector<float>& temperatures, std::vector<bool>& valid) const
+{
+    temperatures.resize(_romIds.size(), 0.0f);
+    valid = _valid;
+    for (size_t i = 0; i < _romIds.size(); i++) {
+        if (_valid[i]) {
+            temperatures[i] = _temperatures[i];
+        }
+    }
+    return _readCount;
+}
+
+int DS18B20BusReader::retry(Phase phase)
+{
+    _attempt++;
+    if (_attempt >= MAX_ATTEMPTS) {
+        return _parallel ? finish() : nextSensor();
+    }
+
+    _phase = phase;
+    return backoffMs(_attempt - 1);
+}
+
+int DS18B20BusReader::nextSensor()
+{
+    _sensor++;
+    _attempt = 0;
+    if (_sensor >= _romIds.size()) {
+        return finish();
+    }
+
+    _phase = CONVERT;
+    return 0;
+}
+
+int DS18B20BusReader::finish()
+{
+    _phase = FINISHED;
+    return DONE;
+}
+
+bool DS18B20BusReader::readSensor(size_t index)
+{
+    if (!readScratchpad(_romIds[index], _temperatures[index])) {
+        return false;
+    }
+    _valid[index] = true;
+    _readCount++;
+    return true;
+}
+
+void DS18B20BusReader::selectRom(const DS18B20RomId& romId)
+{
+    _bus.writeByte(DS18B20_CMD_MATCH_ROM);
+    for (int i = 0; i < 8; i++) {
+        _bus.writeByte(romId[i]);
+    }
+}
+
+bool DS18B20BusReader::startConversion(const DS18B20RomId* romId)
+{
+    if (!_bus.reset()) {
+        return false;
+    }
+
+    if (romId) {
+        selectRom(*romId);
+    } else {
+        _bus.writeByte(DS18B20_CMD_SKIP_ROM);
+    }
+    _bus.writeByte(DS18B20_CMD_CONVERT_T);
+    _stats.conversions++;
+    return true;
+}
+
+bool DS18B20BusReader::readScratchpad(const DS18B20RomId& romId, float& temperature)
+{
+    if (!_bus.reset()) {
+        return false;
+    }
+
+    // Small delays for bus stabilization, they made the reads more reliable
+    _bus.delayMs(1);
+    selectRom(romId);
+    _bus.delayMs(1);
+
+    _bus.writeByte(DS18B20_CMD_READ_SCRATCHPAD);
+
+    uint8_t data[9];
+    bool allZero = true;
+    for (int i = 0; i < 9; i++) {
+        data[i] = _bus.readByte();
+        allZero = allZero && (data[i] == 0);
+    }
+    _stats.scratchpadReads++;
+
+    // A bus which is stuck low reads as zeros, which would pass the CRC
+    if (allZero || (ds18b20_crc8(data, 8) != data[8])) {
+        _stats.crcErrors++;
+        return false;
+    }
+
+    int16_t rawTemp = (data[1] << 8) | data[0];
+    temperature = (float)rawTemp / 16.0f;
+    return true;
+}
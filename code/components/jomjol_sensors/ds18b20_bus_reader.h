@@ -0,0 +1,116 @@
+#pragma once
+
+#ifndef DS18B20_BUS_READER_H
+#define DS18B20_BUS_READER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "onewire_bus.h"
+
+typedef std::array<uint8_t, 8> DS18B20RomId;
+
+/**
+ * @brief Statistics of one DS18B20BusReader::read() call, for logging and tests
+ */
+struct DS18B20ReadStats {
+    int conversions = 0;        // Convert T commands sent (one per bus in parallel mode)
+    int scratchpadReads = 0;
+    int crcErrors = 0;
+    int conversionWaitMs = 0;   // Time spent waiting for conversions
+};
+
+/**
+ * @brief Reads the temperature of all DS18B20 on one bus
+ *
+ * Parallel mode (default):
+ * - One Skip ROM + Convert T starts the conversion on all sensors at once
+ * - The bus is polled until the slowest sensor is done (max. 750ms at 12 bit)
+ * - Each scratchpad is read with Match ROM
+ * - Retries only re-read the scratchpads of the sensors which failed (CRC), the converted
+ *   value stays in the scratchpad. A new conversion is only started if the last one failed.
+ * So N sensors take one conversion time instead of N.
+ *
+ * Sequential mode converts and reads one sensor after the other, e.g. for parasite powered
+ * sensors where the pull-up can not supply all of them converting at the same time.
+ *
+ * The read is a state machine: start() and step() return the time until the next step, so the
+ * sensor scheduler can serve other sensors during the conversion. read() runs it blocking.
+ */
+class DS18B20BusReader {
+public:
+    static constexpr int MAX_ATTEMPTS = 5;
+    static constexpr int CONVERSION_TIMEOUT_MS = 1000;     // 750ms at 12 bit + margin
+    static constexpr int POLL_INTERVAL_MS = 10;
+    static constexpr int SETTLE_MS = 3;                    // After the conversion, reduces CRC errors
+    static constexpr int DONE = -1;
+
+    explicit DS18B20BusReader(OneWireBus& bus) : _bus(bus) {}
+
+    /**
+     * @brief Read all sensors
+     * @param romIds ROM IDs of the sensors (from the ROM search)
+     * @param temperatures Updated for every sensor which could be read (same index as romIds)
+     * @param valid Set to true for every sensor which could be read
+     * @param parallel Convert all sensors at once (Skip ROM) instead of one after the other
+     * @return Number of sensors read successfully
+     */
+    int read(const std::vector<DS18B20RomId>& romIds, std::vector<float>& temperatures,
+             std::vector<bool>& valid, bool parallel = true);
+
+    /**
+     * @brief Start a non-blocking read, same parameters as read()
+     * @return Milliseconds until step() has to be called, DONE if the read is finished
+     */
+    int start(const std::vector<DS18B20RomId>& romIds, bool parallel = true);
+
+    /**
+     * @brief Continue the read started with start()
+     * @return Milliseconds until the next step(), DONE if the read is finished
+     */
+    int step();
+
+    /**
+     * @brief Result of the finished read, see read()
+     * @return Number of sensors read successfully
+     */
+    int getResult(std::vector<float>& temperatures, std::vector<bool>& valid) const;
+
+    const DS18B20ReadStats& getStats() const { return _stats; }
+
+private:
+    enum Phase { CONVERT, WAIT_CONVERSION, READ_SCRATCHPADS, FINISHED };
+
+    OneWireBus& _bus;
+    DS18B20ReadStats _stats;
+
+    std::vector<DS18B20RomId> _romIds;
+    std::vector<float> _temperatures;
+    std::vector<bool> _valid;
+    bool _parallel = true;
+    Phase _phase = FINISHED;
+    size_t _sensor = 0;         // Sequential mode: sensor in progress
+    int _attempt = 0;
+    int _waitedMs = 0;          // Time waited for the running conversion
+    int _readCount = 0;
+
+    int retry(Phase phase);
+    int nextSensor();
+    int finish();
+    bool readSensor(size_t index);
+
+    bool startConversion(const DS18B20RomId* romId);   // nullptr = all sensors (Skip ROM)
+    bool readScratchpad(const DS18B20RomId& romId, float& temperature);
+    void selectRom(const DS18B20RomId& romId);
+
+    static int backoffMs(int attempt) { return 50 + attempt * 50; }
+};
+
+/**
+ * @brief Dallas/Maxim CRC8 of ROM IDs and scratchpads
+ */
+uint8_t ds18b20_crc8(const uint8_t* data, int len);
+
+#endif // DS18B20_BUS_READER_H
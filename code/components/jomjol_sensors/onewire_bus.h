@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef ONEWIRE_BUS_H
+#define ONEWIRE_BUS_H
+
+#include <cstdint>
+
+/**
+ * @brief Byte level access to a 1-Wire bus
+ *
+ * The DS18B20 read sequence (DS18B20BusReader) only talks to this interface, so its timing
+ * can be checked against a simulated bus on the host. On the device it is the bit-banged GPIO.
+ */
+class OneWireBus {
+public:
+    virtual ~OneWireBus() {}
+
+    /**
+     * @brief Reset pulse
+     * @return true if at least one device answered with a presence pulse
+     */
+    virtual bool reset() = 0;
+
+    virtual void writeByte(uint8_t byte) = 0;
+    virtual uint8_t readByte() = 0;
+
+    /**
+     * @brief Single read time slot, a DS18B20 answers 0 while it is converting
+     */
+    virtual int readBit() = 0;
+
+    /**
+     * @brief Waits without blocking other tasks
+     */
+    virtual void delayMs(int ms) = 0;
+};
+
+#endif // ONEWIRE_BUS_H
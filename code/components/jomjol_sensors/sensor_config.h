@@ -12,6 +12,7 @@
 struct SensorConfig {
     bool enable = false;
     int interval = -1;  // -1 = follow flow (default), >0 = custom interval in seconds
+    int aggregationWindow = 0;  // 0 = publish every reading (default), >0 = publish min/max/mean per window in seconds
     bool mqttEnable = true;
     std::string mqttTopic;
     bool influxEnable = false;
@@ -23,4 +24,5 @@ struct SensorConfig {
     
     // DS18B20 specific parameters
     int expectedSensors = -1;  // -1 = auto-detect (default), >0 = expected sensor count for retry validation
+    bool parallelConversion = true;  // Convert all sensors at once, false = one after the other (parasite power)
 };
@@ -11,7 +11,6 @@
 
 #ifdef ENABLE_INFLUXDB
 #include "interface_influxdb.h"
-extern InfluxDB influxDB;
 #endif
 
 #include "esp_log.h"
@@ -23,12 +22,8 @@ extern InfluxDB influxDB;
 
 static const char *TAG = "DS18B20";
 
-// DS18B20 commands
-#define DS18B20_CMD_SKIP_ROM        0xCC
-#define DS18B20_CMD_CONVERT_T       0x44
-#define DS18B20_CMD_READ_SCRATCHPAD 0xBE
+// DS18B20 commands (reading: see ds18b20_bus_reader.cpp)
 #define DS18B20_CMD_SEARCH_ROM      0xF0
-#define DS18B20_CMD_MATCH_ROM       0x55
 
 SensorDS18B20::SensorDS18B20(gpio_num_t gpio,
                              const std::string& mqttTopic,
@@ -36,8 +31,10 @@ SensorDS18B20::SensorDS18B20(gpio_num_t gpio,
                              int interval,
                              bool mqttEnabled,
                              bool influxEnabled,
-                             int expectedSensors)
-    : _gpio(gpio), _initialized(false), _readTaskHandle(nullptr), _readSuccess(false), _expectedSensors(expectedSensors)
+                             int expectedSensors,
+                             bool parallelConversion)
+    : _gpio(gpio), _initialized(false), _expectedSensors(expectedSensors),
+      _parallelConversion(parallelConversion), _readStartTicks(0)
 {
     _mqttTopic = mqttTopic;
     _influxMeasurement = influxMeasurement;
@@ -49,12 +46,6 @@ SensorDS18B20::SensorDS18B20(gpio_num_t gpio,
 
 SensorDS18B20::~SensorDS18B20()
 {
-    // Stop background task if running
-    if (_readTaskHandle != nullptr) {
-        vTaskDelete(_readTaskHandle);
-        _readTaskHandle = nullptr;
-    }
-    
     if (_initialized) {
         gpio_reset_pin(_gpio);
     }
@@ -149,21 +140,26 @@ static uint8_t ow_read_byte(gpio_num_t gpio)
     return byte;
 }
 
+/**
+ * @brief Bit-banged 1-Wire bus on the GPIO of the sensor
+ */
+class GpioOneWireBus : public OneWireBus {
+public:
+    explicit GpioOneWireBus(gpio_num_t gpio) : _gpio(gpio) {}
+
+    bool reset() override { return ow_reset(_gpio); }
+    void writeByte(uint8_t byte) override { ow_write_byte(_gpio, byte); }
+    uint8_t readByte() override { return ow_read_byte(_gpio); }
+    int readBit() override { return ow_read_bit(_gpio); }
+    void delayMs(int ms) override { vTaskDelay(pdMS_TO_TICKS(ms)); }
+
+private:
+    gpio_num_t _gpio;
+};
+
 uint8_t SensorDS18B20::calculateCRC8(const uint8_t* data, int len)
 {
-    uint8_t crc = 0;
-    for (int i = 0; i < len; i++) {
-        uint8_t inByte = data[i];
-        for (int j = 0; j < 8; j++) {
-            uint8_t mix = (crc ^ inByte) & 0x01;
-            crc >>= 1;
-            if (mix) {
-                crc ^= 0x8C;
-            }
-            inByte >>= 1;
-        }
-    }
-    return crc;
+    return ds18b20_crc8(data, len);
 }
 
 int SensorDS18B20::performRomSearch(std::vector<std::array<uint8_t, 8>>& romIds)
@@ -284,101 +280,6 @@ int SensorDS18B20::performRomSearch(std::vector<std::array<uint8_t, 8>>& romIds)
     return romIds.size();
 }
 
-bool SensorDS18B20::startConversion(size_t sensorIndex)
-{
-    if (sensorIndex >= _romIds.size()) {
-        return false;
-    }
-    
-    // Reset and check presence
-    if (!ow_reset(_gpio)) {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "No presence pulse for sensor #" + std::to_string(sensorIndex + 1));
-        return false;
-    }
-    
-    // Match ROM - address specific sensor
-    ow_write_byte(_gpio, DS18B20_CMD_MATCH_ROM);
-    
-    // Send the ROM ID
-    for (int i = 0; i < 8; i++) {
-        ow_write_byte(_gpio, _romIds[sensorIndex][i]);
-    }
-    
-    // Start temperature conversion
-    ow_write_byte(_gpio, DS18B20_CMD_CONVERT_T);
-    
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Started conversion for sensor #" + std::to_string(sensorIndex + 1));
-    
-    return true;
-}
-
-bool SensorDS18B20::isConversionComplete(size_t sensorIndex)
-{
-    if (sensorIndex >= _romIds.size()) {
-        return false;
-    }
-    
-    // Check if conversion is complete by reading the bus
-    // DS18B20 pulls line low during conversion, releases when done
-    return ow_read(_gpio);
-}
-
-bool SensorDS18B20::readScratchpad(size_t sensorIndex)
-{
-    if (sensorIndex >= _romIds.size()) {
-        return false;
-    }
-    
-    // Reset and check presence
-    if (!ow_reset(_gpio)) {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "No presence pulse when reading sensor #" + std::to_string(sensorIndex + 1));
-        return false;
-    }
-    
-    // Small delay after reset for bus stabilization
-    vTaskDelay(pdMS_TO_TICKS(1));
-    
-    // Match ROM again
-    ow_write_byte(_gpio, DS18B20_CMD_MATCH_ROM);
-    
-    // Send the ROM ID again
-    for (int i = 0; i < 8; i++) {
-        ow_write_byte(_gpio, _romIds[sensorIndex][i]);
-    }
-    
-    // Small delay before read command for better reliability
-    vTaskDelay(pdMS_TO_TICKS(1));
-    
-    // Read scratchpad
-    ow_write_byte(_gpio, DS18B20_CMD_READ_SCRATCHPAD);
-    
-    // Read 9 bytes
-    uint8_t data[9];
-    for (int i = 0; i < 9; i++) {
-        data[i] = ow_read_byte(_gpio);
-    }
-    
-    // Verify CRC
-    if (calculateCRC8(data, 8) != data[8]) {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "CRC mismatch for sensor #" + std::to_string(sensorIndex + 1) + 
-                            " (expected: 0x" + std::to_string(calculateCRC8(data, 8)) + 
-                            ", got: 0x" + std::to_string(data[8]) + ")");
-        return false;
-    }
-    
-    // Convert temperature
-    int16_t rawTemp = (data[1] << 8) | data[0];
-    float temp = (float)rawTemp / 16.0f;
-    
-    // Update temperature directly
-    _temperatures[sensorIndex] = temp;
-    
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Sensor #" + std::to_string(sensorIndex + 1) + 
-                        " (" + getRomId(sensorIndex) + "): " + std::to_string(temp) + "°C");
-    
-    return true;
-}
-
 bool SensorDS18B20::init()
 {
     LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Initializing DS18B20 sensor on GPIO" + 
@@ -480,11 +381,14 @@ bool SensorDS18B20::init()
     }
     
     // Read initial temperatures from all sensors
-    _temperatures.clear();
-    _temperatures.resize(_romIds.size(), 0.0f);
-    
-    // Set timestamp for initial read
-    _lastRead = time(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(_valuesLock);
+        _temperatures.clear();
+        _temperatures.resize(_romIds.size(), 0.0f);
+
+        // Set timestamp for initial read
+        _lastRead = time(nullptr);
+    }
     
     LogFile.WriteToFile(ESP_LOG_INFO, TAG, "=== DS18B20 initialization complete ===");
     LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Future reads will use these " + std::to_string(deviceCount) + 
@@ -493,187 +397,81 @@ bool SensorDS18B20::init()
     return true;
 }
 
-void SensorDS18B20::readTaskWrapper(void* pvParameters)
+int SensorDS18B20::startMeasurement()
 {
-    SensorDS18B20* sensor = static_cast<SensorDS18B20*>(pvParameters);
-    sensor->readTask();
+    if (!_initialized) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Cannot read DS18B20: sensor not initialized");
+        return STEP_FAILED;
+    }
+    
+    if (!_reader) {
+        _bus.reset(new GpioOneWireBus(_gpio));
+        _reader.reset(new DS18B20BusReader(*_bus));
+    }
+    
+    // Use tick-based timing instead of time() which returns epoch (1970) on cold boot before NTP sync
+    _readStartTicks = xTaskGetTickCount();
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "DS18B20 read started for " + std::to_string(_romIds.size()) + " sensor(s)");
+    
+    // The conversion runs in the sensors, the scheduler serves other sensors in the meantime
+    int wait = _reader->start(_romIds, _parallelConversion);
+    return (wait == DS18B20BusReader::DONE) ? finishRead() : wait;
 }
 
-void SensorDS18B20::readTask()
+int SensorDS18B20::continueMeasurement()
 {
-    // Use tick-based timing instead of time() which returns epoch (1970) on cold boot before NTP sync
-    TickType_t taskStartTicks = xTaskGetTickCount();
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "DS18B20 background read task started for " + 
-                        std::to_string(_romIds.size()) + " sensor(s)");
-    
-    // Read all sensors with retry logic
-    const int maxRetries = 5;  // Increased from 3 to 5 for better transient error handling
-    bool anySuccess = false;
-    
+    int wait = _reader->step();
+    return (wait == DS18B20BusReader::DONE) ? finishRead() : wait;
+}
+
+int SensorDS18B20::finishRead()
+{
+    std::vector<float> temperatures;
+    std::vector<bool> valid;
+    int readCount = _reader->getResult(temperatures, valid);
+    const DS18B20ReadStats& stats = _reader->getStats();
+    _lastValid = valid;
+
     for (size_t sensorIndex = 0; sensorIndex < _romIds.size(); sensorIndex++) {
-        bool success = false;
-        
-        for (int retry = 0; retry < maxRetries; retry++) {
-            // Start conversion
-            if (!startConversion(sensorIndex)) {
-                if (retry < maxRetries - 1) {
-                    // Exponential backoff: 50ms, 100ms, 150ms, 200ms, 250ms
-                    int delayMs = 50 + (retry * 50);
-                    LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Failed to start conversion for sensor #" + 
-                                        std::to_string(sensorIndex + 1) + ", retry " + std::to_string(retry + 1) + 
-                                        " after " + std::to_string(delayMs) + "ms");
-                    vTaskDelay(pdMS_TO_TICKS(delayMs));
-                    continue;
-                }
-                break;
-            }
-            
-            // Poll for completion - yields to other tasks
-            bool conversionComplete = false;
-            const int maxWaitMs = 1000;
-            const int pollIntervalMs = 10;
-            
-            for (int elapsed = 0; elapsed < maxWaitMs; elapsed += pollIntervalMs) {
-                vTaskDelay(pdMS_TO_TICKS(pollIntervalMs));
-                
-                if (isConversionComplete(sensorIndex)) {
-                    conversionComplete = true;
-                    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Conversion completed for sensor #" + 
-                                        std::to_string(sensorIndex + 1) + " after ~" + std::to_string(elapsed) + "ms");
-                    break;
-                }
-            }
-            
-            if (!conversionComplete) {
-                if (retry < maxRetries - 1) {
-                    int delayMs = 50 + (retry * 50);
-                    LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Conversion timeout for sensor #" + 
-                                        std::to_string(sensorIndex + 1) + ", retry " + std::to_string(retry + 1) + 
-                                        " after " + std::to_string(delayMs) + "ms");
-                    vTaskDelay(pdMS_TO_TICKS(delayMs));
-                    continue;
-                }
-                break;
-            }
-            
-            // Add settling delay after conversion completes to reduce CRC errors
-            // This gives the sensor time to stabilize the data before we read it
-            vTaskDelay(pdMS_TO_TICKS(3));
-            
-            // Read the data
-            if (readScratchpad(sensorIndex)) {
-                success = true;
-                anySuccess = true;
-                break;
-            } else if (retry < maxRetries - 1) {
-                // Exponential backoff on read failures
-                int delayMs = 50 + (retry * 50);
-                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Read failed for sensor #" + 
-                                    std::to_string(sensorIndex + 1) + " (likely CRC error), retry " + 
-                                    std::to_string(retry + 1) + " after " + std::to_string(delayMs) + "ms");
-                vTaskDelay(pdMS_TO_TICKS(delayMs));
+        if (valid[sensorIndex]) {
+            {
+                std::lock_guard<std::mutex> lock(_valuesLock);
+                _temperatures[sensorIndex] = temperatures[sensorIndex];
             }
-        }
-        
-        if (!success) {
+            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Sensor #" + std::to_string(sensorIndex + 1) + 
+                                " (" + getRomId(sensorIndex) + "): " + std::to_string(temperatures[sensorIndex]) + "°C");
+        } else {
             LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to read sensor #" + 
-                                std::to_string(sensorIndex + 1) + " after " + std::to_string(maxRetries) + " attempts");
+                                std::to_string(sensorIndex + 1) + " after " + std::to_string(DS18B20BusReader::MAX_ATTEMPTS) + " attempts");
         }
     }
-    
-    _readSuccess = anySuccess;
-    
-    // Calculate task duration using ticks (works even when time() returns epoch on cold boot)
-    TickType_t taskEndTicks = xTaskGetTickCount();
-    TickType_t taskDurationTicks = taskEndTicks - taskStartTicks;
-    int taskDurationSeconds = taskDurationTicks / configTICK_RATE_HZ;
-    
-    if (anySuccess) {
-        // Update last read time using time(nullptr) for consistency with shouldRead()
-        // Note: On cold boot before NTP, this is seconds since boot, which is fine for interval checking
-        _lastRead = time(nullptr);
-        
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "DS18B20 read completed successfully in " + 
-                            std::to_string(taskDurationSeconds) + "s, publishing data");
-        
-        // Publish data from background task after successful read
-        publishMQTT();
-        publishInfluxDB();
-        
-        // Calculate total time including publishing
-        TickType_t totalTicks = xTaskGetTickCount() - taskStartTicks;
-        int totalSeconds = totalTicks / configTICK_RATE_HZ;
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "DS18B20 async task finished - clearing handle and exiting (total time: " + 
-                            std::to_string(totalSeconds) + "s)");
-    } else {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Background read task failed to read any sensors after " + 
-                            std::to_string(taskDurationSeconds) + "s");
-    }
-    
-    // Clear handle before deleting task to prevent race condition
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "DS18B20 async task setting handle to nullptr (was=" + 
-                        std::to_string((unsigned long)_readTaskHandle) + ")");
-    _readTaskHandle = nullptr;
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "DS18B20 async task calling vTaskDelete(NULL)");
-    vTaskDelete(NULL);
-}
 
-bool SensorDS18B20::readData()
-{
-    if (!_initialized) {
-        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Cannot read DS18B20: sensor not initialized");
-        return false;
-    }
+    // Calculate read duration using ticks (works even when time() returns epoch on cold boot)
+    int durationMs = (xTaskGetTickCount() - _readStartTicks) * portTICK_PERIOD_MS;
     
-    // Check if a read is already in progress
-    // Note: This check is safe because:
-    // 1. Task sets _readTaskHandle to nullptr immediately before vTaskDelete(NULL)
-    // 2. vTaskDelete(NULL) for current task is synchronous - task ends immediately
-    // 3. No window where task is active but handle is nullptr
-    if (_readTaskHandle != nullptr) {
-        // Read still in progress, return false (not complete yet)
-        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "DS18B20 read skipped: previous read task still in progress (handle=" + 
-                            std::to_string((unsigned long)_readTaskHandle) + ")");
-        return false;
-    }
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Read " + std::to_string(readCount) + "/" + std::to_string(_romIds.size()) +
+                        " sensor(s) in " + std::to_string(durationMs) + "ms: " + std::to_string(stats.conversions) +
+                        " conversion(s), waited " + std::to_string(stats.conversionWaitMs) + "ms, " +
+                        std::to_string(stats.scratchpadReads) + " scratchpad read(s), " +
+                        std::to_string(stats.crcErrors) + " CRC error(s)");
     
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "DS18B20 readData() starting - creating async read task");
-    
-    // Note: shouldRead() check is done by SensorManager::update() before calling this
-    // Start a background task to read sensors asynchronously
-    // This task will poll sensors and delete itself when done
-    
-    BaseType_t xReturned = xTaskCreatePinnedToCore(
-        &SensorDS18B20::readTaskWrapper,
-        "ds18b20_read",
-        4096,  // Stack size
-        this,  // Parameter
-        tskIDLE_PRIORITY,  // Priority - low for reading (not critical)
-        &_readTaskHandle,
-        0  // Core 0
-    );
-    
-    if (xReturned != pdPASS) {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to create background read task");
-        _readTaskHandle = nullptr;
-        return false;
+    if (readCount == 0) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "DS18B20 read failed, no sensor could be read");
+        return STEP_FAILED;
     }
     
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "DS18B20 readData() spawned async read task successfully (handle=" + 
-                        std::to_string((unsigned long)_readTaskHandle) + ")");
-    
-    // Return true to indicate read was initiated
-    // The task will complete in background
-    return true;
+    return STEP_DONE;
 }
 
 int SensorDS18B20::getSensorCount() const
 {
+    std::lock_guard<std::mutex> lock(_valuesLock);
     return _temperatures.size();
 }
 
 float SensorDS18B20::getTemperature(int index) const
 {
+    std::lock_guard<std::mutex> lock(_valuesLock);
     if (index >= 0 && index < (int)_temperatures.size()) {
         return _temperatures[index];
     }
@@ -703,6 +501,16 @@ int SensorDS18B20::scanDevices()
     return _romIds.size();
 }
 
+void SensorDS18B20::recordSamples(time_t time)
+{
+    // Only the sensors which could be read, a failed one keeps its old value
+    for (size_t i = 0; i < _temperatures.size() && i < _lastValid.size(); i++) {
+        if (_lastValid[i]) {
+            _history.add(getRomId(i) + "/temperature", time, _temperatures[i]);
+        }
+    }
+}
+
 void SensorDS18B20::publishMQTT()
 {
 #ifdef ENABLE_MQTT
@@ -764,12 +572,13 @@ void SensorDS18B20::publishInfluxDB()
         std::string romIdStr = getRomId(i);
         std::string field = "ds18b20_" + romIdStr + "_temperature";
         
-        influxDB.InfluxDBPublish(_influxMeasurement, 
-                                 field, 
-                                 std::to_string(_temperatures[i]), 
-                                 now);
+        // Sent together with the next round
+        InfluxDBAddSensorPoint(_influxMeasurement, 
+                               field, 
+                               std::to_string(_temperatures[i]), 
+                               now);
         
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Published to InfluxDB: " + field + " = " + 
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Queued for InfluxDB: " + field + " = " + 
                             std::to_string(_temperatures[i]));
     }
 #endif
@@ -4,6 +4,7 @@
 #define SENSOR_DS18B20_H
 
 #include "sensor_manager.h"
+#include "ds18b20_bus_reader.h"
 #include "driver/gpio.h"
 
 /**
@@ -12,9 +13,12 @@
  * Multi-sensor support with ROM search:
  * - ROM search is performed ONCE during init() at startup
  * - All discovered sensor ROM IDs are cached
- * - Each readData() call reads from the cached list of sensors
+ * - Each measurement reads from the cached list of sensors
  * - Hot-plugging sensors after startup is NOT supported
  * - To detect new sensors, device must be restarted
+ *
+ * By default all sensors convert at the same time (see DS18B20BusReader), so a read
+ * takes one conversion time independent of the number of sensors.
  */
 class SensorDS18B20 : public SensorBase {
 public:
@@ -27,6 +31,7 @@ public:
      * @param mqttEnabled Enable MQTT publishing
      * @param influxEnabled Enable InfluxDB publishing
      * @param expectedSensors Expected number of sensors (-1 = auto-detect, >0 = expected count for validation)
+     * @param parallelConversion Convert all sensors at once (Skip ROM) instead of one after the other
      */
     SensorDS18B20(gpio_num_t gpio,
                   const std::string& mqttTopic,
@@ -34,12 +39,14 @@ public:
                   int interval,
                   bool mqttEnabled,
                   bool influxEnabled,
-                  int expectedSensors = -1);
+                  int expectedSensors = -1,
+                  bool parallelConversion = true);
     
     virtual ~SensorDS18B20();
     
     bool init() override;
-    bool readData() override;
+    int startMeasurement() override;
+    int continueMeasurement() override;
     void publishMQTT() override;
     void publishInfluxDB() override;
     std::string getName() override { return "DS18B20"; }
@@ -63,26 +70,26 @@ public:
      */
     std::string getRomId(int index = 0) const;
     
-    /**
-     * @brief Check if a read operation is currently in progress
-     * @return true if reading
-     */
-    bool isReadInProgress() const override { return _readTaskHandle != nullptr; }
+protected:
+    void recordSamples(time_t time) override;
     
 private:
     std::vector<float> _temperatures;
     std::vector<std::array<uint8_t, 8>> _romIds; // Store ROM IDs for each sensor
     gpio_num_t _gpio;
     bool _initialized;
-    TaskHandle_t _readTaskHandle;  // Handle for background read task
-    bool _readSuccess;  // Result of background read
     int _expectedSensors;  // Expected number of sensors (-1 = auto-detect)
+    bool _parallelConversion;  // One Convert T for all sensors on the bus
+    std::unique_ptr<OneWireBus> _bus;
+    std::unique_ptr<DS18B20BusReader> _reader;  // State of the running read
+    std::vector<bool> _lastValid;  // Sensors read successfully by the last read
+    TickType_t _readStartTicks;
     
     /**
-     * @brief Background task that polls sensors until conversion complete
+     * @brief Take over the result of the finished read
+     * @return STEP_DONE if at least one sensor was read, STEP_FAILED otherwise
      */
-    static void readTaskWrapper(void* pvParameters);
-    void readTask();
+    int finishRead();
     
     /**
      * @brief Scan the 1-Wire bus for DS18B20 devices using ROM search
@@ -90,27 +97,6 @@ private:
      */
     int scanDevices();
     
-    /**
-     * @brief Start temperature conversion for a sensor (non-blocking)
-     * @param sensorIndex Index of sensor to start conversion for
-     * @return true if conversion started successfully
-     */
-    bool startConversion(size_t sensorIndex);
-    
-    /**
-     * @brief Check if conversion is complete (non-blocking check only)
-     * @param sensorIndex Index of sensor to check
-     * @return true if conversion is complete
-     */
-    bool isConversionComplete(size_t sensorIndex);
-    
-    /**
-     * @brief Read scratchpad from sensor
-     * @param sensorIndex Index of sensor to read from
-     * @return true if read was successful
-     */
-    bool readScratchpad(size_t sensorIndex);
-    
     /**
      * @brief Perform 1-Wire ROM search to find all devices on the bus
      * @param romIds Vector to store found ROM IDs
@@ -0,0 +1,114 @@
+#include "sensor_history.h"
+
+void SensorHistory::setWindow(int seconds)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _windowSeconds = (seconds > 0) ? seconds : 0;
+}
+
+SensorHistory::Series& SensorHistory::getSeries(const std::string& name)
+{
+    for (Series& series : _series) {
+        if (series.name == name) {
+            return series;
+        }
+    }
+
+    _series.push_back(Series());
+    _series.back().name = name;
+    _series.back().aggregate.name = name;
+    _series.back().samples.reserve(_capacity);
+    return _series.back();
+}
+
+void SensorHistory::add(const std::string& name, time_t time, float value)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Series& series = getSeries(name);
+
+    SensorSample sample = {(uint32_t)time, value};
+    if (series.samples.size() < _capacity) {
+        series.samples.push_back(sample);
+    } else if (_capacity > 0) {
+        series.samples[series.next] = sample;
+        series.next = (series.next + 1) % _capacity;
+    }
+
+    SensorAggregate& aggregate = series.aggregate;
+    if (aggregate.count == 0) {
+        aggregate.min = value;
+        aggregate.max = value;
+    } else {
+        aggregate.min = (value < aggregate.min) ? value : aggregate.min;
+        aggregate.max = (value > aggregate.max) ? value : aggregate.max;
+    }
+    aggregate.count++;
+    aggregate.sum += value;
+    aggregate.last = value;
+
+    if (!_windowOpen) {
+        _windowOpen = true;
+        _windowStart = time;
+    }
+}
+
+bool SensorHistory::isWindowComplete(time_t now) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_windowSeconds <= 0 || !_windowOpen) {
+        return false;
+    }
+    return (now - _windowStart >= _windowSeconds) || (now < _windowStart);
+}
+
+SensorWindow SensorHistory::takeWindow(time_t now)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    SensorWindow window;
+    window.start = _windowStart;
+    window.end = now;
+
+    for (Series& series : _series) {
+        if (series.aggregate.count > 0) {
+            window.series.push_back(series.aggregate);
+        }
+        series.aggregate = SensorAggregate();
+        series.aggregate.name = series.name;
+    }
+
+    _windowOpen = false;
+    return window;
+}
+
+std::vector<std::string> SensorHistory::getSeriesNames() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::string> names;
+    for (const Series& series : _series) {
+        names.push_back(series.name);
+    }
+    return names;
+}
+
+std::vector<SensorSample> SensorHistory::getSamples(const std::string& name, time_t since) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<SensorSample> result;
+
+    for (const Series& series : _series) {
+        if (series.name != name) {
+            continue;
+        }
+
+        // Once the ring is full, the oldest sample is the one which gets overwritten next
+        size_t count = series.samples.size();
+        size_t oldest = (count < _capacity) ? 0 : series.next;
+        for (size_t i = 0; i < count; i++) {
+            const SensorSample& sample = series.samples[(oldest + i) % count];
+            if ((time_t)sample.time >= since) {
+                result.push_back(sample);
+            }
+        }
+    }
+    return result;
+}
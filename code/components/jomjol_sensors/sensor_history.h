@@ -0,0 +1,110 @@
+#pragma once
+
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One reading of a sensor value
+ */
+struct SensorSample {
+    uint32_t time;      // Unix timestamp (seconds since boot before NTP sync)
+    float value;
+};
+
+/**
+ * @brief Summary of the readings of one value within an aggregation window
+ */
+struct SensorAggregate {
+    std::string name;
+    int count = 0;
+    float min = 0.0f;
+    float max = 0.0f;
+    float last = 0.0f;
+    double sum = 0.0;
+
+    float getMean() const { return (count > 0) ? (float)(sum / count) : 0.0f; }
+};
+
+/**
+ * @brief Aggregates of all values of a sensor for one window
+ */
+struct SensorWindow {
+    time_t start = 0;
+    time_t end = 0;
+    std::vector<SensorAggregate> series;
+};
+
+/**
+ * @brief Recent readings of a sensor, one fixed-size ring buffer per value (series)
+ *
+ * A series is e.g. "temperature" and "humidity" of the SHT3x, or "<ROM ID>/temperature" of
+ * each DS18B20 on the bus. Besides the raw samples (for the /sensors?history= endpoint) every
+ * series keeps count/min/max/mean/last of the current aggregation window, so publishing can
+ * send one summary per window instead of every reading.
+ *
+ * Samples are added by the sensor scheduler task and read by the HTTP server, all methods lock.
+ */
+class SensorHistory {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 120;     // Samples per series, e.g. 10 minutes at 5s interval
+
+    explicit SensorHistory(size_t capacity = DEFAULT_CAPACITY) : _capacity(capacity) {}
+
+    /**
+     * @brief Length of the aggregation window
+     * @param seconds 0 = no aggregation, every reading gets published on its own
+     */
+    void setWindow(int seconds);
+    int getWindow() const { return _windowSeconds; }
+
+    /**
+     * @brief Add a reading to the ring buffer and the aggregate of its series
+     */
+    void add(const std::string& series, time_t time, float value);
+
+    /**
+     * @brief Check if the aggregation window is over, call after all values of a reading were added
+     *
+     * The window ends with the first reading at least one window length after its first reading.
+     * A clock which jumps back (NTP sync) also ends the window.
+     */
+    bool isWindowComplete(time_t now) const;
+
+    /**
+     * @brief Return the aggregates of the window and start the next one
+     */
+    SensorWindow takeWindow(time_t now);
+
+    std::vector<std::string> getSeriesNames() const;
+
+    /**
+     * @brief Samples of a series, oldest first
+     * @param since Only samples at or after this time
+     */
+    std::vector<SensorSample> getSamples(const std::string& series, time_t since = 0) const;
+
+private:
+    struct Series {
+        std::string name;
+        std::vector<SensorSample> samples;  // Ring buffer, grows up to _capacity
+        size_t next = 0;                    // Position of the next write once the ring is full
+        SensorAggregate aggregate;
+    };
+
+    size_t _capacity;
+    int _windowSeconds = 0;
+    bool _windowOpen = false;
+    time_t _windowStart = 0;
+    std::vector<Series> _series;
+    mutable std::mutex _mutex;
+
+    Series& getSeries(const std::string& name);
+};
+
+#endif // SENSOR_HISTORY_H
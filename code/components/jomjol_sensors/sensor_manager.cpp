@@ -5,6 +5,17 @@
 #include "ClassLogFile.h"
 #include "Helper.h"
 
+#ifdef ENABLE_MQTT
+#include "interface_mqtt.h"
+#include "server_mqtt.h"
+#include "mqtt_batch_payload.h"
+#endif
+
+#ifdef ENABLE_INFLUXDB
+#include "interface_influxdb.h"
+#endif
+
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
@@ -13,6 +24,7 @@
 #include <cstdint>
 
 #include "driver/i2c.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -84,179 +96,202 @@ bool SensorBase::shouldRead(int flowInterval)
     return (now - _lastRead) >= interval;
 }
 
-void SensorBase::sensorTaskWrapper(void* pvParameters)
+void SensorBase::finishMeasurement(bool success)
 {
-    SensorBase* sensor = static_cast<SensorBase*>(pvParameters);
-    sensor->sensorTask();
-}
-
-void SensorBase::sensorTask()
-{
-    // ============================================================================
-    // PERIODIC TASK FOR SENSOR READING (DS18B20, SHT3x, etc.)
-    // ============================================================================
-    // 
-    // This task runs for sensors with custom intervals (not "follow flow" mode).
-    // 
-    // SCHEDULING LOGIC:
-    //   1. Spawn async read task (returns immediately)
-    //   2. Wait for async task to complete (polls isReadInProgress())
-    //   3. Wait configured interval
-    //   4. Repeat
-    // 
-    // This ensures interval is time BETWEEN reads, not overlapping reads.
-    // Works correctly even if read takes longer than interval.
-    // 
-    // FAILPROOF FEATURES:
-    //   - If readData() fails: skips and retries after interval
-    //   - If async task hangs: timeout after 5 minutes, continue anyway
-    //   - vTaskDelay() always executes: next iteration always scheduled
-    //   - No try-catch: uses return values and timeouts
-    // 
-    // POWER EFFICIENCY:
-    //   - Task at tskIDLE_PRIORITY (lowest)
-    //   - vTaskDelay() yields CPU completely
-    //   - Polling uses 100ms delays (not busy wait)
-    // 
-    // USED BY: DS18B20, SHT3x (both inherit from SensorBase)
-    // ============================================================================
-    
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Periodic task started (interval: " + 
-                        std::to_string(_readInterval) + "s)");
-    
-    // Prevent integer overflow: _readInterval (seconds) * 1000 can overflow for large intervals
-    uint64_t intervalMs = (uint64_t)_readInterval * 1000ULL;
-    const uint64_t maxSafeMs = (uint64_t)UINT32_MAX * 1000ULL / configTICK_RATE_HZ;
-    if (intervalMs > maxSafeMs) {
-        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Interval exceeds maximum, capping to " + 
-                            std::to_string(maxSafeMs / 1000) + "s");
-        intervalMs = maxSafeMs;
+    if (!success) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, getName() + " read failed, will retry with the next interval");
+        return;
     }
-    const TickType_t xDelay = pdMS_TO_TICKS(intervalMs);
     
-    // Initial delay before first read
-    TickType_t initialDelay = xDelay;
-    if (_readInterval > 300) {  // If interval > 5 minutes, use shorter initial delay
-        initialDelay = pdMS_TO_TICKS(30000);
+    // Uses time(nullptr) for consistency with shouldRead()
+    // Note: On cold boot before NTP, this is seconds since boot, which is fine for interval checking
+    {
+        std::lock_guard<std::mutex> lock(_valuesLock);
+        _lastRead = time(nullptr);
     }
+    recordSamples(_lastRead);
     
-    float delaySeconds = (float)initialDelay / (float)configTICK_RATE_HZ;
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Waiting " + std::to_string((int)delaySeconds) + 
-                        "s before first read");
-    
-    // Power-efficient sleep - completely yields CPU
-    vTaskDelay(initialDelay);
+    if (_history.getWindow() <= 0) {
+        publishMQTT();
+        publishInfluxDB();
+        return;
+    }
     
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Starting main loop (interval: " + 
-                        std::to_string(_readInterval) + "s between reads)");
+    if (_history.isWindowComplete(_lastRead)) {
+        publishWindow(_history.takeWindow(_lastRead), toLower(getName()));
+    }
+}
+
+void SensorBase::publishWindow(const SensorWindow& window, const std::string& defaultSubtopic)
+{
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, getName() + ": publishing aggregates of " + 
+                        std::to_string(window.end - window.start) + "s window");
     
-    int iteration = 0;
-    while (true) {
-        iteration++;
+#ifdef ENABLE_MQTT
+    if (_mqttEnabled && getMQTTisConnected()) {
+        std::string baseTopic = _mqttTopic.empty() ? (mqttServer_getMainTopic() + "/" + defaultSubtopic) : _mqttTopic;
         
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Iteration " + std::to_string(iteration));
-        
-        // Trigger async read (spawns separate task, returns immediately)
-        bool readStarted = readData();
-        if (!readStarted) {
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Read busy or failed, will retry after interval");
-            // Even if read failed to start, still wait the interval before retrying
-            vTaskDelay(xDelay);
-            continue;
+        // One message with the summary of all values
+        MQTTBatchPayload payload(MQTT_BATCH_FORMAT_JSON);
+        payload.beginMap();
+        payload.key("window_start");   payload.addInt(window.start);
+        payload.key("window_end");     payload.addInt(window.end);
+        for (const SensorAggregate& aggregate : window.series) {
+            payload.key(aggregate.name);
+            payload.beginMap();
+            payload.key("count");      payload.addInt(aggregate.count);
+            payload.key("min");        payload.addFloat(aggregate.min);
+            payload.key("max");        payload.addFloat(aggregate.max);
+            payload.key("mean");       payload.addFloat(aggregate.getMean());
+            payload.key("last");       payload.addFloat(aggregate.last);
+            payload.endMap();
         }
+        payload.endMap();
+        MQTTPublish(baseTopic + "/aggregate", payload.getData(), 1, true);
         
-        // Wait for async read task to complete before scheduling next iteration
-        // This ensures interval is BETWEEN reads, not overlapping reads
-        // Use polling with delays (power efficient - yields CPU between checks)
-        // Add timeout to prevent infinite wait if async task crashes
-        bool wasWaiting = false;
-        int waitIterations = 0;
-        const int maxWaitIterations = 3000;  // 3000 * 100ms = 5 minutes max wait
-        
-        while (isReadInProgress()) {
-            if (!wasWaiting) {
-                LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Waiting for async read to complete");
-                wasWaiting = true;
-            }
-            
-            // Power-efficient: yield CPU while waiting
-            // Check every 100ms to be responsive but not wasteful
-            vTaskDelay(pdMS_TO_TICKS(100));
+        // Keep the usual topics (Home Assistant Discovery) up to date with the last value
+        for (const SensorAggregate& aggregate : window.series) {
+            MQTTPublish(baseTopic + "/" + aggregate.name, std::to_string(aggregate.last), 1, true);
+        }
+    }
+#endif
+
+#ifdef ENABLE_INFLUXDB
+    if (_influxEnabled) {
+        for (const SensorAggregate& aggregate : window.series) {
+            // Same field names as the single readings, e.g. "ds18b20_<ROM ID>_temperature"
+            std::string field = defaultSubtopic + "_" + aggregate.name;
+            std::replace(field.begin(), field.end(), '/', '_');
             
-            waitIterations++;
-            if (waitIterations >= maxWaitIterations) {
-                // Timeout: async task took too long or crashed
-                // Log error and continue to next iteration to prevent permanent hang
-                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, 
-                    "Timeout waiting for async read (waited " + 
-                    std::to_string(waitIterations / 10) + "s), continuing anyway");
-                break;  // Exit wait loop, proceed to interval delay
-            }
+            InfluxDBAddSensorPoint(_influxMeasurement, field, std::to_string(aggregate.getMean()), window.end);
+            InfluxDBAddSensorPoint(_influxMeasurement, field + "_min", std::to_string(aggregate.min), window.end);
+            InfluxDBAddSensorPoint(_influxMeasurement, field + "_max", std::to_string(aggregate.max), window.end);
+        }
+    }
+#endif
+}
+
+void SensorManager::schedulerTaskWrapper(void* pvParameters)
+{
+    SensorManager* manager = static_cast<SensorManager*>(pvParameters);
+    manager->schedulerTask();
+}
+
+void SensorManager::schedulerTask()
+{
+    // ============================================================================
+    // SENSOR SCHEDULER TASK (DS18B20, SHT3x, etc.)
+    // ============================================================================
+    // 
+    // One task drives all sensors. A sensor read is a state machine
+    // (start -> wait -> read -> publish), every step only takes a few milliseconds
+    // (start a conversion, check if it is done, read the result).
+    // The waiting between the steps is done here, by sleeping until the next step
+    // of any sensor is due or update() requests a read of a "follow flow" sensor.
+    // 
+    // Task at tskIDLE_PRIORITY (lowest), never blocks the main digitalization flow.
+    // ============================================================================
+    
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Sensor scheduler task started");
+    
+    while (!_schedulerStop) {
+        int64_t waitMs = _scheduler.run(esp_timer_get_time() / 1000);
+        if (_schedulerStop) {
+            break;
         }
         
-        if (wasWaiting) {
-            if (waitIterations < maxWaitIterations) {
-                LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, 
-                    "Async read completed after " + std::to_string(waitIterations / 10) + "s");
-            }
+        if (waitMs == SensorScheduler::NOTHING_DUE || waitMs > SCHEDULER_MAX_SLEEP_MS) {
+            waitMs = SCHEDULER_MAX_SLEEP_MS;
         }
         
-        // Now that previous read is complete, wait for the configured interval
-        // This ensures reads happen at interval AFTER completion, not overlapping
-        vTaskDelay(xDelay);
+        // Sleep at least one tick, a step due within the current tick would spin otherwise
+        TickType_t ticks = pdMS_TO_TICKS(waitMs);
+        ulTaskNotifyTake(pdTRUE, (ticks > 0) ? ticks : 1);
     }
+    
+    // Clear handle before deleting task, stopScheduler() waits for it
+    _schedulerTaskHandle = nullptr;
+    vTaskDelete(NULL);
 }
 
-bool SensorBase::startPeriodicTask()
+bool SensorManager::startScheduler()
 {
-    // Only create task for custom intervals
-    // _readInterval = -1 means "follow flow" mode - handled by SensorManager::update()
-    // _readInterval > 0 means custom interval - needs dedicated task
-    if (_readInterval <= 0) {
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Using follow-flow mode, no periodic task");
+    if (_schedulerTaskHandle != nullptr) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Sensor scheduler already running");
         return true;
     }
     
-    if (_taskHandle != nullptr) {
-        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Task already running");
+    if (_sensors.empty()) {
         return true;
     }
     
-    // Create task at IDLE priority to ensure it never blocks main digitalization flow
-    // This is critical for power and CPU efficiency
+    int64_t nowMs = esp_timer_get_time() / 1000;
+    
+    for (auto& sensor : _sensors) {
+        int interval = sensor->getReadInterval();
+        
+        if (interval > 0) {
+            // The interval is the time BETWEEN reads, counted from the end of the last read
+            // If interval > 5 minutes, use shorter initial delay
+            int64_t intervalMs = (int64_t)interval * 1000;
+            int64_t firstDelayMs = (interval > 300) ? 30000 : intervalMs;
+            _scheduler.add(sensor.get(), intervalMs, nowMs + firstDelayMs);
+            
+            LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Sensor " + sensor->getName() + ": read every " + 
+                                std::to_string(interval) + "s, first read in " + std::to_string(firstDelayMs / 1000) + "s");
+        } else {
+            // "Follow flow" mode - reads are requested by update()
+            _scheduler.add(sensor.get(), 0, SensorScheduler::NOTHING_DUE);
+            
+            LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Sensor " + sensor->getName() + " will follow flow interval");
+        }
+    }
+    
+    _schedulerStop = false;
+    
     BaseType_t xReturned = xTaskCreatePinnedToCore(
-        &SensorBase::sensorTaskWrapper,
-        "sensor",              // Short name to save memory
-        4096,                  // Stack size
-        this,                  // Pass sensor object
+        &SensorManager::schedulerTaskWrapper,
+        "sensors",             // Short name to save memory
+        SCHEDULER_STACK_SIZE,
+        this,
         tskIDLE_PRIORITY,      // LOWEST priority - never blocks main flow
-        &_taskHandle,
+        &_schedulerTaskHandle,
         0                      // Core 0
     );
     
     if (xReturned != pdPASS) {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to create periodic task");
-        _taskHandle = nullptr;
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to create sensor scheduler task");
+        _schedulerTaskHandle = nullptr;
+        _scheduler.clear();
         return false;
     }
     
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Created periodic task (interval: " + 
-                        std::to_string(_readInterval) + "s, priority: IDLE)");
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Created sensor scheduler task for " + std::to_string(_sensors.size()) + 
+                        " sensor(s) (priority: IDLE)");
     return true;
 }
 
-void SensorBase::stopPeriodicTask()
+void SensorManager::stopScheduler()
 {
-    if (_taskHandle != nullptr) {
-        TaskHandle_t taskToDelete = _taskHandle;
-        _taskHandle = nullptr;  // Clear atomically to prevent double-delete
+    if (_schedulerTaskHandle != nullptr) {
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Stopping sensor scheduler task");
         
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Stopping periodic task");
-        vTaskDelete(taskToDelete);
+        _schedulerStop = true;
+        xTaskNotifyGive(_schedulerTaskHandle);
         
-        // Small delay to let scheduler cleanup
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // A running step still accesses the sensors, let it finish (max. 1s)
+        for (int i = 0; i < 100 && _schedulerTaskHandle != nullptr; i++) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        
+        if (_schedulerTaskHandle != nullptr) {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Sensor scheduler task did not stop, deleting it");
+            vTaskDelete(_schedulerTaskHandle);
+            _schedulerTaskHandle = nullptr;
+        }
     }
+    
+    _scheduler.clear();
 }
 
 SensorManager::SensorManager() : _enabled(false), _i2cInitialized(false)
@@ -277,26 +312,8 @@ bool SensorManager::init()
     
     LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Initializing sensor manager...");
     
-    bool anySuccess = false;
-    bool anyFailure = false;
-    
-    for (auto& sensor : _sensors) {
-        // Sensors are already initialized in initFromConfig, just start periodic tasks
-        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Starting periodic task for sensor: " + sensor->getName());
-        
-        // Start periodic task for sensors with custom intervals (> 0)
-        if (sensor->getReadInterval() > 0) {
-            if (!sensor->startPeriodicTask()) {
-                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to start periodic task for sensor: " + sensor->getName());
-                anyFailure = true;
-            } else {
-                anySuccess = true;
-            }
-        } else {
-            LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Sensor " + sensor->getName() + " will follow flow interval (no periodic task)");
-            anySuccess = true;
-        }
-    }
+    // Sensors are already initialized in initFromConfig, just start the scheduler
+    bool anyFailure = !startScheduler();
     
     // Log results
     if (_sensors.empty()) {
@@ -306,7 +323,7 @@ bool SensorManager::init()
             LogFile.WriteToFile(ESP_LOG_WARN, TAG, "All configured sensors failed to initialize");
         }
     } else if (anyFailure) {
-        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Some sensors failed to start periodic tasks");
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Sensor scheduler failed to start");
     } else {
         LogFile.WriteToFile(ESP_LOG_INFO, TAG, "All sensors started successfully");
     }
@@ -386,6 +403,7 @@ bool SensorManager::initFromConfig(const std::string& configFile, const std::map
                     config.mqttEnable,
                     config.influxEnable
                 );
+                sensor->setAggregationWindow(config.aggregationWindow);
                 
                 std::stringstream ss;
                 ss << "0x" << std::hex << (int)config.sht3xAddress;
@@ -445,8 +463,10 @@ bool SensorManager::initFromConfig(const std::string& configFile, const std::map
                 config.interval,
                 config.mqttEnable,
                 config.influxEnable,
-                config.expectedSensors
+                config.expectedSensors,
+                config.parallelConversion
             );
+            sensor->setAggregationWindow(config.aggregationWindow);
             
             LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Created DS18B20 sensor (GPIO:" + std::to_string(onewirePin) + 
                                 ", interval:" + (config.interval < 0 ? "follow flow" : std::to_string(config.interval) + "s") + ")");
@@ -486,14 +506,8 @@ bool SensorManager::initFromConfig(const std::string& configFile, const std::map
         }
     }
     
-    // Start periodic tasks for sensors with custom intervals
-    for (auto& sensor : _sensors) {
-        if (sensor->getReadInterval() > 0) {
-            if (!sensor->startPeriodicTask()) {
-                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to start periodic task for sensor: " + sensor->getName());
-            }
-        }
-    }
+    // One scheduler task reads all sensors
+    startScheduler();
     
     // Log summary
     if (_sensors.empty() && _sensorErrors.empty()) {
@@ -518,33 +532,33 @@ void SensorManager::update(int flowInterval)
         return;
     }
     
+    bool readRequested = false;
+    
     for (auto& sensor : _sensors) {
-        // For sensors with custom intervals, their periodic tasks handle reading
+        // Sensors with custom intervals are scheduled by the scheduler itself
         // Only process "follow flow" sensors here (interval = -1)
         if (sensor->getReadInterval() > 0) {
             continue;
         }
         
         // Check if we should start a new read
+        // The read runs in the scheduler task, which publishes the data when complete.
+        // A request for a sensor which is still reading is ignored.
         if (sensor->shouldRead(flowInterval)) {
-            // Start async read (spawns ephemeral background task)
-            // readData() returns immediately - conversion happens in background
-            // The background task will:
-            // 1. Poll hardware with vTaskDelay() yields (power efficient)
-            // 2. Update sensor data when complete
-            // 3. Publish to MQTT/InfluxDB
-            // 4. Self-terminate via vTaskDelete(NULL)
-            sensor->readData();
+            _scheduler.requestRead(sensor.get());
+            readRequested = true;
         }
     }
+    
+    if (readRequested && _schedulerTaskHandle != nullptr) {
+        xTaskNotifyGive(_schedulerTaskHandle);
+    }
 }
 
 void SensorManager::deinit()
 {
-    // Stop all periodic tasks before clearing sensors
-    for (auto& sensor : _sensors) {
-        sensor->stopPeriodicTask();
-    }
+    // Stop the scheduler before clearing sensors
+    stopScheduler();
     
     _sensors.clear();
     
@@ -768,6 +782,51 @@ std::string SensorManager::getJSON()
     return json.str();
 }
 
+std::string SensorManager::getHistoryJSON(int minutes)
+{
+    // 0 = everything which is still in the ring buffers
+    time_t since = (minutes > 0) ? time(nullptr) - (time_t)minutes * 60 : 0;
+    
+    std::stringstream json;
+    json << "{\"minutes\":" << minutes << ",\"sensors\":[";
+    
+    bool firstSensor = true;
+    for (const auto& sensor : _sensors) {
+        if (!firstSensor) {
+            json << ",";
+        }
+        firstSensor = false;
+        
+        json << "{\"name\":\"" << sensor->getName() << "\"";
+        json << ",\"aggregation_window\":" << sensor->getHistory().getWindow();
+        json << ",\"series\":{";
+        
+        bool firstSeries = true;
+        for (const std::string& name : sensor->getHistory().getSeriesNames()) {
+            if (!firstSeries) {
+                json << ",";
+            }
+            firstSeries = false;
+            
+            // [time, value] pairs, oldest first
+            json << "\"" << name << "\":[";
+            bool firstSample = true;
+            for (const SensorSample& sample : sensor->getHistory().getSamples(name, since)) {
+                if (!firstSample) {
+                    json << ",";
+                }
+                firstSample = false;
+                json << "[" << sample.time << "," << sample.value << "]";
+            }
+            json << "]";
+        }
+        json << "}}";
+    }
+    
+    json << "]}";
+    return json.str();
+}
+
 void SensorManager::addSensorError(const std::string& sensorName, SensorInitStatus status, 
                                    const std::string& errorMessage, int retryCount)
 {
@@ -4,25 +4,26 @@
 #define SENSOR_MANAGER_H
 
 #include "sensor_config.h"
+#include "sensor_scheduler.h"
+#include "sensor_history.h"
 #include <string>
 #include <vector>
 #include <memory>
 #include <map>
+#include <mutex>
 #include <time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 /**
  * @brief Base class for all sensors
+ *
+ * Reads are non-blocking state machines (see ScheduledSensor), all sensors are driven by the
+ * one scheduler task of the SensorManager.
  */
-class SensorBase {
+class SensorBase : public ScheduledSensor {
 public:
-    virtual ~SensorBase() {
-        // CRITICAL: Stop periodic task before object is destroyed to prevent race condition
-        // The task runs in a separate thread and accesses member variables
-        // If we don't stop it, it will crash when trying to access freed memory
-        stopPeriodicTask();
-    }
+    virtual ~SensorBase() {}
     
     /**
      * @brief Initialize the sensor hardware
@@ -31,10 +32,23 @@ public:
     virtual bool init() = 0;
     
     /**
-     * @brief Read data from the sensor
-     * @return true if successful, false otherwise
+     * @brief Update the read time, record the values and publish them after a successful measurement
+     *
+     * Without aggregation window every reading gets published. With window, the readings are
+     * collected and one summary (count/min/max/mean/last) gets published at the end of the window.
+     */
+    void finishMeasurement(bool success) override;
+    
+    /**
+     * @brief Publish a summary per aggregation window instead of every reading
+     * @param seconds Window length, 0 = publish every reading
      */
-    virtual bool readData() = 0;
+    void setAggregationWindow(int seconds) { _history.setWindow(seconds); }
+    
+    /**
+     * @brief Recent readings of this sensor
+     */
+    const SensorHistory& getHistory() const { return _history; }
     
     /**
      * @brief Publish sensor data to MQTT
@@ -62,18 +76,7 @@ public:
      * @brief Get timestamp of last successful read
      * @return Unix timestamp
      */
-    time_t getLastReadTime() const { return _lastRead; }
-    
-    /**
-     * @brief Start periodic task for this sensor (for custom intervals)
-     * @return true if task started successfully
-     */
-    bool startPeriodicTask();
-    
-    /**
-     * @brief Stop periodic task for this sensor
-     */
-    void stopPeriodicTask();
+    time_t getLastReadTime() const { std::lock_guard<std::mutex> lock(_valuesLock); return _lastRead; }
     
     /**
      * @brief Get the read interval for this sensor
@@ -81,12 +84,6 @@ public:
      */
     int getReadInterval() const { return _readInterval; }
     
-    /**
-     * @brief Check if sensor is currently performing an async read operation
-     * @return true if read is in progress
-     */
-    virtual bool isReadInProgress() const { return false; }
-    
     /**
      * @brief Get the MQTT topic for this sensor
      * @return MQTT topic string (empty if using default)
@@ -100,19 +97,21 @@ protected:
     bool _mqttEnabled;
     bool _influxEnabled;
     time_t _lastRead = 0;
-    
-private:
-    TaskHandle_t _taskHandle = nullptr;
+    SensorHistory _history;
+    mutable std::mutex _valuesLock;    // Held while the readings get written, the getters are called by other tasks (HTTP, publish)
     
     /**
-     * @brief Static task function wrapper for FreeRTOS
+     * @brief Add the values of the last reading to _history
+     * @param time Time of the reading
      */
-    static void sensorTaskWrapper(void* pvParameters);
+    virtual void recordSamples(time_t time) = 0;
     
     /**
-     * @brief Periodic task function for reading sensor
+     * @brief Publish the aggregates of a window: one JSON message to <base topic>/aggregate,
+     * the last values to the usual topics and the means to InfluxDB
+     * @param defaultSubtopic Subtopic below the main topic if no MQTT topic is configured
      */
-    void sensorTask();
+    void publishWindow(const SensorWindow& window, const std::string& defaultSubtopic);
 };
 
 /**
@@ -160,7 +159,7 @@ public:
     bool init();
     
     /**
-     * @brief Update all sensors (read if interval elapsed, publish if needed)
+     * @brief Request a read of the "follow flow" sensors whose interval elapsed
      * @param flowInterval Current flow interval for "follow flow" mode (in seconds)
      */
     void update(int flowInterval = 0);
@@ -181,6 +180,13 @@ public:
      */
     std::string getJSON();
     
+    /**
+     * @brief Get the recent raw readings of all sensors as JSON string
+     * @param minutes Only readings of the last minutes, 0 = all buffered readings
+     * @return JSON string, per sensor the series with [time, value] pairs
+     */
+    std::string getHistoryJSON(int minutes);
+    
     /**
      * @brief Get list of detected/enabled sensors
      * @return Vector of sensor pointers
@@ -205,9 +211,30 @@ private:
     bool _enabled;
     bool _i2cInitialized;
     
+    SensorScheduler _scheduler;
+    TaskHandle_t _schedulerTaskHandle = nullptr;
+    volatile bool _schedulerStop = false;
+    
     // TODO: Make retry count configurable via config file
     static constexpr int SENSOR_INIT_RETRY_COUNT = 3;
     
+    static constexpr int SCHEDULER_STACK_SIZE = 4096;
+    static constexpr int SCHEDULER_MAX_SLEEP_MS = 60000;    // Upper limit of one sleep of the scheduler task
+    
+    /**
+     * @brief Add all sensors to the scheduler and start the scheduler task
+     * @return true if the task is running
+     */
+    bool startScheduler();
+    
+    /**
+     * @brief Stop the scheduler task, waits until a running step is finished
+     */
+    void stopScheduler();
+    
+    static void schedulerTaskWrapper(void* pvParameters);
+    void schedulerTask();
+    
     /**
      * @brief Initialize I2C bus
      * @param sda SDA GPIO pin
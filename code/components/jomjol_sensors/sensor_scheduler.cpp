@@ -0,0 +1,99 @@
+#include "sensor_scheduler.h"
+
+#include <algorithm>
+
+void SensorScheduler::add(ScheduledSensor* sensor, int64_t intervalMs, int64_t firstDueMs)
+{
+    std::unique_ptr<Job> job(new Job());
+    job->sensor = sensor;
+    job->intervalMs = intervalMs;
+    _jobs.push_back(std::move(job));
+
+    if (firstDueMs != NOTHING_DUE) {
+        schedule(_jobs.back().get(), firstDueMs);
+    }
+}
+
+void SensorScheduler::requestRead(ScheduledSensor* sensor)
+{
+    for (auto& job : _jobs) {
+        if (job->sensor == sensor) {
+            job->readRequested = true;
+        }
+    }
+}
+
+void SensorScheduler::clear()
+{
+    _heap.clear();
+    _jobs.clear();
+}
+
+bool SensorScheduler::isMeasuring(const ScheduledSensor* sensor) const
+{
+    for (const auto& job : _jobs) {
+        if (job->sensor == sensor) {
+            return job->measuring;
+        }
+    }
+    return false;
+}
+
+void SensorScheduler::schedule(Job* job, int64_t dueMs)
+{
+    job->queued = true;
+    _heap.push_back({dueMs, job});
+    std::push_heap(_heap.begin(), _heap.end(), dueLater);
+}
+
+int64_t SensorScheduler::run(int64_t nowMs)
+{
+    for (auto& job : _jobs) {
+        if (job->readRequested.exchange(false) && !job->queued) {
+            schedule(job.get(), nowMs);
+        }
+    }
+
+    while (!_heap.empty() && _heap.front().dueMs <= nowMs) {
+        std::pop_heap(_heap.begin(), _heap.end(), dueLater);
+        Job* job = _heap.back().job;
+        _heap.pop_back();
+        job->queued = false;
+
+        step(job, nowMs);
+    }
+
+    if (_heap.empty()) {
+        return NOTHING_DUE;
+    }
+    return _heap.front().dueMs - nowMs;
+}
+
+void SensorScheduler::step(Job* job, int64_t nowMs)
+{
+    int result;
+    if (!job->measuring) {
+        job->measuring = true;
+        _stats.measurements++;
+        result = job->sensor->startMeasurement();
+    } else {
+        result = job->sensor->continueMeasurement();
+    }
+    _stats.steps++;
+
+    if (result >= 0) {
+        schedule(job, nowMs + result);
+        return;
+    }
+
+    // start → wait → read done, publish and plan the next measurement
+    job->measuring = false;
+    if (result != ScheduledSensor::STEP_DONE) {
+        _stats.failures++;
+    }
+    job->sensor->finishMeasurement(result == ScheduledSensor::STEP_DONE);
+
+    if (job->intervalMs > 0) {
+        schedule(job, nowMs + job->intervalMs);
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#ifndef SENSOR_SCHEDULER_H
+#define SENSOR_SCHEDULER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief A sensor read as non-blocking state machine, driven by the SensorScheduler
+ *
+ * Instead of waiting for the hardware (e.g. the 750ms DS18B20 conversion), a step returns
+ * after a few milliseconds with the time until it wants to be called again.
+ */
+class ScheduledSensor {
+public:
+    static constexpr int STEP_DONE = -1;      // Measurement finished successfully
+    static constexpr int STEP_FAILED = -2;    // Measurement failed, retried with the next interval
+
+    virtual ~ScheduledSensor() {}
+
+    /**
+     * @brief Start a measurement
+     * @return Milliseconds until continueMeasurement() has to be called, STEP_DONE or STEP_FAILED
+     */
+    virtual int startMeasurement() = 0;
+
+    /**
+     * @brief Continue the measurement (check for completion, read, retry)
+     * @return Milliseconds until the next call, STEP_DONE or STEP_FAILED
+     */
+    virtual int continueMeasurement() = 0;
+
+    /**
+     * @brief Called once the measurement is finished, publishes the values on success
+     */
+    virtual void finishMeasurement(bool success) = 0;
+};
+
+/**
+ * @brief Statistics of the scheduler, for logging and tests
+ */
+struct SensorSchedulerStats {
+    int measurements = 0;   // Started measurements
+    int failures = 0;       // Measurements which ended with STEP_FAILED
+    int steps = 0;          // Calls of startMeasurement() and continueMeasurement()
+};
+
+/**
+ * @brief Drives all sensors from one task
+ *
+ * Every sensor is a job with the time its next step is due. The due jobs are kept in a min-heap,
+ * run() executes all jobs which are due and returns how long the task can sleep.
+ * - Periodic jobs (interval > 0) start their next measurement one interval after the last one finished
+ * - Jobs without interval ("follow flow") only measure after requestRead()
+ *
+ * The scheduler has no clock of its own, the caller passes the time. So it runs on a simulated
+ * clock on the host. Jobs must be added before the scheduler task starts; requestRead() may be
+ * called from any task.
+ */
+class SensorScheduler {
+public:
+    static constexpr int64_t NOTHING_DUE = -1;
+
+    /**
+     * @brief Add a sensor
+     * @param sensor Sensor to drive, must outlive the scheduler
+     * @param intervalMs Time between two measurements, 0 = only on requestRead()
+     * @param firstDueMs Time of the first measurement, NOTHING_DUE = wait for requestRead()
+     */
+    void add(ScheduledSensor* sensor, int64_t intervalMs, int64_t firstDueMs);
+
+    /**
+     * @brief Measure the sensor with the next run(), ignored while it is measuring or queued
+     */
+    void requestRead(ScheduledSensor* sensor);
+
+    /**
+     * @brief Execute all steps which are due
+     * @param nowMs Current time
+     * @return Milliseconds until the next step is due, NOTHING_DUE if no job is queued
+     */
+    int64_t run(int64_t nowMs);
+
+    /**
+     * @brief Remove all jobs, the scheduler task must not be running
+     */
+    void clear();
+
+    /**
+     * @brief Check if a measurement of the sensor is in progress
+     */
+    bool isMeasuring(const ScheduledSensor* sensor) const;
+
+    size_t getJobCount() const { return _jobs.size(); }
+    const SensorSchedulerStats& getStats() const { return _stats; }
+
+private:
+    struct Job {
+        ScheduledSensor* sensor;
+        int64_t intervalMs;
+        bool measuring = false;
+        bool queued = false;
+        std::atomic<bool> readRequested{false};
+    };
+
+    struct DueEntry {
+        int64_t dueMs;
+        Job* job;
+    };
+
+    std::vector<std::unique_ptr<Job>> _jobs;
+    std::vector<DueEntry> _heap;
+    SensorSchedulerStats _stats;
+
+    void schedule(Job* job, int64_t dueMs);
+    void step(Job* job, int64_t nowMs);
+
+    static bool dueLater(const DueEntry& a, const DueEntry& b) { return a.dueMs > b.dueMs; }   // Min-heap
+};
+
+#endif // SENSOR_SCHEDULER_H
@@ -8,7 +8,6 @@
 
 #ifdef ENABLE_INFLUXDB
 #include "interface_influxdb.h"
-extern InfluxDB influxDB;
 #endif
 
 #include <string.h>
@@ -29,7 +28,7 @@ SensorSHT3x::SensorSHT3x(uint8_t address,
                          bool mqttEnabled,
                          bool influxEnabled)
     : _temperature(0.0f), _humidity(0.0f), _i2cAddress(address),
-      _i2cPort(I2C_NUM_0), _initialized(false), _readTaskHandle(nullptr), _readSuccess(false)
+      _i2cPort(I2C_NUM_0), _initialized(false), _measurementSent(false), _attempt(0), _waitedMs(0)
 {
     _mqttTopic = mqttTopic;
     _influxMeasurement = influxMeasurement;
@@ -41,11 +40,6 @@ SensorSHT3x::SensorSHT3x(uint8_t address,
 
 SensorSHT3x::~SensorSHT3x()
 {
-    // Stop background task if running
-    if (_readTaskHandle != nullptr) {
-        vTaskDelete(_readTaskHandle);
-        _readTaskHandle = nullptr;
-    }
 }
 
 uint8_t SensorSHT3x::calculateCRC(const uint8_t* data, size_t len)
@@ -67,192 +61,125 @@ uint8_t SensorSHT3x::calculateCRC(const uint8_t* data, size_t len)
     return crc;
 }
 
-void SensorSHT3x::readTaskWrapper(void* pvParameters)
+int SensorSHT3x::startMeasurement()
 {
-    SensorSHT3x* sensor = static_cast<SensorSHT3x*>(pvParameters);
-    sensor->readTask();
+    if (!_initialized) {
+        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Cannot read SHT3x: sensor not initialized");
+        return STEP_FAILED;
+    }
+    
+    _attempt = 0;
+    return sendMeasurementCommand();
 }
 
-void SensorSHT3x::readTask()
+int SensorSHT3x::continueMeasurement()
 {
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Background read task started");
-    
-    // Read with retry logic
-    const int maxRetries = 5;  // Increased from 3 to 5 for better transient error handling
-    bool success = false;
-    
-    for (int retry = 0; retry < maxRetries; retry++) {
-        // Send measurement command
-        uint8_t cmd[2];
-        cmd[0] = (SHT3X_CMD_MEASURE_HIGH_REP >> 8) & 0xFF;
-        cmd[1] = SHT3X_CMD_MEASURE_HIGH_REP & 0xFF;
-        
-        i2c_cmd_handle_t cmdHandle = i2c_cmd_link_create();
-        i2c_master_start(cmdHandle);
-        i2c_master_write_byte(cmdHandle, (_i2cAddress << 1) | I2C_MASTER_WRITE, true);
-        i2c_master_write(cmdHandle, cmd, 2, true);
-        i2c_master_stop(cmdHandle);
-        
-        esp_err_t ret = i2c_master_cmd_begin(_i2cPort, cmdHandle, pdMS_TO_TICKS(1000));
-        i2c_cmd_link_delete(cmdHandle);
-        
-        if (ret != ESP_OK) {
-            if (retry < maxRetries - 1) {
-                // Exponential backoff: 50ms, 100ms, 150ms, 200ms, 250ms
-                int delayMs = 50 + (retry * 50);
-                LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Failed to send measurement command, retry " + 
-                                    std::to_string(retry + 1) + " after " + std::to_string(delayMs) + "ms");
-                vTaskDelay(pdMS_TO_TICKS(delayMs));
-                continue;
-            }
-            break;
-        }
-        
-        // Wait for measurement to complete before polling
-        // SHT3x high repeatability measurement takes ~15ms according to datasheet
-        vTaskDelay(pdMS_TO_TICKS(15));
-        
-        // Poll for completion - yields to other tasks
-        // Timeout protection: max 100ms (should be done already, but just in case)
-        bool measurementComplete = false;
-        const int maxWaitMs = 100;
-        const int pollIntervalMs = 5;
-        
-        for (int elapsed = 0; elapsed < maxWaitMs; elapsed += pollIntervalMs) {
-            // Try to read data - sensor will NACK if not ready
-            uint8_t data[6];
-            cmdHandle = i2c_cmd_link_create();
-            i2c_master_start(cmdHandle);
-            i2c_master_write_byte(cmdHandle, (_i2cAddress << 1) | I2C_MASTER_READ, true);
-            i2c_master_read(cmdHandle, data, 5, I2C_MASTER_ACK);
-            i2c_master_read_byte(cmdHandle, &data[5], I2C_MASTER_NACK);
-            i2c_master_stop(cmdHandle);
-            
-            ret = i2c_master_cmd_begin(_i2cPort, cmdHandle, pdMS_TO_TICKS(100));
-            i2c_cmd_link_delete(cmdHandle);
-            
-            if (ret == ESP_OK) {
-                // Data received - log completion time
-                LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Measurement completed in ~" + 
-                                    std::to_string(15 + elapsed) + "ms");
-                
-                // Add settling delay after data ready to reduce CRC errors
-                vTaskDelay(pdMS_TO_TICKS(2));
-                
-                // Verify CRC
-                uint8_t tempCRC = calculateCRC(&data[0], 2);
-                uint8_t humCRC = calculateCRC(&data[3], 2);
-                
-                if (tempCRC != data[2]) {
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Temperature CRC mismatch (expected: 0x" + 
-                                        std::to_string(tempCRC) + ", got: 0x" + std::to_string(data[2]) + ")");
-                    break;  // Try retry
-                }
-                
-                if (humCRC != data[5]) {
-                    LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Humidity CRC mismatch (expected: 0x" + 
-                                        std::to_string(humCRC) + ", got: 0x" + std::to_string(data[5]) + ")");
-                    break;  // Try retry
-                }
-                
-                // Convert raw values to temperature and humidity
-                uint16_t rawTemp = (data[0] << 8) | data[1];
-                uint16_t rawHum = (data[3] << 8) | data[4];
-                
-                _temperature = -45.0f + 175.0f * (float)rawTemp / 65535.0f;
-                _humidity = 100.0f * (float)rawHum / 65535.0f;
-                
-                LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Read: Temp=" + std::to_string(_temperature) + 
-                                    "°C, Humidity=" + std::to_string(_humidity) + "%");
-                
-                measurementComplete = true;
-                success = true;
-                break;
-            } else if (ret != ESP_ERR_TIMEOUT && ret != ESP_FAIL) {
-                // Real I2C error (not just sensor busy)
-                LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "I2C read error: " + std::to_string(ret));
-                break;
-            }
-            // Otherwise sensor is still busy, continue polling after delay
-            vTaskDelay(pdMS_TO_TICKS(pollIntervalMs));
-        }
-        
-        if (success) {
-            break;  // Success, exit retry loop
-        }
-        
-        if (!measurementComplete && retry < maxRetries - 1) {
-            // Exponential backoff on measurement timeout
-            int delayMs = 50 + (retry * 50);
-            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Measurement timeout, retry " + 
-                                std::to_string(retry + 1) + " after " + std::to_string(delayMs) + "ms");
-            vTaskDelay(pdMS_TO_TICKS(delayMs));
-        }
-    }
+    return _measurementSent ? readMeasurement() : sendMeasurementCommand();
+}
+
+int SensorSHT3x::sendMeasurementCommand()
+{
+    uint8_t cmd[2];
+    cmd[0] = (SHT3X_CMD_MEASURE_HIGH_REP >> 8) & 0xFF;
+    cmd[1] = SHT3X_CMD_MEASURE_HIGH_REP & 0xFF;
+    
+    i2c_cmd_handle_t cmdHandle = i2c_cmd_link_create();
+    i2c_master_start(cmdHandle);
+    i2c_master_write_byte(cmdHandle, (_i2cAddress << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write(cmdHandle, cmd, 2, true);
+    i2c_master_stop(cmdHandle);
     
-    _readSuccess = success;
+    esp_err_t ret = i2c_master_cmd_begin(_i2cPort, cmdHandle, pdMS_TO_TICKS(1000));
+    i2c_cmd_link_delete(cmdHandle);
     
-    if (success) {
-        _lastRead = time(nullptr);
-        
-        // Publish data from background task after successful read
-        publishMQTT();
-        publishInfluxDB();
-        
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Background read task completed successfully");
-    } else {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Background read task failed after " + 
-                            std::to_string(maxRetries) + " attempts");
+    if (ret != ESP_OK) {
+        return retry("Failed to send measurement command");
     }
     
-    // Clear handle before deleting task to prevent race condition
-    _readTaskHandle = nullptr;
-    vTaskDelete(NULL);
+    // Wait for measurement to complete before polling
+    _measurementSent = true;
+    _waitedMs = 0;
+    return MEASUREMENT_TIME_MS;
 }
 
-bool SensorSHT3x::readData()
+int SensorSHT3x::readMeasurement()
 {
-    if (!_initialized) {
-        LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Cannot read SHT3x: sensor not initialized");
-        return false;
+    // Try to read data - sensor will NACK if not ready
+    uint8_t data[6];
+    i2c_cmd_handle_t cmdHandle = i2c_cmd_link_create();
+    i2c_master_start(cmdHandle);
+    i2c_master_write_byte(cmdHandle, (_i2cAddress << 1) | I2C_MASTER_READ, true);
+    i2c_master_read(cmdHandle, data, 5, I2C_MASTER_ACK);
+    i2c_master_read_byte(cmdHandle, &data[5], I2C_MASTER_NACK);
+    i2c_master_stop(cmdHandle);
+    
+    esp_err_t ret = i2c_master_cmd_begin(_i2cPort, cmdHandle, pdMS_TO_TICKS(100));
+    i2c_cmd_link_delete(cmdHandle);
+    
+    if (ret == ESP_ERR_TIMEOUT || ret == ESP_FAIL) {
+        // Sensor is still busy, poll again
+        // Timeout protection: max 100ms (should be done already, but just in case)
+        _waitedMs += POLL_INTERVAL_MS;
+        if (_waitedMs < MAX_WAIT_MS) {
+            return POLL_INTERVAL_MS;
+        }
+        return retry("Measurement timeout");
     }
     
-    // Check if a read is already in progress  
-    // Note: This check is safe because:
-    // 1. Task sets _readTaskHandle to nullptr immediately before vTaskDelete(NULL)
-    // 2. vTaskDelete(NULL) for current task is synchronous - task ends immediately
-    // 3. No window where task is active but handle is nullptr
-    if (_readTaskHandle != nullptr) {
-        // Read still in progress, return false (not complete yet)
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "SHT3x read skipped: previous read task still in progress");
-        return false;
+    if (ret != ESP_OK) {
+        // Real I2C error (not just sensor busy)
+        return retry("I2C read error: " + std::to_string(ret));
     }
     
-    // Note: shouldRead() check is done by SensorManager::update() before calling this
-    // Start a background task to read sensor asynchronously
-    // This task will poll sensor and delete itself when done
-    
-    BaseType_t xReturned = xTaskCreatePinnedToCore(
-        &SensorSHT3x::readTaskWrapper,
-        "sht3x_read",
-        4096,  // Stack size
-        this,  // Parameter
-        tskIDLE_PRIORITY,  // Priority - low for reading (not critical)
-        &_readTaskHandle,
-        0  // Core 0
-    );
-    
-    if (xReturned != pdPASS) {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "Failed to create background read task");
-        _readTaskHandle = nullptr;
-        return false;
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Measurement completed in ~" + 
+                        std::to_string(MEASUREMENT_TIME_MS + _waitedMs) + "ms");
+    
+    // Verify CRC
+    uint8_t tempCRC = calculateCRC(&data[0], 2);
+    uint8_t humCRC = calculateCRC(&data[3], 2);
+    
+    if (tempCRC != data[2]) {
+        return retry("Temperature CRC mismatch (expected: 0x" + 
+                     std::to_string(tempCRC) + ", got: 0x" + std::to_string(data[2]) + ")");
     }
     
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Started background read task (true async)");
+    if (humCRC != data[5]) {
+        return retry("Humidity CRC mismatch (expected: 0x" + 
+                     std::to_string(humCRC) + ", got: 0x" + std::to_string(data[5]) + ")");
+    }
     
-    // Return true to indicate read was initiated
-    // The task will complete in background
-    return true;
+    // Convert raw values to temperature and humidity
+    uint16_t rawTemp = (data[0] << 8) | data[1];
+    uint16_t rawHum = (data[3] << 8) | data[4];
+    
+    {
+        std::lock_guard<std::mutex> lock(_valuesLock);
+        _temperature = -45.0f + 175.0f * (float)rawTemp / 65535.0f;
+        _humidity = 100.0f * (float)rawHum / 65535.0f;
+    }
+    _measurementSent = false;
+    
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Read: Temp=" + std::to_string(_temperature) + 
+                        "°C, Humidity=" + std::to_string(_humidity) + "%");
+    return STEP_DONE;
+}
+
+int SensorSHT3x::retry(const std::string& reason)
+{
+    _measurementSent = false;
+    _attempt++;
+    
+    if (_attempt >= MAX_ATTEMPTS) {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, reason + ", read failed after " + 
+                            std::to_string(MAX_ATTEMPTS) + " attempts");
+        return STEP_FAILED;
+    }
+    
+    // Exponential backoff: 50ms, 100ms, 150ms, 200ms
+    int delayMs = 50 + ((_attempt - 1) * 50);
+    LogFile.WriteToFile(ESP_LOG_WARN, TAG, reason + ", retry " + 
+                        std::to_string(_attempt) + " after " + std::to_string(delayMs) + "ms");
+    return delayMs;
 }
 
 bool SensorSHT3x::init()
@@ -290,6 +217,12 @@ bool SensorSHT3x::init()
     return true;
 }
 
+void SensorSHT3x::recordSamples(time_t time)
+{
+    _history.add("temperature", time, _temperature);
+    _history.add("humidity", time, _humidity);
+}
+
 void SensorSHT3x::publishMQTT()
 {
 #ifdef ENABLE_MQTT
@@ -330,18 +263,18 @@ void SensorSHT3x::publishInfluxDB()
     
     time_t now = time(nullptr);
     
-    // Publish temperature with sensor type prefix
-    influxDB.InfluxDBPublish(_influxMeasurement, 
-                             "sht3x_temperature", 
-                             std::to_string(_temperature), 
-                             now);
+    // Publish temperature with sensor type prefix (sent together with the next round)
+    InfluxDBAddSensorPoint(_influxMeasurement, 
+                           "sht3x_temperature", 
+                           std::to_string(_temperature), 
+                           now);
     
     // Publish humidity with sensor type prefix
-    influxDB.InfluxDBPublish(_influxMeasurement, 
-                             "sht3x_humidity", 
-                             std::to_string(_humidity), 
-                             now);
+    InfluxDBAddSensorPoint(_influxMeasurement, 
+                           "sht3x_humidity", 
+                           std::to_string(_humidity), 
+                           now);
     
-    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Published to InfluxDB");
+    LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Queued for InfluxDB");
 #endif
 }
@@ -31,7 +31,8 @@ public:
     virtual ~SensorSHT3x();
     
     bool init() override;
-    bool readData() override;
+    int startMeasurement() override;
+    int continueMeasurement() override;
     void publishMQTT() override;
     void publishInfluxDB() override;
     std::string getName() override { return "SHT3x"; }
@@ -39,33 +40,47 @@ public:
     /**
      * @brief Get last temperature reading
      */
-    float getTemperature() const { return _temperature; }
+    float getTemperature() const { std::lock_guard<std::mutex> lock(_valuesLock); return _temperature; }
     
     /**
      * @brief Get last humidity reading
      */
-    float getHumidity() const { return _humidity; }
+    float getHumidity() const { std::lock_guard<std::mutex> lock(_valuesLock); return _humidity; }
     
-    /**
-     * @brief Check if a read operation is currently in progress
-     * @return true if reading
-     */
-    bool isReadInProgress() const override { return _readTaskHandle != nullptr; }
+protected:
+    void recordSamples(time_t time) override;
     
 private:
+    static constexpr int MAX_ATTEMPTS = 5;
+    static constexpr int MEASUREMENT_TIME_MS = 15;     // High repeatability measurement (datasheet)
+    static constexpr int POLL_INTERVAL_MS = 5;
+    static constexpr int MAX_WAIT_MS = 100;
+    
     float _temperature;
     float _humidity;
     uint8_t _i2cAddress;
     i2c_port_t _i2cPort;
     bool _initialized;
-    TaskHandle_t _readTaskHandle;  // Handle for background read task
-    bool _readSuccess;  // Result of background read
+    bool _measurementSent;  // Measurement command sent, result is polled
+    int _attempt;
+    int _waitedMs;  // Time polled for the running measurement
+    
+    /**
+     * @brief Send the measurement command
+     * @return Time until the result can be read, or the result of retry()
+     */
+    int sendMeasurementCommand();
+    
+    /**
+     * @brief Try to read the result, the sensor NACKs while it is measuring
+     * @return STEP_DONE, time until the next poll, or the result of retry()
+     */
+    int readMeasurement();
     
     /**
-     * @brief Background task that polls sensor until measurement complete
+     * @brief Start the next attempt after a backoff, or give up after MAX_ATTEMPTS
      */
-    static void readTaskWrapper(void* pvParameters);
-    void readTask();
+    int retry(const std::string& reason);
     
     /**
      * @brief Calculate CRC8 checksum for SHT3x
@@ -4,11 +4,13 @@
 #include "esp_log.h"
 #include <time.h>
 #include "ClassLogFile.h"
-#include "esp_http_client.h"
 #include "time_sntp.h"
+#include "http_client_pool.h"
 #include "../../include/defines.h"
 #include <cJSON.h>
 #include <ClassFlowDefineTypes.h>
+#include "publish_spool.h"
+#include <atomic>
 
 
 static const char *TAG = "WEBHOOK";
@@ -17,13 +19,106 @@ std::string _webhookURI;
 std::string _webhookApiKey;
 long _lastTimestamp;
 
-static esp_err_t http_event_handler(esp_http_client_event_t *evt);
+static PublishSpool *webhookSpool = NULL;
+static std::atomic<uint32_t> requestsFailed(0);
 
 void WebhookInit(std::string _uri, std::string _apiKey)
 {
     _webhookURI = _uri;
     _webhookApiKey = _apiKey;
     _lastTimestamp = 0L;
+
+    if (!webhookSpool) {
+        webhookSpool = new PublishSpool("webhook");
+    }
+}
+
+
+static HttpPoolRequest *WebhookCreateJSONRequest(void)
+{
+    HttpPoolRequest *request = new HttpPoolRequest;
+    request->url = _webhookURI;
+    request->method = HTTP_POOL_POST;
+    request->headers.push_back({"Content-Type", "application/json"});
+    request->headers.push_back({"APIKEY", _webhookApiKey});
+    return request;
+}
+
+
+/**
+ * @brief Evaluates the result of a JSON POST request.
+ *
+ * @return true if the data got delivered or was rejected by the receiver (sending it again would not help),
+ *         false if the receiver could not be reached or had a temporary problem.
+ */
+static bool WebhookDelivered(const HttpPoolResult &_result)
+{
+    bool delivered = false;
+
+    if (_result.err == ESP_OK) {
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP request was performed");
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP status code: " + std::to_string(_result.status));
+        delivered = (_result.status < 500) && (_result.status != 429);
+    } else {
+        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "HTTP request failed");
+    }
+
+    if (!delivered) {
+        requestsFailed++;
+    }
+    return delivered;
+}
+
+
+/**
+ * @brief Sends a JSON array with a POST request on a connection of the HTTP client pool.
+ *
+ * @return see WebhookDelivered()
+ */
+static bool WebhookPostJSON(const std::string &_json)
+{
+    HttpPoolRequest *request = WebhookCreateJSONRequest();
+    request->body = _json.c_str();
+    request->bodyLen = _json.length();
+
+    bool delivered = WebhookDelivered(getHttpClientPool().perform(*request));
+    delete request;
+    return delivered;
+}
+
+
+uint32_t WebhookGetFailedCount()
+{
+    return requestsFailed;
+}
+
+
+/**
+ * @brief Sends the oldest spooled rounds as one JSON array.
+ */
+static void WebhookReplaySpool(void)
+{
+    if (!webhookSpool || webhookSpool->isEmpty()) {
+        return;
+    }
+
+    webhookSpool->Replay(SPOOL_REPLAY_MAX_BYTES, [](const std::vector<SpoolRecord> &_records) {
+        // Each record is the JSON array of one round -> merge the elements into one array
+        std::string json = "[";
+        for (auto &record : _records) {
+            if (record.payload.size() <= 2) {
+                continue;
+            }
+            if (json.size() > 1) {
+                json += ",";
+            }
+            json += record.payload.substr(1, record.payload.size() - 2);
+        }
+        json += "]";
+
+        LogFile.WriteToFile(ESP_LOG_INFO, TAG, "sending " + std::to_string(_records.size()) + " spooled round(s)");
+        return WebhookPostJSON(json);
+    });
 }
 
 bool WebhookPublish(std::vector<NumberPost*>* numbers)
@@ -64,107 +159,69 @@ bool WebhookPublish(std::vector<NumberPost*>* numbers)
     LogFile.WriteToFile(ESP_LOG_INFO, TAG, "sending webhook");
     LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "sending JSON: " + std::string(jsonString));
 
-    char response_buffer[MAX_HTTP_OUTPUT_BUFFER] = {0};
-    esp_http_client_config_t http_config = {
-        .url = _webhookURI.c_str(),
-        .user_agent = "ESP32 Meter reader",
-        .method = HTTP_METHOD_POST,
-        .event_handler = http_event_handler,
-        .buffer_size = MAX_HTTP_OUTPUT_BUFFER,
-        .user_data = response_buffer
-    };
-
-    esp_http_client_handle_t http_client = esp_http_client_init(&http_config);
-
-    esp_http_client_set_header(http_client, "Content-Type", "application/json");
-    esp_http_client_set_header(http_client, "APIKEY", _webhookApiKey.c_str());
+    // The round gets sent by the worker task of the HTTP client pool, the spool is only used there
+    HttpPoolRequest *request = WebhookCreateJSONRequest();
+    request->ownedBody = jsonString;
+    long timestamp = _lastTimestamp;
 
-    ESP_ERROR_CHECK(esp_http_client_set_post_field(http_client, jsonString, strlen(jsonString)));
-
-    esp_err_t err = ESP_ERROR_CHECK_WITHOUT_ABORT(esp_http_client_perform(http_client));
+    bool queued = getHttpClientPool().submit(request, [json = request->ownedBody, timestamp](const HttpPoolResult &_result) {
+        if (WebhookDelivered(_result)) {
+            // Receiver reachable -> send a part of what got lost while it was not
+            WebhookReplaySpool();
+        }
+        else if (webhookSpool && webhookSpool->Append(json, timestamp)) {
+            LogFile.WriteToFile(ESP_LOG_WARN, TAG, "Webhook not reachable, round spooled for retry");
+        }
+    });
 
-    if(err == ESP_OK) {
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP request was performed");
-        int status_code = esp_http_client_get_status_code(http_client);
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP status code: " + std::to_string(status_code));
-    } else {
-        LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "HTTP request failed");
-    } 
+    if (!queued) {
+        requestsFailed++;   // Earlier rounds are still waiting for the receiver
+    }
 
-    esp_http_client_cleanup(http_client);
     cJSON_Delete(jsonArray);
     free(jsonString);
     return numbersWithError;    
 }
 
-void WebhookUploadPic(ImageData *Img) {
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Starting WebhookUploadPic");
-
-    std::string fullURI = _webhookURI + "?timestamp=" + std::to_string(_lastTimestamp);
-    char response_buffer[MAX_HTTP_OUTPUT_BUFFER] = {0};
-    esp_http_client_config_t http_config = {
-        .url = fullURI.c_str(),
-        .user_agent = "ESP32 Meter reader",
-        .method = HTTP_METHOD_PUT,
-        .event_handler = http_event_handler,
-        .buffer_size = MAX_HTTP_OUTPUT_BUFFER,
-        .user_data = response_buffer
-    };
-
-    esp_http_client_handle_t http_client = esp_http_client_init(&http_config);
-
-    esp_http_client_set_header(http_client, "Content-Type", "image/jpeg");
-    esp_http_client_set_header(http_client, "APIKEY", _webhookApiKey.c_str());
+static HttpPoolRequest WebhookCreatePicRequest(void)
+{
+    HttpPoolRequest request;
+    request.url = _webhookURI + "?timestamp=" + std::to_string(_lastTimestamp);
+    request.method = HTTP_POOL_PUT;
+    request.headers.push_back({"Content-Type", "image/jpeg"});
+    request.headers.push_back({"APIKEY", _webhookApiKey});
+    return request;
+}
 
-    esp_err_t err = ESP_ERROR_CHECK_WITHOUT_ABORT(esp_http_client_set_post_field(http_client, (const char *)Img->data, Img->size));
 
-    err = ESP_ERROR_CHECK_WITHOUT_ABORT(esp_http_client_perform(http_client));
+static void WebhookPutPic(const HttpPoolRequest &_request)
+{
+    HttpPoolResult result = getHttpClientPool().perform(_request);
 
-    if (err == ESP_OK) {
+    if (result.err == ESP_OK) {
         LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP PUT request was performed successfully");
-        int status_code = esp_http_client_get_status_code(http_client);
-        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP status code: " + std::to_string(status_code));
+        LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP status code: " + std::to_string(result.status));
     } else {
         LogFile.WriteToFile(ESP_LOG_ERROR, TAG, "HTTP PUT request failed");
+        requestsFailed++;
     }
+}
 
-    esp_http_client_cleanup(http_client);
 
-    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "WebhookUploadPic finished");
-}
+/**
+ * @brief Uploads an already encoded JPG, its pages are sent as they are (chunked request body)
+ */
+void WebhookUploadPic(CJpegData *_jpeg) {
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "Starting WebhookUploadPic");
 
+    HttpPoolRequest request = WebhookCreatePicRequest();
+    request.streamBody = [_jpeg](const HttpPoolWrite &_write) {
+        return _jpeg->forEachChunk(_write);
+    };
+    WebhookPutPic(request);
 
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
-{
-    switch(evt->event_id)
-    {
-        case HTTP_EVENT_ERROR:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client Error encountered");
-            break;
-        case HTTP_EVENT_ON_CONNECTED:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client connected");
-            ESP_LOGI(TAG, "HTTP Client Connected");
-            break;
-        case HTTP_EVENT_HEADERS_SENT:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client sent all request headers");
-            break;
-        case HTTP_EVENT_ON_HEADER:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "Header: key=" + std::string(evt->header_key) + ", value="  + std::string(evt->header_value));
-            break;
-        case HTTP_EVENT_ON_DATA:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client data recevied: len=" + std::to_string(evt->data_len));
-            break;
-        case HTTP_EVENT_ON_FINISH:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client finished");
-            break;
-         case HTTP_EVENT_DISCONNECTED:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Client Disconnected");
-            break;
-        case HTTP_EVENT_REDIRECT:
-            LogFile.WriteToFile(ESP_LOG_DEBUG, TAG, "HTTP Redirect");
-            break;
-    }
-    return ESP_OK;
+    LogFile.WriteToFile(ESP_LOG_INFO, TAG, "WebhookUploadPic finished");
 }
 
+
 #endif //ENABLE_WEBHOOK
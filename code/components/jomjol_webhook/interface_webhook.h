@@ -8,10 +8,12 @@
 #include <map>
 #include <functional>
 #include <ClassFlowDefineTypes.h>
+#include "CImageBasis.h"
 
 void WebhookInit(std::string _webhookURI, std::string _apiKey);
 bool WebhookPublish(std::vector<NumberPost*>* numbers);
-void WebhookUploadPic(ImageData *Img);
+void WebhookUploadPic(CJpegData *_jpeg);
+uint32_t WebhookGetFailedCount();      // Requests which did not reach the receiver since startup
 
 #endif //INTERFACE_WEBHOOK_H
 #endif //ENABLE_WEBHOOK
\ No newline at end of file
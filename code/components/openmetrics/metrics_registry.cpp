@@ -0,0 +1,330 @@
+#include "metrics_registry.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+MetricsRegistry metricsRegistry;
+
+
+/*******************************************************************
+ * MetricsWriter
+ *******************************************************************/
+MetricsWriter::MetricsWriter(char *_buffer, size_t _size, Flush _flush, void *_context)
+{
+    buffer = _buffer;
+    size = _size;
+    used = 0;
+    flush = _flush;
+    context = _context;
+    error = false;
+}
+
+
+void MetricsWriter::flushBuffer(void)
+{
+    if ((used > 0) && !error) {
+        error = !flush(context, buffer, used);
+    }
+    used = 0;
+}
+
+
+void MetricsWriter::write(const char *_str, size_t _len)
+{
+    while (_len > 0) {
+        if (used == size) {
+            flushBuffer();
+        }
+
+        size_t part = std::min(_len, size - used);
+        memcpy(buffer + used, _str, part);
+        used += part;
+        _str += part;
+        _len -= part;
+    }
+}
+
+
+void MetricsWriter::write(const char *_str)
+{
+    write(_str, strlen(_str));
+}
+
+
+void MetricsWriter::writeLabelValue(const char *_str, size_t _len)
+{
+    for (size_t i = 0; i < _len; ++i) {
+        if ((_str[i] != '\\') && (_str[i] != '"') && (_str[i] != '\n')) {
+            write(&_str[i], 1);
+        }
+    }
+}
+
+
+void MetricsWriter::writeNumber(double _value)
+{
+    char number[32];
+
+    if (isnan(_value)) {
+        write("NaN", 3);
+        return;
+    }
+
+    if (isinf(_value)) {
+        write((_value > 0) ? "+Inf" : "-Inf");
+        return;
+    }
+
+    int len;
+    if ((_value == floor(_value)) && (fabs(_value) < 1e15)) {
+        len = snprintf(number, sizeof(number), "%lld", (long long)_value);
+    }
+    else {
+        len = snprintf(number, sizeof(number), "%.9g", _value);
+    }
+    write(number, len);
+}
+
+
+bool MetricsWriter::finish(void)
+{
+    flushBuffer();
+    return !error;
+}
+
+
+/*******************************************************************
+ * MetricsRegistry
+ *******************************************************************/
+int MetricsRegistry::addFamily(const char *_name, const char *_help, MetricType _type, const double *_buckets, int _bucketCount)
+{
+    std::lock_guard<std::mutex> lock(registryLock);
+
+    for (int i = 0; i < (int)families.size(); ++i) {
+        if (strcmp(families[i].name, _name) == 0) {
+            return i;
+        }
+    }
+
+    Family family;
+    family.name = _name;
+    family.help = _help;
+    family.type = _type;
+    family.bucketCount = (_type == METRIC_HISTOGRAM) ? std::min(_bucketCount, METRICS_MAX_BUCKETS) : 0;
+    for (int i = 0; i < family.bucketCount; ++i) {
+        family.buckets[i] = _buckets[i];
+    }
+
+    families.push_back(family);
+    return families.size() - 1;
+}
+
+
+int MetricsRegistry::addSeries(int _family, const std::string &_labels)
+{
+    std::lock_guard<std::mutex> lock(registryLock);
+
+    if ((_family < 0) || (_family >= (int)families.size())) {
+        return -1;
+    }
+
+    char labels[METRICS_MAX_LABELS_LEN];
+    strncpy(labels, _labels.c_str(), sizeof(labels) - 1);
+    labels[sizeof(labels) - 1] = '\0';
+
+    for (int i = 0; i < (int)series.size(); ++i) {
+        if ((series[i].family == _family) && (strcmp(series[i].labels, labels) == 0)) {
+            return i;
+        }
+    }
+
+    Series newSeries;
+    memset(&newSeries, 0, sizeof(newSeries));
+    newSeries.family = _family;
+    strcpy(newSeries.labels, labels);
+    // Counters and histograms start at 0, a gauge has no value until it gets set
+    newSeries.valid = (families[_family].type != METRIC_GAUGE);
+
+    series.push_back(newSeries);
+    return series.size() - 1;
+}
+
+
+void MetricsRegistry::inc(int _series, double _delta)
+{
+    std::lock_guard<std::mutex> lock(registryLock);
+
+    if (isValidSeries(_series)) {
+        series[_series].value += _delta;
+        series[_series].valid = true;
+    }
+}
+
+
+void MetricsRegistry::set(int _series, double _value)
+{
+    std::lock_guard<std::mutex> lock(registryLock);
+
+    if (isValidSeries(_series)) {
+        series[_series].value = _value;
+        series[_series].valid = true;
+    }
+}
+
+
+void MetricsRegistry::observe(int _series, double _value)
+{
+    std::lock_guard<std::mutex> lock(registryLock);
+
+    if (!isValidSeries(_series)) {
+        return;
+    }
+
+    Series &s = series[_series];
+    const Family &family = families[s.family];
+
+    for (int i = 0; i < family.bucketCount; ++i) {
+        if (_value <= family.buckets[i]) {
+            s.bucketCounts[i]++;
+            break;
+        }
+    }
+    s.value += _value;
+    s.count++;
+}
+
+
+void MetricsRegistry::unset(int _series)
+{
+    std::lock_guard<std::mutex> lock(registryLock);
+
+    if (isValidSeries(_series)) {
+        series[_series].valid = false;
+    }
+}
+
+
+void MetricsRegistry::renderSeries(MetricsWriter &_writer, const char *_prefix, const Family &_family, const Series &_series)
+{
+    bool hasLabels = (_series.labels[0] != '\0');
+
+    if (_family.type != METRIC_HISTOGRAM) {
+        _writer.write(_prefix);
+        _writer.write("_", 1);
+        _writer.write(_family.name);
+        if (hasLabels) {
+            _writer.write("{", 1);
+            _writer.write(_series.labels);
+            _writer.write("}", 1);
+        }
+        _writer.write(" ", 1);
+        _writer.writeNumber(_series.value);
+        _writer.write("\n", 1);
+        return;
+    }
+
+    uint64_t cumulative = 0;
+    for (int i = 0; i <= _family.bucketCount; ++i) {
+        bool isInf = (i == _family.bucketCount);
+        cumulative = isInf ? _series.count : cumulative + _series.bucketCounts[i];
+
+        _writer.write(_prefix);
+        _writer.write("_", 1);
+        _writer.write(_family.name);
+        _writer.write("_bucket{", 8);
+        if (hasLabels) {
+            _writer.write(_series.labels);
+            _writer.write(",", 1);
+        }
+        _writer.write("le=\"", 4);
+        _writer.writeNumber(isInf ? INFINITY : _family.buckets[i]);
+        _writer.write("\"} ", 3);
+        _writer.writeNumber((double)cumulative);
+        _writer.write("\n", 1);
+    }
+
+    const char *suffixes[2] = {"_sum", "_count"};
+    for (int i = 0; i < 2; ++i) {
+        _writer.write(_prefix);
+        _writer.write("_", 1);
+        _writer.write(_family.name);
+        _writer.write(suffixes[i]);
+        if (hasLabels) {
+            _writer.write("{", 1);
+            _writer.write(_series.labels);
+            _writer.write("}", 1);
+        }
+        _writer.write(" ", 1);
+        _writer.writeNumber((i == 0) ? _series.value : (double)_series.count);
+        _writer.write("\n", 1);
+    }
+}
+
+
+/* Every series gets copied while locked and formatted afterwards, so the flush to the network
+ * does not block the tasks which update the values */
+void MetricsRegistry::render(MetricsWriter &_writer, const char *_prefix)
+{
+    static const char *typeNames[] = {"counter", "gauge", "histogram"};
+    Family family;
+    Series snapshot;
+
+    for (int f = 0; ; ++f) {
+        {
+            std::lock_guard<std::mutex> lock(registryLock);
+            if (f >= (int)families.size()) {
+                break;
+            }
+            family = families[f];
+        }
+
+        bool metadataWritten = false;
+
+        for (int s = 0; ; ++s) {
+            {
+                std::lock_guard<std::mutex> lock(registryLock);
+                if (s >= (int)series.size()) {
+                    break;
+                }
+                if ((series[s].family != f) || !series[s].valid) {
+                    continue;
+                }
+                snapshot = series[s];
+            }
+
+            // only valid data is reported (https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md#missing-data)
+            if (!metadataWritten) {
+                _writer.write("# HELP ", 7);
+                _writer.write(_prefix);
+                _writer.write("_", 1);
+                _writer.write(family.name);
+                _writer.write(" ", 1);
+                _writer.write(family.help);
+                _writer.write("\n# TYPE ", 8);
+                _writer.write(_prefix);
+                _writer.write("_", 1);
+                _writer.write(family.name);
+                _writer.write(" ", 1);
+                _writer.write(typeNames[family.type]);
+                _writer.write("\n", 1);
+                metadataWritten = true;
+            }
+
+            renderSeries(_writer, _prefix, family, snapshot);
+        }
+    }
+}
+
+
+std::string metricsLabel(const char *_name, const std::string &_value)
+{
+    std::string label = std::string(_name) + "=\"";
+    for (char c : _value) {
+        if ((c != '\\') && (c != '"') && (c != '\n')) {
+            label += c;
+        }
+    }
+    return label + "\"";
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#ifndef METRICS_REGISTRY_H
+#define METRICS_REGISTRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#define METRICS_MAX_BUCKETS     12      // Upper bounds of a histogram, +Inf is added on rendering
+#define METRICS_MAX_LABELS_LEN  96      // Length of the formatted label set, e.g. sequence="main",roi="dig1"
+
+
+/* Formats the text exposition into a fixed buffer. Whenever the buffer is full, its content is handed
+ * to the flush callback (e.g. as one chunk of the HTTP response), so no string of the whole response
+ * gets built. */
+class MetricsWriter {
+public:
+    typedef bool (*Flush)(void *_context, const char *_data, size_t _len);
+
+    MetricsWriter(char *_buffer, size_t _size, Flush _flush, void *_context);
+
+    void write(const char *_str);
+    void write(const char *_str, size_t _len);
+    void writeLabelValue(const char *_str, size_t _len);    // Drops '\', '"' and newline, see metricsLabel()
+    void writeNumber(double _value);                        // Integral values without decimals, NaN as "NaN"
+    bool finish(void);                                      // Flushes the rest, false if any flush failed
+
+private:
+    char *buffer;
+    size_t size;
+    size_t used;
+    Flush flush;
+    void *context;
+    bool error;
+
+    void flushBuffer(void);
+};
+
+
+enum MetricType {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+};
+
+
+/* Counters, gauges and histograms with a label set per series.
+ * Families and series get registered once (config read, startup), the returned ids are used to
+ * update the values from any task without allocation. A series is only exposed once it has a value. */
+class MetricsRegistry {
+public:
+    // Returns the id of an already registered family with the same name
+    int addFamily(const char *_name, const char *_help, MetricType _type, const double *_buckets = NULL, int _bucketCount = 0);
+    // Returns the id of an already registered series of the family with the same labels, -1 on an invalid family
+    int addSeries(int _family, const std::string &_labels = "");
+
+    void inc(int _series, double _delta = 1);
+    void set(int _series, double _value);       // Gauges, and counters which mirror a count kept elsewhere
+    void observe(int _series, double _value);   // Histograms
+    void unset(int _series);                    // No valid value -> the series is not exposed
+
+    void render(MetricsWriter &_writer, const char *_prefix);
+
+private:
+    struct Family {
+        const char *name;
+        const char *help;
+        MetricType type;
+        double buckets[METRICS_MAX_BUCKETS];
+        int bucketCount;
+    };
+
+    struct Series {
+        int family;
+        char labels[METRICS_MAX_LABELS_LEN];
+        bool valid;
+        double value;                               // Counter/gauge value, sum of the observations of a histogram
+        uint64_t count;                             // Observations of a histogram
+        uint32_t bucketCounts[METRICS_MAX_BUCKETS]; // Not cumulative, summed up on rendering
+    };
+
+    std::mutex registryLock;
+    std::vector<Family> families;
+    std::vector<Series> series;
+
+    bool isValidSeries(int _series) { return (_series >= 0) && (_series < (int)series.size()); };
+    void renderSeries(MetricsWriter &_writer, const char *_prefix, const Family &_family, const Series &_series);
+};
+
+
+// Formats one label, '\', '"' and newline are removed from the value to keep it simple
+// (https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md#abnf)
+std::string metricsLabel(const char *_name, const std::string &_value);
+
+extern MetricsRegistry metricsRegistry;
+
+#endif // METRICS_REGISTRY_H
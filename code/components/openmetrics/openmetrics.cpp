@@ -1,6 +1,4 @@
 #include "openmetrics.h"
-#include "functional"
-#include "esp_log.h"
 
 /**
  * create a singe metric from the given input
@@ -12,57 +10,106 @@ std::string createMetric(const std::string &metricName, const std::string &help,
            metricName + " " + value + "\n";
 }
 
-typedef struct sequence_metric {
+/* Value of the metric _index of a sequence, see sequenceMetrics */
+static const std::string &sequenceMetricValue(int _index, NumberPost *_number)
+{
+    static const std::string noError = "0";
+    static const std::string error = "1";
+
+    switch (_index) {
+        case 0:  return _number->ReturnValue;
+        case 1:  return _number->ReturnRawValue;
+        case 2:  return _number->ReturnPreValue;
+        default: return (_number->ErrorMessageText.compare("no error") == 0) ? noError : error;
+    }
+}
+
+
+static const struct {
     const char *name;
     const char *help;
     const char *type;
-    std::function<std::string(NumberPost *number)> valueFunc;
-} sequence_metric_t;
-
-
-sequence_metric_t sequenceMetrics[4] = {
-    { "flow_value",     "current value of meter readout",     "gauge", [](NumberPost *number)-> std::string {return number->ReturnValue;} },
-    { "flow_raw_value", "current raw value of meter readout", "gauge", [](NumberPost *number)-> std::string {return number->ReturnRawValue;} },
-    { "flow_pre_value", "previous value of meter readout",    "gauge", [](NumberPost *number)-> std::string {return number->ReturnPreValue;} },
-    { "flow_error",     "Error message text != 'no error'",   "gauge", [](NumberPost *number)-> std::string {return number->ErrorMessageText.compare("no error") == 0 ? "0" : "1";} },
+} sequenceMetrics[4] = {
+    { "flow_value",     "current value of meter readout",     "gauge" },
+    { "flow_raw_value", "current raw value of meter readout", "gauge" },
+    { "flow_pre_value", "previous value of meter readout",    "gauge" },
+    { "flow_error",     "Error message text != 'no error'",   "gauge" },
 };
 
-std::string createSequenceMetrics(std::string prefix, const std::vector<NumberPost *> &numbers)
+
+/**
+ * Writes the MetricFamilies of all available sequences directly to the writer
+ **/
+void writeSequenceMetrics(MetricsWriter &writer, const char *prefix, const std::vector<NumberPost *> &numbers)
 {
-    std::string result;
-    for (int i = 0; i<sizeof(sequenceMetrics)/sizeof(sequence_metric_t);i++) 
+    for (int i = 0; i < sizeof(sequenceMetrics) / sizeof(sequenceMetrics[0]); i++)
     {
-        std::string res;
+        bool metadataWritten = false;
+
         for (const auto &number : numbers)
         {
-            std::string value = sequenceMetrics[i].valueFunc(number); 
-            if (value.find("N") != std::string::npos) {
-                value = "NaN";
-            }
-            ESP_LOGD("METRICS", "metric=%s, name=%s, value = %s ",sequenceMetrics[i].name,number->name.c_str(), value.c_str());
+            const std::string &value = sequenceMetricValue(i, number);
 
             // only valid data is reported (https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md#missing-data)
-            if (value.length() > 0)
+            if (value.length() == 0)
             {
-                auto label = number->name;
-                // except newline, double quote, and backslash (https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md#abnf)
-                // to keep it simple, these characters are just removed from the label
-                replaceAll(label, "\\", "");
-                replaceAll(label, "\"", "");
-                replaceAll(label, "\n", "");
-
-                res += prefix + "_" + sequenceMetrics[i].name + "{sequence=\"" + label + "\"} " + value + "\n";
+                continue;
             }
+
+            // metadata only if a valid metric gets created
+            if (!metadataWritten)
+            {
+                writer.write("# HELP ");
+                writer.write(prefix);
+                writer.write("_");
+                writer.write(sequenceMetrics[i].name);
+                writer.write(" ");
+                writer.write(sequenceMetrics[i].help);
+                writer.write("\n# TYPE ");
+                writer.write(prefix);
+                writer.write("_");
+                writer.write(sequenceMetrics[i].name);
+                writer.write(" ");
+                writer.write(sequenceMetrics[i].type);
+                writer.write("\n");
+                metadataWritten = true;
+            }
+
+            writer.write(prefix);
+            writer.write("_");
+            writer.write(sequenceMetrics[i].name);
+            writer.write("{sequence=\"");
+            // except newline, double quote, and backslash (https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md#abnf)
+            // to keep it simple, these characters are just removed from the label
+            writer.writeLabelValue(number->name.c_str(), number->name.length());
+            writer.write("\"} ");
+            if (value.find("N") != std::string::npos) {
+                writer.write("NaN");
+            }
+            else {
+                writer.write(value.c_str(), value.length());
+            }
+            writer.write("\n");
         }
-        // prepend metadata if a valid metric was created
-        if (res.length() > 0)
-        {
-            res = "# HELP " + prefix + "_" + sequenceMetrics[i].name + " " + sequenceMetrics[i].help + "\n"
-                + "# TYPE " + prefix + "_" + sequenceMetrics[i].name + " " + sequenceMetrics[i].type + "\n"
-                + res;
-        }
-        result += res;
     }
+}
+
+
+static bool appendToString(void *_context, const char *_data, size_t _len)
+{
+    ((std::string *)_context)->append(_data, _len);
+    return true;
+}
+
+
+std::string createSequenceMetrics(std::string prefix, const std::vector<NumberPost *> &numbers)
+{
+    std::string result;
+    char buffer[256];
+
+    MetricsWriter writer(buffer, sizeof(buffer), appendToString, &result);
+    writeSequenceMetrics(writer, prefix.c_str(), numbers);
+    writer.finish();
 
     return result;
 }
@@ -8,8 +8,10 @@
 #include <vector>
 
 #include "ClassFlowDefineTypes.h"
+#include "metrics_registry.h"
 
 std::string createMetric(const std::string &metricName, const std::string &help, const std::string &type, const std::string &value);
 std::string createSequenceMetrics(std::string prefix, const std::vector<NumberPost *> &numbers);
+void writeSequenceMetrics(MetricsWriter &writer, const char *prefix, const std::vector<NumberPost *> &numbers);
 
 #endif // OPENMETRICS_H
@@ -94,7 +94,6 @@
     #define LOGFILE_LAST_PART_BYTES 80 * 1024 // 80 kBytes  // Size of partial log file to return 
 
     #define SERVER_FILER_SCRATCH_BUFSIZE  4096 
-    #define SERVER_HELPER_SCRATCH_BUFSIZE  4096
     #define SERVER_OTA_SCRATCH_BUFSIZE  1024 
 
 
@@ -103,6 +102,37 @@
     (strcasecmp(&filename[strlen(filename) - sizeof(ext) + 1], ext) == 0)
 
 
+    //file_stream
+    #define FILE_STREAM_BUFFER_SIZE (16 * 1024)     // Two of them in the PSRAM: one gets filled from the SD card while the other one gets sent
+    #define FILE_STREAM_TASK_STACKSIZE (3 * 1024)
+    #define FILE_STREAM_TASK_PRIORITY (tskIDLE_PRIORITY + 3)   // Same as the HTTP server
+
+
+    //dir_listing
+    #define DIR_LISTING_FLUSH_SIZE 4096             // Listing rows get collected and sent in pieces of this size
+    #define DIR_LISTING_JSON_LIMIT 100              // Default for ?limit= of the JSON listing
+    #define DIR_LISTING_HTML_LIMIT 200              // Default for ?limit= of the HTML listing
+
+
+    //delete_job
+    #define DELETE_JOB_TASK_STACKSIZE (4 * 1024)
+    #define DELETE_JOB_TASK_PRIORITY (tskIDLE_PRIORITY + 1)    // Below the flow and the HTTP server
+
+    //zip_stream
+    #define ZIP_STREAM_BUFFER_SIZE 4096         // Headers get collected up to this size before they are sent
+
+    //image_log_store
+    #define IMAGE_LOG_READ_CHUNK 4096           // Buffer for reading an image back from its segment
+    #define IMAGE_LOG_ZIP_MAX_ENTRIES 4096      // Max. images in one ZIP of /imagelog, the central directory is kept in the PSRAM
+
+
+    //asset_cache
+    #define ASSET_CACHE_DIRECTORY "/sdcard/html/"
+    #define ASSET_CACHE_SIZE (256 * 1024)           // PSRAM for the static files of the web UI (/sdcard/html)
+    #define ASSET_CACHE_MAX_FILE_SIZE (64 * 1024)   // Larger files are sent from the SD card
+    #define ASSET_CACHE_REVALIDATE_S 60             // Cached files are checked against the SD card (mtime, size) at most this often
+
+
     //server_ota
     #define HASH_LEN 32 // SHA-256 digest length
     #define OTA_URL_SIZE 256
@@ -119,6 +149,23 @@
     #define READOUT_TYPE_PREVALUE 1
     #define READOUT_TYPE_RAWVALUE 2
     #define READOUT_TYPE_ERROR 3
+    #define FLOW_PUBLISH_QUEUE_LENGTH 2                 // Rounds waiting to be published before the oldest gets dropped
+    #define FLOW_PUBLISH_TASK_STACKSIZE (10 * 1024)
+
+
+    //MainFlowControl: Round scheduling
+    #define FLOW_SCHEDULE_TOLERANCE_MS 500              // A round started this much before its tick still belongs to the tick
+    #define FLOW_HOUSEKEEPING_MIN_IDLE_MS 5000          // Idle time needed before the next round to do housekeeping (roaming scan takes ca. 2s)
+    #define FLOW_HOUSEKEEPING_MAX_POSTPONED 10          // Rounds after which housekeeping gets done anyway
+
+
+    //parallel_for: One worker per core, same priority as the flow task
+    #define PARALLEL_FOR_TASK_STACKSIZE (6 * 1024)          // CutAndSave/Resize bodies may log to SD card (fatfs + vsnprintf), 4 KB was too tight
+    #define PARALLEL_FOR_TASK_STACK_MIN_FREE 1024           // Warn once if a worker gets below this (high-water mark)
+    #define PARALLEL_FOR_TASK_PRIORITY (tskIDLE_PRIORITY + 2)
+
+    //CRotateImage: Smaller images are not worth to be split over both cores
+    #define ROTATE_PARALLEL_MIN_ROWS 16
 
 
     //ClassFlowControll: Serve alg_roi.jpg from memory as JPG
@@ -138,7 +185,10 @@
 
     //CImageBasis
     #define HTTP_BUFFER_SENT 1024
-    #define MAX_JPG_SIZE 128000
+
+    //CJpegData
+    #define JPEG_PAGE_SIZE (8 * 1024)           // An encoded JPG is a chain of pages of this size in the PSRAM
+    #define JPEG_PAGE_POOL_MAX 8                // Free pages kept for the next JPG (64 KB), more get freed
 
     //make_stb + stb_image_resize + stb_image_write + stb_image //do not work if not in make_stb.cpp
     //#define STB_IMAGE_IMPLEMENTATION
@@ -147,8 +197,37 @@
     #define STBI_ONLY_JPEG // (save 2% of Flash, but breaks the alignment mark generation, see https://github.com/jomjol/AI-on-the-edge-device/issues/1721)
 
 
+    //server_mqtt
+    #define MQTT_DISCOVERY_PAYLOAD_SIZE 1024    // Initial size of the reused buffer for a Homeassistant Discovery config
+    #define MQTT_DISCOVERY_STATUS_TOPIC "homeassistant/status"  // Birth message of Homeassistant, "online" -> send Discovery again
+
+    //mqtt_outbox
+    #define MQTT_OUTBOX_BUDGET (16 * 1024)      // Max. bytes of unacknowledged/unsent messages, see CONFIG_MQTT_CUSTOM_OUTBOX
+    #define MQTT_OUTBOX_SLAB_ITEMS 64           // Max. number of messages, allocated once with the outbox
+
+    //publish_spool
+    #define SPOOL_ROOT "/sdcard/spool"
+    #define SPOOL_SEGMENT_SIZE (16 * 1024)
+    #define SPOOL_MAX_SEGMENTS 16               // Max. 256 kB per publisher, the oldest segment gets dropped
+    #define SPOOL_REPLAY_MAX_BYTES 4096         // Replayed per round and publisher, so the backlog does not delay the live round
+
+    //openmetrics
+    #define METRICS_CHUNK_SIZE 1024             // /metrics gets rendered into this buffer and sent chunk by chunk
+
+    //http_client_pool
+    #define HTTP_POOL_MAX_CONNECTIONS 2         // Kept open connections (keep-alive) of all exporters together
+    #define HTTP_POOL_IDLE_TIMEOUT_S 120        // Idle connections get closed, most servers drop them after a similar time
+    #define HTTP_POOL_RESPONSE_SIZE 256         // Start of the response body which is kept, e.g. for error messages
+    #define HTTP_POOL_QUEUE_LENGTH 4            // Requests waiting for the worker task (submit())
+    #define HTTP_POOL_TASK_STACKSIZE (5 * 1024)
+
+
     //interface_influxdb
     #define MAX_HTTP_OUTPUT_BUFFER 2048
+    #define INFLUXDB_BATCH_MAX_SIZE 4096        // Max. size of the body of one write request
+    #define INFLUXDB_BUFFER_MAX_SIZE 8192       // Max. size of pending points and retry buffer (each), oldest lines get dropped
+    #define INFLUXDB_SENSOR_FLUSH_INTERVAL_S 30 // Sensor points waiting in the batch get sent at least this often
+    #define INFLUXDB_FLUSH_TASK_STACKSIZE (5 * 1024)
 
 
     //server_mqtt
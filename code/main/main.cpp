@@ -39,6 +39,7 @@
     #include "server_mqtt.h"
 #endif //ENABLE_MQTT
 #include "Helper.h"
+#include "parallel_for.h"
 #include "statusled.h"
 #include "sdcard_check.h"
 
@@ -543,6 +544,10 @@ extern "C" void app_main(void)
     //setSystemStatusFlag(SYSTEM_STATUS_CAM_FB_BAD);
     //setSystemStatusFlag(SYSTEM_STATUS_PSRAM_BAD);
 
+    // Worker pool to split alignment and ROI preprocessing over both cores
+    // ********************************************
+    parallel_for_init();
+
     // Check main init + start TFlite task
     // ********************************************
     if (getSystemStatus() == 0) { // No error flag is set
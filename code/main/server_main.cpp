@@ -290,17 +290,10 @@ esp_err_t hello_main_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    res = send_file(req, filetosend);
-    /* Respond with an empty chunk to signal HTTP response completion */
-    httpd_resp_send_chunk(req, NULL, 0);
-
+    res = send_file(req, filetosend);       // Completes the response
     if (res != ESP_OK)
         return res;
 
-    /* Respond with an empty chunk to signal HTTP response completion */
-//    httpd_resp_sendstr(req, "");
-//    httpd_resp_send_chunk(req, NULL, 0);
-
 #ifdef DEBUG_DETAIL_ON      
     LogFile.WriteHeapInfo("hello_main_handler - Stop");   
 #endif
@@ -324,13 +317,7 @@ esp_err_t img_tmp_handler(httpd_req_t *req)
     filetosend = filetosend + "/img_tmp/" + std::string(filename);
     ESP_LOGD(TAG, "File to upload: %s", filetosend.c_str());
 
-    esp_err_t res = send_file(req, filetosend); 
-    if (res != ESP_OK)
-        return res;
-
-    /* Respond with an empty chunk to signal HTTP response completion */
-    httpd_resp_send_chunk(req, NULL, 0);
-    return ESP_OK;
+    return send_file(req, filetosend);      // Completes the response
 }
 
 
@@ -460,7 +447,7 @@ httpd_handle_t start_webserver(void)
     config.server_port = 80;
     config.ctrl_port = 32768;
     config.max_open_sockets = 5; //20210921 --> previously 7   
-    config.max_uri_handlers = 45; // Make sure this fits all URI handlers. Memory usage in bytes: 6*max_uri_handlers (increased for sensor support)
+    config.max_uri_handlers = 48; // Make sure this fits all URI handlers. Memory usage in bytes: 6*max_uri_handlers (increased for sensor support and /imagelog)
     config.max_resp_headers = 8;                        
     config.backlog_conn = 5;                        
     config.lru_purge_enable = true; // this cuts old connections if new ones are needed.               
@@ -0,0 +1,189 @@
+#include <unity.h>
+#include <string.h>
+#include "configParser.h"
+#include "configFile.h"
+#include "Helper.h"
+#include "esp_timer.h"
+
+static const char *testConfig =
+    "[TakeImage]\r\n"
+    ";RawImagesLocation = /log/source\r\n"
+    "WaitBeforeTakingPicture = 2.5\r\n"
+    "\r\n"
+    ";[Analog]\r\n"
+    "Model = /config/ana.tflite\r\n"
+    "[Digits]\n"
+    "Model=/config/dig.tflite\n"
+    "main.dig1 294 126 30 54 false\n"
+    "# comment\n"
+    "[MQTT]\n"
+    "user = admin\n"
+    "password = my pass=word\n"
+    "Empty =\n"
+    "[AutoTimer]\n"
+    "Interval = 5,5\n"
+    "AlignToClock = true\n"
+    "interval_unknown = 1";
+
+/**
+ * @brief Sections, disabled sections, comments and multi value lines
+ */
+void test_configparser_sections()
+{
+    ConfigParser parser;
+    TEST_ASSERT_TRUE(parser.Parse(testConfig, strlen(testConfig)));
+
+    std::vector<ConfigSection> &sections = parser.getSections();
+    TEST_ASSERT_EQUAL_INT(5, sections.size());
+
+    TEST_ASSERT_EQUAL_STRING("[TakeImage]", sections[0].name.toString().c_str());
+    TEST_ASSERT_EQUAL_INT(1, sections[0].entries.size());
+    TEST_ASSERT_EQUAL_STRING("WaitBeforeTakingPicture", sections[0].entries[0].key.toString().c_str());
+    TEST_ASSERT_EQUAL_STRING("2.5", sections[0].entries[0].asString().c_str());
+
+    TEST_ASSERT_TRUE(sections[1].disabled);
+    TEST_ASSERT_NULL(parser.getSection("[Analog]"));
+
+    ConfigSection *digits = parser.getSection("[DIGITS]");
+    TEST_ASSERT_NOT_NULL(digits);
+    TEST_ASSERT_EQUAL_INT(2, digits->entries.size());
+    TEST_ASSERT_EQUAL_STRING("/config/dig.tflite", digits->entries[0].asString().c_str());
+
+    ConfigEntry &roi = digits->entries[1];
+    TEST_ASSERT_EQUAL_STRING("main.dig1", roi.key.toString().c_str());
+    TEST_ASSERT_EQUAL_INT(5, roi.valueCount());
+    TEST_ASSERT_EQUAL_STRING("126", roi.value(1).toString().c_str());
+    TEST_ASSERT_EQUAL_STRING("false", roi.value(4).toString().c_str());
+
+    // Password may contain '=' and blanks
+    ConfigSection *mqtt = parser.getSection("[MQTT]");
+    TEST_ASSERT_NOT_NULL(mqtt);
+    TEST_ASSERT_EQUAL_STRING("my pass=word", mqtt->entries[1].asString().c_str());
+    TEST_ASSERT_EQUAL_INT(0, mqtt->entries[2].valueCount());
+
+    // The body of a section can still be read by the line based ReadParameter()
+    TEST_ASSERT_EQUAL_INT(0, strncmp(mqtt->body.str, "user = admin\n", 13));
+}
+
+/**
+ * @brief Typed dispatch through the parameter table
+ */
+void test_configparser_paramtable()
+{
+    ConfigParser parser;
+    parser.Parse(testConfig, strlen(testConfig));
+
+    float interval = 0;
+    bool alignToClock = false;
+    std::string user = "";
+    std::string empty = "unchanged";
+
+    ConfigParamTable autoTimer;
+    autoTimer.addFloat("INTERVAL", &interval);
+    autoTimer.addBool("AlignToClock", &alignToClock);
+    TEST_ASSERT_EQUAL_INT(2, autoTimer.apply(*parser.getSection("[AutoTimer]")));
+    TEST_ASSERT_EQUAL_FLOAT(5.5, interval);
+    TEST_ASSERT_TRUE(alignToClock);
+
+    ConfigParamTable mqtt;
+    mqtt.addString("User", &user);
+    mqtt.addString("Empty", &empty);
+    TEST_ASSERT_EQUAL_INT(1, mqtt.apply(*parser.getSection("[MQTT]")));
+    TEST_ASSERT_EQUAL_STRING("admin", user.c_str());
+    TEST_ASSERT_EQUAL_STRING("unchanged", empty.c_str());
+}
+
+/**
+ * @brief Lines without own key (ROIs) and "<number>.<param>" keys like in [Digits] and [PostProcessing]
+ */
+void test_configparser_default_and_prefix()
+{
+    const char *config =
+        ";[Digits]\n"
+        "[PostProcessing]\n"
+        "main.dig1 294 126 30 54 true\n"
+        "main.DecimalShift = 2\n"
+        "PreValueUse = true\n";
+
+    ConfigParser parser;
+    parser.Parse(config, strlen(config));
+
+    TEST_ASSERT_TRUE(parser.getSections()[0].isNamed("[DIGITS]"));
+    TEST_ASSERT_FALSE(parser.getSections()[0].isNamed(";[Digits]"));
+
+    ConfigSection *section = parser.getSection("[PostProcessing]");
+    TEST_ASSERT_NOT_NULL(section);
+
+    std::string decimalShiftKey = "";
+    int decimalShift = 0;
+    bool preValueUse = false;
+    int roiY = 0;
+    bool roiCCW = false;
+    std::string roiName = "";
+
+    ConfigParamTable params;
+    params.setNumberPrefix(true);
+    params.add("DecimalShift", [&](const ConfigEntry &_entry) {
+        decimalShiftKey = _entry.key.toString();
+        decimalShift = _entry.asInt();
+    });
+    params.addBool("PreValueUse", &preValueUse);
+    params.setDefault([&](const ConfigEntry &_entry) {
+        roiName = _entry.key.toString();
+        roiY = _entry.asInt(1);
+        roiCCW = _entry.asBool(4);
+    });
+
+    TEST_ASSERT_EQUAL_INT(3, params.apply(*section));
+    TEST_ASSERT_EQUAL_STRING("main.DecimalShift", decimalShiftKey.c_str());
+    TEST_ASSERT_EQUAL_INT(2, decimalShift);
+    TEST_ASSERT_TRUE(preValueUse);
+    TEST_ASSERT_EQUAL_STRING("main.dig1", roiName.c_str());
+    TEST_ASSERT_EQUAL_INT(126, roiY);
+    TEST_ASSERT_TRUE(roiCCW);
+}
+
+/**
+ * @brief Compares the single pass parser with the line based reader on the config of the SD card
+ */
+void test_configparser_timing()
+{
+    std::string path = FormatFileName("/sdcard/config/config.ini");
+
+    int64_t start = esp_timer_get_time();
+    ConfigFile configFile(path);
+    std::string line = "";
+    int anzLines = 0;
+    bool disabled = false;
+    bool eof = false;
+    while (configFile.getNextLine(&line, disabled, eof) && !eof) {
+        ZerlegeZeile(line, " =");
+        anzLines++;
+    }
+    int64_t legacy = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    ConfigParser parser;
+    bool loaded = parser.Load(path);
+    int anzEntries = 0;
+    for (auto &section : parser.getSections()) {
+        anzEntries += section.entries.size();
+    }
+    int64_t singlePass = esp_timer_get_time() - start;
+
+    if (!loaded) {
+        TEST_IGNORE_MESSAGE("No config.ini on the SD card");
+    }
+
+    printf("config.ini: line reader %d lines in %lld us, single pass %d entries in %lld us\n",
+           anzLines, legacy, anzEntries, singlePass);
+    TEST_ASSERT_GREATER_THAN(0, anzEntries);
+}
+
+void test_configparser()
+{
+    test_configparser_sections();
+    test_configparser_paramtable();
+    test_configparser_default_and_prefix();
+    test_configparser_timing();
+}
@@ -0,0 +1,134 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include "asset_cache.h"
+
+#define ASSET_TEST_DIR "/sdcard/test_asset_cache"
+
+
+static std::string writeAssetTestFile(const std::string &_name, const std::string &_content)
+{
+    std::string path = std::string(ASSET_TEST_DIR) + "/" + _name;
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file != NULL) {
+        fwrite(_content.data(), 1, _content.size(), file);
+        fclose(file);
+    }
+    return path;
+}
+
+
+/**
+ * @brief Hits are served from the cache with a stable ETag, the content is the one of the file
+ */
+void test_asset_cache_hit()
+{
+    AssetCache cache(4096, 1024, 3600);
+    std::string js = writeAssetTestFile("common.js", "function a() { return 1; }");
+
+    TEST_ASSERT_NULL(cache.get(js).get());
+    std::shared_ptr<const CachedAsset> loaded = cache.load(js, js, false);
+    TEST_ASSERT_NOT_NULL(loaded.get());
+    TEST_ASSERT_EQUAL_STRING_LEN("function a() { return 1; }", loaded->data, loaded->size);
+    TEST_ASSERT_EQUAL_INT(18, loaded->etag.size());         // "16 hex digits"
+    TEST_ASSERT_EQUAL_INT('"', loaded->etag[0]);
+
+    std::shared_ptr<const CachedAsset> hit = cache.get(js);
+    TEST_ASSERT_TRUE(hit == loaded);
+    TEST_ASSERT_EQUAL_INT(1, cache.getHits());
+    TEST_ASSERT_EQUAL_INT(1, cache.getMisses());
+
+    // Same content -> same ETag, other content -> other ETag
+    std::string copy = writeAssetTestFile("copy.js", "function a() { return 1; }");
+    std::string other = writeAssetTestFile("other.js", "function a() { return 2; }");
+    TEST_ASSERT_EQUAL_STRING(loaded->etag.c_str(), cache.load(copy, copy, false)->etag.c_str());
+    TEST_ASSERT_NOT_EQUAL(0, strcmp(loaded->etag.c_str(), cache.load(other, other, false)->etag.c_str()));
+
+    // Too large for a single entry
+    std::string large = writeAssetTestFile("large.js", std::string(1025, 'x'));
+    TEST_ASSERT_NULL(cache.load(large, large, false).get());
+    TEST_ASSERT_NULL(cache.load(std::string(ASSET_TEST_DIR) + "/missing.js", std::string(ASSET_TEST_DIR) + "/missing.js", false).get());
+
+    // The content stays valid for a request which is still sending it
+    cache.invalidate();
+    TEST_ASSERT_EQUAL_INT(0, cache.getCount());
+    TEST_ASSERT_EQUAL_INT(0, cache.getUsedBytes());
+    TEST_ASSERT_EQUAL_STRING_LEN("function a() { return 1; }", hit->data, hit->size);
+}
+
+
+/**
+ * @brief The least recently used files get dropped when the cache is full
+ */
+void test_asset_cache_lru()
+{
+    AssetCache cache(3000, 1024, 3600);
+    std::string files[4];
+    for (int i = 0; i < 4; ++i) {
+        files[i] = writeAssetTestFile("f" + std::to_string(i) + ".css", std::string(1000, 'a' + i));
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        TEST_ASSERT_NOT_NULL(cache.load(files[i], files[i], false).get());
+    }
+    TEST_ASSERT_EQUAL_INT(3000, cache.getUsedBytes());
+
+    TEST_ASSERT_NOT_NULL(cache.get(files[0]).get());         // f1 is now the least recently used
+    TEST_ASSERT_NOT_NULL(cache.load(files[3], files[3], false).get());
+
+    TEST_ASSERT_EQUAL_INT(3, cache.getCount());
+    TEST_ASSERT_EQUAL_INT(3000, cache.getUsedBytes());
+    TEST_ASSERT_NOT_NULL(cache.get(files[0]).get());
+    TEST_ASSERT_NULL(cache.get(files[1]).get());
+    TEST_ASSERT_NOT_NULL(cache.get(files[2]).get());
+    TEST_ASSERT_NOT_NULL(cache.get(files[3]).get());
+
+    // Loading a key again replaces the entry
+    TEST_ASSERT_NOT_NULL(cache.load(files[3], files[3], false).get());
+    TEST_ASSERT_EQUAL_INT(3, cache.getCount());
+    TEST_ASSERT_EQUAL_INT(3000, cache.getUsedBytes());
+}
+
+
+/**
+ * @brief A changed file gets noticed with the next check against the SD card
+ */
+void test_asset_cache_revalidate()
+{
+    AssetCache cache(4096, 1024, 0);        // Check every time
+    std::string html = writeAssetTestFile("index.html", "<html>1</html>");
+    std::string gz = writeAssetTestFile("index.html.gz", "gzipped");
+
+    TEST_ASSERT_NOT_NULL(cache.load(html, html, false).get());
+    TEST_ASSERT_NOT_NULL(cache.load(html + ":gzip", gz, true).get());
+    TEST_ASSERT_TRUE(cache.get(html + ":gzip")->gzip);
+    TEST_ASSERT_NOT_NULL(cache.get(html).get());
+
+    writeAssetTestFile("index.html", "<html>12</html>");
+    TEST_ASSERT_NULL(cache.get(html).get());
+    TEST_ASSERT_NOT_NULL(cache.get(html + ":gzip").get());
+
+    remove(gz.c_str());
+    TEST_ASSERT_NULL(cache.get(html + ":gzip").get());
+    TEST_ASSERT_EQUAL_INT(0, cache.getCount());
+}
+
+
+void test_asset_cache()
+{
+    mkdir(ASSET_TEST_DIR, 0775);
+
+    test_asset_cache_hit();
+    test_asset_cache_lru();
+    test_asset_cache_revalidate();
+
+    const char *names[] = { "common.js", "copy.js", "other.js", "large.js", "f0.css", "f1.css", "f2.css", "f3.css",
+                            "index.html", "index.html.gz" };
+    for (const char *name : names) {
+        remove((std::string(ASSET_TEST_DIR) + "/" + name).c_str());
+    }
+    rmdir(ASSET_TEST_DIR);
+}
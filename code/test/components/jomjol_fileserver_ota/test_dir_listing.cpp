@@ -0,0 +1,184 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include "dir_listing.h"
+#include "delete_job.h"
+
+#define LISTING_TEST_DIR "/sdcard/test_dir_listing"
+
+
+static void createListingTestDir(int _files)
+{
+    mkdir(LISTING_TEST_DIR, 0775);
+    mkdir(LISTING_TEST_DIR "/sub", 0775);
+    for (int i = 0; i < _files; ++i) {
+        FILE *file = fopen((LISTING_TEST_DIR "/img_" + std::to_string(i) + ".jpg").c_str(), "wb");
+        fwrite("0123456789", 1, (i % 10) + 1, file);
+        fclose(file);
+    }
+    FILE *file = fopen(LISTING_TEST_DIR "/wlan.ini", "wb");
+    fclose(file);
+}
+
+
+static void removeListingTestDir(void)
+{
+    remove(LISTING_TEST_DIR "/wlan.ini");
+    rmdir(LISTING_TEST_DIR "/sub");
+    rmdir(LISTING_TEST_DIR);
+}
+
+
+/**
+ * @brief Many small pieces go out in a few large ones, a failed sink stops the sending
+ */
+void test_dir_listing_buffer()
+{
+    std::string received;
+    std::vector<size_t> chunks;
+    ResponseBuffer out([&](const char *_data, size_t _len) {
+        received.append(_data, _len);
+        chunks.push_back(_len);
+        return true;
+    }, 100);
+
+    for (int i = 0; i < 50; ++i) {
+        out.append("0123456789");
+    }
+    TEST_ASSERT_TRUE(out.flush());
+    TEST_ASSERT_EQUAL_INT(500, received.size());
+    TEST_ASSERT_EQUAL_INT(5, chunks.size());
+
+    received.clear();
+    out.appendHtml("a&b<c>\"d\"");
+    out.appendJson("q\"b\\n\n");
+    TEST_ASSERT_TRUE(out.flush());
+    TEST_ASSERT_EQUAL_STRING("a&amp;b&lt;c&gt;&quot;d&quot;q\\\"b\\\\n\\u000a", received.c_str());
+
+    int calls = 0;
+    ResponseBuffer failing([&](const char *_data, size_t _len) {
+        calls++;
+        return false;
+    }, 10);
+    failing.append("0123456789");
+    failing.append("0123456789");
+    TEST_ASSERT_FALSE(failing.ok());
+    TEST_ASSERT_FALSE(failing.flush());
+    TEST_ASSERT_EQUAL_INT(1, calls);
+}
+
+
+/**
+ * @brief Paging over a directory, wlan.ini is hidden, the total counts all entries
+ */
+void test_dir_listing_paging()
+{
+    createListingTestDir(25);
+
+    std::vector<std::string> names;
+    long size = 0;
+    int total = for_each_dir_entry(LISTING_TEST_DIR, 0, SIZE_MAX, [&](const DirEntry &_entry) {
+        names.push_back(_entry.name);
+        if (!_entry.isDir) {
+            size += _entry.size;
+        }
+        else {
+            TEST_ASSERT_EQUAL_INT(-1, _entry.size);
+        }
+        return true;
+    });
+
+    // 25 files and sub/ (the host lists . and .. as well)
+    TEST_ASSERT_EQUAL_INT(names.size(), total);
+    TEST_ASSERT_TRUE(total >= 26);
+    TEST_ASSERT_EQUAL_INT(2 * 55 + 15, size);
+    for (const std::string &name : names) {
+        TEST_ASSERT_TRUE(name != "wlan.ini");
+    }
+
+    std::vector<std::string> page;
+    TEST_ASSERT_EQUAL_INT(total, for_each_dir_entry(LISTING_TEST_DIR, 10, 5, [&](const DirEntry &_entry) {
+        page.push_back(_entry.name);
+        return true;
+    }));
+    TEST_ASSERT_EQUAL_INT(5, page.size());
+    for (int i = 0; i < 5; ++i) {
+        TEST_ASSERT_EQUAL_STRING(names[10 + i].c_str(), page[i].c_str());
+    }
+
+    // Stopped by the callback, still counts everything
+    int calls = 0;
+    TEST_ASSERT_EQUAL_INT(total, for_each_dir_entry(LISTING_TEST_DIR, 0, SIZE_MAX, [&](const DirEntry &_entry) {
+        return ++calls < 3;
+    }));
+    TEST_ASSERT_EQUAL_INT(3, calls);
+
+    TEST_ASSERT_EQUAL_INT(-1, for_each_dir_entry(LISTING_TEST_DIR "/missing", 0, SIZE_MAX, [](const DirEntry &_entry) {
+        return true;
+    }));
+
+    // Rows
+    std::string received;
+    ResponseBuffer out([&](const char *_data, size_t _len) {
+        received.append(_data, _len);
+        return true;
+    });
+    DirEntry file = { "a&b.jpg", false, 2048 };
+    DirEntry dir = { "sub", true, -1 };
+    dir_listing_json_entry(out, file, true);
+    dir_listing_json_entry(out, dir, false);
+    out.flush();
+    TEST_ASSERT_EQUAL_STRING("{\"name\":\"a&b.jpg\",\"type\":\"file\",\"size\":2048},{\"name\":\"sub\",\"type\":\"directory\"}", received.c_str());
+
+    received.clear();
+    dir_listing_html_row(out, "/log/", file, true);
+    out.flush();
+    TEST_ASSERT_EQUAL_STRING("<tr><td><a href=\"/fileserver/log/a&amp;b.jpg\">a&amp;b.jpg</a></td><td>file</td><td>2 KiB</td></tr>\n",
+                             received.c_str());
+}
+
+
+/**
+ * @brief The files get deleted in the background, subfolders and wlan.ini stay
+ */
+void test_dir_listing_delete_job()
+{
+    // The files of the paging test are still there
+    DeleteJob job;
+    int finished = 0;
+
+    TEST_ASSERT_EQUAL_INT(DELETE_JOB_IDLE, job.getStatus().state);
+    TEST_ASSERT_EQUAL_INT(DELETE_JOB_STARTED, job.start(LISTING_TEST_DIR, [&]() { finished++; }));
+    job.wait();
+
+    DeleteJobStatus status = job.getStatus();
+    TEST_ASSERT_EQUAL_INT(DELETE_JOB_DONE, status.state);
+    TEST_ASSERT_EQUAL_INT(25, status.deleted);
+    TEST_ASSERT_EQUAL_INT(0, status.failed);
+    TEST_ASSERT_EQUAL_INT(1, finished);
+    TEST_ASSERT_EQUAL_STRING("{\"state\":\"done\",\"directory\":\"" LISTING_TEST_DIR "\",\"deleted\":25,\"failed\":0}",
+                             job.getStatusJson().c_str());
+
+    struct stat file_stat;
+    TEST_ASSERT_EQUAL_INT(0, stat(LISTING_TEST_DIR "/wlan.ini", &file_stat));
+    TEST_ASSERT_EQUAL_INT(0, stat(LISTING_TEST_DIR "/sub", &file_stat));
+    TEST_ASSERT_EQUAL_INT(-1, stat(LISTING_TEST_DIR "/img_0.jpg", &file_stat));
+
+    // The next one can start, a missing directory fails
+    TEST_ASSERT_EQUAL_INT(DELETE_JOB_STARTED, job.start(LISTING_TEST_DIR "/missing"));
+    job.wait();
+    TEST_ASSERT_EQUAL_INT(DELETE_JOB_FAILED, job.getStatus().state);
+}
+
+
+void test_dir_listing()
+{
+    test_dir_listing_buffer();
+    test_dir_listing_paging();
+    test_dir_listing_delete_job();
+    removeListingTestDir();
+}
@@ -0,0 +1,172 @@
+#include <unity.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <chrono>
+#include "file_stream.h"
+
+#define STREAM_TEST_FILE "/sdcard/test_file_stream.bin"
+
+
+static uint8_t streamTestByte(size_t _i)
+{
+    return (uint8_t)((_i * 13 + (_i >> 12)) & 0xff);
+}
+
+
+static bool writeStreamTestFile(size_t _size)
+{
+    FILE *file = fopen(STREAM_TEST_FILE, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < _size; ++i) {
+        fputc(streamTestByte(i), file);
+    }
+    return fclose(file) == 0;
+}
+
+
+/**
+ * @brief Stand-in for the socket: checks the content, the network gets simulated with a fixed rate
+ */
+struct FakeSocket {
+    size_t received = 0;
+    int chunks = 0;
+    size_t maxChunk = 0;
+    bool content = true;
+    int failAtChunk = -1;
+    double bytesPerUs = 0;          // 0: no delay
+
+    FileStreamSink sink() {
+        return [this](const char *_data, size_t _len) {
+            if (chunks == failAtChunk) {
+                return false;
+            }
+            for (size_t i = 0; i < _len; ++i) {
+                content = content && ((uint8_t)_data[i] == streamTestByte(received + i));
+            }
+            if (bytesPerUs > 0) {
+                usleep((useconds_t)(_len / bytesPerUs));
+            }
+            received += _len;
+            maxChunk = std::max(maxChunk, _len);
+            chunks++;
+            return true;
+        };
+    }
+};
+
+
+/**
+ * @brief Every size arrives completely and in order, in pieces of at most one buffer
+ */
+void test_file_stream_content()
+{
+    FileStreamer streamer(4096);
+    size_t sizes[] = { 0, 100, 4096, 3 * 4096, 3 * 4096 + 123, 100000 };
+
+    for (size_t size : sizes) {
+        TEST_ASSERT_TRUE(writeStreamTestFile(size));
+        FILE *file = fopen(STREAM_TEST_FILE, "rb");
+        TEST_ASSERT_NOT_NULL(file);
+
+        FakeSocket socket;
+        TEST_ASSERT_TRUE(streamer.send(file, socket.sink()));
+        fclose(file);
+
+        TEST_ASSERT_EQUAL_INT(size, socket.received);
+        TEST_ASSERT_TRUE(socket.content);
+        TEST_ASSERT_TRUE(socket.maxChunk <= 4096);
+        TEST_ASSERT_EQUAL_INT((size + 4095) / 4096, socket.chunks);
+    }
+
+    // Starts at the current position (e.g. last part of the log file)
+    TEST_ASSERT_TRUE(writeStreamTestFile(20000));
+    FILE *file = fopen(STREAM_TEST_FILE, "rb");
+    fseek(file, 10000, SEEK_SET);
+    FakeSocket socket;
+    socket.received = 10000;
+    TEST_ASSERT_TRUE(streamer.send(file, socket.sink()));
+    fclose(file);
+    TEST_ASSERT_EQUAL_INT(20000, socket.received);
+    TEST_ASSERT_TRUE(socket.content);
+
+    remove(STREAM_TEST_FILE);
+}
+
+
+/**
+ * @brief A closed connection stops the reader, the streamer can be used again
+ */
+void test_file_stream_abort()
+{
+    FileStreamer streamer(4096);
+    TEST_ASSERT_TRUE(writeStreamTestFile(100000));
+
+    FILE *file = fopen(STREAM_TEST_FILE, "rb");
+    FakeSocket failing;
+    failing.failAtChunk = 3;
+    TEST_ASSERT_FALSE(streamer.send(file, failing.sink()));
+    fclose(file);
+    TEST_ASSERT_EQUAL_INT(3, failing.chunks);
+
+    file = fopen(STREAM_TEST_FILE, "rb");
+    FakeSocket socket;
+    TEST_ASSERT_TRUE(streamer.send(file, socket.sink()));
+    fclose(file);
+    TEST_ASSERT_EQUAL_INT(100000, socket.received);
+
+    remove(STREAM_TEST_FILE);
+}
+
+
+/**
+ * @brief MB/s of the old loop (4 kB, read and send one after the other) and the double buffered streamer
+ */
+void test_file_stream_throughput()
+{
+    const size_t size = 1024 * 1024;
+    TEST_ASSERT_TRUE(writeStreamTestFile(size));
+
+    FakeSocket serial;
+    serial.bytesPerUs = 20;         // 20 MB/s network
+    char chunk[4096];
+    size_t chunksize;
+
+    auto start = std::chrono::steady_clock::now();
+    FILE *file = fopen(STREAM_TEST_FILE, "rb");
+    auto sink = serial.sink();
+    while ((chunksize = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        sink(chunk, chunksize);
+    }
+    fclose(file);
+    double serialUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    FileStreamer streamer;
+    FakeSocket streamed;
+    streamed.bytesPerUs = 20;
+
+    start = std::chrono::steady_clock::now();
+    file = fopen(STREAM_TEST_FILE, "rb");
+    TEST_ASSERT_TRUE(streamer.send(file, streamed.sink()));
+    fclose(file);
+    double streamedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    printf("File streaming 1 MB: 4 kB serial %.2f MB/s (%d chunks), %d kB double buffered %.2f MB/s (%d chunks)\n",
+           size / serialUs, serial.chunks, (int)(streamer.getBufferSize() / 1024), size / streamedUs, streamed.chunks);
+
+    TEST_ASSERT_EQUAL_INT(size, serial.received);
+    TEST_ASSERT_EQUAL_INT(size, streamed.received);
+    TEST_ASSERT_TRUE(streamed.content);
+
+    remove(STREAM_TEST_FILE);
+}
+
+
+void test_file_stream()
+{
+    test_file_stream_content();
+    test_file_stream_abort();
+    test_file_stream_throughput();
+}
@@ -0,0 +1,370 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+#include "ota_writer.h"
+#include "zip_extract.h"
+
+#define OTA_TEST_PARTITION "/sdcard/test_ota_partition.bin"
+
+/**
+ * @brief Fake OTA partition: a file with a fixed capacity
+ */
+class FileOtaWriter : public OtaWriter {
+public:
+    size_t capacity;
+    bool begun = false;
+    bool booted = false;
+    bool aborted = false;
+
+    FileOtaWriter(size_t _capacity) : capacity(_capacity) {};
+    ~FileOtaWriter() { abort(); };
+
+    bool begin(void) override {
+        file = fopen(OTA_TEST_PARTITION, "wb");     // "Erases" the partition
+        begun = (file != NULL);
+        return begun;
+    }
+    bool write(const void *_data, size_t _len) override {
+        if (written + _len > capacity) {
+            error = "Partition full";
+            return false;
+        }
+        written += _len;
+        return fwrite(_data, 1, _len, file) == _len;
+    }
+    bool end(void) override {
+        bool ok = (fclose(file) == 0);
+        file = NULL;
+        booted = ok;
+        return ok;
+    }
+    void abort(void) override {
+        if (file != NULL) {
+            fclose(file);
+            file = NULL;
+            aborted = true;
+        }
+    }
+
+private:
+    FILE *file = NULL;
+    size_t written = 0;
+};
+
+
+/* Hand made, the firmware is written like by a streaming zip tool:
+ *   config/          directory
+ *   firmware.bin     204800 bytes, byte i = (i * 7 + (i >> 10)) & 0xff, byte 0 = 0xE9, deflated,
+ *                    sizes and CRC in a data descriptor after the data
+ *   html/index.html  "<html>stream</html>", stored */
+static const unsigned char otaTestZip[] = {
+    0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x63, 0x6f,
+    0x6e, 0x66, 0x69, 0x67, 0x2f, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0x00,
+    0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c,
+    0x00, 0x00, 0x00, 0x66, 0x69, 0x72, 0x6d, 0x77, 0x61, 0x72, 0x65, 0x2e, 0x62, 0x69, 0x6e, 0xed,
+    0xd0, 0x03, 0x02, 0x28, 0x86, 0x01, 0x40, 0xb1, 0xda, 0xb6, 0xbd, 0xda, 0xb6, 0x6d, 0xdb, 0xb6,
+    0x6d, 0xdb, 0xda, 0xda, 0xd5, 0xb6, 0x6d, 0xdb, 0xb6, 0xf5, 0x6b, 0x5b, 0x07, 0x79, 0x39, 0x42,
+    0x32, 0x60, 0xc8, 0x11, 0x46, 0x1f, 0x6f, 0xd2, 0xa9, 0x67, 0x9a, 0x73, 0x81, 0xc5, 0x97, 0x5b,
+    0x75, 0x9d, 0x8d, 0xb7, 0xda, 0x71, 0x8f, 0xfd, 0x0f, 0x3b, 0xf6, 0x94, 0x33, 0xcf, 0xbf, 0xec,
+    0xda, 0x5b, 0xee, 0x7e, 0xe8, 0xc9, 0x17, 0x5e, 0x7f, 0xef, 0xd3, 0xaf, 0x7f, 0xfa, 0x73, 0xd0,
+    0x61, 0x46, 0x1e, 0x6b, 0xc2, 0xc9, 0xa7, 0x9b, 0x75, 0x9e, 0x85, 0x97, 0x5a, 0x71, 0x8d, 0xf5,
+    0x37, 0xdb, 0x76, 0x97, 0xbd, 0x0f, 0x3a, 0xf2, 0x84, 0xd3, 0xcf, 0xbe, 0xe8, 0xca, 0x1b, 0x6e,
+    0xbf, 0xef, 0xd1, 0x67, 0x5e, 0x7e, 0xeb, 0xc3, 0xcf, 0xbf, 0xfb, 0xf5, 0x9f, 0x21, 0x86, 0x1f,
+    0x6d, 0xdc, 0x49, 0xa6, 0x9a, 0x71, 0x8e, 0xf9, 0x17, 0x5b, 0x76, 0x95, 0xb5, 0x37, 0xda, 0x72,
+    0x87, 0xdd, 0xf7, 0x3b, 0xf4, 0x98, 0x93, 0xcf, 0x38, 0xef, 0xd2, 0x6b, 0x6e, 0xbe, 0xeb, 0xc1,
+    0x27, 0x9e, 0x7f, 0xed, 0xdd, 0x4f, 0xbe, 0xfa, 0xf1, 0x8f, 0x41, 0x86, 0x1e, 0x69, 0xcc, 0x09,
+    0xfe, 0x33, 0xed, 0x2c, 0x73, 0x2f, 0xb4, 0xe4, 0x0a, 0xab, 0xaf, 0xb7, 0xe9, 0x36, 0x3b, 0xef,
+    0x75, 0xe0, 0x11, 0xc7, 0x9f, 0x76, 0xd6, 0x85, 0x57, 0x5c, 0x7f, 0xdb, 0xbd, 0x8f, 0x3c, 0xfd,
+    0xd2, 0x9b, 0x1f, 0x0c, 0xf8, 0xf6, 0x97, 0xbf, 0x07, 0x1f, 0x6e, 0xd4, 0x71, 0x26, 0x9e, 0x72,
+    0x86, 0xd9, 0xe7, 0x5b, 0x74, 0x99, 0x95, 0xd7, 0xda, 0x70, 0x8b, 0xed, 0x77, 0xdb, 0xf7, 0x90,
+    0xa3, 0x4f, 0xfa, 0xdf, 0xb9, 0x97, 0x5c, 0x7d, 0xd3, 0x9d, 0x0f, 0x3c, 0xfe, 0xdc, 0xab, 0xef,
+    0x7c, 0xfc, 0xe5, 0x0f, 0xbf, 0x0f, 0x3c, 0xd4, 0x88, 0x63, 0x8c, 0x3f, 0xd9, 0x34, 0x33, 0xcf,
+    0xb5, 0xe0, 0x12, 0xcb, 0xaf, 0xb6, 0xee, 0x26, 0x5b, 0xef, 0xb4, 0xe7, 0x01, 0x87, 0x1f, 0x77,
+    0xea, 0xff, 0x2f, 0xb8, 0xfc, 0xba, 0x5b, 0xef, 0x79, 0xf8, 0xa9, 0x17, 0xdf, 0x78, 0xff, 0xb3,
+    0x6f, 0x7e, 0xfe, 0x6b, 0xb0, 0x61, 0x47, 0x19, 0x7b, 0xa2, 0x29, 0xa6, 0x9f, 0x6d, 0xde, 0x45,
+    0x96, 0x5e, 0x69, 0xcd, 0x0d, 0x36, 0xdf, 0x6e, 0xd7, 0x7d, 0x0e, 0x3e, 0xea, 0xc4, 0xff, 0x9e,
+    0x73, 0xf1, 0x55, 0x37, 0xde, 0x71, 0xff, 0x63, 0xcf, 0xbe, 0xf2, 0xf6, 0x47, 0x5f, 0x7c, 0xff,
+    0xdb, 0x40, 0xfc, 0xfc, 0x61, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f,
+    0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2,
+    0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe,
+    0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5,
+    0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91,
+    0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f,
+    0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77,
+    0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f,
+    0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4,
+    0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc,
+    0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb,
+    0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22,
+    0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f,
+    0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef,
+    0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf,
+    0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9,
+    0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9,
+    0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7,
+    0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45,
+    0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e,
+    0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf,
+    0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e,
+    0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92,
+    0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3,
+    0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae,
+    0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b,
+    0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc,
+    0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf,
+    0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd,
+    0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24,
+    0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7,
+    0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d,
+    0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17,
+    0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9,
+    0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f,
+    0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa,
+    0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48,
+    0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf,
+    0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb,
+    0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f,
+    0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2,
+    0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe,
+    0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5,
+    0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91,
+    0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f,
+    0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77,
+    0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f,
+    0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4,
+    0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc,
+    0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb,
+    0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22,
+    0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f,
+    0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef,
+    0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf,
+    0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9,
+    0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9,
+    0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7,
+    0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45,
+    0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e,
+    0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf,
+    0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0xfe,
+    0x7f, 0x01, 0x50, 0x4b, 0x07, 0x08, 0xc1, 0x02, 0x2c, 0xb9, 0x33, 0x05, 0x00, 0x00, 0x00, 0x20,
+    0x03, 0x00, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00,
+    0xa0, 0x95, 0xa8, 0x92, 0x13, 0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x0f, 0x00, 0x00, 0x00,
+    0x68, 0x74, 0x6d, 0x6c, 0x2f, 0x69, 0x6e, 0x64, 0x65, 0x78, 0x2e, 0x68, 0x74, 0x6d, 0x6c, 0x3c,
+    0x68, 0x74, 0x6d, 0x6c, 0x3e, 0x73, 0x74, 0x72, 0x65, 0x61, 0x6d, 0x3c, 0x2f, 0x68, 0x74, 0x6d,
+    0x6c, 0x3e, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x00, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x21, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x63, 0x6f, 0x6e, 0x66, 0x69, 0x67, 0x2f, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x00, 0x14, 0x00, 0x08,
+    0x00, 0x08, 0x00, 0x00, 0x00, 0x21, 0x00, 0xc1, 0x02, 0x2c, 0xb9, 0x33, 0x05, 0x00, 0x00, 0x00,
+    0x20, 0x03, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x25, 0x00, 0x00, 0x00, 0x66, 0x69, 0x72, 0x6d, 0x77, 0x61, 0x72, 0x65, 0x2e, 0x62, 0x69,
+    0x6e, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x00, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21,
+    0x00, 0xa0, 0x95, 0xa8, 0x92, 0x13, 0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x0f, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x92, 0x05, 0x00, 0x00, 0x68,
+    0x74, 0x6d, 0x6c, 0x2f, 0x69, 0x6e, 0x64, 0x65, 0x78, 0x2e, 0x68, 0x74, 0x6d, 0x6c, 0x50, 0x4b,
+    0x05, 0x06, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x03, 0x00, 0xac, 0x00, 0x00, 0x00, 0xd2, 0x05,
+    0x00, 0x00, 0x00, 0x00,
+};
+
+#define OTA_TEST_FIRMWARE_SIZE (200 * 1024)
+
+
+static uint8_t otaFirmwareByte(size_t _i)
+{
+    return (_i == 0) ? OTA_FIRMWARE_MAGIC : (uint8_t)((_i * 7 + (_i >> 10)) & 0xff);
+}
+
+
+static bool otaPartitionMatches(size_t _size)
+{
+    FILE *file = fopen(OTA_TEST_PARTITION, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    size_t i = 0;
+    int c;
+    bool ok = true;
+    while ((c = fgetc(file)) != EOF) {
+        ok = ok && (c == otaFirmwareByte(i));
+        i++;
+    }
+    fclose(file);
+    return ok && (i == _size);
+}
+
+
+/**
+ * @brief A bin file goes piece by piece into the partition, the header is checked before it gets erased
+ */
+void test_ota_writer_bin()
+{
+    std::vector<uint8_t> image(OTA_TEST_FIRMWARE_SIZE);
+    for (size_t i = 0; i < image.size(); ++i) {
+        image[i] = otaFirmwareByte(i);
+    }
+
+    FileOtaWriter writer(1024 * 1024);
+    FirmwareStream firmware(&writer);
+
+    // Odd piece sizes, the first ones are shorter than the header
+    size_t pos = 0;
+    size_t pieces[] = { 1, 100, 1000, 4096, 3 };
+    for (int i = 0; pos < image.size(); ++i) {
+        size_t len = std::min(pieces[i % 5], image.size() - pos);
+        TEST_ASSERT_TRUE(firmware.write(&image[pos], len));
+        pos += len;
+        if (pos < OTA_FIRMWARE_HEADER_LEN) {
+            TEST_ASSERT_FALSE(writer.begun);
+        }
+    }
+
+    TEST_ASSERT_TRUE(writer.begun);
+    TEST_ASSERT_FALSE(writer.booted);
+    TEST_ASSERT_TRUE(firmware.finish());
+    TEST_ASSERT_TRUE(writer.booted);
+    TEST_ASSERT_EQUAL_INT(OTA_TEST_FIRMWARE_SIZE, firmware.getSize());
+    TEST_ASSERT_TRUE(otaPartitionMatches(OTA_TEST_FIRMWARE_SIZE));
+
+    remove(OTA_TEST_PARTITION);
+}
+
+
+/**
+ * @brief Wrong files do not touch the partition, a failed write does not activate it
+ */
+void test_ota_writer_reject()
+{
+    std::string zip(1024, 'x');
+    zip[0] = 'P';
+
+    {   // No app image
+        FileOtaWriter writer(1024 * 1024);
+        FirmwareStream firmware(&writer);
+        TEST_ASSERT_FALSE(firmware.write(zip.c_str(), zip.length()));
+        TEST_ASSERT_FALSE(firmware.finish());
+        TEST_ASSERT_FALSE(writer.begun);
+    }
+
+    std::vector<uint8_t> image(4096);
+    for (size_t i = 0; i < image.size(); ++i) {
+        image[i] = otaFirmwareByte(i);
+    }
+
+    {   // Rejected by the header check (e.g. version rolled back before)
+        FileOtaWriter writer(1024 * 1024);
+        size_t checked = 0;
+        FirmwareStream firmware(&writer, [&](const uint8_t *_header, size_t _len) { checked = _len; return false; });
+        TEST_ASSERT_FALSE(firmware.write(image.data(), image.size()));
+        TEST_ASSERT_EQUAL_INT(OTA_FIRMWARE_HEADER_LEN, checked);
+        TEST_ASSERT_FALSE(writer.begun);
+    }
+
+    {   // Too short
+        FileOtaWriter writer(1024 * 1024);
+        FirmwareStream firmware(&writer);
+        TEST_ASSERT_TRUE(firmware.write(image.data(), 100));
+        TEST_ASSERT_FALSE(firmware.finish());
+        TEST_ASSERT_FALSE(writer.begun);
+    }
+
+    {   // Partition too small
+        FileOtaWriter writer(2048);
+        FirmwareStream firmware(&writer);
+        TEST_ASSERT_FALSE(firmware.write(image.data(), image.size()));
+        TEST_ASSERT_FALSE(firmware.finish());
+        TEST_ASSERT_TRUE(writer.aborted);
+        TEST_ASSERT_FALSE(writer.booted);
+        TEST_ASSERT_EQUAL_STRING("Partition full", firmware.getError().c_str());
+    }
+
+    remove(OTA_TEST_PARTITION);
+}
+
+
+/**
+ * @brief Extracts the ZIP while it is "received": firmware into the partition, other files into memory
+ */
+static bool otaStreamZip(const unsigned char *_zip, size_t _len, size_t _piece, FileOtaWriter *_writer,
+                         std::map<std::string, std::string> *_files, std::vector<std::string> *_ended)
+{
+    FirmwareStream firmware(_writer);
+    ZipStreamHandler handler;
+
+    handler.begin = [&](const ZipEntry &_entry) -> ZipWrite {
+        if (_entry.name == "firmware.bin") {
+            return [&](const void *_data, size_t _len) { return firmware.write(_data, _len); };
+        }
+        std::string *content = &(*_files)[_entry.name];
+        return [content](const void *_data, size_t _len) { content->append((const char*)_data, _len); return true; };
+    };
+    handler.end = [&](const ZipEntry &_entry, bool _ok) {
+        _ended->push_back(_entry.name + (_ok ? "" : " failed"));
+        return _ok;
+    };
+
+    ZipStreamReader zip(handler);
+    for (size_t pos = 0; pos < _len; pos += _piece) {
+        if (!zip.feed(_zip + pos, std::min(_piece, _len - pos))) {
+            return false;
+        }
+    }
+    return zip.finish() && firmware.finish();
+}
+
+
+void test_ota_writer_zip()
+{
+    size_t pieces[] = { 1, 7, 1024, sizeof(otaTestZip) };
+
+    for (size_t piece : pieces) {
+        FileOtaWriter writer(1024 * 1024);
+        std::map<std::string, std::string> files;
+        std::vector<std::string> ended;
+
+        TEST_ASSERT_TRUE(otaStreamZip(otaTestZip, sizeof(otaTestZip), piece, &writer, &files, &ended));
+        TEST_ASSERT_TRUE(writer.booted);
+        TEST_ASSERT_TRUE(otaPartitionMatches(OTA_TEST_FIRMWARE_SIZE));
+
+        TEST_ASSERT_EQUAL_INT(1, files.size());
+        TEST_ASSERT_EQUAL_STRING("<html>stream</html>", files["html/index.html"].c_str());
+        TEST_ASSERT_EQUAL_INT(2, ended.size());         // Directories are not handed over
+        TEST_ASSERT_EQUAL_STRING("firmware.bin", ended[0].c_str());
+        TEST_ASSERT_EQUAL_STRING("html/index.html", ended[1].c_str());
+    }
+
+    // Damaged compressed data -> the firmware is not activated
+    std::vector<unsigned char> damaged(otaTestZip, otaTestZip + sizeof(otaTestZip));
+    damaged[200] ^= 0x55;
+    {
+        FileOtaWriter writer(1024 * 1024);
+        std::map<std::string, std::string> files;
+        std::vector<std::string> ended;
+
+        TEST_ASSERT_FALSE(otaStreamZip(damaged.data(), damaged.size(), 512, &writer, &files, &ended));
+        TEST_ASSERT_FALSE(writer.booted);
+        TEST_ASSERT_EQUAL_STRING("firmware.bin failed", ended[0].c_str());
+    }
+
+    // Cut off -> incomplete
+    {
+        FileOtaWriter writer(1024 * 1024);
+        std::map<std::string, std::string> files;
+        std::vector<std::string> ended;
+
+        TEST_ASSERT_FALSE(otaStreamZip(otaTestZip, 1000, 512, &writer, &files, &ended));
+        TEST_ASSERT_FALSE(writer.booted);
+    }
+
+    remove(OTA_TEST_PARTITION);
+}
+
+
+void test_ota_writer()
+{
+    test_ota_writer_bin();
+    test_ota_writer_reject();
+    test_ota_writer_zip();
+}
@@ -0,0 +1,151 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include "web_bundle.h"
+#include "miniz.h"
+
+#define BUNDLE_TEST_DIR "/sdcard/test_web_bundle/"
+
+
+static const char *bundleTestContent[] = { "console.log(1);", "body { margin: 0; }", "<html>bundled</html>" };
+
+static WebBundleAsset bundleTestAssets[] = {
+    { "a.js", (const uint8_t*) "gz-a", 4, 0, 0, "\"a\"" },
+    { "b.css", (const uint8_t*) "gz-b", 4, 0, 0, "\"b\"" },
+    { "c.html", (const uint8_t*) "gz-c", 4, 0, 0, "\"c\"" },
+};
+
+static uint16_t bundleTestSlots[8];
+
+
+static void writeBundleTestFile(const std::string &_name, const std::string &_content)
+{
+    FILE *file = fopen((BUNDLE_TEST_DIR + _name).c_str(), "wb");
+    if (file != NULL) {
+        fwrite(_content.data(), 1, _content.size(), file);
+        fclose(file);
+    }
+}
+
+
+/**
+ * @brief Builds the index like make-web-bundle.py does
+ */
+static WebBundleIndex makeBundleTestIndex(void)
+{
+    WebBundleIndex index = { bundleTestAssets, 3, bundleTestSlots, 8, 0 };
+
+    for (int i = 0; i < 3; ++i) {
+        bundleTestAssets[i].originalSize = strlen(bundleTestContent[i]);
+        bundleTestAssets[i].originalCrc32 = mz_crc32(MZ_CRC32_INIT, (const uint8_t*) bundleTestContent[i], strlen(bundleTestContent[i]));
+    }
+
+    for (;; index.seed++) {
+        memset(bundleTestSlots, 0, sizeof(bundleTestSlots));
+        bool collision = false;
+        for (int i = 0; i < 3; ++i) {
+            uint16_t &slot = bundleTestSlots[web_bundle_hash(bundleTestAssets[i].path, index.seed) % 8];
+            collision = collision || (slot != 0);
+            slot = i + 1;
+        }
+        if (!collision) {
+            return index;
+        }
+    }
+}
+
+
+/**
+ * @brief Same hash as the generator: "index.html" with seed 8 lands in slot 25 of 32 (see make-web-bundle.py)
+ */
+void test_web_bundle_hash()
+{
+    TEST_ASSERT_EQUAL_INT(25, web_bundle_hash("index.html", 8) % 32);
+}
+
+
+/**
+ * @brief Only bundled paths are found, everything else goes to the SD card
+ */
+void test_web_bundle_lookup()
+{
+    WebBundleIndex index = makeBundleTestIndex();
+    WebBundle bundle(index, BUNDLE_TEST_DIR);
+
+    TEST_ASSERT_TRUE(bundle.lookup("a.js") == &bundleTestAssets[0]);
+    TEST_ASSERT_TRUE(bundle.lookup("b.css") == &bundleTestAssets[1]);
+    TEST_ASSERT_TRUE(bundle.lookup("c.html") == &bundleTestAssets[2]);
+
+    // Some of them share a slot with a bundled file
+    for (int i = 0; i < 50; ++i) {
+        TEST_ASSERT_NULL(bundle.lookup("other" + std::to_string(i) + ".js"));
+    }
+    TEST_ASSERT_NULL(bundle.lookup(""));
+
+    WebBundleIndex empty = { NULL, 0, NULL, 0, 0 };
+    WebBundle emptyBundle(empty, BUNDLE_TEST_DIR);
+    TEST_ASSERT_NULL(emptyBundle.find("a.js"));
+}
+
+
+/**
+ * @brief A different file on the SD card wins, the same one (plain or .gz) does not
+ */
+void test_web_bundle_override()
+{
+    WebBundleIndex index = makeBundleTestIndex();
+    WebBundle bundle(index, BUNDLE_TEST_DIR);
+
+    writeBundleTestFile("b.css", bundleTestContent[1]);                 // Same as bundled
+    writeBundleTestFile("c.html", "<html>modified</html>");             // Modified by the user
+
+    TEST_ASSERT_NOT_NULL(bundle.find("a.js"));                          // Not on the SD card at all
+    TEST_ASSERT_NOT_NULL(bundle.find("b.css"));
+    TEST_ASSERT_NULL(bundle.find("c.html"));
+    TEST_ASSERT_EQUAL_INT(1, bundle.getOverrideCount());
+
+    // Only checked again after invalidate()
+    writeBundleTestFile("c.html", bundleTestContent[2]);
+    TEST_ASSERT_NULL(bundle.find("c.html"));
+    bundle.invalidate();
+    TEST_ASSERT_NOT_NULL(bundle.find("c.html"));
+
+    // Release: gzip files, the trailer has CRC32 and size of the content
+    uint32_t crc = bundleTestAssets[0].originalCrc32;
+    uint32_t size = bundleTestAssets[0].originalSize;
+    std::string gz = "gzip-data";
+    for (int i = 0; i < 4; ++i) {
+        gz += (char)((crc >> (8 * i)) & 0xff);
+    }
+    for (int i = 0; i < 4; ++i) {
+        gz += (char)((size >> (8 * i)) & 0xff);
+    }
+    writeBundleTestFile("a.js.gz", gz);
+    bundle.invalidate();
+    TEST_ASSERT_NOT_NULL(bundle.find("a.js"));
+
+    gz[gz.size() - 8] ^= 1;
+    writeBundleTestFile("a.js.gz", gz);
+    bundle.invalidate();
+    TEST_ASSERT_NULL(bundle.find("a.js"));
+    TEST_ASSERT_EQUAL_INT(1, bundle.getOverrideCount());
+}
+
+
+void test_web_bundle()
+{
+    mkdir(BUNDLE_TEST_DIR, 0775);
+
+    test_web_bundle_hash();
+    test_web_bundle_lookup();
+    test_web_bundle_override();
+
+    const char *names[] = { "b.css", "c.html", "a.js.gz" };
+    for (const char *name : names) {
+        remove((std::string(BUNDLE_TEST_DIR) + name).c_str());
+    }
+    rmdir(BUNDLE_TEST_DIR);
+}
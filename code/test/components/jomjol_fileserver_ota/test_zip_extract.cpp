@@ -0,0 +1,242 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include "zip_extract.h"
+
+#define ZIP_TEST_FILE "/sdcard/test_zip_extract.zip"
+#define ZIP_TEST_HTML "/sdcard/test_zip_extract.html"
+
+/* Created with Python's zipfile:
+ *   config/          directory
+ *   firmware.bin     307200 bytes, byte i = (i * 7 + (i >> 10)) & 0xff, deflated
+ *   html/index.html  "<html>update</html>\n", stored */
+static const unsigned char testZip[] = {
+    0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x63, 0x6f,
+    0x6e, 0x66, 0x69, 0x67, 0x2f, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0x60,
+    0xba, 0x50, 0x5d, 0xfe, 0xa2, 0x54, 0x7a, 0x1a, 0x07, 0x00, 0x00, 0x00, 0xb0, 0x04, 0x00, 0x0c,
+    0x00, 0x00, 0x00, 0x66, 0x69, 0x72, 0x6d, 0x77, 0x61, 0x72, 0x65, 0x2e, 0x62, 0x69, 0x6e, 0xed,
+    0xd0, 0x03, 0x02, 0x28, 0x04, 0x02, 0x40, 0xc1, 0x9f, 0x6d, 0xdb, 0xb6, 0x6d, 0xdb, 0xb6, 0xdb,
+    0x6c, 0xdb, 0xb6, 0x6d, 0xdb, 0xb6, 0xb5, 0x5b, 0x6d, 0xb6, 0x6d, 0xbb, 0x83, 0xbc, 0x39, 0xc2,
+    0xcc, 0x80, 0x21, 0x86, 0x1f, 0x6d, 0xdc, 0x49, 0xa6, 0x9e, 0x69, 0xce, 0x05, 0x16, 0x5f, 0x6e,
+    0xd5, 0x75, 0x36, 0xfe, 0xcf, 0x0e, 0xbb, 0xef, 0x77, 0xe8, 0x31, 0x27, 0x9f, 0x75, 0xe1, 0x15,
+    0xd7, 0xdf, 0x76, 0xef, 0x23, 0x4f, 0xbf, 0xf0, 0xda, 0xbb, 0x9f, 0x7c, 0xfd, 0xd3, 0x9f, 0x83,
+    0x0c, 0x3d, 0xd2, 0x98, 0x13, 0x4c, 0x3e, 0xdd, 0xac, 0xf3, 0x2c, 0xbc, 0xd4, 0x8a, 0x6b, 0xac,
+    0xbf, 0xd9, 0x36, 0x3b, 0xef, 0x75, 0xe0, 0x11, 0xc7, 0x9f, 0x76, 0xee, 0x25, 0x57, 0xdf, 0x74,
+    0xe7, 0x03, 0x8f, 0x3f, 0xf7, 0xd2, 0x9b, 0x1f, 0x7c, 0xfe, 0xdd, 0xaf, 0xff, 0x0c, 0x3e, 0xdc,
+    0xa8, 0xe3, 0x4c, 0x3c, 0xd5, 0x8c, 0x73, 0xcc, 0xbf, 0xd8, 0xb2, 0xab, 0xac, 0xbd, 0xd1, 0x96,
+    0xdb, 0xef, 0xb6, 0xef, 0x21, 0x47, 0x9f, 0x74, 0xe6, 0x05, 0x97, 0x5f, 0x77, 0xeb, 0x3d, 0x0f,
+    0x3f, 0xf5, 0xfc, 0xab, 0xef, 0x7c, 0xfc, 0xd5, 0x8f, 0x7f, 0x0c, 0x3c, 0xd4, 0x88, 0x63, 0x8c,
+    0x3f, 0xd9, 0xb4, 0xb3, 0xcc, 0xbd, 0xd0, 0x92, 0x2b, 0xac, 0xbe, 0xde, 0xa6, 0x5b, 0xef, 0xb4,
+    0xe7, 0x01, 0x87, 0x1f, 0x77, 0xea, 0x39, 0x17, 0x5f, 0x75, 0xe3, 0x1d, 0xf7, 0x3f, 0xf6, 0xec,
+    0xff, 0xdf, 0x78, 0xff, 0xb3, 0x6f, 0x7f, 0xf9, 0x7b, 0xb0, 0x61, 0x47, 0x19, 0x7b, 0xa2, 0x29,
+    0x67, 0x98, 0x7d, 0xbe, 0x45, 0x97, 0x59, 0x79, 0xad, 0x0d, 0xb7, 0xd8, 0x6e, 0xd7, 0x7d, 0x0e,
+    0x3e, 0xea, 0xc4, 0x33, 0xce, 0xbf, 0xec, 0xda, 0x5b, 0xee, 0x7e, 0xe8, 0xc9, 0xff, 0xbd, 0xf2,
+    0xf6, 0x47, 0x5f, 0xfe, 0xf0, 0xfb, 0x40, 0x43, 0x8e, 0x30, 0xfa, 0x78, 0x93, 0x4e, 0x33, 0xf3,
+    0x5c, 0x0b, 0x2e, 0xb1, 0xfc, 0x6a, 0xeb, 0x6e, 0xb2, 0xd5, 0x8e, 0x7b, 0xec, 0x7f, 0xd8, 0xb1,
+    0xa7, 0x9c, 0x7d, 0xd1, 0x95, 0x37, 0xdc, 0x7e, 0xdf, 0xa3, 0xcf, 0xbc, 0xf8, 0xfa, 0x7b, 0x9f,
+    0x7e, 0xf3, 0xf3, 0x5f, 0x83, 0x0e, 0x33, 0xf2, 0x58, 0x13, 0x4e, 0x31, 0xfd, 0x6c, 0xf3, 0x2e,
+    0xb2, 0xf4, 0x4a, 0x6b, 0x6e, 0xb0, 0xf9, 0xb6, 0xbb, 0xec, 0x7d, 0xd0, 0x91, 0x27, 0x9c, 0x7e,
+    0xde, 0xa5, 0xd7, 0xdc, 0x7c, 0xd7, 0x83, 0x4f, 0xfc, 0xf7, 0xe5, 0xb7, 0x3e, 0xfc, 0xe2, 0xfb,
+    0xdf, 0x06, 0xf0, 0xf3, 0x87, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf,
+    0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9,
+    0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9,
+    0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7,
+    0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45,
+    0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e,
+    0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf,
+    0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e,
+    0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92,
+    0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3,
+    0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae,
+    0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b,
+    0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc,
+    0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf,
+    0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd,
+    0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24,
+    0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7,
+    0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d,
+    0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17,
+    0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9,
+    0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f,
+    0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa,
+    0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48,
+    0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf,
+    0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb,
+    0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f,
+    0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2,
+    0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe,
+    0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5,
+    0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91,
+    0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f,
+    0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77,
+    0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f,
+    0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4,
+    0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc,
+    0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb,
+    0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22,
+    0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f,
+    0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef,
+    0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf,
+    0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9,
+    0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9,
+    0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7,
+    0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45,
+    0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e,
+    0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf,
+    0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e,
+    0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92,
+    0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3,
+    0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae,
+    0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b,
+    0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc,
+    0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf,
+    0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd,
+    0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24,
+    0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7,
+    0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d,
+    0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17,
+    0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9,
+    0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f,
+    0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa,
+    0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48,
+    0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf,
+    0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb,
+    0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f,
+    0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2,
+    0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe,
+    0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5,
+    0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91,
+    0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f,
+    0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77,
+    0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f,
+    0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4,
+    0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc,
+    0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb,
+    0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22,
+    0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f,
+    0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef,
+    0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf,
+    0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9,
+    0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9,
+    0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7,
+    0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45,
+    0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e,
+    0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf,
+    0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e,
+    0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92,
+    0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b, 0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3,
+    0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc, 0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae,
+    0x5f, 0x24, 0x3f, 0x7f, 0xd7, 0x2f, 0x92, 0x9f, 0xbf, 0xeb, 0x17, 0xc9, 0xcf, 0xdf, 0xf5, 0x8b,
+    0xe4, 0xe7, 0xef, 0xfa, 0x45, 0xf2, 0xf3, 0x77, 0xfd, 0x22, 0xf9, 0xf9, 0xbb, 0x7e, 0x91, 0xfc,
+    0xfc, 0x5d, 0xbf, 0x48, 0x7e, 0xfe, 0xae, 0xff, 0x5f, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x60, 0xba, 0x50, 0x5d, 0xe4, 0xff, 0x4b, 0xf5, 0x14, 0x00, 0x00, 0x00, 0x14,
+    0x00, 0x00, 0x00, 0x0f, 0x00, 0x00, 0x00, 0x68, 0x74, 0x6d, 0x6c, 0x2f, 0x69, 0x6e, 0x64, 0x65,
+    0x78, 0x2e, 0x68, 0x74, 0x6d, 0x6c, 0x3c, 0x68, 0x74, 0x6d, 0x6c, 0x3e, 0x75, 0x70, 0x64, 0x61,
+    0x74, 0x65, 0x3c, 0x2f, 0x68, 0x74, 0x6d, 0x6c, 0x3e, 0x0a, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03,
+    0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x63, 0x6f, 0x6e, 0x66, 0x69, 0x67, 0x2f, 0x50,
+    0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0x60, 0xba, 0x50, 0x5d, 0xfe,
+    0xa2, 0x54, 0x7a, 0x1a, 0x07, 0x00, 0x00, 0x00, 0xb0, 0x04, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0x25, 0x00, 0x00, 0x00, 0x66, 0x69, 0x72,
+    0x6d, 0x77, 0x61, 0x72, 0x65, 0x2e, 0x62, 0x69, 0x6e, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0xba, 0x50, 0x5d, 0xe4, 0xff, 0x4b, 0xf5, 0x14, 0x00, 0x00,
+    0x00, 0x14, 0x00, 0x00, 0x00, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x80, 0x01, 0x69, 0x07, 0x00, 0x00, 0x68, 0x74, 0x6d, 0x6c, 0x2f, 0x69, 0x6e, 0x64, 0x65,
+    0x78, 0x2e, 0x68, 0x74, 0x6d, 0x6c, 0x50, 0x4b, 0x05, 0x06, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00,
+    0x03, 0x00, 0xac, 0x00, 0x00, 0x00, 0xaa, 0x07, 0x00, 0x00, 0x00, 0x00,
+};
+
+static uint8_t firmwareByte(size_t _i)
+{
+    return (_i * 7 + (_i >> 10)) & 0xff;
+}
+
+
+static bool writeTestZip()
+{
+    FILE *file = fopen(ZIP_TEST_FILE, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = (fwrite(testZip, 1, sizeof(testZip), file) == sizeof(testZip));
+    return (fclose(file) == 0) && ok;
+}
+
+
+/**
+ * @brief The entries get extracted piece by piece, the memory needed does not depend on their size
+ */
+void test_zip_extract_stream()
+{
+    TEST_ASSERT_TRUE(writeTestZip());
+
+    ZipExtractor zip;
+    ZipEntry entry;
+    TEST_ASSERT_TRUE(zip.open(ZIP_TEST_FILE));
+    TEST_ASSERT_EQUAL_INT(3, zip.getEntryCount());
+
+    TEST_ASSERT_TRUE(zip.getEntry(0, &entry));
+    TEST_ASSERT_EQUAL_STRING("config/", entry.name.c_str());
+    TEST_ASSERT_TRUE(entry.isDirectory);
+
+    TEST_ASSERT_TRUE(zip.getEntry(1, &entry));
+    TEST_ASSERT_EQUAL_STRING("firmware.bin", entry.name.c_str());
+    TEST_ASSERT_EQUAL_INT(300 * 1024, entry.size);
+
+    size_t received = 0;
+    int pieces = 0;
+    bool content = true;
+    TEST_ASSERT_TRUE(zip.extract(1, [&](const void *_data, size_t _len) {
+        for (size_t i = 0; i < _len; ++i) {
+            content = content && (((const uint8_t*)_data)[i] == firmwareByte(received + i));
+        }
+        received += _len;
+        pieces++;
+        return true;
+    }));
+    TEST_ASSERT_EQUAL_INT(entry.size, received);
+    TEST_ASSERT_TRUE(content);
+    TEST_ASSERT_TRUE(pieces > 1);
+
+    // Dictionary (32 kB) + read buffer + central directory, but never the whole entry
+    TEST_ASSERT_TRUE(zip.getPeakAllocation() > 0);
+    TEST_ASSERT_TRUE(zip.getPeakAllocation() < 64 * 1024);
+
+    // Writer fails -> extraction stops
+    pieces = 0;
+    TEST_ASSERT_FALSE(zip.extract(1, [&](const void *_data, size_t _len) { pieces++; return false; }));
+    TEST_ASSERT_EQUAL_INT(1, pieces);
+
+    remove(ZIP_TEST_FILE);
+}
+
+
+void test_zip_extract_file()
+{
+    TEST_ASSERT_TRUE(writeTestZip());
+
+    ZipExtractor zip;
+    TEST_ASSERT_TRUE(zip.open(ZIP_TEST_FILE));
+    TEST_ASSERT_TRUE(zip.extractToFile(2, ZIP_TEST_HTML));
+
+    char buffer[64] = "";
+    FILE *file = fopen(ZIP_TEST_HTML, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    fread(buffer, 1, sizeof(buffer) - 1, file);
+    fclose(file);
+    TEST_ASSERT_EQUAL_STRING("<html>update</html>\n", buffer);
+
+    TEST_ASSERT_FALSE(zip.open("/sdcard/does_not_exist.zip"));
+
+    remove(ZIP_TEST_HTML);
+    remove(ZIP_TEST_FILE);
+}
+
+
+void test_zip_extract()
+{
+    test_zip_extract_stream();
+    test_zip_extract_file();
+}
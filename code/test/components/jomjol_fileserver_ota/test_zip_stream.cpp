@@ -0,0 +1,99 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "zip_stream.h"
+#include "zip_extract.h"
+
+#define ZIP_STREAM_TEST_FILE "/sdcard/test_zip_stream.zip"
+
+
+/**
+ * @brief A streamed archive can be read back by miniz, small headers are sent together
+ */
+void test_zip_stream()
+{
+    std::string archive;
+    int chunks = 0;
+    ZipStreamWriter zip([&](const char *_data, size_t _len) {
+        archive.append(_data, _len);
+        chunks++;
+        return true;
+    });
+
+    std::string large(2 * ZIP_STREAM_BUFFER_SIZE + 5, 'j');
+    struct tm modified = {};
+    modified.tm_year = 124;
+    modified.tm_mon = 0;
+    modified.tm_mday = 31;
+    modified.tm_hour = 23;
+
+    TEST_ASSERT_TRUE(zip.beginEntry("20240131/23/7_main_dig1_20240131-230000.jpg", &modified));
+    TEST_ASSERT_TRUE(zip.write("small", 5));
+    TEST_ASSERT_TRUE(zip.write(" image", 6));
+    TEST_ASSERT_TRUE(zip.endEntry());
+    TEST_ASSERT_TRUE(zip.beginEntry("20240131/23/raw_20240131-230000.jpg"));
+    TEST_ASSERT_TRUE(zip.write(large.data(), large.length()));
+    TEST_ASSERT_TRUE(zip.beginEntry("empty.jpg"));        // Closes the previous entry
+    TEST_ASSERT_TRUE(zip.finish());
+    TEST_ASSERT_EQUAL_INT(3, zip.getEntryCount());
+    TEST_ASSERT_EQUAL_INT(3, chunks);                        // Headers + small image, large image, rest
+
+    FILE *pFile = fopen(ZIP_STREAM_TEST_FILE, "wb");
+    fwrite(archive.data(), 1, archive.length(), pFile);
+    fclose(pFile);
+
+    ZipExtractor extractor;
+    TEST_ASSERT_TRUE(extractor.open(ZIP_STREAM_TEST_FILE));
+    TEST_ASSERT_EQUAL_INT(3, extractor.getEntryCount());
+
+    ZipEntry entry;
+    std::string content;
+    auto collect = [&](const void *_data, size_t _len) {
+        content.append((const char*) _data, _len);
+        return true;
+    };
+
+    TEST_ASSERT_TRUE(extractor.getEntry(0, &entry));
+    TEST_ASSERT_EQUAL_STRING("20240131/23/7_main_dig1_20240131-230000.jpg", entry.name.c_str());
+    TEST_ASSERT_TRUE(extractor.extract(0, collect));
+    TEST_ASSERT_EQUAL_STRING("small image", content.c_str());
+
+    content.clear();
+    TEST_ASSERT_TRUE(extractor.extract(1, collect));
+    TEST_ASSERT_TRUE(large == content);
+
+    TEST_ASSERT_TRUE(extractor.getEntry(2, &entry));
+    TEST_ASSERT_EQUAL_INT(0, entry.size);
+
+    extractor.close();
+
+    // The central directory grows while the entries get added
+    archive.clear();
+    ZipStreamWriter many([&](const char *_data, size_t _len) {
+        archive.append(_data, _len);
+        return true;
+    });
+    for (int i = 0; i < 300; ++i) {
+        TEST_ASSERT_TRUE(many.beginEntry("20240131/23/" + std::to_string(i) + "_main_dig1_20240131-230000.jpg"));
+        TEST_ASSERT_TRUE(many.write("x", 1));
+    }
+    TEST_ASSERT_TRUE(many.finish());
+
+    pFile = fopen(ZIP_STREAM_TEST_FILE, "wb");
+    fwrite(archive.data(), 1, archive.length(), pFile);
+    fclose(pFile);
+
+    TEST_ASSERT_TRUE(extractor.open(ZIP_STREAM_TEST_FILE));
+    TEST_ASSERT_EQUAL_INT(300, extractor.getEntryCount());
+    TEST_ASSERT_TRUE(extractor.getEntry(299, &entry));
+    TEST_ASSERT_EQUAL_STRING("20240131/23/299_main_dig1_20240131-230000.jpg", entry.name.c_str());
+    extractor.close();
+    remove(ZIP_STREAM_TEST_FILE);
+
+    // A failed sink stops everything
+    ZipStreamWriter failing([](const char *_data, size_t _len) { return false; });
+    failing.beginEntry("a.jpg");
+    TEST_ASSERT_FALSE(failing.write(large.data(), large.length()));
+    TEST_ASSERT_FALSE(failing.finish());
+}
@@ -0,0 +1,146 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "http_client_pool.h"
+
+/**
+ * @brief Stand-in for the server: counts the opened TCP connections and can drop them
+ */
+struct FakeServer {
+    int connects = 0;
+    int open = 0;
+    int requests = 0;
+    bool dropNext = false;          // Server closes the connection, the request fails
+    int64_t time = 0;
+    std::vector<std::string> hosts;
+
+    HttpPoolTransport transport() {
+        HttpPoolTransport t;
+        t.open = [this](const std::string &_hostKey) {
+            connects++;
+            open++;
+            hosts.push_back(_hostKey);
+            return (void*)new int(connects);
+        };
+        t.close = [this](void *_connection) {
+            open--;
+            delete (int*)_connection;
+        };
+        t.perform = [this](void *_connection, const HttpPoolRequest &_request, HttpPoolResult &_result) {
+            requests++;
+            if (dropNext) {
+                dropNext = false;
+                _result.err = -1;
+                return false;
+            }
+            _result.err = 0;
+            _result.status = 204;
+            return true;
+        };
+        t.now = [this]() { return time; };
+        return t;
+    }
+};
+
+
+static HttpPoolRequest poolRequest(const std::string &_url)
+{
+    HttpPoolRequest request;
+    request.url = _url;
+    request.body = "value=1";
+    request.bodyLen = 7;
+    return request;
+}
+
+
+/**
+ * @brief 100 rounds to the same server need a single connection
+ */
+void test_http_client_pool_reuse()
+{
+    FakeServer server;
+    HttpClientPool pool(server.transport(), 2, 120 * 1000000LL);
+
+    for (int i = 0; i < 100; ++i) {
+        server.time += 30 * 1000000LL;
+        TEST_ASSERT_TRUE(pool.perform(poolRequest("http://influx.local:8086/write?db=meter")).ok());
+    }
+
+    TEST_ASSERT_EQUAL_INT(100, server.requests);
+    TEST_ASSERT_EQUAL_INT(1, server.connects);
+    TEST_ASSERT_EQUAL_INT(1, pool.getOpened());
+    TEST_ASSERT_EQUAL_INT(99, pool.getReused());
+    TEST_ASSERT_EQUAL_INT(1, pool.getOpenConnections());
+
+    pool.closeAll();
+    TEST_ASSERT_EQUAL_INT(0, server.open);
+}
+
+
+/**
+ * @brief Each host gets its own connection, the least recently used one is closed for a new host
+ */
+void test_http_client_pool_hosts()
+{
+    FakeServer server;
+    HttpClientPool pool(server.transport(), 2, 120 * 1000000LL);
+
+    for (int i = 0; i < 10; ++i) {
+        server.time += 1000000;
+        pool.perform(poolRequest("http://influx.local:8086/write"));
+        pool.perform(poolRequest("http://hook.local/api?timestamp=" + std::to_string(i)));
+    }
+    TEST_ASSERT_EQUAL_INT(2, server.connects);
+    TEST_ASSERT_EQUAL_INT(2, server.open);
+
+    // Pool is full -> the connection to influx.local was used least recently
+    server.time += 1000000;
+    pool.perform(poolRequest("https://cloud.example.com/write"));
+    TEST_ASSERT_EQUAL_INT(3, server.connects);
+    TEST_ASSERT_EQUAL_INT(2, server.open);
+    TEST_ASSERT_EQUAL_STRING("https://cloud.example.com:443", server.hosts.back().c_str());
+
+    pool.perform(poolRequest("http://hook.local/api"));
+    TEST_ASSERT_EQUAL_INT(3, server.connects);
+}
+
+
+/**
+ * @brief A broken or idle connection is not used again
+ */
+void test_http_client_pool_reconnect()
+{
+    FakeServer server;
+    HttpClientPool pool(server.transport(), 2, 120 * 1000000LL);
+
+    pool.perform(poolRequest("http://influx.local:8086/write"));
+    server.dropNext = true;
+    TEST_ASSERT_FALSE(pool.perform(poolRequest("http://influx.local:8086/write")).ok());
+    TEST_ASSERT_EQUAL_INT(0, server.open);
+
+    TEST_ASSERT_TRUE(pool.perform(poolRequest("http://influx.local:8086/write")).ok());
+    TEST_ASSERT_EQUAL_INT(2, server.connects);
+
+    server.time += 121 * 1000000LL;
+    pool.perform(poolRequest("http://influx.local:8086/write"));
+    TEST_ASSERT_EQUAL_INT(3, server.connects);
+    TEST_ASSERT_EQUAL_INT(1, server.open);
+}
+
+
+void test_http_client_pool_hostkey()
+{
+    TEST_ASSERT_EQUAL_STRING("http://influx.local:8086", HttpClientPool::hostKey("http://influx.local:8086/write?db=x").c_str());
+    TEST_ASSERT_EQUAL_STRING("http://influx.local:80", HttpClientPool::hostKey("HTTP://Influx.local?db=x").c_str());
+    TEST_ASSERT_EQUAL_STRING("https://hook.local:443", HttpClientPool::hostKey("https://user:pw@hook.local/api").c_str());
+    TEST_ASSERT_EQUAL_STRING("http://192.168.1.5:80", HttpClientPool::hostKey("192.168.1.5").c_str());
+}
+
+
+void test_http_client_pool()
+{
+    test_http_client_pool_reuse();
+    test_http_client_pool_hosts();
+    test_http_client_pool_reconnect();
+    test_http_client_pool_hostkey();
+}
@@ -0,0 +1,113 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "image_log_store.h"
+
+#define IMAGE_LOG_TEST_DIR "/sdcard/test_image_log"
+
+
+static bool appendTestImage(ImageLogStore &_store, const std::string &_time, const std::string &_name,
+                            const std::string &_result, const std::string &_data)
+{
+    // Written in two parts like the JPEG encoder does
+    return _store.Begin(_time, _name, _result) &&
+           _store.Write(_data.data(), _data.length() / 2) &&
+           _store.Write(_data.data() + _data.length() / 2, _data.length() - _data.length() / 2) &&
+           _store.Commit();
+}
+
+
+static std::string readTestImage(ImageLogStore &_store, const std::string &_day, const ImageLogRecord &_record)
+{
+    std::string data;
+    _store.ReadImage(_day, _record, [&](const char *_data, size_t _len) {
+        data.append(_data, _len);
+        return true;
+    });
+    return data;
+}
+
+
+/**
+ * @brief Images come back with their index data, a record without complete index entry is ignored
+ */
+void test_image_log_store_append()
+{
+    mkdir(IMAGE_LOG_TEST_DIR, 0775);
+    ImageLogStore store(IMAGE_LOG_TEST_DIR);
+
+    std::string large(3 * IMAGE_LOG_READ_CHUNK + 17, 'x');
+    TEST_ASSERT_TRUE(appendTestImage(store, "20240130-235901", "raw", "", "source image"));
+    TEST_ASSERT_TRUE(appendTestImage(store, "20240131-000101", "main_dig1", "7", "digit one"));
+    TEST_ASSERT_TRUE(appendTestImage(store, "20240131-000101", "main_ana1", "N.N", large));
+
+    // Aborted image and a torn index record (power loss while writing)
+    TEST_ASSERT_TRUE(store.Begin("20240131-000201", "main_dig1", "8"));
+    TEST_ASSERT_TRUE(store.Write("lost", 4));
+    store.Abort();
+    TEST_ASSERT_FALSE(store.Commit());
+    FILE *index = fopen(IMAGE_LOG_TEST_DIR "/20240131.idx", "ab");
+    fwrite("torn", 1, 4, index);
+    fclose(index);
+
+    std::vector<std::string> days = store.ListDays();
+    TEST_ASSERT_EQUAL_INT(2, days.size());
+    TEST_ASSERT_EQUAL_STRING("20240130", days[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("20240131", days[1].c_str());
+
+    std::vector<ImageLogRecord> records;
+    TEST_ASSERT_TRUE(store.ReadIndex("20240131", records));
+    TEST_ASSERT_EQUAL_INT(2, records.size());
+    TEST_ASSERT_EQUAL_STRING("main_dig1", records[0].name.c_str());
+    TEST_ASSERT_EQUAL_STRING("7", records[0].result.c_str());
+    TEST_ASSERT_EQUAL_STRING("7_main_dig1_20240131-000101.jpg", records[0].getFileName().c_str());
+    TEST_ASSERT_EQUAL_INT(0, records[0].offset);
+    TEST_ASSERT_EQUAL_INT(9, records[1].offset);
+    TEST_ASSERT_EQUAL_INT(large.length(), records[1].length);
+
+    TEST_ASSERT_EQUAL_STRING("digit one", readTestImage(store, "20240131", records[0]).c_str());
+    TEST_ASSERT_TRUE(large == readTestImage(store, "20240131", records[1]));
+
+    // Sink aborts
+    int calls = 0;
+    TEST_ASSERT_FALSE(store.ReadImage("20240131", records[1], [&](const char *_data, size_t _len) { return ++calls < 2; }));
+    TEST_ASSERT_EQUAL_INT(2, calls);
+
+    TEST_ASSERT_TRUE(store.ReadIndex("20240130", records));
+    TEST_ASSERT_EQUAL_INT(1, records.size());
+    TEST_ASSERT_EQUAL_STRING("raw_20240130-235901.jpg", records[0].getFileName().c_str());
+    TEST_ASSERT_FALSE(store.ReadIndex("20240129", records));
+}
+
+
+/**
+ * @brief Retention removes the segment and index of the older days only
+ */
+void test_image_log_store_retention()
+{
+    ImageLogStore store(IMAGE_LOG_TEST_DIR);
+
+    TEST_ASSERT_EQUAL_INT(0, store.RemoveOlderThan("20240130"));
+    TEST_ASSERT_EQUAL_INT(1, store.RemoveOlderThan("20240131"));
+
+    std::vector<std::string> days = store.ListDays();
+    TEST_ASSERT_EQUAL_INT(1, days.size());
+    TEST_ASSERT_EQUAL_STRING("20240131", days[0].c_str());
+
+    struct stat file_stat;
+    TEST_ASSERT_EQUAL_INT(-1, stat(IMAGE_LOG_TEST_DIR "/20240130.seg", &file_stat));
+
+    TEST_ASSERT_EQUAL_INT(1, store.RemoveOlderThan("99999999"));
+    TEST_ASSERT_EQUAL_INT(0, store.ListDays().size());
+    rmdir(IMAGE_LOG_TEST_DIR);
+}
+
+
+void test_image_log_store()
+{
+    test_image_log_store_append();
+    test_image_log_store_retention();
+}
@@ -0,0 +1,178 @@
+#include <unity.h>
+#include <vector>
+#include "parallel_for.h"
+#include "CFindTemplate.h"
+#include "CRotateImage.h"
+#include "CAlignAndCutImage.h"
+
+/**
+ * @brief Every index must be processed exactly once, in contiguous chunks
+ */
+void test_parallel_for_coverage()
+{
+    for (int count = 0; count < 50; ++count) {
+        std::vector<int> hits(count, 0);
+
+        parallel_for(0, count, [&](int _start, int _end) {
+            for (int i = _start; i < _end; ++i) {
+                hits[i]++;
+            }
+        });
+
+        for (int i = 0; i < count; ++i) {
+            TEST_ASSERT_EQUAL_INT(1, hits[i]);
+        }
+    }
+}
+
+/**
+ * @brief A nested call must not block, it runs on the calling task instead
+ */
+void test_parallel_for_nested()
+{
+    std::vector<int> hits(16 * 16, 0);
+
+    parallel_for(0, 16, [&](int _ystart, int _yend) {
+        for (int y = _ystart; y < _yend; ++y) {
+            parallel_for(0, 16, [&](int _xstart, int _xend) {
+                for (int x = _xstart; x < _xend; ++x) {
+                    hits[y * 16 + x]++;
+                }
+            });
+        }
+    });
+
+    for (int i = 0; i < hits.size(); ++i) {
+        TEST_ASSERT_EQUAL_INT(1, hits[i]);
+    }
+}
+
+/* Some structure for the image algorithms, the same on every call */
+static void parallelForFillImage(CImageBasis *_image)
+{
+    for (int y = 0; y < _image->height; ++y) {
+        for (int x = 0; x < _image->width; ++x) {
+            _image->setPixelColor(x, y, (x * 7 + y * 3) % 256, (x * y) % 256, ((x / 8 + y / 8) % 2) * 200);
+        }
+    }
+}
+
+
+/**
+ * @brief The template search finds the same position and SAD with and without pool
+ */
+void test_parallel_for_find_template()
+{
+    CImageBasis image("pf_find", 160, 120, 3);
+    parallelForFillImage(&image);
+
+    CAlignAndCutImage cut("pf_find_cut", image.rgb_image, image.channels, image.width, image.height, image.bpp);
+    CImageBasis *tpl = cut.CutAndSave(70, 40, 24, 20);
+    tpl->SaveToFile("/sdcard/pf_template.jpg");
+    delete tpl;
+
+    RefInfo refs[2];
+    for (int run = 0; run < 2; ++run) {
+        parallel_for_enable(run == 0);
+
+        CFindTemplate find("pf_find_tpl", image.rgb_image, image.channels, image.width, image.height, image.bpp);
+        refs[run].image_file = "/sdcard/pf_template.jpg";
+        refs[run].target_x = 66;
+        refs[run].target_y = 44;
+        refs[run].search_x = 20;
+        refs[run].search_y = 15;
+        refs[run].alignment_algo = 1;
+        find.FindTemplate(&refs[run]);
+    }
+    parallel_for_enable(true);
+
+    TEST_ASSERT_EQUAL_INT(refs[1].found_x, refs[0].found_x);
+    TEST_ASSERT_EQUAL_INT(refs[1].found_y, refs[0].found_y);
+    TEST_ASSERT_EQUAL_MEMORY(&refs[1].found_SAD, &refs[0].found_SAD, sizeof(float));
+}
+
+
+/**
+ * @brief Both rotations give the same image byte by byte with and without pool
+ */
+void test_parallel_for_rotate()
+{
+    CImageBasis *images[2];
+
+    for (int run = 0; run < 2; ++run) {
+        parallel_for_enable(run == 0);
+
+        images[run] = new CImageBasis("pf_rotate", 160, 120, 3);
+        parallelForFillImage(images[run]);
+
+        CRotateImage rotate("pf_rotate_rot", images[run], NULL);
+        rotate.Rotate(3.7f);
+        rotate.RotateAntiAliasing(-1.3f, 70, 50);
+    }
+    parallel_for_enable(true);
+
+    TEST_ASSERT_EQUAL_MEMORY(images[1]->rgb_image, images[0]->rgb_image, 160 * 120 * 3);
+
+    delete images[0];
+    delete images[1];
+}
+
+
+/**
+ * @brief Cutting and resizing the ROIs like ClassFlowCNNGeneral::doAlignAndCut() gives the same images
+ */
+void test_parallel_for_roi_cut()
+{
+    CImageBasis image("pf_roi", 160, 120, 3);
+    parallelForFillImage(&image);
+    CAlignAndCutImage cut("pf_roi_cut", image.rgb_image, image.channels, image.width, image.height, image.bpp);
+
+    const int anzROI = 7;
+    std::vector<CImageBasis*> results[2];
+
+    for (int run = 0; run < 2; ++run) {
+        parallel_for_enable(run == 0);
+
+        std::vector<CImageBasis*> rois;
+        for (int i = 0; i < anzROI; ++i) {
+            rois.push_back(new CImageBasis("pf_roi_org", 17, 29, 3));
+            results[run].push_back(new CImageBasis("pf_roi_resized", 20, 32, 3));
+        }
+
+        parallel_for(0, anzROI, [&](int _start, int _end) {
+            for (int i = _start; i < _end; ++i) {
+                cut.CutAndSave(5 + i * 21, 10 + i * 9, 17, 29, rois[i]);
+                rois[i]->Resize(20, 32, results[run][i]);
+            }
+        });
+
+        for (auto roi : rois) {
+            delete roi;
+        }
+    }
+    parallel_for_enable(true);
+
+    for (int i = 0; i < anzROI; ++i) {
+        TEST_ASSERT_EQUAL_MEMORY(results[1][i]->rgb_image, results[0][i]->rgb_image, 20 * 32 * 3);
+        delete results[0][i];
+        delete results[1][i];
+    }
+
+    // Bodies like these run on the workers, they must not come close to the end of the stack
+    int stackFree = parallel_for_stack_free();
+    if (stackFree >= 0) {
+        TEST_ASSERT_GREATER_OR_EQUAL_INT(PARALLEL_FOR_TASK_STACK_MIN_FREE, stackFree);
+    }
+}
+
+
+void test_parallel_for()
+{
+    parallel_for_init();
+
+    test_parallel_for_coverage();
+    test_parallel_for_nested();
+    test_parallel_for_find_template();
+    test_parallel_for_rotate();
+    test_parallel_for_roi_cut();
+}
@@ -0,0 +1,85 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "publish_spool.h"
+#include "Helper.h"
+
+/**
+ * @brief Records come back in the order they got appended, batched up to the given size
+ */
+void test_publish_spool_replay()
+{
+    removeFolder(SPOOL_ROOT "/test", "TEST");
+    PublishSpool spool("test", 1024, 4);
+    std::vector<std::string> delivered;
+    int requests = 0;
+
+    auto sender = [&](const std::vector<SpoolRecord> &_records) {
+        requests++;
+        for (auto &record : _records) {
+            delivered.push_back(record.payload);
+        }
+        return true;
+    };
+
+    TEST_ASSERT_TRUE(spool.isEmpty());
+    TEST_ASSERT_EQUAL_INT(0, spool.Replay(4096, sender));
+    TEST_ASSERT_EQUAL_INT(0, requests);
+
+    for (int i = 0; i < 10; ++i) {
+        TEST_ASSERT_TRUE(spool.Append("record " + std::to_string(i), 1700000000 + i));
+    }
+    TEST_ASSERT_FALSE(spool.isEmpty());
+
+    // Server still unreachable -> nothing gets lost
+    TEST_ASSERT_EQUAL_INT(-1, spool.Replay(4096, [](const std::vector<SpoolRecord> &_records) { return false; }));
+
+    TEST_ASSERT_EQUAL_INT(4, spool.Replay(32, sender));          // 8 bytes per record
+    TEST_ASSERT_EQUAL_INT(6, spool.Replay(4096, sender));
+    TEST_ASSERT_EQUAL_INT(2, requests);
+    TEST_ASSERT_TRUE(spool.isEmpty());
+
+    TEST_ASSERT_EQUAL_INT(10, delivered.size());
+    for (int i = 0; i < 10; ++i) {
+        TEST_ASSERT_EQUAL_STRING(("record " + std::to_string(i)).c_str(), delivered[i].c_str());
+    }
+}
+
+/**
+ * @brief The size is bounded, the oldest segment gets dropped; the read position survives a restart
+ */
+void test_publish_spool_bounded()
+{
+    removeFolder(SPOOL_ROOT "/test", "TEST");
+    std::string payload(100, 'x');
+
+    {
+        PublishSpool spool("test", 1024, 4);
+        for (int i = 0; i < 45; ++i) {                            // ~110 bytes per record, 9 records per segment
+            spool.Append(payload + std::to_string(i), 1700000000 + i);
+        }
+        TEST_ASSERT_EQUAL_INT(1, spool.getDroppedSegments());
+        TEST_ASSERT_EQUAL_INT(1, spool.Replay(1, [](const std::vector<SpoolRecord> &_records) { return true; }));
+    }
+
+    // Restart: continues behind the replayed record
+    PublishSpool spool("test", 1024, 4);
+    std::vector<SpoolRecord> delivered;
+    spool.Replay(1024 * 1024, [&](const std::vector<SpoolRecord> &_records) {
+        delivered = _records;
+        return true;
+    });
+
+    TEST_ASSERT_EQUAL_INT(45 - 9 - 1, delivered.size());
+    TEST_ASSERT_EQUAL_STRING((payload + "10").c_str(), delivered[0].payload.c_str());
+    TEST_ASSERT_EQUAL_INT(1700000010, delivered[0].time);
+    TEST_ASSERT_TRUE(spool.isEmpty());
+
+    removeFolder(SPOOL_ROOT "/test", "TEST");
+}
+
+void test_publish_spool()
+{
+    test_publish_spool_replay();
+    test_publish_spool_bounded();
+}
@@ -0,0 +1,166 @@
+#include <unity.h>
+#include "CImageBasis.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+/**
+ * @brief Locks and releases an image from a second task, like an HTTP handler does
+ */
+struct ImageLockTask {
+    CImageBasis *image;
+    bool write;
+    int waitmaxsec;
+    bool locked = false;
+    SemaphoreHandle_t done = NULL;
+};
+
+
+static void imageLockTaskMain(void *pvParameter)
+{
+    ImageLockTask *job = (ImageLockTask*) pvParameter;
+
+    if (job->write) {
+        job->locked = (job->image->RGBImageLock(job->waitmaxsec) != NULL);
+        if (job->locked) {
+            job->image->RGBImageRelease();
+        }
+    }
+    else {
+        job->locked = (job->image->RGBImageLockRead(job->waitmaxsec) != NULL);
+        if (job->locked) {
+            job->image->RGBImageReleaseRead();
+        }
+    }
+
+    xSemaphoreGive(job->done);
+    vTaskDelete(NULL);
+}
+
+
+static void imageLockStart(ImageLockTask &_job, CImageBasis *_image, bool _write, int _waitmaxsec)
+{
+    _job.image = _image;
+    _job.write = _write;
+    _job.waitmaxsec = _waitmaxsec;
+    _job.locked = false;
+    _job.done = xSemaphoreCreateBinary();
+    xTaskCreate(&imageLockTaskMain, "image_lock_test", 4 * 1024, &_job, tskIDLE_PRIORITY + 1, NULL);
+}
+
+
+static bool imageLockFinished(ImageLockTask &_job, int _waitms)
+{
+    bool finished = (xSemaphoreTake(_job.done, _waitms / portTICK_PERIOD_MS) == pdTRUE);
+    if (finished) {
+        vSemaphoreDelete(_job.done);
+        _job.done = NULL;
+    }
+    return finished;
+}
+
+
+/**
+ * @brief Both locks are recursive for the owning task, the writer may also read
+ */
+void test_image_lock_nested()
+{
+    CImageBasis image("lock_nested", 8, 8, 3);
+
+    TEST_ASSERT_NOT_NULL(image.RGBImageLock(0));
+    TEST_ASSERT_NOT_NULL(image.RGBImageLock(0));
+    TEST_ASSERT_NOT_NULL(image.RGBImageLockRead(0));
+    image.RGBImageReleaseRead();
+    image.RGBImageRelease();
+
+    ImageLockTask other;
+    imageLockStart(other, &image, false, 0);
+    TEST_ASSERT_TRUE(imageLockFinished(other, 1000));
+    TEST_ASSERT_FALSE(other.locked);        // Still locked once
+
+    image.RGBImageRelease();
+    imageLockStart(other, &image, true, 0);
+    TEST_ASSERT_TRUE(imageLockFinished(other, 1000));
+    TEST_ASSERT_TRUE(other.locked);
+
+    // A reader can not upgrade to a writer
+    TEST_ASSERT_NOT_NULL(image.RGBImageLockRead(0));
+    TEST_ASSERT_NOT_NULL(image.RGBImageLockRead(0));
+    TEST_ASSERT_NULL(image.RGBImageLock(0));
+    image.RGBImageReleaseRead();
+    image.RGBImageReleaseRead();
+}
+
+
+/**
+ * @brief Readers share the image, a writer waits for all of them
+ */
+void test_image_lock_read()
+{
+    CImageBasis image("lock_read", 8, 8, 3);
+    TEST_ASSERT_NOT_NULL(image.RGBImageLockRead(0));
+
+    ImageLockTask reader;
+    imageLockStart(reader, &image, false, 0);
+    TEST_ASSERT_TRUE(imageLockFinished(reader, 1000));
+    TEST_ASSERT_TRUE(reader.locked);
+
+    ImageLockTask writer;
+    imageLockStart(writer, &image, true, 0);
+    TEST_ASSERT_TRUE(imageLockFinished(writer, 1000));
+    TEST_ASSERT_FALSE(writer.locked);
+
+    // The waiting writer gets the lock as soon as the last reader is done
+    imageLockStart(writer, &image, true, 5);
+    TEST_ASSERT_FALSE(imageLockFinished(writer, 200));
+    image.RGBImageReleaseRead();
+    TEST_ASSERT_TRUE(imageLockFinished(writer, 1000));
+    TEST_ASSERT_TRUE(writer.locked);
+}
+
+
+/**
+ * @brief A writer excludes everybody else and is preferred to new readers
+ */
+void test_image_lock_write()
+{
+    CImageBasis image("lock_write", 8, 8, 3);
+    TEST_ASSERT_NOT_NULL(image.RGBImageLock(0));
+
+    ImageLockTask reader;
+    imageLockStart(reader, &image, false, 0);
+    TEST_ASSERT_TRUE(imageLockFinished(reader, 1000));
+    TEST_ASSERT_FALSE(reader.locked);
+    image.RGBImageRelease();
+
+    // Writer waits for the reader of this task, new readers wait for the writer
+    TEST_ASSERT_NOT_NULL(image.RGBImageLockRead(0));
+    ImageLockTask writer;
+    imageLockStart(writer, &image, true, 5);
+    vTaskDelay(100 / portTICK_PERIOD_MS);
+
+    imageLockStart(reader, &image, false, 0);
+    TEST_ASSERT_TRUE(imageLockFinished(reader, 1000));
+    TEST_ASSERT_FALSE(reader.locked);
+
+    // ... but a task which already reads may read again (no deadlock)
+    TEST_ASSERT_NOT_NULL(image.RGBImageLockRead(0));
+    image.RGBImageReleaseRead();
+
+    image.RGBImageReleaseRead();
+    TEST_ASSERT_TRUE(imageLockFinished(writer, 1000));
+    TEST_ASSERT_TRUE(writer.locked);
+
+    imageLockStart(reader, &image, false, 0);
+    TEST_ASSERT_TRUE(imageLockFinished(reader, 1000));
+    TEST_ASSERT_TRUE(reader.locked);
+}
+
+
+void test_image_lock()
+{
+    test_image_lock_nested();
+    test_image_lock_read();
+    test_image_lock_write();
+}
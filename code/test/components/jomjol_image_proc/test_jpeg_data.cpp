@@ -0,0 +1,113 @@
+#include <unity.h>
+#include <string>
+#include "CJpegData.h"
+
+static std::string jpegContent(CJpegData &_jpeg, int *_chunks = NULL)
+{
+    std::string content;
+    int chunks = 0;
+
+    _jpeg.forEachChunk([&](const char *_data, size_t _len) {
+        content.append(_data, _len);
+        chunks++;
+        return true;
+    });
+
+    if (_chunks) {
+        *_chunks = chunks;
+    }
+    return content;
+}
+
+
+/**
+ * @brief The JPG grows page by page and comes back unchanged, in one chunk per page
+ */
+void test_jpeg_data_append()
+{
+    CJpegData jpeg;
+    std::string expected;
+
+    TEST_ASSERT_EQUAL_INT(0, jpeg.getSize());
+    TEST_ASSERT_EQUAL_STRING("", jpegContent(jpeg).c_str());
+
+    // Small writes like the ones of the encoder, more than 2 pages
+    for (int i = 0; expected.size() < 2 * JPEG_PAGE_SIZE + 100; ++i) {
+        std::string part = std::to_string(i) + ",";
+        TEST_ASSERT_TRUE(jpeg.append((const uint8_t*)part.data(), part.size()));
+        expected += part;
+    }
+
+    // A write larger than a page
+    std::string big(JPEG_PAGE_SIZE + 10, 'x');
+    TEST_ASSERT_TRUE(jpeg.append((const uint8_t*)big.data(), big.size()));
+    expected += big;
+
+    int chunks;
+    TEST_ASSERT_EQUAL_INT(expected.size(), jpeg.getSize());
+    TEST_ASSERT_TRUE(expected == jpegContent(jpeg, &chunks));
+    TEST_ASSERT_EQUAL_INT((expected.size() + JPEG_PAGE_SIZE - 1) / JPEG_PAGE_SIZE, chunks);
+}
+
+
+/**
+ * @brief take() replaces the content, the pages go back to the pool, which only keeps what the next JPG needs
+ */
+void test_jpeg_data_take()
+{
+    CJpegData shown;
+    CJpegData encoded;
+    std::string first(3 * JPEG_PAGE_SIZE, 'a');
+    std::string second(JPEG_PAGE_SIZE / 2, 'b');
+
+    shown.append((const uint8_t*)first.data(), first.size());
+    encoded.append((const uint8_t*)second.data(), second.size());
+    shown.take(&encoded);
+
+    TEST_ASSERT_EQUAL_INT(0, encoded.getSize());
+    TEST_ASSERT_TRUE(second == jpegContent(shown));
+    TEST_ASSERT_EQUAL_INT(2, jpegPagePoolSize());       // 3 went back, trimmed to the size of the new JPG + 1
+
+    // Reader stops early
+    int chunks = 0;
+    TEST_ASSERT_FALSE(shown.forEachChunk([&](const char *_data, size_t _len) { chunks++; return false; }));
+    TEST_ASSERT_EQUAL_INT(1, chunks);
+
+    shown.clear();
+    TEST_ASSERT_EQUAL_INT(0, shown.getSize());
+}
+
+
+/**
+ * @brief A reader keeps its pages while the content gets replaced (no lock held during the send)
+ */
+void test_jpeg_data_snapshot()
+{
+    CJpegData shown;
+    CJpegData encoded;
+    std::string first(2 * JPEG_PAGE_SIZE, 'a');
+    std::string second(JPEG_PAGE_SIZE, 'b');
+
+    shown.append((const uint8_t*)first.data(), first.size());
+    encoded.append((const uint8_t*)second.data(), second.size());
+
+    std::string received;
+    TEST_ASSERT_TRUE(shown.forEachChunk([&](const char *_data, size_t _len) {
+        if (received.empty()) {
+            shown.take(&encoded);       // Next round, while the client still reads
+        }
+        received.append(_data, _len);
+        return true;
+    }));
+
+    TEST_ASSERT_TRUE(first == received);
+    TEST_ASSERT_TRUE(second == jpegContent(shown));
+}
+
+
+void test_jpeg_data()
+{
+    test_jpeg_data_append();
+    test_jpeg_data_take();
+    test_jpeg_data_snapshot();
+}
@@ -0,0 +1,213 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "CImageBasis.h"
+#include "CJpegData.h"
+
+#include "esp_netif.h"
+#include "esp_http_server.h"
+#include "esp_http_client.h"
+
+#define TEST_JPEG_SINK_PORT 8765
+
+/**
+ * @brief Records the chunks it gets, can fail from a given chunk on
+ */
+class TestChunkSink : public CJpegChunkSink
+{
+    public:
+        std::vector<std::string> chunks;
+        int failAt = -1;
+
+    protected:
+        bool sendChunk(const char *_data, size_t _len) override
+        {
+            if ((int)chunks.size() == failAt) {
+                return false;
+            }
+            chunks.push_back(std::string(_data, _len));
+            return true;
+        }
+};
+
+
+static std::string jpegSinkTestData(size_t _len)
+{
+    std::string data;
+    for (size_t i = 0; i < _len; ++i) {
+        data += (char)(i % 251);
+    }
+    return data;
+}
+
+
+static CImageBasis *jpegSinkTestImage()
+{
+    CImageBasis *image = new CImageBasis("jpeg_sink", 64, 48, 3);
+    for (int y = 0; y < 48; ++y) {
+        for (int x = 0; x < 64; ++x) {
+            image->setPixelColor(x, y, x * 4, y * 5, (x + y) * 2);
+        }
+    }
+    return image;
+}
+
+
+static std::string jpegSinkContent(CJpegData &_jpeg)
+{
+    std::string content;
+    _jpeg.forEachChunk([&](const char *_data, size_t _len) {
+        content.append(_data, _len);
+        return true;
+    });
+    return content;
+}
+
+
+/**
+ * @brief Full chunks of HTTP_BUFFER_SENT bytes, the rest with finish()
+ */
+void test_jpeg_sink_chunk()
+{
+    std::string data = jpegSinkTestData(2 * HTTP_BUFFER_SENT + 100);
+    TestChunkSink sink;
+
+    // Small writes like the ones of the encoder, then one larger than the buffer
+    size_t pos = 0;
+    for (; pos < 300; pos += 3) {
+        sink.write((const uint8_t*)data.data() + pos, 3);
+    }
+    sink.write((const uint8_t*)data.data() + pos, data.size() - pos);
+
+    TEST_ASSERT_EQUAL_INT(2, sink.chunks.size());
+    TEST_ASSERT_TRUE(sink.finish());
+    TEST_ASSERT_EQUAL_INT(3, sink.chunks.size());
+    TEST_ASSERT_EQUAL_INT(HTTP_BUFFER_SENT, sink.chunks[0].size());
+    TEST_ASSERT_EQUAL_INT(HTTP_BUFFER_SENT, sink.chunks[1].size());
+    TEST_ASSERT_EQUAL_INT(100, sink.chunks[2].size());
+    TEST_ASSERT_TRUE(data == sink.chunks[0] + sink.chunks[1] + sink.chunks[2]);
+
+    // Nothing left
+    TEST_ASSERT_TRUE(sink.finish());
+    TEST_ASSERT_EQUAL_INT(3, sink.chunks.size());
+}
+
+
+/**
+ * @brief Once a chunk could not be sent, the rest gets ignored and finish() reports it
+ */
+void test_jpeg_sink_chunk_failed()
+{
+    std::string data = jpegSinkTestData(3 * HTTP_BUFFER_SENT);
+    TestChunkSink sink;
+    sink.failAt = 1;
+
+    sink.write((const uint8_t*)data.data(), data.size());
+    TEST_ASSERT_FALSE(sink.finish());
+    TEST_ASSERT_EQUAL_INT(1, sink.chunks.size());
+}
+
+
+/**
+ * @brief The callback gets the same JPG as the memory sink, the callback can abort
+ */
+void test_jpeg_sink_callback()
+{
+    CImageBasis *image = jpegSinkTestImage();
+
+    CJpegData expected;
+    TEST_ASSERT_TRUE(image->writeToMemoryAsJPG(&expected, 90));
+    TEST_ASSERT_GREATER_THAN(HTTP_BUFFER_SENT, expected.getSize());
+
+    std::string received;
+    CJpegCallbackSink sink([&received](const char *_data, size_t _len) {
+        received.append(_data, _len);
+        return true;
+    });
+    TEST_ASSERT_TRUE(image->writeToSinkAsJPG(&sink, 90));
+    TEST_ASSERT_TRUE(jpegSinkContent(expected) == received);
+    TEST_ASSERT_EQUAL_INT(0xFF, (uint8_t)received[0]);
+    TEST_ASSERT_EQUAL_INT(0xD8, (uint8_t)received[1]);
+
+    int calls = 0;
+    CJpegCallbackSink aborting([&calls](const char *_data, size_t _len) {
+        calls++;
+        return false;
+    });
+    TEST_ASSERT_FALSE(image->writeToSinkAsJPG(&aborting, 90));
+    TEST_ASSERT_EQUAL_INT(1, calls);
+
+    delete image;
+}
+
+
+static esp_err_t jpegSinkTestHandler(httpd_req_t *req)
+{
+    CImageBasis *image = (CImageBasis*) req->user_ctx;
+    httpd_resp_set_type(req, "image/jpeg");
+
+    esp_err_t result = image->SendJPGtoHTTP(req, 90);     // CJpegHttpdSink
+    httpd_resp_send_chunk(req, NULL, 0);
+    return result;
+}
+
+
+static esp_err_t jpegSinkTestClientEvent(esp_http_client_event_t *evt)
+{
+    if ((evt->event_id == HTTP_EVENT_ON_DATA) && evt->user_data) {
+        ((std::string*) evt->user_data)->append((const char*) evt->data, evt->data_len);
+    }
+    return ESP_OK;
+}
+
+
+/**
+ * @brief The web server sends the JPG as chunked response, a client gets it unchanged (over the loopback)
+ */
+void test_jpeg_sink_httpd()
+{
+    CImageBasis *image = jpegSinkTestImage();
+    CJpegData expected;
+    TEST_ASSERT_TRUE(image->writeToMemoryAsJPG(&expected, 90));
+
+    esp_netif_init();       // Already done if WLAN got started
+
+    httpd_handle_t server = NULL;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = TEST_JPEG_SINK_PORT;
+    config.ctrl_port = TEST_JPEG_SINK_PORT + 1;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, httpd_start(&server, &config));
+
+    httpd_uri_t uri = {};
+    uri.uri = "/jpeg";
+    uri.method = HTTP_GET;
+    uri.handler = jpegSinkTestHandler;
+    uri.user_ctx = image;
+    httpd_register_uri_handler(server, &uri);
+
+    std::string received;
+    esp_http_client_config_t clientConfig = {};
+    clientConfig.url = "http://127.0.0.1:8765/jpeg";
+    clientConfig.event_handler = jpegSinkTestClientEvent;
+    clientConfig.user_data = &received;
+    esp_http_client_handle_t client = esp_http_client_init(&clientConfig);
+
+    TEST_ASSERT_EQUAL_INT(ESP_OK, esp_http_client_perform(client));
+    TEST_ASSERT_EQUAL_INT(200, esp_http_client_get_status_code(client));
+    TEST_ASSERT_TRUE(esp_http_client_is_chunked_response(client));
+    TEST_ASSERT_EQUAL_INT(expected.getSize(), received.size());
+    TEST_ASSERT_TRUE(jpegSinkContent(expected) == received);
+
+    esp_http_client_cleanup(client);
+    httpd_stop(server);
+    delete image;
+}
+
+
+void test_jpeg_sink()
+{
+    test_jpeg_sink_chunk();
+    test_jpeg_sink_chunk_failed();
+    test_jpeg_sink_callback();
+    test_jpeg_sink_httpd();
+}
@@ -0,0 +1,106 @@
+#include <unity.h>
+#include <string>
+#include "influxdb_batch.h"
+
+/**
+ * @brief Stand-in for the InfluxDB server, counts the requests and bytes it receives
+ */
+struct InfluxDBStandIn {
+    int requests = 0;
+    size_t bytes = 0;
+    std::string received = "";
+    InfluxDBSendResult answer = INFLUXDB_SEND_OK;
+
+    InfluxDBBatch::Sender sender()
+    {
+        return [this](const std::string &_body) {
+            requests++;
+            if (answer == INFLUXDB_SEND_OK) {
+                bytes += _body.size();
+                received += _body;
+            }
+            return answer;
+        };
+    }
+};
+
+/**
+ * @brief All points of a round go out with one request
+ */
+void test_influxdb_batch_round()
+{
+    InfluxDBBatch batch(4096, 8192);
+    InfluxDBStandIn server;
+
+    batch.addPoint("water", "value", "123.456", 1700000000);
+    batch.addPoint("water", "main/value", "7.5", 1700000000);
+    batch.addPoint("environment", "sht3x_temperature", "21.5", 0);
+
+    TEST_ASSERT_EQUAL_INT(1, batch.flush(server.sender()));
+    TEST_ASSERT_EQUAL_INT(1, server.requests);
+    TEST_ASSERT_EQUAL_STRING("water value=123.456 1700000000000000000\n"
+                             "water main/value=7.5 1700000000000000000\n"
+                             "environment sht3x_temperature=21.5\n", server.received.c_str());
+    TEST_ASSERT_EQUAL_INT(server.received.size(), server.bytes);
+
+    // Nothing left, nothing sent
+    TEST_ASSERT_EQUAL_INT(0, batch.flush(server.sender()));
+    TEST_ASSERT_EQUAL_INT(1, server.requests);
+}
+
+/**
+ * @brief Bodies are limited in size and split at line boundaries
+ */
+void test_influxdb_batch_size_cap()
+{
+    InfluxDBBatch batch(64, 8192);
+    InfluxDBStandIn server;
+
+    for (int i = 0; i < 10; ++i) {
+        batch.addPoint("m", "k", std::to_string(i), 1700000000);       // 26 bytes per line
+    }
+
+    TEST_ASSERT_EQUAL_INT(5, batch.flush(server.sender()));           // 2 lines per body
+    TEST_ASSERT_EQUAL_INT(10 * 26, server.bytes);
+}
+
+/**
+ * @brief Lines which could not be sent are sent again with the next flush, the retry buffer is limited
+ */
+void test_influxdb_batch_retry()
+{
+    InfluxDBBatch batch(4096, 60);
+    InfluxDBStandIn server;
+
+    server.answer = INFLUXDB_SEND_RETRY;
+    batch.addPoint("m", "k", "1", 1700000000);
+    batch.addPoint("m", "k", "2", 1700000000);
+    TEST_ASSERT_EQUAL_INT(0, batch.flush(server.sender()));
+    TEST_ASSERT_EQUAL_INT(52, batch.getRetrySize());
+
+    // Retry buffer full -> the oldest line gets dropped
+    batch.addPoint("m", "k", "3", 1700000000);
+    TEST_ASSERT_EQUAL_INT(0, batch.flush(server.sender()));
+    TEST_ASSERT_EQUAL_INT(52, batch.getRetrySize());
+    TEST_ASSERT_EQUAL_INT(1, batch.getDroppedLines());
+
+    server.answer = INFLUXDB_SEND_OK;
+    TEST_ASSERT_EQUAL_INT(1, batch.flush(server.sender()));
+    TEST_ASSERT_EQUAL_INT(3, server.requests);
+    TEST_ASSERT_EQUAL_STRING("m k=2 1700000000000000000\nm k=3 1700000000000000000\n", server.received.c_str());
+    TEST_ASSERT_EQUAL_INT(0, batch.getRetrySize());
+
+    // Rejected data does not get sent again
+    server.answer = INFLUXDB_SEND_DROP;
+    batch.addPoint("m", "k", "invalid", 0);
+    TEST_ASSERT_EQUAL_INT(0, batch.flush(server.sender()));
+    TEST_ASSERT_EQUAL_INT(0, batch.getRetrySize());
+    TEST_ASSERT_EQUAL_INT(0, batch.getPendingSize());
+}
+
+void test_influxdb_batch()
+{
+    test_influxdb_batch_round();
+    test_influxdb_batch_size_cap();
+    test_influxdb_batch_retry();
+}
@@ -0,0 +1,108 @@
+#include <unity.h>
+#include <string>
+#include <string.h>
+#include "mqtt_batch_payload.h"
+
+/**
+ * @brief Writes the same round in both formats
+ */
+static void writeRound(MQTTBatchPayload &_payload)
+{
+    _payload.beginMap();
+    _payload.key("time");
+    _payload.addString("2025-01-01T12:00:00");
+    _payload.key("numbers");
+    _payload.beginMap();
+    _payload.key("main");
+    _payload.beginMap();
+    _payload.key("value");  _payload.addValue("123.45");
+    _payload.key("raw");    _payload.addValue("12");
+    _payload.key("error");  _payload.addValue("no error");
+    _payload.key("rate");   _payload.addValue("");
+    _payload.endMap();
+    _payload.endMap();
+    _payload.key("sensors");
+    _payload.beginArray();
+    _payload.addFloat(21.5f);
+    _payload.addInt(-1);
+    _payload.endArray();
+    _payload.endMap();
+}
+
+void test_mqtt_batch_payload_json()
+{
+    MQTTBatchPayload payload(MQTT_BATCH_FORMAT_JSON);
+    writeRound(payload);
+
+    TEST_ASSERT_EQUAL_STRING("{\"time\":\"2025-01-01T12:00:00\",\"numbers\":{\"main\":{\"value\":123.45,\"raw\":12,"
+                             "\"error\":\"no error\",\"rate\":null}},\"sensors\":[21.5,-1]}", payload.getData().c_str());
+
+    // Strings get escaped
+    MQTTBatchPayload escaped(MQTT_BATCH_FORMAT_JSON);
+    escaped.addString("a\"b\\c\n");
+    TEST_ASSERT_EQUAL_STRING("\"a\\\"b\\\\c\\n\"", escaped.getData().c_str());
+}
+
+void test_mqtt_batch_payload_msgpack()
+{
+    MQTTBatchPayload payload(MQTT_BATCH_FORMAT_MSGPACK);
+    writeRound(payload);
+
+    const unsigned char expected[] = {
+        0x83,                                                   // map, 3 entries
+        0xa4, 't', 'i', 'm', 'e',
+        0xb3, '2', '0', '2', '5', '-', '0', '1', '-', '0', '1', 'T', '1', '2', ':', '0', '0', ':', '0', '0',
+        0xa7, 'n', 'u', 'm', 'b', 'e', 'r', 's',
+        0x81,                                                   // map, 1 entry
+        0xa4, 'm', 'a', 'i', 'n',
+        0x84,                                                   // map, 4 entries
+        0xa5, 'v', 'a', 'l', 'u', 'e', 0xcb, 0x40, 0x5e, 0xdc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcd,   // float64 123.45
+        0xa3, 'r', 'a', 'w', 0x0c,                              // positive fixint 12
+        0xa5, 'e', 'r', 'r', 'o', 'r', 0xa8, 'n', 'o', ' ', 'e', 'r', 'r', 'o', 'r',
+        0xa4, 'r', 'a', 't', 'e', 0xc0,                         // nil
+        0xa7, 's', 'e', 'n', 's', 'o', 'r', 's',
+        0x92, 0xca, 0x41, 0xac, 0x00, 0x00, 0xff                // array, float32 21.5, negative fixint -1
+    };
+
+    TEST_ASSERT_EQUAL_INT(sizeof(expected), payload.getData().size());
+    TEST_ASSERT_TRUE(memcmp(expected, payload.getData().data(), sizeof(expected)) == 0);
+}
+
+/**
+ * @brief Containers with 16 or more entries need the larger MessagePack header
+ */
+void test_mqtt_batch_payload_msgpack_header()
+{
+    MQTTBatchPayload payload(MQTT_BATCH_FORMAT_MSGPACK);
+
+    payload.beginArray();
+    for (int i = 0; i < 20; ++i) {
+        payload.addInt(i);
+    }
+    payload.endArray();
+
+    TEST_ASSERT_EQUAL_INT(3 + 20, payload.getData().size());
+    TEST_ASSERT_EQUAL_INT(0xdc, (unsigned char)payload.getData()[0]);
+    TEST_ASSERT_EQUAL_INT(20, (unsigned char)payload.getData()[2]);
+    TEST_ASSERT_EQUAL_INT(0, payload.getData()[3]);
+}
+
+void test_mqtt_batch_payload_is_number()
+{
+    TEST_ASSERT_TRUE(MQTTBatchIsNumber("0"));
+    TEST_ASSERT_TRUE(MQTTBatchIsNumber("-12.5"));
+    TEST_ASSERT_TRUE(MQTTBatchIsNumber("1e-3"));
+    TEST_ASSERT_FALSE(MQTTBatchIsNumber(""));
+    TEST_ASSERT_FALSE(MQTTBatchIsNumber("012"));
+    TEST_ASSERT_FALSE(MQTTBatchIsNumber("1,5"));
+    TEST_ASSERT_FALSE(MQTTBatchIsNumber("1."));
+    TEST_ASSERT_FALSE(MQTTBatchIsNumber("N"));
+}
+
+void test_mqtt_batch_payload()
+{
+    test_mqtt_batch_payload_json();
+    test_mqtt_batch_payload_msgpack();
+    test_mqtt_batch_payload_msgpack_header();
+    test_mqtt_batch_payload_is_number();
+}
@@ -0,0 +1,192 @@
+#include <unity.h>
+#include <string>
+#include <string.h>
+#include "mqtt_outbox.h"
+
+#define TEST_OUTBOX_MSG_TYPE_PUBLISH 3
+#define TEST_OUTBOX_MSG_TYPE_SUBSCRIBE 8
+
+/**
+ * @brief Topics of the test are named after their class, e.g. "wm/error"
+ */
+static outbox_priority_t test_outbox_classifier(const char *topic, int topic_len)
+{
+    std::string t(topic, topic_len);
+    if (t.find("error") != std::string::npos) {
+        return OUTBOX_PRIORITY_ERROR;
+    }
+    if (t.find("uptime") != std::string::npos) {
+        return OUTBOX_PRIORITY_DIAGNOSTIC;
+    }
+    if (t.find("homeassistant") == 0) {
+        return OUTBOX_PRIORITY_DISCOVERY;
+    }
+    return OUTBOX_PRIORITY_VALUE;
+}
+
+/**
+ * @brief Enqueues a PUBLISH with a payload of _payloadLen bytes
+ */
+static outbox_item_handle_t test_outbox_publish(outbox_handle_t _outbox, int _msgId, const char *_topic, int _payloadLen)
+{
+    uint8_t packet[256];
+    int topicLen = strlen(_topic);
+    int remaining = 2 + topicLen + 2 + _payloadLen;     // Topic, msg id, payload
+
+    packet[0] = 0x32;                                   // PUBLISH, qos 1
+    packet[1] = remaining;
+    packet[2] = 0;
+    packet[3] = topicLen;
+    memcpy(&packet[4], _topic, topicLen);
+    memset(&packet[4 + topicLen], 'x', remaining - 2 - topicLen);
+
+    outbox_message_t message = {};
+    message.data = packet;
+    message.len = 2 + remaining;
+    message.msg_id = _msgId;
+    message.msg_qos = 1;
+    message.msg_type = TEST_OUTBOX_MSG_TYPE_PUBLISH;
+    return outbox_enqueue(_outbox, &message, 0);
+}
+
+/**
+ * @brief The budget is kept, the least important and oldest messages get dropped first
+ */
+void test_mqtt_outbox_budget()
+{
+    outbox_configure(80, 8, test_outbox_classifier);
+    outbox_handle_t outbox = outbox_init();
+    outbox_stats_t stats;
+
+    // Fixed header, topic length, topic, msg id and payload: 2 + 2 + 13 + 2 + 4 = 23 bytes
+    TEST_ASSERT_NOT_NULL(test_outbox_publish(outbox, 1, "homeassistant", 4));
+    TEST_ASSERT_NOT_NULL(test_outbox_publish(outbox, 2, "wm/uptime", 8));        // 23 bytes
+    TEST_ASSERT_NOT_NULL(test_outbox_publish(outbox, 3, "wm/error", 9));         // 23 bytes
+    TEST_ASSERT_EQUAL_INT(69, outbox_get_size(outbox));
+
+    // Discovery goes first
+    TEST_ASSERT_NOT_NULL(test_outbox_publish(outbox, 4, "wm/value", 9));         // 23 bytes
+    TEST_ASSERT_NULL(outbox_get(outbox, 1));
+    TEST_ASSERT_EQUAL_INT(69, outbox_get_size(outbox));
+
+    // Then the diagnostics and the errors
+    TEST_ASSERT_NOT_NULL(test_outbox_publish(outbox, 5, "wm/value", 29));        // 43 bytes
+    TEST_ASSERT_NULL(outbox_get(outbox, 2));
+    TEST_ASSERT_NULL(outbox_get(outbox, 3));
+    TEST_ASSERT_EQUAL_INT(66, outbox_get_size(outbox));
+
+    // Diagnostics do not replace more important messages
+    TEST_ASSERT_NULL(test_outbox_publish(outbox, 6, "wm/uptime", 8));
+
+    // A new value replaces the oldest one
+    TEST_ASSERT_NOT_NULL(test_outbox_publish(outbox, 7, "wm/value", 9));         // 23 bytes
+    TEST_ASSERT_NULL(outbox_get(outbox, 4));
+    TEST_ASSERT_NOT_NULL(outbox_get(outbox, 5));
+    TEST_ASSERT_NOT_NULL(outbox_get(outbox, 7));
+
+    outbox_get_stats(outbox, &stats);
+    TEST_ASSERT_EQUAL_INT(2, stats.items);
+    TEST_ASSERT_EQUAL_INT(66, stats.bytes);
+    TEST_ASSERT_EQUAL_INT(69, stats.bytes_peak);
+    TEST_ASSERT_EQUAL_INT(1, stats.dropped[OUTBOX_PRIORITY_DISCOVERY]);
+    TEST_ASSERT_EQUAL_INT(1, stats.dropped[OUTBOX_PRIORITY_DIAGNOSTIC]);
+    TEST_ASSERT_EQUAL_INT(1, stats.dropped[OUTBOX_PRIORITY_ERROR]);
+    TEST_ASSERT_EQUAL_INT(1, stats.dropped[OUTBOX_PRIORITY_VALUE]);
+    TEST_ASSERT_EQUAL_INT(1, stats.rejected);
+
+    // Acknowledged
+    TEST_ASSERT_EQUAL_INT(ESP_OK, outbox_delete(outbox, 5, TEST_OUTBOX_MSG_TYPE_PUBLISH));
+    TEST_ASSERT_EQUAL_INT(23, outbox_get_size(outbox));
+
+    outbox_destroy(outbox);
+}
+
+/**
+ * @brief The slab limits the number of messages, control messages are never dropped
+ */
+void test_mqtt_outbox_slab()
+{
+    outbox_configure(1000, 3, test_outbox_classifier);
+    outbox_handle_t outbox = outbox_init();
+    outbox_stats_t stats;
+
+    uint8_t subscribe[] = {0x82, 0x02, 0x00, 0x01};
+    outbox_message_t message = {};
+    message.data = subscribe;
+    message.len = sizeof(subscribe);
+    message.msg_id = 1;
+    message.msg_type = TEST_OUTBOX_MSG_TYPE_SUBSCRIBE;
+    TEST_ASSERT_NOT_NULL(outbox_enqueue(outbox, &message, 0));
+
+    TEST_ASSERT_NOT_NULL(test_outbox_publish(outbox, 2, "wm/value", 1));
+    TEST_ASSERT_NOT_NULL(test_outbox_publish(outbox, 3, "wm/value", 1));
+    TEST_ASSERT_NOT_NULL(test_outbox_publish(outbox, 4, "wm/value", 1));
+    TEST_ASSERT_NOT_NULL(outbox_get(outbox, 1));
+    TEST_ASSERT_NULL(outbox_get(outbox, 2));
+
+    // Expiry frees the slots again
+    TEST_ASSERT_EQUAL_INT(3, outbox_delete_expired(outbox, 1000, 500));
+    outbox_get_stats(NULL, &stats);
+    TEST_ASSERT_EQUAL_INT(0, stats.items);
+    TEST_ASSERT_EQUAL_INT(3, stats.item_capacity);
+    TEST_ASSERT_EQUAL_INT(3, stats.expired);
+    TEST_ASSERT_EQUAL_INT(0, outbox_get_size(outbox));
+
+    outbox_destroy(outbox);
+    outbox_configure(MQTT_OUTBOX_BUDGET, MQTT_OUTBOX_SLAB_ITEMS, NULL);
+}
+
+/**
+ * @brief The message data lives in the arena, freed gaps get reused without dropping anything
+ */
+void test_mqtt_outbox_arena()
+{
+    outbox_configure(60, 8, test_outbox_classifier);
+    outbox_handle_t outbox = outbox_init();
+    outbox_stats_t stats;
+
+    // 2 + 2 + 8 + 2 + 6 = 20 bytes each, the arena is full
+    TEST_ASSERT_NOT_NULL(test_outbox_publish(outbox, 1, "wm/value", 6));
+    TEST_ASSERT_NOT_NULL(test_outbox_publish(outbox, 2, "wm/value", 6));
+    TEST_ASSERT_NOT_NULL(test_outbox_publish(outbox, 3, "wm/value", 6));
+
+    // Acknowledged in the middle, the next message takes its place
+    TEST_ASSERT_EQUAL_INT(ESP_OK, outbox_delete(outbox, 2, TEST_OUTBOX_MSG_TYPE_PUBLISH));
+    outbox_item_handle_t item = test_outbox_publish(outbox, 4, "wm/error", 6);
+    TEST_ASSERT_NOT_NULL(item);
+    TEST_ASSERT_NOT_NULL(outbox_get(outbox, 1));
+    TEST_ASSERT_NOT_NULL(outbox_get(outbox, 3));
+
+    size_t len;
+    uint16_t msgId;
+    int msgType, qos;
+    uint8_t *data = outbox_item_get_data(item, &len, &msgId, &msgType, &qos);
+    TEST_ASSERT_EQUAL_INT(20, len);
+    TEST_ASSERT_EQUAL_INT(4, msgId);
+    TEST_ASSERT_EQUAL_INT(0x32, data[0]);
+    TEST_ASSERT_EQUAL_MEMORY("wm/error", &data[4], 8);
+    TEST_ASSERT_EQUAL_INT('x', data[19]);
+
+    // The neighbours are untouched
+    data = outbox_item_get_data(outbox_get(outbox, 3), &len, &msgId, &msgType, &qos);
+    TEST_ASSERT_EQUAL_MEMORY("wm/value", &data[4], 8);
+    TEST_ASSERT_EQUAL_INT('x', data[19]);
+
+    outbox_get_stats(NULL, &stats);
+    TEST_ASSERT_EQUAL_INT(3, stats.items);
+    TEST_ASSERT_EQUAL_INT(60, stats.bytes);
+    TEST_ASSERT_EQUAL_INT(0, stats.dropped[OUTBOX_PRIORITY_VALUE]);
+
+    // A destroyed outbox has no stats anymore
+    outbox_destroy(outbox);
+    outbox_get_stats(NULL, &stats);
+    TEST_ASSERT_EQUAL_INT(0, stats.budget);
+    outbox_configure(MQTT_OUTBOX_BUDGET, MQTT_OUTBOX_SLAB_ITEMS, NULL);
+}
+
+void test_mqtt_outbox()
+{
+    test_mqtt_outbox_budget();
+    test_mqtt_outbox_slab();
+    test_mqtt_outbox_arena();
+}
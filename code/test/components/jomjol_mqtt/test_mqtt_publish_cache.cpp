@@ -0,0 +1,103 @@
+#include <unity.h>
+#include <string>
+#include "mqtt_publish_cache.h"
+
+#define MINUTE_US (60LL * 1000 * 1000)
+
+/**
+ * @brief Publishes _payload through the cache like MQTTPublish() does, returns true if it got sent
+ */
+static bool publishThroughCache(MQTTPublishCache &_cache, const std::string &_topic, const std::string &_payload, int64_t _nowUs)
+{
+    if (_cache.isUnchanged(_topic, _payload, _nowUs)) {
+        return false;
+    }
+    _cache.published(_topic, _payload, _nowUs);
+    return true;
+}
+
+/**
+ * @brief Without heartbeat everything gets published
+ */
+void test_mqtt_publish_cache_disabled()
+{
+    MQTTPublishCache cache;
+
+    TEST_ASSERT_FALSE(cache.isEnabled());
+    TEST_ASSERT_TRUE(publishThroughCache(cache, "wm/main/value", "123.45", 0));
+    TEST_ASSERT_TRUE(publishThroughCache(cache, "wm/main/value", "123.45", 1));
+    TEST_ASSERT_EQUAL_UINT32(2, cache.getSent());
+    TEST_ASSERT_EQUAL_UINT32(0, cache.getSuppressed());
+}
+
+/**
+ * @brief Unchanged payloads are suppressed per topic, changed ones get published
+ */
+void test_mqtt_publish_cache_change()
+{
+    MQTTPublishCache cache;
+    cache.setHeartbeat(60 * MINUTE_US);
+
+    TEST_ASSERT_TRUE(publishThroughCache(cache, "wm/main/value", "123.45", 0));
+    TEST_ASSERT_TRUE(publishThroughCache(cache, "wm/main/rate", "0.000", 0));
+
+    // Next round, only the value changed
+    TEST_ASSERT_TRUE(publishThroughCache(cache, "wm/main/value", "123.46", 5 * MINUTE_US));
+    TEST_ASSERT_FALSE(publishThroughCache(cache, "wm/main/rate", "0.000", 5 * MINUTE_US));
+
+    // Same payload on another topic is not affected
+    TEST_ASSERT_TRUE(publishThroughCache(cache, "wm/main/changeabsolut", "0.000", 5 * MINUTE_US));
+
+    TEST_ASSERT_EQUAL_UINT32(4, cache.getSent());
+    TEST_ASSERT_EQUAL_UINT32(1, cache.getSuppressed());
+}
+
+/**
+ * @brief Unchanged payloads get published again after the heartbeat and after clear()
+ */
+void test_mqtt_publish_cache_heartbeat()
+{
+    MQTTPublishCache cache;
+    cache.setHeartbeat(10 * MINUTE_US);
+
+    TEST_ASSERT_TRUE(publishThroughCache(cache, "wm/main/rate", "0.000", 0));
+    TEST_ASSERT_FALSE(publishThroughCache(cache, "wm/main/rate", "0.000", 9 * MINUTE_US));
+    TEST_ASSERT_TRUE(publishThroughCache(cache, "wm/main/rate", "0.000", 10 * MINUTE_US));
+
+    // The heartbeat counts from the last real publish
+    TEST_ASSERT_FALSE(publishThroughCache(cache, "wm/main/rate", "0.000", 19 * MINUTE_US));
+
+    // Reconnect -> the broker might have lost the retained message
+    cache.clear();
+    TEST_ASSERT_TRUE(publishThroughCache(cache, "wm/main/rate", "0.000", 19 * MINUTE_US));
+
+    TEST_ASSERT_EQUAL_UINT32(3, cache.getSent());
+    TEST_ASSERT_EQUAL_UINT32(2, cache.getSuppressed());
+}
+
+/**
+ * @brief Without heartbeat (discovery registry) only a changed payload or clear() allows to publish again
+ */
+void test_mqtt_publish_cache_registry()
+{
+    MQTTPublishCache registry(INT64_MAX);
+
+    TEST_ASSERT_TRUE(publishThroughCache(registry, "homeassistant/sensor/wm/uptime/config", "{\"name\": \"Uptime\"}", 0));
+    TEST_ASSERT_FALSE(publishThroughCache(registry, "homeassistant/sensor/wm/uptime/config", "{\"name\": \"Uptime\"}", 0));
+    TEST_ASSERT_FALSE(publishThroughCache(registry, "homeassistant/sensor/wm/uptime/config", "{\"name\": \"Uptime\"}", INT64_MAX - 1));
+
+    // e.g. new IP address in the configuration_url
+    TEST_ASSERT_TRUE(publishThroughCache(registry, "homeassistant/sensor/wm/uptime/config", "{\"name\": \"Uptime\", \"ip\": 2}", 0));
+
+    // Homeassistant restarted
+    registry.clear();
+    TEST_ASSERT_TRUE(publishThroughCache(registry, "homeassistant/sensor/wm/uptime/config", "{\"name\": \"Uptime\", \"ip\": 2}", 0));
+}
+
+void test_mqtt_publish_cache()
+{
+    test_mqtt_publish_cache_disabled();
+    test_mqtt_publish_cache_change();
+    test_mqtt_publish_cache_heartbeat();
+    test_mqtt_publish_cache_registry();
+}
@@ -0,0 +1,231 @@
+#include <unity.h>
+#include <vector>
+#include "ds18b20_bus_reader.h"
+
+
+/**
+ * @brief DS18B20 sensors on a simulated bus with a virtual clock
+ *
+ * Times are the standard speed slots of the bit-banged bus: reset 960us, byte 8x70us, read slot 70us.
+ * A conversion takes 750ms (12 bit). While a sensor converts, the read slot returns 0.
+ */
+class SimulatedDS18B20Bus : public OneWireBus {
+public:
+    struct Device {
+        DS18B20RomId rom;
+        int16_t raw;
+        int crcErrors = 0;          // Next scratchpad reads with a wrong CRC
+        int scratchpadReads = 0;
+        int64_t convertDoneUs = 0;
+    };
+
+    std::vector<Device> devices;
+    int64_t nowUs = 0;
+
+    void addDevice(uint8_t serial, float temperature)
+    {
+        Device device;
+        device.rom = {0x28, serial, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+        device.rom[7] = ds18b20_crc8(device.rom.data(), 7);
+        device.raw = (int16_t)(temperature * 16);
+        devices.push_back(device);
+    }
+
+    bool reset() override
+    {
+        nowUs += 960;
+        state = ROM_COMMAND;
+        return !devices.empty();
+    }
+
+    void writeByte(uint8_t byte) override
+    {
+        nowUs += 8 * 70;
+
+        if (state == ROM_COMMAND) {
+            if (byte == 0xCC) {
+                selected = -1;
+                state = FUNCTION_COMMAND;
+            } else if (byte == 0x55) {
+                romPos = 0;
+                state = MATCH_ROM;
+            } else {
+                state = IDLE;
+            }
+        } else if (state == MATCH_ROM) {
+            match[romPos++] = byte;
+            if (romPos == 8) {
+                selected = -2;
+                for (size_t i = 0; i < devices.size(); i++) {
+                    if (devices[i].rom == match) {
+                        selected = i;
+                    }
+                }
+                state = (selected >= 0) ? FUNCTION_COMMAND : IDLE;
+            }
+        } else if (state == FUNCTION_COMMAND) {
+            if (byte == 0x44) {
+                for (size_t i = 0; i < devices.size(); i++) {
+                    if (selected == -1 || selected == (int)i) {
+                        devices[i].convertDoneUs = nowUs + 750000;
+                    }
+                }
+                state = IDLE;
+            } else if (byte == 0xBE && selected >= 0) {
+                Device &device = devices[selected];
+                uint8_t data[9] = {(uint8_t)(device.raw & 0xFF), (uint8_t)(device.raw >> 8), 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10, 0};
+                data[8] = ds18b20_crc8(data, 8);
+                if (device.crcErrors > 0) {
+                    device.crcErrors--;
+                    data[8] ^= 0x01;
+                }
+                device.scratchpadReads++;
+                for (int i = 0; i < 9; i++) {
+                    scratchpad[i] = data[i];
+                }
+                readPos = 0;
+                state = READ_SCRATCHPAD;
+            } else {
+                state = IDLE;
+            }
+        }
+    }
+
+    uint8_t readByte() override
+    {
+        nowUs += 8 * 70;
+        if (state == READ_SCRATCHPAD && readPos < 9) {
+            return scratchpad[readPos++];
+        }
+        return 0xFF;    // Nobody pulls the bus low
+    }
+
+    int readBit() override
+    {
+        nowUs += 70;
+        for (const Device &device : devices) {
+            if (nowUs < device.convertDoneUs) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+
+    void delayMs(int ms) override
+    {
+        nowUs += (int64_t)ms * 1000;
+    }
+
+private:
+    enum State { IDLE, ROM_COMMAND, MATCH_ROM, FUNCTION_COMMAND, READ_SCRATCHPAD };
+
+    State state = IDLE;
+    int selected = -1;
+    DS18B20RomId match;
+    int romPos = 0;
+    uint8_t scratchpad[9];
+    int readPos = 0;
+};
+
+
+static std::vector<DS18B20RomId> ds18b20TestRomIds(const SimulatedDS18B20Bus &_bus)
+{
+    std::vector<DS18B20RomId> romIds;
+    for (const SimulatedDS18B20Bus::Device &device : _bus.devices) {
+        romIds.push_back(device.rom);
+    }
+    return romIds;
+}
+
+
+/**
+ * @brief Six sensors share one conversion and are read in less than a second
+ */
+void test_ds18b20_parallel_conversion()
+{
+    SimulatedDS18B20Bus bus;
+    for (int i = 0; i < 6; i++) {
+        bus.addDevice(i + 1, 20.5f + i);
+    }
+
+    DS18B20BusReader reader(bus);
+    std::vector<float> temperatures;
+    std::vector<bool> valid;
+
+    TEST_ASSERT_EQUAL_INT(6, reader.read(ds18b20TestRomIds(bus), temperatures, valid));
+    TEST_ASSERT_EQUAL_INT(1, reader.getStats().conversions);
+    TEST_ASSERT_EQUAL_INT(6, reader.getStats().scratchpadReads);
+    TEST_ASSERT_EQUAL_INT(0, reader.getStats().crcErrors);
+    TEST_ASSERT_TRUE(bus.nowUs >= 750000);
+    TEST_ASSERT_TRUE(bus.nowUs < 1000000);
+
+    for (int i = 0; i < 6; i++) {
+        TEST_ASSERT_TRUE(valid[i]);
+        TEST_ASSERT_EQUAL_FLOAT(20.5f + i, temperatures[i]);
+    }
+}
+
+
+/**
+ * @brief A CRC error only re-reads the scratchpad of the failed sensor, without a new conversion
+ */
+void test_ds18b20_retry_failed_sensor()
+{
+    SimulatedDS18B20Bus bus;
+    for (int i = 0; i < 4; i++) {
+        bus.addDevice(i + 1, -5.0f + i);
+    }
+    bus.devices[2].crcErrors = 2;
+
+    DS18B20BusReader reader(bus);
+    std::vector<float> temperatures;
+    std::vector<bool> valid;
+
+    TEST_ASSERT_EQUAL_INT(4, reader.read(ds18b20TestRomIds(bus), temperatures, valid));
+    TEST_ASSERT_EQUAL_INT(1, reader.getStats().conversions);
+    TEST_ASSERT_EQUAL_INT(2, reader.getStats().crcErrors);
+    TEST_ASSERT_EQUAL_INT(6, reader.getStats().scratchpadReads);
+    TEST_ASSERT_EQUAL_INT(1, bus.devices[0].scratchpadReads);
+    TEST_ASSERT_EQUAL_INT(3, bus.devices[2].scratchpadReads);
+    TEST_ASSERT_EQUAL_FLOAT(-3.0f, temperatures[2]);
+
+    // A sensor which is gone stays invalid, its old value is kept
+    std::vector<DS18B20RomId> romIds = ds18b20TestRomIds(bus);
+    bus.devices.pop_back();
+    temperatures[3] = 42.0f;
+
+    TEST_ASSERT_EQUAL_INT(3, reader.read(romIds, temperatures, valid));
+    TEST_ASSERT_FALSE(valid[3]);
+    TEST_ASSERT_EQUAL_FLOAT(42.0f, temperatures[3]);
+    TEST_ASSERT_EQUAL_INT(1, reader.getStats().conversions);
+    TEST_ASSERT_EQUAL_INT(DS18B20BusReader::MAX_ATTEMPTS, reader.getStats().crcErrors);
+}
+
+
+/**
+ * @brief Sequential mode needs one conversion time per sensor
+ */
+void test_ds18b20_sequential_conversion()
+{
+    SimulatedDS18B20Bus bus;
+    for (int i = 0; i < 6; i++) {
+        bus.addDevice(i + 1, 20.5f + i);
+    }
+
+    DS18B20BusReader reader(bus);
+    std::vector<float> temperatures;
+    std::vector<bool> valid;
+
+    TEST_ASSERT_EQUAL_INT(6, reader.read(ds18b20TestRomIds(bus), temperatures, valid, false));
+    TEST_ASSERT_EQUAL_INT(6, reader.getStats().conversions);
+    TEST_ASSERT_TRUE(bus.nowUs >= 4500000);
+    TEST_ASSERT_EQUAL_FLOAT(25.5f, temperatures[5]);
+}
+
+
+void test_ds18b20_bus_reader()
+{
+    test_ds18b20_parallel_conversion();
+    test_ds18b20_retry_failed_sensor();
+    test_ds18b20_sequential_conversion();
+}
@@ -0,0 +1,119 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "sensor_history.h"
+
+
+/**
+ * @brief The ring keeps the newest samples, oldest first
+ */
+void test_sensor_history_ring()
+{
+    SensorHistory history(4);
+
+    for (int i = 0; i < 6; i++) {
+        history.add("temperature", 1000 + i * 10, 20.0f + i);
+    }
+
+    std::vector<SensorSample> samples = history.getSamples("temperature");
+    TEST_ASSERT_EQUAL_INT(4, samples.size());
+    TEST_ASSERT_EQUAL_INT(1020, samples[0].time);
+    TEST_ASSERT_EQUAL_FLOAT(22.0f, samples[0].value);
+    TEST_ASSERT_EQUAL_INT(1050, samples[3].time);
+    TEST_ASSERT_EQUAL_FLOAT(25.0f, samples[3].value);
+
+    // Only the last samples
+    samples = history.getSamples("temperature", 1040);
+    TEST_ASSERT_EQUAL_INT(2, samples.size());
+    TEST_ASSERT_EQUAL_INT(1040, samples[0].time);
+
+    // Unknown series
+    TEST_ASSERT_EQUAL_INT(0, history.getSamples("humidity").size());
+    TEST_ASSERT_EQUAL_INT(1, history.getSeriesNames().size());
+}
+
+
+/**
+ * @brief Aggregates per series, published once the window is over
+ */
+void test_sensor_history_window()
+{
+    SensorHistory history;
+    history.setWindow(60);
+
+    history.add("temperature", 1000, 21.0f);
+    history.add("humidity", 1000, 50.0f);
+    history.add("temperature", 1030, 23.0f);
+    history.add("humidity", 1030, 40.0f);
+    TEST_ASSERT_FALSE(history.isWindowComplete(1030));
+
+    history.add("temperature", 1060, 22.0f);
+    history.add("humidity", 1060, 45.0f);
+    TEST_ASSERT_TRUE(history.isWindowComplete(1060));
+
+    SensorWindow window = history.takeWindow(1060);
+    TEST_ASSERT_EQUAL_INT(1000, window.start);
+    TEST_ASSERT_EQUAL_INT(1060, window.end);
+    TEST_ASSERT_EQUAL_INT(2, window.series.size());
+
+    const SensorAggregate &temperature = window.series[0];
+    TEST_ASSERT_EQUAL_STRING("temperature", temperature.name.c_str());
+    TEST_ASSERT_EQUAL_INT(3, temperature.count);
+    TEST_ASSERT_EQUAL_FLOAT(21.0f, temperature.min);
+    TEST_ASSERT_EQUAL_FLOAT(23.0f, temperature.max);
+    TEST_ASSERT_EQUAL_FLOAT(22.0f, temperature.getMean());
+    TEST_ASSERT_EQUAL_FLOAT(22.0f, temperature.last);
+
+    const SensorAggregate &humidity = window.series[1];
+    TEST_ASSERT_EQUAL_FLOAT(40.0f, humidity.min);
+    TEST_ASSERT_EQUAL_FLOAT(50.0f, humidity.max);
+    TEST_ASSERT_EQUAL_FLOAT(45.0f, humidity.last);
+
+    // The next window starts with the next reading, the raw samples stay
+    TEST_ASSERT_FALSE(history.isWindowComplete(1090));
+    history.add("temperature", 1090, 19.0f);
+    TEST_ASSERT_FALSE(history.isWindowComplete(1090));
+    TEST_ASSERT_EQUAL_INT(4, history.getSamples("temperature").size());
+
+    // Series without readings in this window are left out
+    window = history.takeWindow(1150);
+    TEST_ASSERT_EQUAL_INT(1, window.series.size());
+    TEST_ASSERT_EQUAL_INT(1, window.series[0].count);
+    TEST_ASSERT_EQUAL_FLOAT(19.0f, window.series[0].min);
+}
+
+
+/**
+ * @brief No window without aggregation, a clock jumping back (NTP sync) ends the window
+ */
+void test_sensor_history_window_edge_cases()
+{
+    SensorHistory history;
+    history.add("temperature", 1000, 21.0f);
+    TEST_ASSERT_FALSE(history.isWindowComplete(100000));
+
+    history.setWindow(-5);
+    TEST_ASSERT_EQUAL_INT(0, history.getWindow());
+
+    history.setWindow(300);
+    history.add("temperature", 1010, 21.5f);
+    TEST_ASSERT_FALSE(history.isWindowComplete(1010));
+    TEST_ASSERT_TRUE(history.isWindowComplete(20));
+
+    // Capacity 0 only aggregates
+    SensorHistory aggregateOnly(0);
+    aggregateOnly.setWindow(10);
+    aggregateOnly.add("temperature", 1000, 21.0f);
+    aggregateOnly.add("temperature", 1010, 22.0f);
+    TEST_ASSERT_EQUAL_INT(0, aggregateOnly.getSamples("temperature").size());
+    TEST_ASSERT_TRUE(aggregateOnly.isWindowComplete(1010));
+    TEST_ASSERT_EQUAL_INT(2, aggregateOnly.takeWindow(1010).series[0].count);
+}
+
+
+void test_sensor_history()
+{
+    test_sensor_history_ring();
+    test_sensor_history_window();
+    test_sensor_history_window_edge_cases();
+}
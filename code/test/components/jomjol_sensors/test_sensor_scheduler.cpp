@@ -0,0 +1,183 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "sensor_scheduler.h"
+
+
+/**
+ * @brief Sensor with a fixed conversion time, polled like the DS18B20
+ */
+class SimulatedScheduledSensor : public ScheduledSensor {
+public:
+    int64_t &nowMs;
+    int conversionMs;
+    int pollMs;
+    int failures = 0;           // Next measurements which fail
+    int64_t convertDoneMs = 0;
+    std::vector<int64_t> started;
+    std::vector<int64_t> finished;
+    int published = 0;
+
+    SimulatedScheduledSensor(int64_t &_nowMs, int _conversionMs, int _pollMs)
+        : nowMs(_nowMs), conversionMs(_conversionMs), pollMs(_pollMs) {}
+
+    int startMeasurement() override
+    {
+        started.push_back(nowMs);
+        convertDoneMs = nowMs + conversionMs;
+        return pollMs;
+    }
+
+    int continueMeasurement() override
+    {
+        if (nowMs < convertDoneMs) {
+            return pollMs;
+        }
+        if (failures > 0) {
+            failures--;
+            return STEP_FAILED;
+        }
+        return STEP_DONE;
+    }
+
+    void finishMeasurement(bool success) override
+    {
+        finished.push_back(nowMs);
+        if (success) {
+            published++;
+        }
+    }
+};
+
+
+/**
+ * @brief Runs the scheduler like its task: sleep until the next step is due
+ */
+static void runSensorScheduler(SensorScheduler &_scheduler, int64_t &_nowMs, int64_t _untilMs, int &_wakeups)
+{
+    while (_nowMs <= _untilMs) {
+        int64_t waitMs = _scheduler.run(_nowMs);
+        _wakeups++;
+        if (waitMs == SensorScheduler::NOTHING_DUE) {
+            break;
+        }
+        _nowMs += (waitMs > 0) ? waitMs : 1;
+    }
+}
+
+
+/**
+ * @brief Sensors with different intervals overlap, the interval counts from the end of a read
+ */
+void test_sensor_scheduler_intervals()
+{
+    int64_t nowMs = 0;
+    SimulatedScheduledSensor ds18b20(nowMs, 750, 10);
+    SimulatedScheduledSensor sht3x(nowMs, 15, 5);
+
+    SensorScheduler scheduler;
+    scheduler.add(&ds18b20, 5000, 5000);
+    scheduler.add(&sht3x, 1000, 1000);
+    TEST_ASSERT_EQUAL_INT(2, scheduler.getJobCount());
+
+    int wakeups = 0;
+    runSensorScheduler(scheduler, nowMs, 12000, wakeups);
+
+    // DS18B20: 5000 → 5750, 10750 → 11500
+    TEST_ASSERT_EQUAL_INT(2, ds18b20.started.size());
+    TEST_ASSERT_EQUAL_INT(5000, ds18b20.started[0]);
+    TEST_ASSERT_EQUAL_INT(5750, ds18b20.finished[0]);
+    TEST_ASSERT_EQUAL_INT(10750, ds18b20.started[1]);
+
+    // SHT3x: 1000 → 1015, 2015 → 2030, ...
+    TEST_ASSERT_EQUAL_INT(11, sht3x.started.size());
+    TEST_ASSERT_EQUAL_INT(1000, sht3x.started[0]);
+    TEST_ASSERT_EQUAL_INT(1015, sht3x.finished[0]);
+    TEST_ASSERT_EQUAL_INT(2015, sht3x.started[1]);
+
+    // The SHT3x is read while the DS18B20 converts
+    TEST_ASSERT_EQUAL_INT(5060, sht3x.started[4]);
+    TEST_ASSERT_TRUE(sht3x.finished[4] < ds18b20.finished[0]);
+
+    TEST_ASSERT_EQUAL_INT(13, scheduler.getStats().measurements);
+    TEST_ASSERT_EQUAL_INT(0, scheduler.getStats().failures);
+
+    // Only woken for steps: 76 per DS18B20 read, 4 per SHT3x read
+    TEST_ASSERT_TRUE(wakeups < 2 * 76 + 11 * 4 + 10);
+}
+
+
+/**
+ * @brief "Follow flow" sensors only read on request, a request during a read is ignored
+ */
+void test_sensor_scheduler_request()
+{
+    int64_t nowMs = 1000;
+    SimulatedScheduledSensor sensor(nowMs, 750, 10);
+
+    SensorScheduler scheduler;
+    scheduler.add(&sensor, 0, SensorScheduler::NOTHING_DUE);
+    TEST_ASSERT_EQUAL_INT(SensorScheduler::NOTHING_DUE, scheduler.run(nowMs));
+    TEST_ASSERT_FALSE(scheduler.isMeasuring(&sensor));
+
+    scheduler.requestRead(&sensor);
+    TEST_ASSERT_EQUAL_INT(10, scheduler.run(nowMs));
+    TEST_ASSERT_TRUE(scheduler.isMeasuring(&sensor));
+
+    nowMs += 100;
+    scheduler.requestRead(&sensor);
+    int wakeups = 0;
+    runSensorScheduler(scheduler, nowMs, 5000, wakeups);
+
+    TEST_ASSERT_EQUAL_INT(1, sensor.started.size());
+    TEST_ASSERT_EQUAL_INT(1, sensor.published);
+    TEST_ASSERT_FALSE(scheduler.isMeasuring(&sensor));
+
+    // A failed read is reported, the next request reads again
+    sensor.failures = 1;
+    scheduler.requestRead(&sensor);
+    runSensorScheduler(scheduler, nowMs, 10000, wakeups);
+    TEST_ASSERT_EQUAL_INT(2, sensor.finished.size());
+    TEST_ASSERT_EQUAL_INT(1, sensor.published);
+    TEST_ASSERT_EQUAL_INT(1, scheduler.getStats().failures);
+}
+
+
+/**
+ * @brief Dozens of sensors due at the same time are all served by one run()
+ */
+void test_sensor_scheduler_many_sensors()
+{
+    int64_t nowMs = 100;
+    std::vector<SimulatedScheduledSensor*> sensors;
+    SensorScheduler scheduler;
+
+    for (int i = 0; i < 40; i++) {
+        sensors.push_back(new SimulatedScheduledSensor(nowMs, 0, 0));
+        scheduler.add(sensors.back(), 1000 * (i % 4 + 1), 100);
+    }
+
+    TEST_ASSERT_EQUAL_INT(1000, scheduler.run(nowMs));
+    for (SimulatedScheduledSensor *sensor : sensors) {
+        TEST_ASSERT_EQUAL_INT(1, sensor->published);
+    }
+
+    int wakeups = 0;
+    runSensorScheduler(scheduler, nowMs, 4100, wakeups);
+    TEST_ASSERT_EQUAL_INT(5, sensors[0]->published);
+    TEST_ASSERT_EQUAL_INT(2, sensors[3]->published);
+
+    scheduler.clear();
+    TEST_ASSERT_EQUAL_INT(0, scheduler.getJobCount());
+    for (SimulatedScheduledSensor *sensor : sensors) {
+        delete sensor;
+    }
+}
+
+
+void test_sensor_scheduler()
+{
+    test_sensor_scheduler_intervals();
+    test_sensor_scheduler_request();
+    test_sensor_scheduler_many_sensors();
+}
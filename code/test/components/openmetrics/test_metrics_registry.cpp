@@ -0,0 +1,99 @@
+#include <unity.h>
+#include <metrics_registry.h>
+
+static bool appendChunk(void *_context, const char *_data, size_t _len)
+{
+    ((std::string *)_context)->append(_data, _len);
+    return true;
+}
+
+static std::string renderRegistry(MetricsRegistry &_registry)
+{
+    std::string result;
+    char buffer[16];        // Smaller than a line -> every line gets split over several chunks
+
+    MetricsWriter writer(buffer, sizeof(buffer), appendChunk, &result);
+    _registry.render(writer, "dev");
+    TEST_ASSERT_TRUE(writer.finish());
+    return result;
+}
+
+
+void test_metrics_counter_gauge()
+{
+    MetricsRegistry registry;
+
+    int rounds = registry.addSeries(registry.addFamily("rounds_total", "rounds", METRIC_COUNTER));
+    int rssi = registry.addSeries(registry.addFamily("rssi_dbm", "signal", METRIC_GAUGE));
+
+    // A gauge without value is not exposed, a counter starts at 0
+    TEST_ASSERT_EQUAL_STRING("# HELP dev_rounds_total rounds\n# TYPE dev_rounds_total counter\ndev_rounds_total 0\n",
+                             renderRegistry(registry).c_str());
+
+    registry.inc(rounds);
+    registry.inc(rounds, 2);
+    registry.set(rssi, -67);
+    TEST_ASSERT_EQUAL_STRING("# HELP dev_rounds_total rounds\n# TYPE dev_rounds_total counter\ndev_rounds_total 3\n"
+                             "# HELP dev_rssi_dbm signal\n# TYPE dev_rssi_dbm gauge\ndev_rssi_dbm -67\n",
+                             renderRegistry(registry).c_str());
+
+    registry.set(rssi, 0.125);
+    registry.unset(rounds);
+    TEST_ASSERT_EQUAL_STRING("# HELP dev_rssi_dbm signal\n# TYPE dev_rssi_dbm gauge\ndev_rssi_dbm 0.125\n",
+                             renderRegistry(registry).c_str());
+}
+
+
+void test_metrics_labels()
+{
+    MetricsRegistry registry;
+
+    int family = registry.addFamily("roi_nan_total", "nan", METRIC_COUNTER);
+    TEST_ASSERT_EQUAL(family, registry.addFamily("roi_nan_total", "other help", METRIC_COUNTER));
+    TEST_ASSERT_EQUAL(-1, registry.addSeries(family + 1, "roi=\"dig1\""));
+
+    int dig1 = registry.addSeries(family, metricsLabel("sequence", "main") + "," + metricsLabel("roi", "dig1"));
+    int dig2 = registry.addSeries(family, metricsLabel("sequence", "ma\"in\\\n") + "," + metricsLabel("roi", "dig2"));
+
+    // Registering the same labels again returns the same series (e.g. after a new init of the flow)
+    TEST_ASSERT_EQUAL(dig1, registry.addSeries(family, "sequence=\"main\",roi=\"dig1\""));
+    TEST_ASSERT_NOT_EQUAL(dig1, dig2);
+
+    registry.inc(dig2);
+    TEST_ASSERT_EQUAL_STRING("# HELP dev_roi_nan_total nan\n# TYPE dev_roi_nan_total counter\n"
+                             "dev_roi_nan_total{sequence=\"main\",roi=\"dig1\"} 0\n"
+                             "dev_roi_nan_total{sequence=\"main\",roi=\"dig2\"} 1\n",
+                             renderRegistry(registry).c_str());
+}
+
+
+void test_metrics_histogram()
+{
+    MetricsRegistry registry;
+    const double buckets[] = {0.5, 1, 2.5};
+
+    int family = registry.addFamily("step_seconds", "step", METRIC_HISTOGRAM, buckets, 3);
+    int step = registry.addSeries(family, "step=\"Digit\"");
+
+    registry.observe(step, 0.25);
+    registry.observe(step, 0.5);
+    registry.observe(step, 2);
+    registry.observe(step, 10);
+
+    TEST_ASSERT_EQUAL_STRING("# HELP dev_step_seconds step\n# TYPE dev_step_seconds histogram\n"
+                             "dev_step_seconds_bucket{step=\"Digit\",le=\"0.5\"} 2\n"
+                             "dev_step_seconds_bucket{step=\"Digit\",le=\"1\"} 2\n"
+                             "dev_step_seconds_bucket{step=\"Digit\",le=\"2.5\"} 3\n"
+                             "dev_step_seconds_bucket{step=\"Digit\",le=\"+Inf\"} 4\n"
+                             "dev_step_seconds_sum{step=\"Digit\"} 12.75\n"
+                             "dev_step_seconds_count{step=\"Digit\"} 4\n",
+                             renderRegistry(registry).c_str());
+}
+
+
+void test_metrics_registry()
+{
+    test_metrics_counter_gauge();
+    test_metrics_labels();
+    test_metrics_histogram();
+}
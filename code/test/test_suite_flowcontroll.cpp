@@ -21,7 +21,30 @@
 #include "components/jomjol-flowcontroll/test_getReadoutRawString.cpp"
 #include "components/jomjol-flowcontroll/test_cnnflowcontroll.cpp"
 #include "components/openmetrics/test_openmetrics.cpp"
+#include "components/openmetrics/test_metrics_registry.cpp"
 #include "components/jomjol_mqtt/test_server_mqtt.cpp"
+#include "components/jomjol_helper/test_parallel_for.cpp"
+#include "components/jomjol_configfile/test_configparser.cpp"
+#include "components/jomjol_influxdb/test_influxdb_batch.cpp"
+#include "components/jomjol_helper/test_publish_spool.cpp"
+#include "components/jomjol_helper/test_image_log_store.cpp"
+#include "components/jomjol_helper/test_http_client_pool.cpp"
+#include "components/jomjol_image_proc/test_jpeg_data.cpp"
+#include "components/jomjol_image_proc/test_jpeg_sink.cpp"
+#include "components/jomjol_image_proc/test_image_lock.cpp"
+#include "components/jomjol_fileserver_ota/test_zip_extract.cpp"
+#include "components/jomjol_fileserver_ota/test_ota_writer.cpp"
+#include "components/jomjol_fileserver_ota/test_file_stream.cpp"
+#include "components/jomjol_fileserver_ota/test_asset_cache.cpp"
+#include "components/jomjol_fileserver_ota/test_web_bundle.cpp"
+#include "components/jomjol_fileserver_ota/test_dir_listing.cpp"
+#include "components/jomjol_fileserver_ota/test_zip_stream.cpp"
+#include "components/jomjol_mqtt/test_mqtt_publish_cache.cpp"
+#include "components/jomjol_mqtt/test_mqtt_batch_payload.cpp"
+#include "components/jomjol_mqtt/test_mqtt_outbox.cpp"
+#include "components/jomjol_sensors/test_ds18b20_bus_reader.cpp"
+#include "components/jomjol_sensors/test_sensor_scheduler.cpp"
+#include "components/jomjol_sensors/test_sensor_history.cpp"
 
 bool Init_NVS_SDCard()
 {
@@ -169,7 +192,30 @@ extern "C" void app_main()
     // getReadoutRawString test
     RUN_TEST(test_getReadoutRawString);
     RUN_TEST(test_openmetrics);
+    RUN_TEST(test_metrics_registry);
     RUN_TEST(test_mqtt);
+    RUN_TEST(test_parallel_for);
+    RUN_TEST(test_configparser);
+    RUN_TEST(test_influxdb_batch);
+    RUN_TEST(test_publish_spool);
+    RUN_TEST(test_image_log_store);
+    RUN_TEST(test_http_client_pool);
+    RUN_TEST(test_jpeg_data);
+    RUN_TEST(test_jpeg_sink);
+    RUN_TEST(test_image_lock);
+    RUN_TEST(test_zip_extract);
+    RUN_TEST(test_ota_writer);
+    RUN_TEST(test_file_stream);
+    RUN_TEST(test_asset_cache);
+    RUN_TEST(test_web_bundle);
+    RUN_TEST(test_dir_listing);
+    RUN_TEST(test_zip_stream);
+    RUN_TEST(test_mqtt_publish_cache);
+    RUN_TEST(test_mqtt_batch_payload);
+    RUN_TEST(test_mqtt_outbox);
+    RUN_TEST(test_ds18b20_bus_reader);
+    RUN_TEST(test_sensor_scheduler);
+    RUN_TEST(test_sensor_history);
   
   UNITY_END();
 }
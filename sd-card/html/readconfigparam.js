@@ -101,6 +101,7 @@ function ParseConfig() {
     param[catname] = new Object();
     ParamAddValue(param, catname, "RawImagesLocation");
     ParamAddValue(param, catname, "RawImagesRetention");
+    ParamAddValue(param, catname, "RawImagesFormat");
     ParamAddValue(param, catname, "WaitBeforeTakingPicture");
     ParamAddValue(param, catname, "CamGainceiling");		// Image gain (GAINCEILING_x2, x4, x8, x16, x32, x64 or x128)
     ParamAddValue(param, catname, "CamQuality");    		// 0 - 63
@@ -153,6 +154,7 @@ function ParseConfig() {
     ParamAddValue(param, catname, "CNNGoodThreshold", 1);
     ParamAddValue(param, catname, "ROIImagesLocation");
     ParamAddValue(param, catname, "ROIImagesRetention");
+    ParamAddValue(param, catname, "ROIImagesFormat");
 
     var catname = "Analog";
     category[catname] = new Object();
@@ -162,6 +164,7 @@ function ParseConfig() {
     ParamAddValue(param, catname, "Model");
     ParamAddValue(param, catname, "ROIImagesLocation");
     ParamAddValue(param, catname, "ROIImagesRetention");
+    ParamAddValue(param, catname, "ROIImagesFormat");
 
     var catname = "PostProcessing";
     category[catname] = new Object();
@@ -194,6 +197,9 @@ function ParseConfig() {
     ParamAddValue(param, catname, "user");
     ParamAddValue(param, catname, "password");
     ParamAddValue(param, catname, "RetainMessages");
+    ParamAddValue(param, catname, "PublishOnChange");
+    ParamAddValue(param, catname, "PublishHeartbeat");
+    ParamAddValue(param, catname, "BatchPublishing");
     ParamAddValue(param, catname, "DomoticzTopicIn");
     ParamAddValue(param, catname, "DomoticzIDX", 1, true);
     ParamAddValue(param, catname, "HomeassistantDiscovery");
@@ -245,6 +251,7 @@ function ParseConfig() {
     param[catname] = new Object();
     ParamAddValue(param, catname, "Address");
     ParamAddValue(param, catname, "Interval");
+    ParamAddValue(param, catname, "AggregationWindow");
     ParamAddValue(param, catname, "I2C_Frequency");
     ParamAddValue(param, catname, "MQTT_Enable");
     ParamAddValue(param, catname, "MQTT_Topic");
@@ -253,6 +260,7 @@ function ParseConfig() {
     // Default values for SHT3x sensor
     param[catname]["Address"]["value1"] = "0x44";
     param[catname]["Interval"]["value1"] = "-1";
+    param[catname]["AggregationWindow"]["value1"] = "0";
     param[catname]["I2C_Frequency"]["value1"] = "100000";
     param[catname]["MQTT_Enable"]["value1"] = "true";
     param[catname]["MQTT_Topic"]["value1"] = "sensors/climate";
@@ -265,14 +273,18 @@ function ParseConfig() {
     category[catname]["found"] = false;
     param[catname] = new Object();
     ParamAddValue(param, catname, "ExpectedSensors");
+    ParamAddValue(param, catname, "ParallelConversion");
     ParamAddValue(param, catname, "Interval");
+    ParamAddValue(param, catname, "AggregationWindow");
     ParamAddValue(param, catname, "MQTT_Enable");
     ParamAddValue(param, catname, "MQTT_Topic");
     ParamAddValue(param, catname, "InfluxDB_Enable");
     ParamAddValue(param, catname, "InfluxDB_Measurement");
     // Default values for DS18B20 sensor
     param[catname]["ExpectedSensors"]["value1"] = "-1";
+    param[catname]["ParallelConversion"]["value1"] = "true";
     param[catname]["Interval"]["value1"] = "-1";
+    param[catname]["AggregationWindow"]["value1"] = "0";
     param[catname]["MQTT_Enable"]["value1"] = "true";
     param[catname]["MQTT_Topic"]["value1"] = "sensors/temperature";
     param[catname]["InfluxDB_Enable"]["value1"] = "false";
@@ -306,6 +318,9 @@ function ParseConfig() {
     param[catname] = new Object();
     //ParamAddValue(param, catname, "AutoStart");
     ParamAddValue(param, catname, "Interval");     
+    ParamAddValue(param, catname, "AlignToClock");
+    ParamAddValue(param, catname, "OverrunPolicy");
+    ParamAddValue(param, catname, "PipelinedPublishing");
 
     var catname = "DataLogging";
     category[catname] = new Object();
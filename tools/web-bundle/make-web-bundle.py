@@ -0,0 +1,124 @@
+"""
+Compiles the web UI files listed in web-bundle.txt into a C++ source file (gzip compressed data and a perfect
+hash index over the paths), see code/components/jomjol_fileserver_ota/web_bundle.h.
+
+Called by the build (code/components/jomjol_fileserver_ota/CMakeLists.txt), it can also be run by hand:
+    python make-web-bundle.py --html ../../sd-card/html --list web-bundle.txt --out web_bundle_data.cpp
+"""
+import argparse
+import gzip
+import hashlib
+import os
+import subprocess
+import zlib
+
+
+FNV_OFFSET = 0x811c9dc5
+FNV_PRIME = 0x01000193
+
+
+def webBundleHash(path, seed):
+    """ Has to match web_bundle_hash() in web_bundle.cpp """
+    h = FNV_OFFSET ^ seed
+    for c in path.encode("utf-8"):
+        h ^= c
+        h = (h * FNV_PRIME) & 0xffffffff
+    return h ^ (h >> 16)                # The low bits of FNV-1a do not depend on the high bits of the seed
+
+
+def findSeed(paths, slotCount):
+    for seed in range(1000000):
+        slots = set(webBundleHash(path, seed) % slotCount for path in paths)
+        if len(slots) == len(paths):
+            return seed
+    raise RuntimeError("No perfect hash found for " + str(len(paths)) + " files")
+
+
+def getCommitHash(htmlFolder):
+    """ Same replacement as the release build does for the files on the SD card """
+    try:
+        return subprocess.check_output(["git", "rev-parse", "--short", "HEAD"], cwd=htmlFolder,
+                                       stderr=subprocess.DEVNULL).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def readList(listFile):
+    paths = []
+    with open(listFile, "r") as listFileHandle:
+        for line in listFileHandle:
+            line = line.strip()
+            if line and not line.startswith("#"):
+                paths.append(line)
+    return paths
+
+
+def cArray(data):
+    lines = []
+    for i in range(0, len(data), 20):
+        lines.append("    " + "".join("0x%02x," % b for b in data[i:i + 20]))
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile web UI files into the firmware")
+    parser.add_argument("--html", required=True, help="Folder with the web UI (sd-card/html)")
+    parser.add_argument("--list", required=True, help="Files to include, one per line")
+    parser.add_argument("--out", required=True, help="Generated C++ file")
+    args = parser.parse_args()
+
+    paths = readList(args.list)
+    commitHash = getCommitHash(args.html)
+
+    slotCount = 1
+    while slotCount < 2 * len(paths):
+        slotCount *= 2
+    seed = findSeed(paths, slotCount)
+
+    source = []
+    source.append("// Generated by tools/web-bundle/make-web-bundle.py from " + os.path.basename(args.list) + ", do not edit!")
+    source.append("#include \"web_bundle.h\"")
+    source.append("")
+
+    assets = []
+    totalSize = 0
+    for i, path in enumerate(paths):
+        with open(os.path.join(args.html, path), "rb") as fileHandle:
+            content = fileHandle.read()
+        if commitHash:
+            content = content.replace(b"$COMMIT_HASH", commitHash.encode())
+
+        compressed = gzip.compress(content, compresslevel=9, mtime=0)
+        totalSize += len(compressed)
+        etag = "\\\"" + hashlib.md5(compressed).hexdigest()[:16] + "\\\""
+
+        source.append("static const uint8_t web_bundle_data_%d[] = {" % i)
+        source.append(cArray(compressed))
+        source.append("};")
+        source.append("")
+        assets.append("    { \"%s\", web_bundle_data_%d, %d, %d, 0x%08x, \"%s\" },"
+                      % (path, i, len(compressed), len(content), zlib.crc32(content) & 0xffffffff, etag))
+
+    slots = [0] * slotCount
+    for i, path in enumerate(paths):
+        slots[webBundleHash(path, seed) % slotCount] = i + 1
+
+    if assets:
+        source.append("static const WebBundleAsset web_bundle_assets[] = {")
+        source.extend(assets)
+        source.append("};")
+        source.append("")
+    source.append("static const uint16_t web_bundle_slots[] = { " + ", ".join(str(s) for s in slots) + " };")
+    source.append("")
+    source.append("const WebBundleIndex webBundleIndex = { %s, %d, web_bundle_slots, %d, %d };"
+                  % ("web_bundle_assets" if assets else "NULL", len(paths), slotCount, seed))
+    source.append("")
+
+    with open(args.out, "w") as outHandle:
+        outHandle.write("\n".join(source))
+
+    print("Web bundle: %d files, %d bytes" % (len(paths), totalSize))
+
+
+if __name__ == "__main__":
+    main()